@@ -0,0 +1,151 @@
+/// @file
+/// @brief Multi-threaded client benchmarks
+/// @details
+/// Measures the throughput of many threads of a single process
+/// sending commands, either all through the global client, whose
+/// replies are matched to their commands by request id, or each
+/// through it's own connection.
+///
+/// Workers reply to every message without executing it, so only
+/// the cost of the client and the socket is measured.
+
+// Imports
+#include <pthread.h>		 // pthread_create, pthread_join
+#include <stdio.h>			 // snprintf, fprintf, stderr
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			 // memcpy
+#include <sys/socket.h>		 // socket, bind, shutdown
+#include <tfs/bench/bench.h> // TfsBench, tfs_bench_run
+#include <tfs/client-api.h>	 // tfsMount, tfsLookup, TfsClientServerConnection
+#include <tfs/protocol.h>	 // TFS_PROTOCOL_HEADER_LEN, tfs_protocol_is_framed
+#include <unistd.h>			 // getpid, unlink, close
+
+/// @brief Maximum number of client threads
+#define MAX_CLIENTS 64
+
+/// @brief Number of server workers
+#define WORKERS 4
+
+/// @brief Data for all benchmarks
+typedef struct ClientData {
+	/// @brief Connection of each thread
+	TfsClientServerConnection connections[MAX_CLIENTS];
+
+	/// @brief Command sent by all threads
+	TfsCommand command;
+
+	/// @brief Path looked up by all threads
+	char* path;
+} ClientData;
+
+static void* worker_thread_fn(void* arg) {
+	int server_socket = *(int*)arg;
+
+	// Note: We stop once the socket is shut down
+	while (1) {
+		char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+		struct sockaddr_un address;
+		socklen_t address_len = sizeof(address);
+		ssize_t message_len =
+			recvfrom(server_socket, message, sizeof(message), 0, (struct sockaddr*)&address, &address_len);
+		if (message_len <= 0) { break; }
+
+		// Reply with success, echoing the header of framed messages
+		char reply[TFS_PROTOCOL_HEADER_LEN + 1];
+		size_t reply_len = 0;
+		if (tfs_protocol_is_framed(message, (size_t)message_len) && message_len >= TFS_PROTOCOL_HEADER_LEN) {
+			memcpy(reply, message, TFS_PROTOCOL_HEADER_LEN);
+			reply_len = TFS_PROTOCOL_HEADER_LEN;
+		}
+		reply[reply_len++] = '\1';
+		sendto(server_socket, reply, reply_len, 0, (struct sockaddr*)&address, address_len);
+	}
+
+	return NULL;
+}
+
+static void lookup_shared(void* data, size_t thread_idx, size_t iters) {
+	ClientData* client_data = data;
+	(void)thread_idx;
+	for (size_t n = 0; n < iters; n++) {
+		if (tfsLookup(client_data->path) != 0) {
+			fprintf(stderr, "Unable to send command\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void lookup_per_thread(void* data, size_t thread_idx, size_t iters) {
+	ClientData* client_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		TfsClientServerConnectionSendCommandResult result =
+			tfs_client_server_connection_send_command(&client_data->connections[thread_idx], &client_data->command);
+		if (!result.success) {
+			fprintf(stderr, "Unable to send command\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	char server_path[108];
+	snprintf(server_path, sizeof(server_path), "/tmp/tfs-bench-client-%d", getpid());
+
+	// Start the server
+	int server_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+	struct sockaddr_un address;
+	bzero(&address, sizeof(address));
+	address.sun_family = AF_UNIX;
+	snprintf(address.sun_path, sizeof(address.sun_path), "%s", server_path);
+	unlink(server_path);
+	if (server_socket < 0 || bind(server_socket, (struct sockaddr*)&address, (socklen_t)SUN_LEN(&address)) < 0) {
+		fprintf(stderr, "Unable to create server socket '%s'\n", server_path);
+		return EXIT_FAILURE;
+	}
+	pthread_t workers[WORKERS];
+	for (size_t n = 0; n < WORKERS; n++) { pthread_create(&workers[n], NULL, worker_thread_fn, &server_socket); }
+
+	// Connect all clients
+	char path[] = "/a";
+	ClientData data = {
+		.command = {.kind = TfsCommandSearch, .data.search.path = {.chars = path, .len = sizeof(path) - 1}},
+		.path = path,
+	};
+	for (size_t n = 0; n < MAX_CLIENTS; n++) {
+		TfsClientServerConnectionNewResult result = tfs_client_server_connection_new(server_path);
+		if (!result.success) {
+			fprintf(stderr, "Unable to connect client #%zu\n", n);
+			tfs_client_server_connection_new_error_print(&result.data.err, stderr);
+			return EXIT_FAILURE;
+		}
+		data.connections[n] = result.data.connection;
+	}
+	if (tfsMount(server_path) != 0) { return EXIT_FAILURE; }
+
+	for (size_t clients = 1; clients <= MAX_CLIENTS; clients *= 4) {
+		TfsBench benches[] = {
+			{.name = "shared", .fn = lookup_shared},
+			{.name = "per_thread", .fn = lookup_per_thread},
+		};
+		for (size_t n = 0; n < sizeof(benches) / sizeof(benches[0]); n++) {
+			benches[n].suite = "client";
+			benches[n].param = clients;
+			benches[n].threads = clients;
+			benches[n].iters = 20000 / clients;
+			benches[n].data = &data;
+			tfs_bench_run(&benches[n], &config);
+		}
+	}
+
+	// Stop the server
+	tfsUnmount();
+	for (size_t n = 0; n < MAX_CLIENTS; n++) { tfs_client_server_connection_destroy(&data.connections[n]); }
+	shutdown(server_socket, SHUT_RDWR);
+	for (size_t n = 0; n < WORKERS; n++) { pthread_join(workers[n], NULL); }
+	close(server_socket);
+	unlink(server_path);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/// @file
+/// @brief `TfsInodeDir` benchmarks
+
+// Imports
+#include <assert.h>			 // assert
+#include <stdio.h>			 // snprintf, fprintf, stderr
+#include <stdlib.h>			 // size_t, malloc, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			 // strlen
+#include <tfs/bench/bench.h> // TfsBench, tfs_bench_run
+#include <tfs/inode/dir.h>	 // TfsInodeDir
+
+/// @brief Number of names searched for in a round-robin fashion
+#define TARGETS_LEN 64
+
+/// @brief Data for all directory benchmarks
+typedef struct DirData {
+	/// @brief The directory
+	TfsInodeDir dir;
+
+	/// @brief Names of existing entries, spread throughout the directory
+	char targets[TARGETS_LEN][32];
+
+	/// @brief Directory index of the first empty entry, after the directory is filled.
+	TfsInodeDirIdx empty_idx;
+} DirData;
+
+static void search_hit(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	DirData* dir_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		const char* name = dir_data->targets[n % TARGETS_LEN];
+		TfsInodeDirSearchByNameResult result = tfs_inode_dir_search_by_name(&dir_data->dir, name, strlen(name));
+		tfs_bench_do_not_optimize(&result);
+	}
+}
+
+static void search_miss(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	DirData* dir_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		TfsInodeDirSearchByNameResult result = tfs_inode_dir_search_by_name(&dir_data->dir, "missing", 7);
+		tfs_bench_do_not_optimize(&result);
+	}
+}
+
+static void add_remove(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	DirData* dir_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		// Note: The new entry is always added to the first empty entry, which we know.
+		TfsInodeDirAddEntryResult result = tfs_inode_dir_add_entry(&dir_data->dir, (TfsInodeIdx){.idx = 0}, "new", 3);
+		tfs_bench_do_not_optimize(&result);
+		tfs_inode_dir_remove_entry_by_dir_idx(&dir_data->dir, dir_data->empty_idx);
+	}
+}
+
+static void rename_entry(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	DirData* dir_data = data;
+
+	// Note: We rename the first entry, as `rename` checks every entry for duplicates anyway.
+	TfsInodeIdx idx = dir_data->dir.entries[0].inode_idx;
+	for (size_t n = 0; n < iters; n++) {
+		const char* name = n % 2 == 0 ? "renamed" : "entry0";
+		TfsInodeDirRenameResult result = tfs_inode_dir_rename(&dir_data->dir, idx, name, strlen(name));
+		tfs_bench_do_not_optimize(&result);
+	}
+}
+
+/// @brief Creates a directory with @p len entries
+/// @details
+/// The entries are written directly, as adding them one by one
+/// would take quadratic time on the larger directories.
+static void build_dir(DirData* data, size_t len) {
+	data->dir = tfs_inode_dir_new();
+	data->dir.entries = malloc(len * sizeof(TfsInodeDirEntry));
+	if (data->dir.entries == NULL) {
+		fprintf(stderr, "Unable to allocate directory with %zu entries\n", len);
+		exit(EXIT_FAILURE);
+	}
+	data->dir.capacity = len;
+
+	for (size_t n = 0; n < len; n++) {
+		char name[32];
+		int name_len = snprintf(name, sizeof(name), "entry%zu", n);
+		data->dir.entries[n] = tfs_inode_dir_entry_new((TfsInodeIdx){.idx = n + 1}, name, (size_t)name_len);
+	}
+
+	// Spread the targets evenly
+	for (size_t n = 0; n < TARGETS_LEN; n++) {
+		snprintf(data->targets[n], sizeof(data->targets[n]), "entry%zu", (n * len) / TARGETS_LEN);
+	}
+
+	// Add an entry to grow the directory and find the first empty entry, then remove it again.
+	TfsInodeDirAddEntryResult add_result = tfs_inode_dir_add_entry(&data->dir, (TfsInodeIdx){.idx = 0}, "new", 3);
+	assert(add_result.success);
+	TfsInodeDirSearchByNameResult search_result = tfs_inode_dir_search_by_name(&data->dir, "new", 3);
+	assert(search_result.success);
+	data->empty_idx = search_result.data.success.dir_idx;
+	tfs_inode_dir_remove_entry_by_dir_idx(&data->dir, data->empty_idx);
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	const size_t sizes[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+	for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		DirData* data = malloc(sizeof(DirData));
+		if (data == NULL) {
+			fprintf(stderr, "Unable to allocate directory data\n");
+			return EXIT_FAILURE;
+		}
+		build_dir(data, sizes[n]);
+
+		// Note: Every operation is linear on the directory size, so we scale
+		//       down the iterations to keep each repetition's time bounded.
+		size_t iters = 1000000 / sizes[n] < 8 ? 8 : 1000000 / sizes[n];
+
+		// clang-format off
+		TfsBench benches[] = {
+			{.name = "search_hit" , .fn = search_hit  },
+			{.name = "search_miss", .fn = search_miss },
+			{.name = "add_remove" , .fn = add_remove  },
+			{.name = "rename"     , .fn = rename_entry},
+		};
+		// clang-format on
+
+		for (size_t m = 0; m < sizeof(benches) / sizeof(benches[0]); m++) {
+			benches[m].suite = "dir";
+			benches[m].param = sizes[n];
+			benches[m].threads = 1;
+			benches[m].iters = iters;
+			benches[m].data = data;
+			tfs_bench_run(&benches[m], &config);
+		}
+
+		tfs_inode_dir_destroy(&data->dir);
+		free(data);
+	}
+
+	return EXIT_SUCCESS;
+}
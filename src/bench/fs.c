@@ -0,0 +1,141 @@
+/// @file
+/// @brief `TfsFs` benchmarks
+
+// Imports
+#include <assert.h>			 // assert
+#include <stdio.h>			 // snprintf
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS
+#include <tfs/bench/bench.h> // TfsBench, tfs_bench_run
+#include <tfs/fs.h>			 // TfsFs
+#include <tfs/util.h>		 // tfs_min_size_t
+
+/// @brief Maximum number of threads
+/// @details
+/// Each thread needs a few inodes of it's own, so this keeps
+/// us within the file system's inode table.
+#define MAX_THREADS 32
+
+/// @brief Data for all file system benchmarks
+typedef struct FsData {
+	/// @brief The file system
+	TfsFs fs;
+} FsData;
+
+/// @brief Creates @p path, exiting on failure
+static void create(TfsFs* fs, const char* path, TfsInodeType type) {
+	TfsFsCreateResult result = tfs_fs_create(fs, tfs_path_from_cstr(path), type);
+	if (!result.success) {
+		fprintf(stderr, "Unable to create '%s'\n", path);
+		tfs_fs_create_error_print(&result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+	tfs_fs_unlock_inode(fs, result.data.idx);
+}
+
+static void find_shared(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	FsData* fs_data = data;
+	TfsPath path = tfs_path_from_cstr("/a/b/c/file");
+	for (size_t n = 0; n < iters; n++) {
+		TfsFsFindResult result = tfs_fs_find(&fs_data->fs, path, TfsRwLockAccessShared);
+		assert(result.success);
+		tfs_fs_unlock_inode(&fs_data->fs, result.data.inode.idx);
+	}
+}
+
+static void create_remove_own_dir(void* data, size_t thread_idx, size_t iters) {
+	FsData* fs_data = data;
+	char path_str[64];
+	snprintf(path_str, sizeof(path_str), "/thread%zu/file", thread_idx);
+	TfsPath path = tfs_path_from_cstr(path_str);
+	for (size_t n = 0; n < iters; n++) {
+		TfsFsCreateResult create_result = tfs_fs_create(&fs_data->fs, path, TfsInodeTypeFile);
+		assert(create_result.success);
+		tfs_fs_unlock_inode(&fs_data->fs, create_result.data.idx);
+
+		TfsFsRemoveResult remove_result = tfs_fs_remove(&fs_data->fs, path);
+		assert(remove_result.success);
+		(void)remove_result;
+	}
+}
+
+static void create_remove_same_dir(void* data, size_t thread_idx, size_t iters) {
+	FsData* fs_data = data;
+	char path_str[64];
+	snprintf(path_str, sizeof(path_str), "/shared/file%zu", thread_idx);
+	TfsPath path = tfs_path_from_cstr(path_str);
+	for (size_t n = 0; n < iters; n++) {
+		TfsFsCreateResult create_result = tfs_fs_create(&fs_data->fs, path, TfsInodeTypeFile);
+		assert(create_result.success);
+		tfs_fs_unlock_inode(&fs_data->fs, create_result.data.idx);
+
+		TfsFsRemoveResult remove_result = tfs_fs_remove(&fs_data->fs, path);
+		assert(remove_result.success);
+		(void)remove_result;
+	}
+}
+
+static void move_own_dir(void* data, size_t thread_idx, size_t iters) {
+	FsData* fs_data = data;
+	char path_strs[2][64];
+	snprintf(path_strs[0], sizeof(path_strs[0]), "/thread%zu/sub/moved", thread_idx);
+	snprintf(path_strs[1], sizeof(path_strs[1]), "/thread%zu/moved", thread_idx);
+	TfsPath paths[2] = {tfs_path_from_cstr(path_strs[0]), tfs_path_from_cstr(path_strs[1])};
+
+	// Note: We move it back and forth between the directory and it's sub-directory.
+	create(&fs_data->fs, path_strs[0], TfsInodeTypeFile);
+	for (size_t n = 0; n < iters; n++) {
+		TfsFsMoveResult result =
+			tfs_fs_move(&fs_data->fs, paths[n % 2], paths[(n + 1) % 2], TfsRwLockAccessUnique);
+		assert(result.success);
+		tfs_fs_unlock_inode(&fs_data->fs, result.data.inode.idx);
+	}
+	TfsFsRemoveResult remove_result = tfs_fs_remove(&fs_data->fs, paths[iters % 2]);
+	assert(remove_result.success);
+	(void)remove_result;
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	// Create the file system with a few directories for all benchmarks
+	FsData data = {.fs = tfs_fs_new()};
+	create(&data.fs, "/a", TfsInodeTypeDir);
+	create(&data.fs, "/a/b", TfsInodeTypeDir);
+	create(&data.fs, "/a/b/c", TfsInodeTypeDir);
+	create(&data.fs, "/a/b/c/file", TfsInodeTypeFile);
+	create(&data.fs, "/shared", TfsInodeTypeDir);
+
+	size_t max_threads = tfs_min_size_t(config.max_threads, MAX_THREADS);
+	for (size_t n = 0; n < max_threads; n++) {
+		char path[64];
+		snprintf(path, sizeof(path), "/thread%zu", n);
+		create(&data.fs, path, TfsInodeTypeDir);
+		snprintf(path, sizeof(path), "/thread%zu/sub", n);
+		create(&data.fs, path, TfsInodeTypeDir);
+	}
+
+	for (size_t threads = 1; threads <= max_threads; threads++) {
+		// clang-format off
+		TfsBench benches[] = {
+			{.name = "find_shared"           , .fn = find_shared           },
+			{.name = "create_remove_own_dir" , .fn = create_remove_own_dir },
+			{.name = "create_remove_same_dir", .fn = create_remove_same_dir},
+			{.name = "move_own_dir"          , .fn = move_own_dir          },
+		};
+		// clang-format on
+
+		for (size_t m = 0; m < sizeof(benches) / sizeof(benches[0]); m++) {
+			benches[m].suite = "fs";
+			benches[m].param = threads;
+			benches[m].threads = threads;
+			benches[m].iters = 20000;
+			benches[m].data = &data;
+			tfs_bench_run(&benches[m], &config);
+		}
+	}
+
+	tfs_fs_destroy(&data.fs);
+
+	return EXIT_SUCCESS;
+}
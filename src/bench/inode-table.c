@@ -0,0 +1,112 @@
+/// @file
+/// @brief `TfsInodeTable` benchmarks
+
+// Imports
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS
+#include <tfs/bench/bench.h> // TfsBench, tfs_bench_run
+#include <tfs/inode/table.h> // TfsInodeTable
+
+/// @brief Capacity of the inode table
+#define TABLE_CAPACITY 1024
+
+/// @brief Data for all inode table benchmarks
+typedef struct TableData {
+	/// @brief The inode table
+	TfsInodeTable table;
+} TableData;
+
+static void add_remove(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	TableData* table_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		TfsInodeIdx idx = tfs_inode_table_add(&table_data->table, TfsInodeTypeFile);
+		tfs_inode_table_remove_inode(&table_data->table, idx);
+	}
+}
+
+static void lock_shared_same(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	TableData* table_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		tfs_inode_table_lock(&table_data->table, (TfsInodeIdx){.idx = 0}, TfsRwLockAccessShared);
+		tfs_inode_table_unlock_inode(&table_data->table, (TfsInodeIdx){.idx = 0});
+	}
+}
+
+static void lock_unique_same(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	TableData* table_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		tfs_inode_table_lock(&table_data->table, (TfsInodeIdx){.idx = 0}, TfsRwLockAccessUnique);
+		tfs_inode_table_unlock_inode(&table_data->table, (TfsInodeIdx){.idx = 0});
+	}
+}
+
+static void lock_unique_own(void* data, size_t thread_idx, size_t iters) {
+	TableData* table_data = data;
+
+	// Note: Each thread locks it's own inode, so this only measures
+	//       the cost of neighbouring inodes sharing cache lines.
+	TfsInodeIdx idx = {.idx = thread_idx};
+	for (size_t n = 0; n < iters; n++) {
+		tfs_inode_table_lock(&table_data->table, idx, TfsRwLockAccessUnique);
+		tfs_inode_table_unlock_inode(&table_data->table, idx);
+	}
+}
+
+/// @brief Creates a table with it's first @p occupied inodes in use
+static TfsInodeTable build_table(size_t occupied) {
+	TfsInodeTable table = tfs_inode_table_new(TABLE_CAPACITY);
+	for (size_t n = 0; n < occupied; n++) {
+		TfsInodeIdx idx = tfs_inode_table_add(&table, TfsInodeTypeFile);
+		tfs_inode_table_unlock_inode(&table, idx);
+	}
+
+	return table;
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	// Adding an inode scans the table for the first empty inode, so
+	// it's measured with several occupancies.
+	const size_t occupancies[] = {0, TABLE_CAPACITY / 4, TABLE_CAPACITY / 2, TABLE_CAPACITY - 1};
+	for (size_t n = 0; n < sizeof(occupancies) / sizeof(occupancies[0]); n++) {
+		TableData data = {.table = build_table(occupancies[n])};
+		TfsBench bench = {
+			.suite = "inode-table",
+			.name = "add_remove",
+			.param = occupancies[n],
+			.threads = 1,
+			.iters = 1000000 / (occupancies[n] + 1),
+			.fn = add_remove,
+			.data = &data,
+		};
+		tfs_bench_run(&bench, &config);
+		tfs_inode_table_destroy(&data.table);
+	}
+
+	// Locking is measured under 1..N threads
+	TableData data = {.table = build_table(TABLE_CAPACITY)};
+	for (size_t threads = 1; threads <= config.max_threads && threads <= TABLE_CAPACITY; threads++) {
+		// clang-format off
+		TfsBench benches[] = {
+			{.name = "lock_shared_same", .fn = lock_shared_same},
+			{.name = "lock_unique_same", .fn = lock_unique_same},
+			{.name = "lock_unique_own" , .fn = lock_unique_own },
+		};
+		// clang-format on
+
+		for (size_t m = 0; m < sizeof(benches) / sizeof(benches[0]); m++) {
+			benches[m].suite = "inode-table";
+			benches[m].param = threads;
+			benches[m].threads = threads;
+			benches[m].iters = 100000;
+			benches[m].data = &data;
+			tfs_bench_run(&benches[m], &config);
+		}
+	}
+	tfs_inode_table_destroy(&data.table);
+
+	return EXIT_SUCCESS;
+}
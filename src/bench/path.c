@@ -0,0 +1,150 @@
+/// @file
+/// @brief `TfsPath` benchmarks
+
+// Imports
+#include <stdio.h>			 // snprintf
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS
+#include <tfs/bench/bench.h> // TfsBench, tfs_bench_run
+#include <tfs/path.h>		 // TfsPath
+
+/// @brief Maximum length of the paths we benchmark
+#define PATH_MAX_LEN 1024
+
+/// @brief Data for all path benchmarks
+typedef struct PathData {
+	/// @brief Path to operate on
+	char path[PATH_MAX_LEN];
+
+	/// @brief Same path as `path`, but with extra slashes and whitespace
+	char path_spaced[PATH_MAX_LEN];
+
+	/// @brief Path sharing the first half of it's components with `path`
+	char path_sibling[PATH_MAX_LEN];
+} PathData;
+
+static void from_cstr(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		TfsPath path = tfs_path_from_cstr(path_data->path);
+		tfs_bench_do_not_optimize(&path);
+	}
+}
+
+static void trim(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath path = tfs_path_from_cstr(path_data->path_spaced);
+	for (size_t n = 0; n < iters; n++) {
+		TfsPath trimmed = tfs_path_trim(path);
+		tfs_bench_do_not_optimize(&trimmed);
+	}
+}
+
+static void pop_first_all(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath path = tfs_path_from_cstr(path_data->path);
+	for (size_t n = 0; n < iters; n++) {
+		TfsPath rest = path;
+		while (rest.len != 0) {
+			TfsPath first = tfs_path_pop_first(rest, &rest);
+			tfs_bench_do_not_optimize(&first);
+		}
+	}
+}
+
+static void pop_last(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath path = tfs_path_from_cstr(path_data->path);
+	for (size_t n = 0; n < iters; n++) {
+		TfsPath rest;
+		TfsPath last = tfs_path_pop_last(path, &rest);
+		tfs_bench_do_not_optimize(&last);
+		tfs_bench_do_not_optimize(&rest);
+	}
+}
+
+static void components_len(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath path = tfs_path_from_cstr(path_data->path);
+	for (size_t n = 0; n < iters; n++) {
+		size_t len = tfs_path_components_len(path);
+		tfs_bench_do_not_optimize(&len);
+	}
+}
+
+static void eq(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath lhs = tfs_path_from_cstr(path_data->path);
+	TfsPath rhs = tfs_path_from_cstr(path_data->path_spaced);
+	for (size_t n = 0; n < iters; n++) {
+		bool is_eq = tfs_path_eq(lhs, rhs);
+		tfs_bench_do_not_optimize(&is_eq);
+	}
+}
+
+static void common_ancestor(void* data, size_t thread_idx, size_t iters) {
+	(void)thread_idx;
+	PathData* path_data = data;
+	TfsPath lhs = tfs_path_from_cstr(path_data->path);
+	TfsPath rhs = tfs_path_from_cstr(path_data->path_sibling);
+	for (size_t n = 0; n < iters; n++) {
+		TfsPath lhs_rest;
+		TfsPath rhs_rest;
+		TfsPath ancestor = tfs_path_common_ancestor(lhs, rhs, &lhs_rest, &rhs_rest);
+		tfs_bench_do_not_optimize(&ancestor);
+	}
+}
+
+/// @brief Builds all paths with @p depth components
+static void build_paths(PathData* data, size_t depth) {
+	size_t path_len = 0;
+	size_t path_spaced_len = 0;
+	size_t path_sibling_len = 0;
+	for (size_t n = 0; n < depth; n++) {
+		path_len += (size_t)snprintf(data->path + path_len, PATH_MAX_LEN - path_len, "/dir%zu", n);
+		path_spaced_len +=
+			(size_t)snprintf(data->path_spaced + path_spaced_len, PATH_MAX_LEN - path_spaced_len, " // dir%zu ", n);
+		path_sibling_len += (size_t)snprintf(data->path_sibling + path_sibling_len,
+			PATH_MAX_LEN - path_sibling_len,
+			n < depth / 2 ? "/dir%zu" : "/other%zu",
+			n);
+	}
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	// Note: All iteration counts are chosen so each repetition takes a few milliseconds.
+	const size_t depths[] = {1, 4, 16, 64};
+	for (size_t n = 0; n < sizeof(depths) / sizeof(depths[0]); n++) {
+		PathData data;
+		build_paths(&data, depths[n]);
+
+		// clang-format off
+		TfsBench benches[] = {
+			{.name = "from_cstr"      , .fn = from_cstr      , .iters = 1000000},
+			{.name = "trim"           , .fn = trim           , .iters = 1000000},
+			{.name = "pop_first_all"  , .fn = pop_first_all  , .iters = 100000 / depths[n]},
+			{.name = "pop_last"       , .fn = pop_last       , .iters = 1000000},
+			{.name = "components_len" , .fn = components_len , .iters = 100000 / depths[n]},
+			{.name = "eq"             , .fn = eq             , .iters = 100000 / depths[n]},
+			{.name = "common_ancestor", .fn = common_ancestor, .iters = 100000 / depths[n]},
+		};
+		// clang-format on
+
+		for (size_t m = 0; m < sizeof(benches) / sizeof(benches[0]); m++) {
+			benches[m].suite = "path";
+			benches[m].param = depths[n];
+			benches[m].threads = 1;
+			benches[m].data = &data;
+			tfs_bench_run(&benches[m], &config);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
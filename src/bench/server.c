@@ -0,0 +1,247 @@
+/// @file
+/// @brief Server message batching benchmarks
+/// @details
+/// Measures the throughput of the server's receive and reply path
+/// under many concurrent clients, for several maximum batch sizes.
+///
+/// Workers reply to every message without executing it, so only
+/// the cost of moving messages through the socket is measured.
+/// After each benchmark, the number of syscalls workers made per
+/// message and the 99th percentile latency of each lookup, over all
+/// repetitions, are reported to stderr.
+///
+/// Besides all workers blocking on their receives, the first worker
+/// is also benchmarked busy-polling the socket, trading it's idle cpu
+/// time for the wakeup latency of a blocking receive.
+///
+/// Clients spend most of their time waiting on the server, so they
+/// go up to #MAX_CLIENTS regardless of the maximum number of threads.
+
+// Imports
+#include <pthread.h>				  // pthread_create, pthread_join
+#include <stdbool.h>				  // bool
+#include <stdio.h>					  // snprintf, fprintf, stderr
+#include <stdlib.h>					  // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>					  // memset
+#include <sys/socket.h>				  // socket, bind, shutdown
+#include <time.h>					  // clock_gettime, CLOCK_MONOTONIC
+#include <tfs/bench/bench.h>		  // TfsBench, tfs_bench_run
+#include <tfs/bench/histogram.h>	  // TfsBenchHistogram
+#include <tfs/client-api.h>			  // TfsClientServerConnection
+#include <tfs/protocol.h>			  // tfs_protocol_*
+#include <tfs/server/message-batch.h> // TfsServerMessageBatch
+#include <unistd.h>					  // getpid, unlink, close
+
+/// @brief Maximum number of clients
+#define MAX_CLIENTS 64
+
+/// @brief Number of server workers
+#define WORKERS 4
+
+/// @brief Time busy-polling workers stay idle for before blocking, in nanoseconds
+#define BUSY_POLL_SPIN_NS 1000000
+
+/// @brief Server configuration benchmarked
+typedef struct ServerConfig {
+	/// @brief Name of the benchmark
+	const char* name;
+
+	/// @brief Maximum number of messages received at once
+	size_t max_batch;
+
+	/// @brief If the first worker busy-polls the socket
+	bool busy_poll;
+} ServerConfig;
+
+/// @brief Data for each worker
+typedef struct WorkerData {
+	/// @brief Server socket
+	int server_socket;
+
+	/// @brief Maximum number of messages received at once
+	size_t max_batch;
+
+	/// @brief If busy-polling the socket
+	bool busy_poll;
+
+	/// @brief Syscall statistics, set once the worker exits
+	TfsServerMessageBatchStats stats;
+} WorkerData;
+
+/// @brief Data for all benchmarks
+typedef struct ServerData {
+	/// @brief Connection of each client
+	TfsClientServerConnection connections[MAX_CLIENTS];
+
+	/// @brief Command sent by all clients
+	TfsCommand command;
+
+	/// @brief Latency of each client's commands, in nanoseconds
+	TfsBenchHistogram* latencies;
+} ServerData;
+
+/// @brief Writes the reply to a message, as if all of it's commands succeeded
+/// @return Length of the reply
+static size_t echo_reply(const char* message, size_t message_len, char* reply) {
+	// Note: Legacy messages are replied to with a single byte, while batches echo their header.
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+	if (!tfs_protocol_is_framed(message, message_len) || !header_result.success) {
+		reply[0] = '\1';
+		return 1;
+	}
+
+	TfsProtocolHeader header = header_result.data.header;
+	tfs_protocol_header_write(header, reply);
+	memset(reply + TFS_PROTOCOL_HEADER_LEN, '\1', header.count);
+	return TFS_PROTOCOL_HEADER_LEN + header.count;
+}
+
+static void* worker_thread_fn(void* arg) {
+	WorkerData* data = arg;
+	TfsServerMessageBatch batch = tfs_server_message_batch_new(data->max_batch);
+
+	// Note: We stop once the socket is shut down
+	while (1) {
+		TfsServerMessageBatchRecvResult result =
+			data->busy_poll ? tfs_server_message_batch_poll_recv(&batch, data->server_socket, BUSY_POLL_SPIN_NS)
+							: tfs_server_message_batch_recv(&batch, data->server_socket);
+		if (!result.success) { break; }
+
+		for (size_t n = 0; n < batch.len; n++) {
+			size_t message_len;
+			const char* message = tfs_server_message_batch_message(&batch, n, &message_len);
+			char* reply = tfs_server_message_batch_reply(&batch, n);
+			tfs_server_message_batch_set_reply_len(&batch, n, echo_reply(message, message_len, reply));
+		}
+		tfs_server_message_batch_send(&batch, data->server_socket);
+	}
+
+	data->stats = batch.stats;
+	tfs_server_message_batch_destroy(&batch);
+	return NULL;
+}
+
+static void send_commands(void* data, size_t thread_idx, size_t iters) {
+	ServerData* server_data = data;
+	for (size_t n = 0; n < iters; n++) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		TfsClientServerConnectionSendCommandResult result =
+			tfs_client_server_connection_send_command(&server_data->connections[thread_idx], &server_data->command);
+		if (!result.success) {
+			fprintf(stderr, "Unable to send command\n");
+			exit(EXIT_FAILURE);
+		}
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		tfs_bench_histogram_record(&server_data->latencies[thread_idx],
+			(uint64_t)((end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec)));
+	}
+}
+
+/// @brief Creates and binds the server socket, exiting on failure
+static int create_server_socket(const char* path) {
+	int server_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+	struct sockaddr_un address;
+	bzero(&address, sizeof(address));
+	address.sun_family = AF_UNIX;
+	snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+	unlink(path);
+	if (server_socket < 0 || bind(server_socket, (struct sockaddr*)&address, (socklen_t)SUN_LEN(&address)) < 0) {
+		fprintf(stderr, "Unable to create server socket '%s'\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	return server_socket;
+}
+
+int main(int argc, char** argv) {
+	TfsBenchConfig config = tfs_bench_config_from_args(argc, argv);
+
+	char server_path[108];
+	snprintf(server_path, sizeof(server_path), "/tmp/tfs-bench-server-%d", getpid());
+
+	// Connect all clients
+	char path[] = "/a";
+	ServerData data = {
+		.command = {.kind = TfsCommandSearch, .data.search.path = {.chars = path, .len = sizeof(path) - 1}},
+		.latencies = malloc(MAX_CLIENTS * sizeof(TfsBenchHistogram)),
+	};
+	if (data.latencies == NULL) {
+		fprintf(stderr, "Unable to allocate latency histograms\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t n = 0; n < MAX_CLIENTS; n++) {
+		TfsClientServerConnectionNewResult result = tfs_client_server_connection_new(server_path);
+		if (!result.success) {
+			fprintf(stderr, "Unable to connect client #%zu\n", n);
+			tfs_client_server_connection_new_error_print(&result.data.err, stderr);
+			return EXIT_FAILURE;
+		}
+		data.connections[n] = result.data.connection;
+	}
+
+	const ServerConfig configs[] = {
+		{.name = "echo_k1", .max_batch = 1, .busy_poll = false},
+		{.name = "echo_k32", .max_batch = 32, .busy_poll = false},
+		{.name = "echo_k32_poll", .max_batch = 32, .busy_poll = true},
+	};
+	for (size_t clients = 1; clients <= MAX_CLIENTS; clients *= 4) {
+		for (size_t m = 0; m < sizeof(configs) / sizeof(configs[0]); m++) {
+			// Start the server
+			int server_socket = create_server_socket(server_path);
+			WorkerData workers_data[WORKERS];
+			pthread_t workers[WORKERS];
+			for (size_t n = 0; n < WORKERS; n++) {
+				workers_data[n] = (WorkerData){
+					.server_socket = server_socket,
+					.max_batch = configs[m].max_batch,
+					.busy_poll = configs[m].busy_poll && n == 0,
+				};
+				pthread_create(&workers[n], NULL, worker_thread_fn, &workers_data[n]);
+			}
+
+			const char* name = configs[m].name;
+			for (size_t n = 0; n < clients; n++) { data.latencies[n] = tfs_bench_histogram_new(); }
+			TfsBench bench = {
+				.suite = "server",
+				.name = name,
+				.param = clients,
+				.threads = clients,
+				.iters = 20000 / clients,
+				.fn = send_commands,
+				.data = &data,
+			};
+			tfs_bench_run(&bench, &config);
+
+			// Stop the server and report it's syscalls
+			shutdown(server_socket, SHUT_RDWR);
+			TfsServerMessageBatchStats stats = {.recv_calls = 0, .send_calls = 0, .messages = 0};
+			for (size_t n = 0; n < WORKERS; n++) {
+				pthread_join(workers[n], NULL);
+				stats.recv_calls += workers_data[n].stats.recv_calls;
+				stats.send_calls += workers_data[n].stats.send_calls;
+				stats.messages += workers_data[n].stats.messages;
+			}
+			close(server_socket);
+			TfsBenchHistogram latencies = tfs_bench_histogram_new();
+			for (size_t n = 0; n < clients; n++) { tfs_bench_histogram_merge(&latencies, &data.latencies[n]); }
+			uint64_t p99_ns = tfs_bench_histogram_percentile(&latencies, 99);
+			fprintf(stderr,
+				"server/%s/%zu: %.3f syscalls per message (%.3f recv, %.3f send), %.1fus p99 lookup latency\n",
+				name,
+				clients,
+				(double)(stats.recv_calls + stats.send_calls) / (double)stats.messages,
+				(double)stats.recv_calls / (double)stats.messages,
+				(double)stats.send_calls / (double)stats.messages,
+				(double)p99_ns / 1e3);
+		}
+	}
+
+	for (size_t n = 0; n < MAX_CLIENTS; n++) { tfs_client_server_connection_destroy(&data.connections[n]); }
+	unlink(server_path);
+	free(data.latencies);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,839 @@
+/// @file
+/// @brief Filesystem load generator
+/// @details
+/// This file serves as a load generator for the tfs server.
+///
+/// It runs several clients, as either threads or processes, each
+/// with it's own server connection. Every client issues a random mix
+/// of creates, lookups, removes and moves on the paths of a synthetic
+/// tree, choosing paths with a zipf distribution, and records the
+/// latency of each operation.
+///
+/// Clients may run closed-loop, issuing the next operation as soon as
+/// the previous one finishes, or open-loop, issuing operations at a
+/// given rate with exponentially distributed gaps. In open-loop mode,
+/// latencies are measured from when each operation was scheduled, so
+/// a slow server isn't hidden by the client falling behind schedule.
+///
+/// Each client may also keep a window of several operations in flight,
+/// submitting new ones while waiting on the replies of the previous ones.
+///
+/// Clients may also attach their connections to a shared-memory ring,
+/// instead of exchanging messages over the server socket, or, with `-Q`,
+/// connect to the server's session socket instead of sending it datagrams.
+/// @note
+/// All static functions here, when encountering an error,
+/// will simply report it and exit the program, as opposed
+/// to returning an error.
+
+#include <errno.h>				 // errno
+#include <inttypes.h>			 // PRIu32, PRIu64
+#include <math.h>				 // pow, log
+#include <poll.h>				 // ppoll, pollfd, POLLIN
+#include <pthread.h>			 // pthread_create, pthread_join, pthread_barrier_t
+#include <sched.h>				 // sched_yield
+#include <stdint.h>				 // uint64_t
+#include <stdio.h>				 // fprintf, printf, stderr
+#include <stdlib.h>				 // strtoul, strtod, malloc, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				 // strlen, strerror
+#include <sys/mman.h>			 // mmap, munmap
+#include <sys/wait.h>			 // waitpid
+#include <tfs/bench/bench.h>	 // tfs_bench_now
+#include <tfs/bench/histogram.h> // TfsBenchHistogram
+#include <tfs/client-api.h>		 // tfs_client_*
+#include <time.h>				 // clock_nanosleep
+#include <unistd.h>				 // getopt, fork
+
+/// @brief Number of inodes in the server's inode table
+/// @details
+/// Trees with more paths than this would exhaust the server's inodes.
+#define SERVER_INODES 128
+
+/// @brief Operation kinds
+typedef enum OpKind {
+	/// @brief Creates a file
+	OpKindCreate,
+
+	/// @brief Looks up a file or directory
+	OpKindLookup,
+
+	/// @brief Removes a file
+	OpKindRemove,
+
+	/// @brief Moves a file onto another file's path
+	OpKindMove,
+
+	/// @brief Number of operation kinds
+	OpKindLen,
+} OpKind;
+
+/// @brief Names of each operation kind
+static const char* const op_kind_names[OpKindLen] = {"create", "lookup", "remove", "move"};
+
+/// @brief Load generator configuration
+typedef struct Config {
+	/// @brief Path of the server socket
+	const char* server_path;
+
+	/// @brief Number of clients
+	size_t clients;
+
+	/// @brief If clients should be processes instead of threads
+	bool processes;
+
+	/// @brief Duration of the run, in seconds
+	double duration_secs;
+
+	/// @brief Relative weight of each operation kind
+	size_t mix[OpKindLen];
+
+	/// @brief Exponent of the zipf distribution
+	double zipf_exponent;
+
+	/// @brief Number of directory levels in the tree
+	size_t depth;
+
+	/// @brief Number of sub-directories of each directory
+	size_t fanout;
+
+	/// @brief Number of files in each directory of the last level
+	size_t files_per_dir;
+
+	/// @brief Operations per second of each client, or `0` for closed-loop
+	double rate;
+
+	/// @brief Maximum number of operations each client has in flight
+	size_t window;
+
+	/// @brief If clients should attach a shared-memory ring to their connections
+	bool shared_memory;
+
+	/// @brief If the server socket is a session socket, see #tfs_client_server_connection_connect
+	bool session;
+
+	/// @brief Seed of all random number generators
+	uint64_t seed;
+} Config;
+
+/// @brief A zipf distributed sampler over a set of items
+typedef struct ZipfSampler {
+	/// @brief Cumulative probability of each rank
+	double* cdf;
+
+	/// @brief Item of each rank
+	/// @details
+	/// Ranks are shuffled over the items, so the most popular
+	/// items aren't all siblings.
+	size_t* items;
+
+	/// @brief Number of items
+	size_t len;
+} ZipfSampler;
+
+/// @brief The synthetic tree
+typedef struct Tree {
+	/// @brief All paths, with parents always before their children
+	char** paths;
+
+	/// @brief Number of paths
+	size_t len;
+
+	/// @brief Indices, into `paths`, of all files
+	size_t* files;
+
+	/// @brief Number of files
+	size_t files_len;
+
+	/// @brief Sampler over all paths
+	ZipfSampler path_sampler;
+
+	/// @brief Sampler over all files
+	ZipfSampler file_sampler;
+} Tree;
+
+/// @brief Statistics of each client
+typedef struct ClientStats {
+	/// @brief Latency, in nanoseconds, of each operation kind
+	TfsBenchHistogram latencies[OpKindLen];
+
+	/// @brief Number of operations of each kind the server failed to execute
+	uint64_t failed[OpKindLen];
+
+	/// @brief Number of operations of each kind the server rejected as busy
+	uint64_t rejected[OpKindLen];
+} ClientStats;
+
+/// @brief Data shared between all clients
+/// @details
+/// This lives in a shared mapping, so it's shared even when clients are processes.
+typedef struct Shared {
+	/// @brief Barrier all clients, and the main thread, wait on before starting
+	pthread_barrier_t start;
+
+	/// @brief Statistics of each client
+	ClientStats stats[];
+} Shared;
+
+/// @brief An operation a client has in flight
+typedef struct InFlight {
+	/// @brief Id of the request
+	uint32_t id;
+
+	/// @brief Time the operation was scheduled at, in nanoseconds
+	uint64_t start_ns;
+
+	/// @brief Operation kind
+	OpKind kind;
+} InFlight;
+
+/// @brief All operations a client has in flight
+typedef struct Window {
+	/// @brief All operations, in no particular order
+	InFlight* ops;
+
+	/// @brief Number of operations
+	size_t len;
+} Window;
+
+/// @brief Data passed to each client thread
+typedef struct ClientData {
+	/// @brief Configuration
+	const Config* config;
+
+	/// @brief Tree
+	const Tree* tree;
+
+	/// @brief Shared data
+	Shared* shared;
+
+	/// @brief Index of this client
+	size_t idx;
+} ClientData;
+
+/// @brief Prints the usage of this program
+static void print_usage(void);
+
+/// @brief Parses the configuration from the command line
+static Config parse_config(int argc, char** argv);
+
+/// @brief Builds the synthetic tree
+static Tree build_tree(const Config* config);
+
+/// @brief Creates every path of the tree in the server
+static void populate_tree(const Config* config, const Tree* tree);
+
+/// @brief Runs a client
+static void run_client(const Config* config, const Tree* tree, Shared* shared, size_t idx);
+
+/// @brief Thread function for each client
+static void* client_thread_fn(void* arg);
+
+/// @brief Prints the results of all clients
+static void print_results(const Config* config, const Shared* shared, uint64_t elapsed_ns);
+
+/// @brief Returns the next random number of a xorshift generator
+static uint64_t rng_next(uint64_t* state);
+
+/// @brief Returns a random number between `0` and `1` (exclusive).
+static double rng_next_double(uint64_t* state);
+
+/// @brief Creates a zipf sampler over @p len items
+static ZipfSampler zipf_sampler_new(size_t len, double exponent, uint64_t* rng);
+
+/// @brief Samples an item from a zipf sampler
+static size_t zipf_sampler_sample(const ZipfSampler* self, uint64_t* rng);
+
+int main(int argc, char** argv) {
+	Config config = parse_config(argc, argv);
+
+	// Build the tree and create it in the server
+	Tree tree = build_tree(&config);
+	populate_tree(&config, &tree);
+
+	// Create the shared data
+	size_t shared_size = sizeof(Shared) + config.clients * sizeof(ClientStats);
+	Shared* shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		fprintf(stderr, "Unable to map shared data\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	for (size_t n = 0; n < config.clients; n++) {
+		for (size_t kind = 0; kind < OpKindLen; kind++) {
+			shared->stats[n].latencies[kind] = tfs_bench_histogram_new();
+			shared->stats[n].failed[kind] = 0;
+			shared->stats[n].rejected[kind] = 0;
+		}
+	}
+	pthread_barrierattr_t barrier_attr;
+	pthread_barrierattr_init(&barrier_attr);
+	pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&shared->start, &barrier_attr, (unsigned)config.clients + 1);
+	pthread_barrierattr_destroy(&barrier_attr);
+
+	// Spawn all clients
+	pthread_t threads[config.processes ? 0 : config.clients];
+	ClientData threads_data[config.processes ? 0 : config.clients];
+	pid_t pids[config.processes ? config.clients : 0];
+	for (size_t n = 0; n < config.clients; n++) {
+		if (config.processes) {
+			pids[n] = fork();
+			if (pids[n] < 0) {
+				fprintf(stderr, "Unable to fork client #%zu\n", n);
+				fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+				return EXIT_FAILURE;
+			}
+			if (pids[n] == 0) {
+				run_client(&config, &tree, shared, n);
+				_exit(EXIT_SUCCESS);
+			}
+		}
+		else {
+			threads_data[n] = (ClientData){.config = &config, .tree = &tree, .shared = shared, .idx = n};
+			int res = pthread_create(&threads[n], NULL, client_thread_fn, &threads_data[n]);
+			if (res != 0) {
+				fprintf(stderr, "Unable to create client thread #%zu: %d\n", n, res);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// Start them all and wait for them to finish
+	pthread_barrier_wait(&shared->start);
+	uint64_t start_ns = tfs_bench_now();
+	for (size_t n = 0; n < config.clients; n++) {
+		if (config.processes) {
+			int status;
+			if (waitpid(pids[n], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+				fprintf(stderr, "Client #%zu failed\n", n);
+				return EXIT_FAILURE;
+			}
+		}
+		else {
+			pthread_join(threads[n], NULL);
+		}
+	}
+	uint64_t elapsed_ns = tfs_bench_now() - start_ns;
+
+	print_results(&config, shared, elapsed_ns);
+
+	pthread_barrier_destroy(&shared->start);
+	munmap(shared, shared_size);
+
+	return EXIT_SUCCESS;
+}
+
+static void print_usage(void) {
+	fprintf(stderr,
+		"Usage: ./tecnicofs-bench [-c <clients>] [-P] [-d <seconds>] [-m <create>:<lookup>:<remove>:<move>]\n"
+		"                         [-z <zipf-exponent>] [-l <depth>] [-f <fanout>] [-F <files-per-dir>]\n"
+		"                         [-r <ops-per-sec-per-client>] [-w <window>] [-S] [-Q] [-s <seed>]\n"
+		"                         <server-socket-name>\n");
+}
+
+/// @brief Parses a non-negative integer argument, exiting on error
+static size_t parse_size(const char* arg) {
+	char* end;
+	size_t value = strtoul(arg, &end, 0);
+	if (end == arg || end[0] != '\0') {
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+/// @brief Parses a non-negative real argument, exiting on error
+static double parse_double(const char* arg) {
+	char* end;
+	double value = strtod(arg, &end);
+	if (end == arg || end[0] != '\0' || value < 0) {
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+static Config parse_config(int argc, char** argv) {
+	Config config = {
+		.clients = 1,
+		.processes = false,
+		.duration_secs = 5,
+		.mix = {[OpKindCreate] = 10, [OpKindLookup] = 80, [OpKindRemove] = 5, [OpKindMove] = 5},
+		.zipf_exponent = 0.99,
+		.depth = 2,
+		.fanout = 4,
+		.files_per_dir = 4,
+		.rate = 0,
+		.window = 1,
+		.shared_memory = false,
+		.session = false,
+		.seed = 0x7f5cu,
+	};
+
+	int option;
+	while ((option = getopt(argc, argv, "c:Pd:m:z:l:f:F:r:w:SQs:")) != -1) {
+		switch (option) {
+			case 'c': config.clients = parse_size(optarg); break;
+			case 'P': config.processes = true; break;
+			case 'd': config.duration_secs = parse_double(optarg); break;
+			case 'm': {
+				if (sscanf(optarg, "%zu:%zu:%zu:%zu", &config.mix[0], &config.mix[1], &config.mix[2], &config.mix[3]) !=
+					4) {
+					print_usage();
+					exit(EXIT_FAILURE);
+				}
+				break;
+			}
+			case 'z': config.zipf_exponent = parse_double(optarg); break;
+			case 'l': config.depth = parse_size(optarg); break;
+			case 'f': config.fanout = parse_size(optarg); break;
+			case 'F': config.files_per_dir = parse_size(optarg); break;
+			case 'r': config.rate = parse_double(optarg); break;
+			case 'w': config.window = parse_size(optarg); break;
+			case 'S': config.shared_memory = true; break;
+			case 'Q': config.session = true; break;
+			case 's': config.seed = parse_size(optarg); break;
+			default: {
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	if (argc - optind != 1 || config.clients == 0 || config.fanout == 0 || config.files_per_dir == 0 ||
+		config.window == 0) {
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+	if (config.mix[0] + config.mix[1] + config.mix[2] + config.mix[3] == 0) {
+		fprintf(stderr, "The operation mix must have at least one operation\n");
+		exit(EXIT_FAILURE);
+	}
+	config.server_path = argv[optind];
+
+	return config;
+}
+
+/// @brief Adds a path to the tree, returning it's index
+static size_t tree_push(Tree* tree, size_t capacity, const char* path) {
+	if (tree->len == capacity) {
+		fprintf(stderr, "Tree exceeded it's capacity of %zu paths\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+	tree->paths[tree->len] = strdup(path);
+	return tree->len++;
+}
+
+/// @brief Adds all paths under directory @p parent, at level @p level
+static void tree_push_children(const Config* config, Tree* tree, size_t capacity, const char* parent, size_t level) {
+	char path[1024];
+	if (level == config->depth) {
+		for (size_t n = 0; n < config->files_per_dir; n++) {
+			snprintf(path, sizeof(path), "%s/f%zu", parent, n);
+			tree->files[tree->files_len++] = tree_push(tree, capacity, path);
+		}
+		return;
+	}
+
+	for (size_t n = 0; n < config->fanout; n++) {
+		snprintf(path, sizeof(path), "%s/d%zu", parent, n);
+		tree_push(tree, capacity, path);
+		tree_push_children(config, tree, capacity, path, level + 1);
+	}
+}
+
+static Tree build_tree(const Config* config) {
+	// Count all paths
+	size_t dirs_len = 0;
+	size_t level_len = 1;
+	for (size_t level = 0; level < config->depth; level++) {
+		level_len *= config->fanout;
+		dirs_len += level_len;
+	}
+	size_t files_len = level_len * config->files_per_dir;
+	size_t capacity = dirs_len + files_len;
+
+	// Note: The root takes up an inode too.
+	if (capacity + 1 > SERVER_INODES) {
+		fprintf(stderr,
+			"Warning: The tree has %zu paths, but the server only supports %d inodes\n",
+			capacity,
+			SERVER_INODES);
+	}
+
+	Tree tree = {
+		.paths = malloc(capacity * sizeof(char*)),
+		.len = 0,
+		.files = malloc(files_len * sizeof(size_t)),
+		.files_len = 0,
+	};
+	if (tree.paths == NULL || tree.files == NULL) {
+		fprintf(stderr, "Unable to allocate tree with %zu paths\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+	tree_push_children(config, &tree, capacity, "", 0);
+
+	uint64_t rng = config->seed;
+	tree.path_sampler = zipf_sampler_new(tree.len, config->zipf_exponent, &rng);
+	tree.file_sampler = zipf_sampler_new(tree.files_len, config->zipf_exponent, &rng);
+
+	return tree;
+}
+
+/// @brief Sends a command, exiting if it couldn't be sent.
+/// @return If the server executed the command successfully
+static bool send_command(TfsClientServerConnection* connection, const TfsCommand* command) {
+	TfsClientServerConnectionSendCommandResult result = tfs_client_server_connection_send_command(connection, command);
+	if (!result.success) {
+		fprintf(stderr, "Unable to send command to server\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		tfs_client_server_connection_send_command_error_print(&result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	return result.data.command_successful;
+}
+
+/// @brief Borrows a path of the tree as an owned path for a command
+/// @details
+/// The commands built with these must _not_ be destroyed.
+static TfsPathOwned borrow_path(const Tree* tree, size_t idx) {
+	return (TfsPathOwned){.chars = tree->paths[idx], .len = strlen(tree->paths[idx])};
+}
+
+/// @brief Opens a connection to the server, exiting on error
+static TfsClientServerConnection connect_to_server(const Config* config) {
+	TfsClientServerConnectionNewResult result = config->session
+		? tfs_client_server_connection_connect(config->server_path)
+		: tfs_client_server_connection_new(config->server_path);
+	if (!result.success) {
+		fprintf(stderr, "Unable to mount socket: %s\n", config->server_path);
+		tfs_client_server_connection_new_error_print(&result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+	TfsClientServerConnection connection = result.data.connection;
+
+	// Note: If the ring can't be attached, the connection simply keeps using the socket.
+	if (config->shared_memory) {
+		TfsClientServerConnectionAttachResult attach_result = tfs_client_server_connection_attach(&connection);
+		if (!attach_result.success) {
+			fprintf(stderr, "Unable to attach shared-memory ring, using the socket\n");
+			tfs_client_server_connection_attach_error_print(&attach_result.data.err, stderr);
+		}
+	}
+
+	return connection;
+}
+
+static void populate_tree(const Config* config, const Tree* tree) {
+	TfsClientServerConnection connection = connect_to_server(config);
+
+	// Note: Paths that already exist, from a previous run, will simply fail to be created.
+	size_t file_idx = 0;
+	for (size_t n = 0; n < tree->len; n++) {
+		bool is_file = file_idx < tree->files_len && tree->files[file_idx] == n;
+		if (is_file) { file_idx++; }
+
+		TfsCommand command = {
+			.kind = TfsCommandCreate,
+			.data.create.path = borrow_path(tree, n),
+			.data.create.type = is_file ? TfsInodeTypeFile : TfsInodeTypeDir,
+		};
+		send_command(&connection, &command);
+	}
+
+	tfs_client_server_connection_destroy(&connection);
+}
+
+/// @brief Picks a random operation kind according to the mix
+static OpKind pick_op_kind(const Config* config, uint64_t* rng) {
+	size_t total = config->mix[0] + config->mix[1] + config->mix[2] + config->mix[3];
+	size_t value = (size_t)(rng_next(rng) % total);
+	for (size_t kind = 0; kind < OpKindLen; kind++) {
+		if (value < config->mix[kind]) { return (OpKind)kind; }
+		value -= config->mix[kind];
+	}
+
+	return OpKindLookup;
+}
+
+/// @brief Builds a random command of kind @p kind
+/// @details
+/// The command borrows it's paths from the tree, so it must _not_ be destroyed.
+static TfsCommand build_command(const Tree* tree, OpKind kind, uint64_t* rng) {
+	switch (kind) {
+		case OpKindCreate: {
+			return (TfsCommand){
+				.kind = TfsCommandCreate,
+				.data.create.path = borrow_path(tree, tree->files[zipf_sampler_sample(&tree->file_sampler, rng)]),
+				.data.create.type = TfsInodeTypeFile,
+			};
+		}
+		case OpKindRemove: {
+			return (TfsCommand){
+				.kind = TfsCommandRemove,
+				.data.remove.path = borrow_path(tree, tree->files[zipf_sampler_sample(&tree->file_sampler, rng)]),
+			};
+		}
+		case OpKindMove: {
+			return (TfsCommand){
+				.kind = TfsCommandMove,
+				.data.move.source = borrow_path(tree, tree->files[zipf_sampler_sample(&tree->file_sampler, rng)]),
+				.data.move.dest = borrow_path(tree, tree->files[zipf_sampler_sample(&tree->file_sampler, rng)]),
+			};
+		}
+		case OpKindLookup:
+		case OpKindLen:
+		default: {
+			return (TfsCommand){
+				.kind = TfsCommandSearch,
+				.data.search.path = borrow_path(tree, zipf_sampler_sample(&tree->path_sampler, rng)),
+			};
+		}
+	}
+}
+
+/// @brief Completes an operation of the window, recording it's latency
+/// @param wait If no reply has arrived yet, whether to wait for one
+/// @return If an operation was completed
+static bool window_complete(Window* window, TfsClientServerConnection* connection, ClientStats* stats, bool wait) {
+	TfsClientServerConnectionPollResult result = tfs_client_server_connection_poll(connection, wait);
+	if (!result.success) {
+		if (result.data.err.kind == TfsClientServerConnectionPollErrorEmpty) { return false; }
+
+		fprintf(stderr, "Unable to receive reply from server\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		tfs_client_server_connection_poll_error_print(&result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+	uint64_t end_ns = tfs_bench_now();
+
+	// Find the operation and remove it from the window
+	size_t idx = 0;
+	while (idx < window->len && window->ops[idx].id != result.data.completion.id) { idx++; }
+	if (idx == window->len) {
+		fprintf(stderr, "Received reply to unknown request %" PRIu32 "\n", result.data.completion.id);
+		exit(EXIT_FAILURE);
+	}
+	InFlight op = window->ops[idx];
+	window->ops[idx] = window->ops[--window->len];
+
+	// Note: Rejected operations aren't retried, nor count towards the latencies, as they weren't executed.
+	if (result.data.completion.retry_after_ms != 0) {
+		stats->rejected[op.kind]++;
+		return true;
+	}
+	tfs_bench_histogram_record(&stats->latencies[op.kind], end_ns - op.start_ns);
+	if (!result.data.completion.command_successful) { stats->failed[op.kind]++; }
+
+	return true;
+}
+
+/// @brief Waits until @p until_ns, completing operations of the window meanwhile
+static void window_wait_until(
+	Window* window, TfsClientServerConnection* connection, ClientStats* stats, uint64_t until_ns) {
+	// If there's nothing to complete, just sleep
+	if (window->len == 0) {
+		struct timespec wake_up = {
+			.tv_sec = (time_t)(until_ns / 1000000000u),
+			.tv_nsec = (long)(until_ns % 1000000000u),
+		};
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_up, NULL) == EINTR) {}
+		return;
+	}
+
+	uint64_t now_ns;
+	while ((now_ns = tfs_bench_now()) < until_ns) {
+		struct timespec timeout = {
+			.tv_sec = (time_t)((until_ns - now_ns) / 1000000000u),
+			.tv_nsec = (long)((until_ns - now_ns) % 1000000000u),
+		};
+		// Note: Replies on a ring can't be polled for, so we just yield until then.
+		if (connection->ring != NULL) { sched_yield(); }
+		else {
+			struct pollfd fd = {.fd = connection->client_socket, .events = POLLIN, .revents = 0};
+			ppoll(&fd, 1, &timeout, NULL);
+		}
+		while (window_complete(window, connection, stats, false)) {}
+	}
+}
+
+static void run_client(const Config* config, const Tree* tree, Shared* shared, size_t idx) {
+	TfsClientServerConnection connection = connect_to_server(config);
+	ClientStats* stats = &shared->stats[idx];
+	uint64_t rng = config->seed ^ (0x9e3779b97f4a7c15u * (idx + 1));
+	Window window = {.ops = malloc(config->window * sizeof(InFlight)), .len = 0};
+	if (window.ops == NULL) {
+		fprintf(stderr, "Unable to allocate window of %zu operations\n", config->window);
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_barrier_wait(&shared->start);
+	uint64_t start_ns = tfs_bench_now();
+	uint64_t end_ns = start_ns + (uint64_t)(config->duration_secs * 1e9);
+	uint64_t next_op_ns = start_ns;
+
+	while (1) {
+		// Wait for a free slot in the window
+		while (window.len == config->window) { window_complete(&window, &connection, stats, true); }
+
+		// Find out when this operation should start, waiting until then in open-loop mode
+		uint64_t op_start_ns;
+		if (config->rate > 0) {
+			next_op_ns += (uint64_t)(-log(1 - rng_next_double(&rng)) * 1e9 / config->rate);
+			if (next_op_ns >= end_ns) { break; }
+			window_wait_until(&window, &connection, stats, next_op_ns);
+			op_start_ns = next_op_ns;
+		}
+		else {
+			op_start_ns = tfs_bench_now();
+			if (op_start_ns >= end_ns) { break; }
+		}
+
+		// Build and submit the command, completing operations while the server's queue is full
+		OpKind kind = pick_op_kind(config, &rng);
+		TfsCommand command = build_command(tree, kind, &rng);
+		TfsClientServerConnectionSubmitResult result;
+		while (!(result = tfs_client_server_connection_submit(&connection, &command)).success) {
+			if (result.data.err.kind != TfsClientServerConnectionSendCommandErrorWouldBlock) {
+				fprintf(stderr, "Unable to send command to server\n");
+				fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+				tfs_client_server_connection_send_command_error_print(&result.data.err, stderr);
+				exit(EXIT_FAILURE);
+			}
+			if (!window_complete(&window, &connection, stats, true)) { sched_yield(); }
+		}
+		window.ops[window.len++] = (InFlight){.id = result.data.id, .start_ns = op_start_ns, .kind = kind};
+
+		// Then complete any operations that already finished
+		while (window_complete(&window, &connection, stats, false)) {}
+	}
+
+	// Finally wait for all operations still in flight
+	while (window_complete(&window, &connection, stats, true)) {}
+
+	free(window.ops);
+	tfs_client_server_connection_destroy(&connection);
+}
+
+static void* client_thread_fn(void* arg) {
+	ClientData* data = arg;
+	run_client(data->config, data->tree, data->shared, data->idx);
+	return NULL;
+}
+
+/// @brief Returns the latency, in microseconds, at a given percentile
+static double percentile_us(const TfsBenchHistogram* latencies, double percentile) {
+	uint64_t latency_ns = tfs_bench_histogram_percentile(latencies, percentile);
+	return (double)latency_ns / 1e3;
+}
+
+/// @brief Prints a single line of results
+static void print_results_line(
+	const char* name, const TfsBenchHistogram* latencies, uint64_t failed, uint64_t rejected, double secs) {
+	printf("%s,%" PRIu64 ",%" PRIu64 ",%.0f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%" PRIu64 "\n",
+		name,
+		latencies->count,
+		failed,
+		(double)latencies->count / secs,
+		tfs_bench_histogram_mean(latencies) / 1e3,
+		percentile_us(latencies, 50),
+		percentile_us(latencies, 90),
+		percentile_us(latencies, 99),
+		percentile_us(latencies, 99.9),
+		(double)latencies->max / 1e3,
+		rejected);
+}
+
+static void print_results(const Config* config, const Shared* shared, uint64_t elapsed_ns) {
+	double secs = (double)elapsed_ns / 1e9;
+	fprintf(stderr,
+		"Ran %zu client %s for %.2fs (%s, %s)\n",
+		config->clients,
+		config->processes ? "processes" : "threads",
+		secs,
+		config->rate > 0 ? "open-loop" : "closed-loop",
+		config->shared_memory ? "shared-memory" : (config->session ? "session" : "socket"));
+
+	printf("op,count,failed,ops_per_sec,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,rejected\n");
+	TfsBenchHistogram all_latencies = tfs_bench_histogram_new();
+	uint64_t all_failed = 0;
+	uint64_t all_rejected = 0;
+	for (size_t kind = 0; kind < OpKindLen; kind++) {
+		TfsBenchHistogram latencies = tfs_bench_histogram_new();
+		uint64_t failed = 0;
+		uint64_t rejected = 0;
+		for (size_t n = 0; n < config->clients; n++) {
+			tfs_bench_histogram_merge(&latencies, &shared->stats[n].latencies[kind]);
+			failed += shared->stats[n].failed[kind];
+			rejected += shared->stats[n].rejected[kind];
+		}
+
+		print_results_line(op_kind_names[kind], &latencies, failed, rejected, secs);
+		tfs_bench_histogram_merge(&all_latencies, &latencies);
+		all_failed += failed;
+		all_rejected += rejected;
+	}
+	print_results_line("all", &all_latencies, all_failed, all_rejected, secs);
+}
+
+static uint64_t rng_next(uint64_t* state) {
+	// Note: xorshift64*, which only requires a non-zero state
+	if (*state == 0) { *state = 0x9e3779b97f4a7c15u; }
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545f4914f6cdd1du;
+}
+
+static double rng_next_double(uint64_t* state) {
+	return (double)(rng_next(state) >> 11) / (double)((uint64_t)1 << 53);
+}
+
+static ZipfSampler zipf_sampler_new(size_t len, double exponent, uint64_t* rng) {
+	ZipfSampler sampler = {
+		.cdf = malloc(len * sizeof(double)),
+		.items = malloc(len * sizeof(size_t)),
+		.len = len,
+	};
+	if (sampler.cdf == NULL || sampler.items == NULL) {
+		fprintf(stderr, "Unable to allocate zipf sampler for %zu items\n", len);
+		exit(EXIT_FAILURE);
+	}
+
+	// Rank `n` has a weight of `1 / (n + 1)^exponent`
+	double total = 0;
+	for (size_t n = 0; n < len; n++) {
+		total += 1 / pow((double)(n + 1), exponent);
+		sampler.cdf[n] = total;
+	}
+	for (size_t n = 0; n < len; n++) { sampler.cdf[n] /= total; }
+
+	// Shuffle the items over the ranks
+	for (size_t n = 0; n < len; n++) { sampler.items[n] = n; }
+	for (size_t n = len - 1; n > 0 && n != (size_t)-1; n--) {
+		size_t other = (size_t)(rng_next(rng) % (n + 1));
+		size_t tmp = sampler.items[n];
+		sampler.items[n] = sampler.items[other];
+		sampler.items[other] = tmp;
+	}
+
+	return sampler;
+}
+
+static size_t zipf_sampler_sample(const ZipfSampler* self, uint64_t* rng) {
+	// Binary search for the first rank whose cumulative probability is above `value`.
+	double value = rng_next_double(rng);
+	size_t low = 0;
+	size_t high = self->len - 1;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (self->cdf[mid] < value) { low = mid + 1; }
+		else {
+			high = mid;
+		}
+	}
+
+	return self->items[low];
+}
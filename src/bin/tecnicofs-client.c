@@ -2,40 +2,86 @@
 /// @brief Filesystem client
 /// @details
 /// This file serves as the client to the tfs.
+///
+/// The input file is parsed all at once, in parallel, before any command is
+/// sent, see #tfs_command_file_parse.
+///
+/// With `-P`, it instead reads the size of the server's executor pool, pins
+/// it to the given size, or, with `auto`, lets the server adapt it again.
 /// @note
 /// All static functions here, when encountering an error,
 /// will simply report it and exit the program, as opposed
 /// to returning an error.
 
-#include <ctype.h>			// isspace
-#include <errno.h>			// errno
-#include <stdio.h>			// fprintf, stderr
-#include <stdlib.h>			// size_t
-#include <tfs/client-api.h> // tfs_client_*
-
-/// @brief Processes all input from `in`, sending it to the server at `connection`
+#include <errno.h>			  // errno
+#include <fcntl.h>			  // open, O_RDONLY
+#include <inttypes.h>		  // PRIu32
+#include <stdio.h>			  // fprintf, stderr
+#include <stdlib.h>			  // size_t, strtoul
+#include <tfs/client-api.h>	  // tfs_client_*
+#include <tfs/command/file.h> // tfs_command_file_*
+#include <tfs/protocol.h>	  // TFS_PROTOCOL_MAX_BATCH_LEN, TFS_PROTOCOL_POOL_ADAPT
+#include <tfs/util.h>		  // tfs_min_size_t
+#include <unistd.h>			  // close, sysconf, STDIN_FILENO
+
+/// @brief Processes all commands in `file`, sending them to the server at `connection`
 /// @param connection The server connection to send commands to
-/// @param in Input file to read commands from
-static void process_input(TfsClientServerConnection* connection, FILE* in);
-
-/// @brief Opens the input file
-/// @param in_filename Filename of the file to open in `in`. Or '-' for stdin.
-/// @param[out] in Opened input file.
-static void open_input(const char* in_filename, FILE** in);
+/// @param file Command file with all commands
+/// @param batch_size Maximum number of consecutive commands to send in a single message
+static void process_input(TfsClientServerConnection* connection, TfsCommandFile* file, size_t batch_size);
 
-/// @brief Closes the input file
-/// @param in The input file.
-static void close_input(FILE** in);
+/// @brief Sends a batch of commands to the server and destroys them
+/// @param connection The server connection to send commands to
+/// @param commands The commands to send
+/// @param lines Line of each command
+/// @param commands_len Number of commands
+/// @details
+/// If the batch doesn't fit in a single message, it's split in two.
+static void send_batch( //
+	TfsClientServerConnection* connection,
+	TfsCommand* commands,
+	const size_t* lines,
+	size_t commands_len //
+);
+
+/// @brief Reads, and optionally changes, the size of the server's executor pool, printing it
+/// @param server_path Path of the server's socket
+/// @param size_str The size to pin, `auto` to let the server adapt it, or `NULL` to only read it
+static void administer_pool(const char* server_path, const char* size_str);
+
+/// @brief Opens and parses the input file
+/// @param in_filename Filename of the file to parse. Or '-' for stdin.
+/// @return All commands in the input file
+static TfsCommandFile parse_input(const char* in_filename);
 
 int main(int argc, char* argv[]) {
-	if (argc != 3) {
-		fprintf(stderr, "Usage: ./tecnicofs-client <input-file> <server-socket-name>\n");
+	if (argc != 3 && argc != 4) {
+		fprintf(stderr,
+			"Usage: ./tecnicofs-client <input-file> <server-socket-name> [<batch-size>]\n"
+			"       ./tecnicofs-client -P [<pool-size>|auto] <server-socket-name>\n");
 		return EXIT_FAILURE;
 	}
 
-	// Open the input file
-	FILE* in;
-	open_input(argv[1], &in);
+	// If requested, administer the pool instead
+	if (strcmp(argv[1], "-P") == 0) {
+		administer_pool(argv[argc - 1], argc == 4 ? argv[2] : NULL);
+		return EXIT_SUCCESS;
+	}
+
+	// Get the batch size
+	// Note: With a batch size of 1, each command is sent on it's own.
+	size_t batch_size = 1;
+	if (argc == 4) {
+		char* batch_size_end;
+		batch_size = strtoul(argv[3], &batch_size_end, 0);
+		if (batch_size_end[0] != '\0' || batch_size == 0 || batch_size > TFS_PROTOCOL_MAX_BATCH_LEN) {
+			fprintf(stderr, "Batch size must be between 1 and %d\n", TFS_PROTOCOL_MAX_BATCH_LEN);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Parse the input file
+	TfsCommandFile file = parse_input(argv[1]);
 
 	// Start the client-server connection
 	const char* server_path = argv[2];
@@ -49,47 +95,33 @@ int main(int argc, char* argv[]) {
 	printf("Mounted on the tfs server! (socket = %s)\n", server_path);
 
 	// Process all input
-	process_input(&connection, in);
+	process_input(&connection, &file, batch_size);
 
 	tfs_client_server_connection_destroy(&connection);
-	close_input(&in);
+	tfs_command_file_destroy(&file);
 
 	return EXIT_SUCCESS;
 }
 
-static void process_input(TfsClientServerConnection* connection, FILE* in) {
-	for (size_t cur_line = 1;; cur_line++) {
-		// Skip any whitespace
-		int last_char;
-		while (last_char = fgetc(in), isspace(last_char)) {}
-		ungetc(last_char, in);
-
-		// If it starts with '#', skip this line
-		int peek = fgetc(in);
-		if (peek == '#') {
-			while (fgetc(in) != '\n' && !feof(in)) {}
-			continue;
-		}
-		else {
-			ungetc(peek, in);
-		}
-
-		// If the line is empty, stop
-		if (feof(in)) { break; }
-
-		// Try to parse it
-		TfsCommandParseResult parse_result = tfs_command_parse(in);
-		if (!parse_result.success) {
-			fprintf(stderr, "Unable to parse line %zu\n", cur_line);
-			tfs_command_parse_error_print(&parse_result.data.err, stderr);
-			exit(EXIT_FAILURE);
-		}
+static void process_input(TfsClientServerConnection* connection, TfsCommandFile* file, size_t batch_size) {
+	// Note: Commands are already in order, along with their lines, so each batch is just a slice of them.
+	for (size_t start = 0; start < file->len; start += batch_size) {
+		size_t batch_len = tfs_min_size_t(batch_size, file->len - start);
+		send_batch(connection, file->commands + start, file->lines + start, batch_len);
+	}
+}
 
-		// Then send it to the server
-		TfsCommand command = parse_result.data.command;
+static void send_batch( //
+	TfsClientServerConnection* connection,
+	TfsCommand* commands,
+	const size_t* lines,
+	size_t commands_len //
+) {
+	// Note: Commands are sent on their own when not batching, so older servers still understand us.
+	if (commands_len == 1) {
 		TfsClientServerConnectionSendCommandResult send_result =
-			tfs_client_server_connection_send_command(connection, &command);
-		tfs_command_destroy(&command);
+			tfs_client_server_connection_send_command(connection, &commands[0]);
+		tfs_command_destroy(&commands[0]);
 		if (!send_result.success) {
 			fprintf(stderr, "Unable to send command to server\n");
 			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
@@ -98,36 +130,102 @@ static void process_input(TfsClientServerConnection* connection, FILE* in) {
 		}
 
 		if (!send_result.data.command_successful) {
-			fprintf(stderr, "Failed to execute command in line %zu\n", cur_line);
+			fprintf(stderr, "Failed to execute command in line %zu\n", lines[0]);
+		}
+		return;
+	}
+
+	bool commands_successful[commands_len];
+	TfsClientServerConnectionSendCommandsResult send_result =
+		tfs_client_server_connection_send_commands(connection, commands, commands_len, commands_successful);
+
+	// If the batch was too large, split it in two
+	if (!send_result.success && send_result.data.err.kind == TfsClientServerConnectionSendCommandErrorTooLarge) {
+		size_t half_len = commands_len / 2;
+		send_batch(connection, commands, lines, half_len);
+		send_batch(connection, commands + half_len, lines + half_len, commands_len - half_len);
+		return;
+	}
+
+	for (size_t n = 0; n < commands_len; n++) { tfs_command_destroy(&commands[n]); }
+	if (!send_result.success) {
+		fprintf(stderr, "Unable to send commands to server\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		tfs_client_server_connection_send_command_error_print(&send_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t n = 0; n < commands_len; n++) {
+		if (!commands_successful[n]) { fprintf(stderr, "Failed to execute command in line %zu\n", lines[n]); }
+	}
+}
+
+static void administer_pool(const char* server_path, const char* size_str) {
+	// Parse the size, if any
+	// Note: A size of `0` only reads it.
+	uint32_t size = 0;
+	if (size_str != NULL && strcmp(size_str, "auto") == 0) { size = TFS_PROTOCOL_POOL_ADAPT; }
+	else if (size_str != NULL) {
+		char* size_end;
+		unsigned long value = strtoul(size_str, &size_end, 0);
+		if (size_end[0] != '\0' || value == 0 || value >= TFS_PROTOCOL_POOL_ADAPT) {
+			fprintf(stderr, "Pool size must be at least 1, or 'auto'\n");
+			exit(EXIT_FAILURE);
 		}
+		size = (uint32_t)value;
 	}
+
+	TfsClientServerConnectionNewResult connection_result = tfs_client_server_connection_new(server_path);
+	if (!connection_result.success) {
+		fprintf(stderr, "Unable to mount socket: %s\n", server_path);
+		tfs_client_server_connection_new_error_print(&connection_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+	TfsClientServerConnection connection = connection_result.data.connection;
+
+	TfsClientServerConnectionPoolResult pool_result = tfs_client_server_connection_pool(&connection, size);
+	tfs_client_server_connection_destroy(&connection);
+	if (!pool_result.success) {
+		fprintf(stderr, "Unable to administer server pool\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		tfs_client_server_connection_send_command_error_print(&pool_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	TfsClientServerConnectionPool pool = pool_result.data.pool;
+	if (pool.max == 0) {
+		printf("Server has no adaptive pool\n");
+		return;
+	}
+	printf("Pool: %" PRIu32 " threads (%" PRIu32 " running, between %" PRIu32 " and %" PRIu32 ", %s)\n",
+		pool.size,
+		pool.live,
+		pool.min,
+		pool.max,
+		pool.pinned ? "pinned" : "adaptive");
 }
 
-static void open_input(const char* in_filename, FILE** in) {
+static TfsCommandFile parse_input(const char* in_filename) {
 	// Open the input file
 	// Note: If we receive '-', use stdin
-	if (strcmp(in_filename, "-") == 0) { *in = stdin; }
-	else {
-		*in = fopen(in_filename, "r");
-		if (*in == NULL) {
+	int in = STDIN_FILENO;
+	if (strcmp(in_filename, "-") != 0) {
+		in = open(in_filename, O_RDONLY);
+		if (in == -1) {
 			fprintf(stderr, "Unable to open input file '%s'\n", in_filename);
 			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
 			exit(EXIT_FAILURE);
 		}
 	}
-}
 
-static void close_input(FILE** in) {
-	// If `in` isn't stdin, close it
-	if (*in != stdin) {
-		int res = fclose(*in);
-		if (res != 0) {
-			fprintf(stderr, "Unable to close input file\n");
-			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
+	// Then parse it with a thread per processor
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	TfsCommandFileParseResult parse_result = tfs_command_file_parse(in, processors > 0 ? (size_t)processors : 1);
+	if (in != STDIN_FILENO) { close(in); }
+	if (!parse_result.success) {
+		tfs_command_file_parse_error_print(&parse_result.data.err, stderr);
+		exit(EXIT_FAILURE);
 	}
 
-	// Then set it to `NULL`
-	*in = NULL;
+	return parse_result.data.file;
 }
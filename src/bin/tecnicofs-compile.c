@@ -0,0 +1,78 @@
+/// @file
+/// @brief Command file compiler
+/// @details
+/// This file compiles a text command file into a compiled one, see
+/// #TfsCommandCompiled, which the server and client then load without
+/// parsing any of it.
+/// @note
+/// All static functions here, when encountering an error,
+/// will simply report it and exit the program, as opposed
+/// to returning an error.
+
+#include <errno.h>				  // errno
+#include <fcntl.h>				  // open, O_RDONLY
+#include <stdio.h>				  // fprintf, fopen, fclose, stderr
+#include <stdlib.h>				  // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				  // strcmp, strerror
+#include <tfs/command/compiled.h> // tfs_command_compiled_write
+#include <tfs/command/file.h>	  // tfs_command_file_*
+#include <unistd.h>				  // close, sysconf, STDIN_FILENO
+
+/// @brief Opens and parses the input file
+/// @param in_filename Filename of the file to parse. Or '-' for stdin.
+/// @return All commands in the input file
+static TfsCommandFile parse_input(const char* in_filename);
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: ./tecnicofs-compile <input-file> <output-file>\n");
+		return EXIT_FAILURE;
+	}
+
+	TfsCommandFile file = parse_input(argv[1]);
+
+	// Note: Compiling an already compiled file just writes it again.
+	FILE* out = fopen(argv[2], "wb");
+	if (out == NULL) {
+		fprintf(stderr, "Unable to open output file '%s'\n", argv[2]);
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	bool written = tfs_command_compiled_write(file.commands, file.lines, file.len, out);
+	if (fclose(out) != 0) { written = false; }
+	if (!written) {
+		fprintf(stderr, "Unable to write compiled command file '%s'\n", argv[2]);
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	printf("Compiled %zu commands to '%s'\n", file.len, argv[2]);
+	tfs_command_file_destroy(&file);
+
+	return EXIT_SUCCESS;
+}
+
+static TfsCommandFile parse_input(const char* in_filename) {
+	// Open the input file
+	// Note: If we receive '-', use stdin
+	int in = STDIN_FILENO;
+	if (strcmp(in_filename, "-") != 0) {
+		in = open(in_filename, O_RDONLY);
+		if (in == -1) {
+			fprintf(stderr, "Unable to open input file '%s'\n", in_filename);
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// Then parse it with a thread per processor
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	TfsCommandFileParseResult parse_result = tfs_command_file_parse(in, processors > 0 ? (size_t)processors : 1);
+	if (in != STDIN_FILENO) { close(in); }
+	if (!parse_result.success) {
+		tfs_command_file_parse_error_print(&parse_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	return parse_result.data.file;
+}
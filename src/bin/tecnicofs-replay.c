@@ -0,0 +1,237 @@
+/// @file
+/// @brief Recorded traffic replayer
+/// @details
+/// This file replays a recording, see #TfsCommandRecording, against a server,
+/// re-issuing each command at the time it was recorded.
+///
+/// Each recorded client is replayed by it's own thread, through it's own
+/// connection, so commands of different clients are sent concurrently, just
+/// as they were received, while those of a single client are sent in order,
+/// each only after the previous one's reply.
+///
+/// With `-s`, the recording is replayed at the given multiple of it's speed,
+/// or, with `0`, as fast as possible, with each client sending it's next
+/// command as soon as the previous one is replied to.
+/// @note
+/// All static functions here, when encountering an error,
+/// will simply report it and exit the program, as opposed
+/// to returning an error.
+
+#include <errno.h>				   // errno
+#include <pthread.h>			   // pthread_create, pthread_join
+#include <stdint.h>				   // uint64_t
+#include <stdio.h>				   // fprintf, printf, fopen, fclose, stderr
+#include <stdlib.h>				   // size_t, strtod, malloc, calloc, free, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				   // strerror
+#include <tfs/client-api.h>		   // tfs_client_*
+#include <tfs/command/recording.h> // tfs_command_recording_*
+#include <tfs/util.h>			   // tfs_max_size_t, tfs_now_ns
+#include <time.h>				   // clock_nanosleep, CLOCK_MONOTONIC
+#include <unistd.h>				   // getopt
+
+/// @brief Data received by each client thread
+typedef struct ClientData {
+	/// @brief Number of the client
+	size_t client;
+
+	/// @brief The recording
+	const TfsCommandRecording* recording;
+
+	/// @brief Indices of all of the client's entries, in order
+	size_t* entries;
+
+	/// @brief Number of entries
+	size_t len;
+
+	/// @brief Path of the server's socket
+	const char* server_path;
+
+	/// @brief Time the replay started, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t start_ns;
+
+	/// @brief Multiple of the recorded speed to replay at, or `0` to replay as fast as possible
+	double speed;
+
+	/// @brief Number of commands the server failed to execute
+	size_t failed;
+
+	/// @brief Longest time a command was sent after it was due, in nanoseconds
+	uint64_t max_lag_ns;
+} ClientData;
+
+/// @brief Loads the recording
+/// @param filename Filename of the recording
+static TfsCommandRecording load_recording(const char* filename);
+
+/// @brief Replays all of a client's commands, see #ClientData
+static void* client_thread_fn(void* arg);
+
+/// @brief Prints the usage of this program to stderr
+static void print_usage(void);
+
+int main(int argc, char* argv[]) {
+	// Parse all options
+	double speed = 1.0;
+	int option;
+	while ((option = getopt(argc, argv, "s:")) != -1) {
+		switch (option) {
+			case 's': {
+				char* speed_end;
+				speed = strtod(optarg, &speed_end);
+				if (speed_end == optarg || speed_end[0] != '\0' || !(speed >= 0.0)) {
+					fprintf(stderr, "Speed must be a non-negative number\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			default: {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	if (argc - optind != 2) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	TfsCommandRecording recording = load_recording(argv[optind]);
+
+	// Split the entries by client
+	// Note: Each client's entries are stored contiguously, in order, in a single array.
+	// Note: We allocate at least one of each, so an empty recording isn't mistaken for a failed allocation.
+	size_t* entries = malloc(tfs_max_size_t(1, recording.len) * sizeof(size_t));
+	size_t* clients_len = calloc(tfs_max_size_t(1, recording.clients), sizeof(size_t));
+	ClientData* clients = malloc(tfs_max_size_t(1, recording.clients) * sizeof(ClientData));
+	pthread_t* threads = malloc(tfs_max_size_t(1, recording.clients) * sizeof(pthread_t));
+	if (entries == NULL || clients_len == NULL || clients == NULL || threads == NULL) {
+		fprintf(stderr, "Unable to allocate clients\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t n = 0; n < recording.len; n++) { clients_len[recording.entries[n].client]++; }
+	size_t offset = 0;
+	for (size_t n = 0; n < recording.clients; n++) {
+		clients[n] = (ClientData){
+			.client = n,
+			.recording = &recording,
+			.entries = entries + offset,
+			.len = 0,
+			.server_path = argv[optind + 1],
+			.start_ns = 0,
+			.speed = speed,
+			.failed = 0,
+			.max_lag_ns = 0,
+		};
+		offset += clients_len[n];
+	}
+	free(clients_len);
+	for (size_t n = 0; n < recording.len; n++) {
+		ClientData* client = &clients[recording.entries[n].client];
+		client->entries[client->len++] = n;
+	}
+
+	// Then replay each client on it's own thread
+	// Note: All clients share the same start, set just before any of them is created.
+	uint64_t start_ns = tfs_now_ns(CLOCK_MONOTONIC);
+	for (size_t n = 0; n < recording.clients; n++) {
+		clients[n].start_ns = start_ns;
+		int res = pthread_create(&threads[n], NULL, client_thread_fn, &clients[n]);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create client thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+
+	size_t failed = 0;
+	uint64_t max_lag_ns = 0;
+	for (size_t n = 0; n < recording.clients; n++) {
+		int res = pthread_join(threads[n], NULL);
+		if (res != 0) {
+			fprintf(stderr, "Unable to join client thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+		failed += clients[n].failed;
+		if (clients[n].max_lag_ns > max_lag_ns) { max_lag_ns = clients[n].max_lag_ns; }
+	}
+	uint64_t elapsed_ns = tfs_now_ns(CLOCK_MONOTONIC) - start_ns;
+
+	printf("Replayed %zu commands from %zu clients in %.4f seconds\n",
+		recording.len,
+		recording.clients,
+		(double)elapsed_ns / 1e9);
+	printf("%zu commands failed, sent at most %.4f seconds late\n", failed, (double)max_lag_ns / 1e9);
+
+	free(threads);
+	free(clients);
+	free(entries);
+	tfs_command_recording_destroy(&recording);
+
+	return EXIT_SUCCESS;
+}
+
+static TfsCommandRecording load_recording(const char* filename) {
+	FILE* in = fopen(filename, "rb");
+	if (in == NULL) {
+		fprintf(stderr, "Unable to open recording '%s'\n", filename);
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	TfsCommandRecordingLoadResult load_result = tfs_command_recording_load(in);
+	fclose(in);
+	if (!load_result.success) {
+		fprintf(stderr, "Unable to load recording '%s'\n", filename);
+		tfs_command_recording_load_error_print(&load_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	return load_result.data.recording;
+}
+
+static void* client_thread_fn(void* arg) {
+	ClientData* data = arg;
+
+	// Note: Each client gets it's own connection, and so it's own address, just as when recorded.
+	TfsClientServerConnectionNewResult connection_result = tfs_client_server_connection_new(data->server_path);
+	if (!connection_result.success) {
+		fprintf(stderr, "Unable to connect client #%zu to server\n", data->client);
+		tfs_client_server_connection_new_error_print(&connection_result.data.err, stderr);
+		exit(EXIT_FAILURE);
+	}
+	TfsClientServerConnection connection = connection_result.data.connection;
+
+	for (size_t n = 0; n < data->len; n++) {
+		const TfsCommandRecordingEntry* entry = &data->recording->entries[data->entries[n]];
+
+		// Wait until the command is due, unless replaying as fast as possible
+		// Note: If we're already late, because the previous reply took longer than recorded, we send it right away.
+		if (data->speed > 0.0) {
+			uint64_t due_ns = data->start_ns + (uint64_t)((double)entry->time_ns / data->speed);
+			struct timespec due = {
+				.tv_sec = (time_t)(due_ns / 1000000000u),
+				.tv_nsec = (long)(due_ns % 1000000000u),
+			};
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR) {}
+
+			uint64_t lag_ns = tfs_now_ns(CLOCK_MONOTONIC) - due_ns;
+			if (lag_ns > data->max_lag_ns) { data->max_lag_ns = lag_ns; }
+		}
+
+		TfsClientServerConnectionSendCommandResult send_result =
+			tfs_client_server_connection_send_command(&connection, &entry->command);
+		if (!send_result.success) {
+			fprintf(stderr, "Unable to send command of entry #%zu to server\n", data->entries[n]);
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			tfs_client_server_connection_send_command_error_print(&send_result.data.err, stderr);
+			exit(EXIT_FAILURE);
+		}
+		if (!send_result.data.command_successful) { data->failed++; }
+	}
+
+	tfs_client_server_connection_destroy(&connection);
+	return NULL;
+}
+
+static void print_usage(void) {
+	fprintf(stderr, "Usage: ./tecnicofs-replay [-s <speed>] <recording-file> <server-socket-name>\n");
+}
@@ -6,285 +6,2640 @@
 /// All static functions here, when encountering an error,
 /// will simply report it and exit the program, as opposed
 /// to returning an error.
+///
+/// Workers serve their messages through an io_uring, keeping as many receives
+/// posted as the socket's backlog calls for, and handing all of their replies
+/// and new receives to the kernel in a single syscall. Prints are written
+/// through a second ring, and waited on, so their reply reports if they failed.
+/// If io_uring isn't available, or with `-U`, they fall back to batched receives instead.
+///
+/// With `-G`, the server instead binds a datagram socket at `<socket-name>.<n>`
+/// for each of the given number of groups, each drained by it's own group of
+/// workers, with worker `n` receiving from socket `n` modulo the number of
+/// groups, so workers of different groups never contend on a receive queue.
+/// Clients pick one of the sockets by themselves, see #tfs_client_server_connection_new.
+///
+/// With `-S`, the server also listens on a `SOCK_SEQPACKET` session socket,
+/// keeping a #TfsServerSession for each connected client. Sessions are served
+/// by their own threads, sharing a single epoll instance, each taking one
+/// ready session at a time. The datagram socket keeps serving as before.
+///
+/// With `-W`, datagram messages are instead only received by the workers,
+/// which classify them by their commands' kinds and push them to the queue
+/// of their #TfsServerSchedulerClass, to be executed, and replied to, by a
+/// separate pool of lanes, with a configurable share of lanes for each class.
+/// The background lanes, which execute prints, run at a lower priority, set
+/// by `-N`, so they never take time from the latency-critical lanes.
+///
+/// With `-A`, datagram messages are instead admitted into a bounded queue per
+/// client, see #TfsServerAdmission, from which as many executors as workers
+/// take them in deficit round-robin order. Messages from a client whose queue
+/// is full are rejected right away with a busy reply.
+///
+/// With `-P`, datagram messages are instead pushed to the queue of an adaptive
+/// pool of executors, see #TfsServerPool, whose size is adapted between the
+/// given bounds to the queue delay, lock blocking and CPU time it observes.
+/// Pool requests, see #TfsProtocolKindPool, read or pin it's size.
+///
+/// With `-C`, workers instead execute each message in a coroutine, see
+/// #TfsCoroutine, of which each runs up to the given number. A coroutine
+/// whose inode lock is contended parks, and it's worker moves on to other
+/// messages, rather than sleeping until the lock is free. Lookups are then
+/// never coalesced, as waiting for another coroutine would sleep as well.
+///
+/// With `-D`, workers instead push the datagram messages they receive to their
+/// own deque, see #TfsServerStealing, executing them newest first, while idle
+/// workers steal the oldest, so a worker stuck on a slow message doesn't hold
+/// back the rest of it's batch. The commands of a single message are still
+/// executed in order, by whichever worker takes it.
+///
+/// With `-B`, the first workers are instead each pinned to one of the given
+/// cpus, and busy-poll the socket, see #tfs_server_message_batch_poll_recv,
+/// sparing latency-critical messages the wakeup of a blocking receive. They
+/// only block once idle for longer than set by `-b`. Rings attached through
+/// them are busy-polled as well, by session threads that may run on any of the
+/// server's cpus, rather than contending for their worker's.
+///
+/// Concurrent lookups of the same path share a single execution, see
+/// #TfsServerSingleflight, unless a lease was granted on them, as a shared
+/// execution may have started before the lease was. `SIGUSR2` prints the
+/// coalescing statistics, from a thread waiting on it, as printing them isn't
+/// safe from a signal handler.
+///
+/// Given a command file, an output file and a number of threads instead, the
+/// file system is run in-process, with no sockets. The command file is parsed
+/// at once, see #TfsCommandFile, after which a producer thread pushes it's
+/// commands into a bounded #TfsCommandQueue, from which the given number of
+/// consumer threads execute them, and the final file system is printed to
+/// the output file, along with the time taken to stdout. Compiled command
+/// files, see #TfsCommandCompiled, are loaded without parsing instead.
+///
+/// With `-R`, the command file is instead replayed by a #TfsCommandReplay,
+/// which executes commands in parallel only when they access disjoint paths,
+/// so the results and final file system are the same as if executed in order.
+///
+/// With `-r`, every command the server executes is recorded, along with when
+/// and from which client, to the given file by a #TfsServerRecorder, to be
+/// replayed later by `tecnicofs-replay`. Malformed commands aren't recorded,
+/// nor are those received while the recorder's buffers are full, which are
+/// instead counted, and reported once the server exits.
 
-#include <assert.h>				 // assert
-#include <ctype.h>				 // isspace
-#include <errno.h>				 // errno
-#include <pthread.h>			 // pthread_create, pthread_join
-#include <stddef.h>				 // size_t
-#include <stdio.h>				 // fprintf, stderr, stdout, stdin
-#include <stdlib.h>				 // EXIT_FAILURE,
-#include <string.h>				 // strerror
-#include <sys/socket.h>			 // socket, bind
-#include <sys/types.h>			 // ssize_t, AF_UNIX, SOCK_DGRAM
-#include <sys/un.h>				 // sockaddr_un
-#include <tfs/command/command.h> // TfsCommand
-#include <tfs/fs.h>				 // TfsFs
-#include <tfs/rw_lock.h>		 // TfsRwLock
-#include <time.h>				 // timespec, clock_gettime
-#include <unistd.h>				 // unlink
+#include <assert.h>					  // assert
+#include <ctype.h>					  // isspace
+#include <errno.h>					  // errno, EINTR, EAGAIN
+#include <fcntl.h>					  // open, O_*
+#include <inttypes.h>				  // PRIu32, PRIu64
+#include <pthread.h>				  // pthread_create, pthread_join, pthread_*affinity_np, pthread_kill
+#include <sched.h>					  // sched_yield, sched_getaffinity, cpu_set_t, CPU_SET
+#include <signal.h>					  // sigaction, sigwait, pthread_sigmask, SIGUSR1, SIGUSR2
+#include <stddef.h>					  // size_t
+#include <stdint.h>					  // uint32_t, UINT32_MAX
+#include <stdio.h>					  // fprintf, stderr, stdout, stdin
+#include <stdlib.h>					  // EXIT_FAILURE, malloc, free
+#include <string.h>					  // strerror, memchr, memcpy, memset
+#include <sys/epoll.h>				  // epoll_*
+#include <sys/resource.h>			  // setpriority, PRIO_PROCESS
+#include <sys/socket.h>				  // socket, bind, listen, accept4
+#include <sys/syscall.h>			  // SYS_gettid
+#include <sys/types.h>				  // ssize_t, AF_UNIX, SOCK_DGRAM
+#include <sys/un.h>					  // sockaddr_un
+#include <tfs/command/command.h>	  // TfsCommand
+#include <tfs/command/file.h>		  // TfsCommandFile
+#include <tfs/command/queue.h>		  // TfsCommandQueue
+#include <tfs/command/replay.h>		  // TfsCommandReplay
+#include <tfs/coroutine.h>			  // TfsCoroutine
+#include <tfs/fs.h>					  // TfsFs
+#include <tfs/protocol.h>			  // tfs_protocol_*
+#include <tfs/rw_lock.h>			  // TfsRwLock
+#include <tfs/server/admission.h>	  // TfsServerAdmission
+#include <tfs/server/leases.h>		  // TfsServerLeases
+#include <tfs/server/message-batch.h> // TfsServerMessageBatch
+#include <tfs/server/pool.h>		  // TfsServerPool
+#include <tfs/server/recorder.h>	  // TfsServerRecorder
+#include <tfs/server/scheduler.h>	  // TfsServerScheduler
+#include <tfs/server/session.h>		  // TfsServerSession
+#include <tfs/server/singleflight.h>  // TfsServerSingleflight
+#include <tfs/server/stealing.h>	  // TfsServerStealing
+#include <tfs/server/uring.h>		  // TfsServerUring
+#include <tfs/shm-ring.h>			  // TfsShmRing
+#include <tfs/trace.h>				  // tfs_trace_*
+#include <time.h>					  // timespec, clock_gettime
+#include <unistd.h>					  // unlink, getopt, dup, close
+
+/// @brief Maximum number of leases granted at once
+#define MAX_LEASES 4096
+
+/// @brief Maximum number of messages served from a session before letting other sessions be served
+#define SESSION_MAX_MESSAGES 32
+
+/// @brief Backlog of the session socket
+#define SESSION_BACKLOG 128
+
+/// @brief Capacity of each scheduling class' queue
+#define SCHEDULER_CAPACITY 1024
+
+/// @brief Maximum number of clients with their own admission queue at once
+#define ADMISSION_MAX_CLIENTS 256
+
+/// @brief Commands each client may execute every admission round
+#define ADMISSION_QUANTUM 8
+
+/// @brief Capacity of the adaptive pool's queue
+#define POOL_CAPACITY 1024
+
+/// @brief Maximum number of busy-polling workers
+#define BUSY_POLL_MAX_WORKERS 64
+
+/// @brief Capacity of each worker's deque, when stealing work
+#define DEQUE_CAPACITY 256
+
+/// @brief Capacity of the queue of commands read from a command file
+#define COMMAND_QUEUE_CAPACITY 1024
+
+/// @brief Size of each coroutine's stack
+#define COROUTINE_STACK_SIZE (256 * 1024)
+
+/// @brief Number of rounds with every coroutine parked a coroutine worker yields for, before sleeping instead
+#define COROUTINE_MAX_YIELDS 16
+
+/// @brief Time a coroutine worker sleeps for once every coroutine stayed parked for long, in nanoseconds
+#define COROUTINE_PARKED_SLEEP_NS 50000
+
+/// @brief Kinds of operations an io_uring worker waits on
+/// @details
+/// These are stored in the low #URING_OP_BITS bits of each operation's user data.
+typedef enum UringOp {
+	/// @brief Receive of a slot's message
+	UringOpRecv = 0,
+
+	/// @brief Send of a slot's reply
+	UringOpSend = 1,
+} UringOp;
+
+/// @brief Number of low bits of an io_uring operation's user data holding it's kind
+#define URING_OP_BITS 1
+
+/// @brief Mask of the kind of an io_uring operation's user data
+#define URING_OP_MASK ((uint64_t)((1 << URING_OP_BITS) - 1))
+
+/// @brief A message served by an io_uring worker
+typedef struct UringSlot {
+	/// @brief The message
+	char message[TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY];
+
+	/// @brief It's reply
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+
+	/// @brief Address of the sender
+	struct sockaddr_un address;
+
+	/// @brief Ancillary data of the message
+	char control[TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY];
+
+	/// @brief Buffer of the message
+	struct iovec message_iovec;
+
+	/// @brief Buffer of the reply
+	struct iovec reply_iovec;
+
+	/// @brief Header of the message
+	struct msghdr message_header;
+
+	/// @brief Header of the reply
+	struct msghdr reply_header;
+} UringSlot;
+
+/// @brief An io_uring worker
+typedef struct UringWorker {
+	/// @brief The ring
+	TfsServerUring uring;
+
+	/// @brief Ring print writes are waited on through
+	/// @details
+	/// This is separate from @ref uring, so waiting on a write never
+	/// consumes the completions of the slots' operations.
+	TfsServerUring print_uring;
+
+	/// @brief All slots
+	UringSlot* slots;
+
+	/// @brief Number of slots
+	size_t slots_len;
+
+	/// @brief Number of receives to keep posted
+	size_t target;
+
+	/// @brief Number of receives posted
+	size_t recvs_posted;
+
+	/// @brief Indices of all slots without any operation posted
+	size_t* idle_slots;
+
+	/// @brief Number of idle slots
+	size_t idle_slots_len;
+} UringWorker;
 
 /// @brief Data received by each worker
 typedef struct WorkerData {
 	/// @brief File system
 	TfsFs* fs;
 
-	/// @brief Our socket
-	int server_socket;
-} WorkerData;
+	/// @brief Our socket
+	int server_socket;
+
+	/// @brief Maximum number of messages each worker receives at once
+	size_t max_batch;
+
+	/// @brief Leases granted on lookups
+	TfsServerLeases* leases;
+
+	/// @brief If workers should serve their messages through an io_uring
+	bool use_uring;
+
+	/// @brief The io_uring worker running, if any
+	/// @details
+	/// Each io_uring worker sets this on it's own copy of the data.
+	UringWorker* uring;
+
+	/// @brief Our session socket, or `-1` if none
+	int session_socket;
+
+	/// @brief Epoll instance of the session socket and all sessions
+	int session_epoll;
+
+	/// @brief Scheduler datagram messages are pushed to, if scheduling them to lanes
+	TfsServerScheduler* scheduler;
+
+	/// @brief Lookups in flight
+	/// @details
+	/// Writes are reported to it even by workers that don't coalesce lookups.
+	TfsServerSingleflight* singleflight;
+
+	/// @brief If lookups are coalesced through @ref singleflight
+	bool coalesce;
+
+	/// @brief Admission control datagram messages are admitted into, if any
+	TfsServerAdmission* admission;
+
+	/// @brief Adaptive pool datagram messages are pushed to, if any
+	TfsServerPool* pool;
+
+	/// @brief Number of coroutines each worker executes messages in, or `0` to execute them on the worker's thread
+	size_t coroutines;
+
+	/// @brief Work-stealing between workers, if any
+	TfsServerStealing* stealing;
+
+	/// @brief Cpu the worker is pinned to and busy-polls on, or `-1` if it blocks instead
+	int busy_poll_cpu;
+
+	/// @brief Time a busy-polling worker stays idle for before blocking, in nanoseconds
+	uint64_t busy_poll_spin_ns;
+
+	/// @brief Queue of the commands read from a command file, if executing one
+	TfsCommandQueue* command_queue;
+
+	/// @brief Recorder of all commands executed, if recording
+	TfsServerRecorder* recorder;
+} WorkerData;
+
+/// @brief A message served by a coroutine worker
+typedef struct CoroutineSlot {
+	/// @brief The message
+	char message[TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY];
+
+	/// @brief Length of @ref message
+	size_t message_len;
+
+	/// @brief It's reply
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+
+	/// @brief Length of @ref reply
+	size_t reply_len;
+
+	/// @brief Address of the sender
+	struct sockaddr_un address;
+
+	/// @brief Length of @ref address
+	socklen_t address_len;
+
+	/// @brief Ancillary data of the message
+	char control[TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY];
+
+	/// @brief File descriptor carried by the message, or `-1` if none
+	int fd;
+
+	/// @brief Worker data
+	const WorkerData* data;
+
+	/// @brief Coroutine executing the message
+	TfsCoroutine coroutine;
+} CoroutineSlot;
+
+/// @brief A datagram message queued to be executed by another thread
+typedef struct QueuedMessage {
+	/// @brief Address of the sender
+	struct sockaddr_un address;
+
+	/// @brief Length of @ref address
+	socklen_t address_len;
+
+	/// @brief Length of @ref message
+	size_t message_len;
+
+	/// @brief The message, with space for a nul terminator
+	char message[];
+} QueuedMessage;
+
+/// @brief Data received by the producer of a command file
+typedef struct ProducerData {
+	/// @brief The command file
+	TfsCommandFile* file;
+
+	/// @brief Queue to push the commands to
+	TfsCommandQueue* queue;
+} ProducerData;
+
+/// @brief Data received by each lane
+typedef struct LaneData {
+	/// @brief Worker data
+	const WorkerData* worker_data;
+
+	/// @brief Scheduling class served
+	TfsServerSchedulerClass class;
+
+	/// @brief Nice value to run at
+	int nice;
+} LaneData;
+
+/// @brief Data received by each shared-memory ring session
+typedef struct SessionData {
+	/// @brief Worker data
+	/// @details
+	/// This is a copy, without the io_uring of the worker that attached the ring.
+	WorkerData worker_data;
+
+	/// @brief The client's ring
+	TfsShmRing ring;
+
+	/// @brief Address of the client
+	struct sockaddr_un address;
+
+	/// @brief Length of @ref address
+	socklen_t address_len;
+} SessionData;
+
+/// @brief Filesystem worker to run in each thread.
+static void* worker_thread_fn(void* arg);
+
+/// @brief Session loop to run in each session thread
+static void* session_loop_thread_fn(void* arg);
+
+/// @brief Accepts all pending connections on the session socket
+static void session_accept(const WorkerData* data);
+
+/// @brief Serves the messages waiting on a ready session
+/// @details
+/// The session is re-armed on it's epoll afterwards, or destroyed, if it's client disconnected.
+static void session_serve(const WorkerData* data, TfsServerSession* session);
+
+/// @brief (Re-)Arms a session on the session epoll
+static void session_arm(const WorkerData* data, TfsServerSession* session, int op);
+
+/// @brief Lane to run in each lane thread
+static void* lane_thread_fn(void* arg);
+
+/// @brief Executor of admitted messages to run in each executor thread
+static void* admission_thread_fn(void* arg);
+
+/// @brief Copies a datagram message to be queued
+static QueuedMessage* queued_message_new(
+	const char* message, size_t message_len, const struct sockaddr_un* address, socklen_t address_len);
+
+/// @brief Admits a message into it's client's queue, to be executed by an executor
+/// @param[out] reply The reply, if rejected
+/// @param[out] reply_len Length of @p reply, or `0` if admitted
+/// @return If admitted or rejected. Attach requests, or messages without a valid header, are never admitted.
+static bool admit_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	char* reply,
+	size_t* reply_len);
+
+/// @brief Executes a queued message, replying to it and freeing it
+static void execute_queued_message(const WorkerData* data, QueuedMessage* job);
+
+/// @brief Executes a message pushed to the adaptive pool
+/// @param item The message
+/// @param arg The worker data
+static void pool_execute(void* item, void* arg);
+
+/// @brief Pushes a message to the adaptive pool, to be executed by an executor
+/// @return If pushed. Attach and pool requests, or messages without a valid header, are never pushed.
+static bool pool_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len);
+
+/// @brief Pushes a message to it's scheduling class' queue, to be executed by a lane
+/// @return If scheduled. Attach requests, or messages without a valid header, are never scheduled.
+static bool schedule_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len);
+
+/// @brief Serves messages through batched receives and sends
+static void run_batch_worker(const WorkerData* data);
+
+/// @brief Serves messages through coroutines, parking those whose inode locks are contended
+static void run_coroutine_worker(const WorkerData* shared_data);
+
+/// @brief Receives a message into a coroutine slot
+/// @param wait If no message is waiting, whether to wait for one
+/// @return If received
+static bool coroutine_recv(const WorkerData* data, CoroutineSlot* slot, bool wait);
+
+/// @brief Executes the message of a coroutine slot
+/// @param arg The slot
+static void coroutine_execute(void* arg);
+
+/// @brief Serves messages through batched receives, pushing them to the worker's deque for idle workers to steal
+static void run_stealing_worker(const WorkerData* data);
+
+/// @brief Serves messages through an io_uring
+static void run_uring_worker(const WorkerData* shared_data, TfsServerUring uring, TfsServerUring print_uring);
+
+/// @brief Posts a receive on a slot of an io_uring worker
+static void uring_post_recv(UringWorker* worker, const WorkerData* data, size_t idx);
+
+/// @brief Recycles a slot of an io_uring worker, posting a receive on it if under the target, else idling it
+static void uring_recycle_slot(UringWorker* worker, const WorkerData* data, size_t idx);
+
+/// @brief Posts the reply of a slot of an io_uring worker, or a new receive, if it has none
+static void uring_post_reply(UringWorker* worker, const WorkerData* data, size_t idx, size_t reply_len);
+
+/// @brief Prints the filesystem, writing it through the io_uring worker's print ring
+/// @details
+/// Waits for the whole file to be written, just like #tfs_fs_print.
+static TfsFsPrintResult uring_print(UringWorker* worker, TfsFs* fs, const char* file_name);
+
+/// @brief Session to run in a thread for each shared-memory ring, until the client closes it
+static void* session_thread_fn(void* arg);
+
+/// @brief Returns the next submission of a shared-memory ring, busy-polling it first if the session does
+/// @return The submission, or `NULL` once the ring is closed.
+static char* session_peek(const WorkerData* data, TfsShmRing* ring, size_t* message_len);
+
+/// @brief Processes a message, executing all of it's commands
+/// @param data Worker data
+/// @param message The message. Must have space for a nul terminator after @p message_len bytes.
+/// @param message_len Length of @p message
+/// @param address Address of the sender
+/// @param address_len Length of @p address
+/// @param fd File descriptor carried by the message, or `-1` if none. It is only borrowed.
+/// @param[out] reply Reply buffer, of at least `TFS_PROTOCOL_HEADER_LEN + TFS_PROTOCOL_MAX_BATCH_LEN` bytes.
+/// @return Length of the reply
+static size_t process_message(const WorkerData* data,
+	char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	int fd,
+	char* reply);
+
+/// @brief Processes an attach request, starting a session on the client's ring
+/// @return If the ring was attached
+/// @details
+/// See #process_message for the parameters.
+static bool process_attach(const WorkerData* data, int fd, const struct sockaddr_un* address, socklen_t address_len);
+
+/// @brief Processes a pool request, reading or pinning the adaptive pool's size
+/// @return Length of the reply
+/// @details
+/// See #process_message for the parameters.
+static size_t process_pool(const WorkerData* data, const char* message, size_t message_len, char* reply);
+
+/// @brief Processes a lease request, executing it's lookup
+/// @return If the lookup was executed successfully
+/// @details
+/// See #process_message for the parameters.
+/// The duration of the lease granted, if any, is written to @p lease_ms.
+static bool process_lease(const WorkerData* data,
+	char* commands_str,
+	size_t commands_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	uint32_t* lease_ms);
+
+/// @brief Parses a nul-terminated command string
+/// @return If the command was parsed successfully
+/// @details
+/// The command borrows it's paths from @p command_str, see #tfs_command_parse_line,
+/// so paths may have any length that fits in a message.
+static bool parse_command_str(char* command_str, size_t command_str_len, TfsCommand* command);
+
+/// @brief Parses and executes a nul-terminated command string
+/// @return If the command was executed successfully
+/// @details
+/// See #process_message for the client's address, which the command is recorded with.
+static bool execute_command_str(const WorkerData* data,
+	char* command_str,
+	size_t command_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len);
+
+/// @brief Records a parsed command string, if recording
+static void record_command_str(const WorkerData* data,
+	const char* command_str,
+	size_t command_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len);
+
+/// @brief Executes a command on the file system
+/// @return If the command was executed successfully
+/// @details
+/// Invalidates the leases on every path the command changes.
+/// @param coalesce If a lookup may share the execution of another in flight
+static bool execute_command(const WorkerData* data, const TfsCommand* command, bool coalesce);
+
+/// @brief Executes a command file, printing the final file system to @p output_path
+/// @param replay If the commands should be replayed, see #replay_command_file
+/// @return The exit code
+static int run_command_file(const WorkerData* data,
+	const char* input_path,
+	const char* output_path,
+	size_t num_threads,
+	bool replay);
+
+/// @brief Executes a command file through a queue, see #producer_thread_fn and #consumer_thread_fn
+static void queue_command_file(const WorkerData* shared_data, TfsCommandFile* file, size_t num_threads);
+
+/// @brief Replays a command file, executing in parallel only commands that don't conflict
+static void replay_command_file(const WorkerData* shared_data, const TfsCommandFile* file, size_t num_threads);
+
+/// @brief Pushes all commands of a command file to the queue
+static void* producer_thread_fn(void* arg);
+
+/// @brief Executes commands from the queue until it's closed and empty
+static void* consumer_thread_fn(void* arg);
+
+/// @brief Executes commands of a replay as they become ready
+static void* replay_thread_fn(void* arg);
+
+/// @brief Executes a replayed command, see #TfsCommandReplayFn
+static bool replay_execute(const TfsCommand* command, void* arg);
+
+/// @brief Signal handler that toggles tracing on and off.
+static void toggle_trace_handler(int signal);
+
+/// @brief Lookups in flight, for #report_stats_thread_fn
+static TfsServerSingleflight* report_singleflight = NULL;
+
+/// @brief Admission control, if any, for #report_stats_thread_fn
+static TfsServerAdmission* report_admission = NULL;
+
+/// @brief Adaptive pool, if any, for #report_stats_thread_fn
+static TfsServerPool* report_pool = NULL;
+
+/// @brief Work-stealing, if any, for #report_stats_thread_fn
+static TfsServerStealing* report_stealing = NULL;
+
+/// @brief Cpus the server may run on, which ring sessions are reset to
+/// @details
+/// Otherwise, sessions attached through a busy-polling worker would inherit it's single cpu.
+static cpu_set_t session_cpus;
+
+/// @brief If #report_stats_thread_fn should stop, once woken up
+static bool report_stats_stopped = false;
+
+/// @brief Prints the lookup coalescing, admission, pool and work-stealing statistics on each `SIGUSR2`
+/// @details
+/// `SIGUSR2` must be blocked in all threads, so it's only ever received by this one, through `sigwait`.
+static void* report_stats_thread_fn(void* arg);
+
+/// @brief Starts #report_stats_thread_fn, once all statistics it prints are set
+static pthread_t report_stats_start(void);
+
+/// @brief Stops and joins #report_stats_thread_fn
+static void report_stats_stop(pthread_t report_thread);
+
+/// @brief Creates a datagram socket bound at @p path
+/// @details
+/// Any file already at @p path is unlinked first.
+static int bind_server_socket(const char* path);
+
+/// @brief Prints the usage of this program to stderr
+static void print_usage(void);
+
+int main(int argc, char** argv) {
+	// Parse all options
+	const char* trace_file_name = NULL;
+	size_t max_batch = 32;
+	uint32_t lease_ms = 1000;
+	bool use_uring = true;
+	const char* session_socket_path = NULL;
+	size_t lanes[TFS_SERVER_SCHEDULER_CLASSES] = {0, 0, 0};
+	bool use_lanes = false;
+	int background_nice = 10;
+	size_t admission_queue_len = 0;
+	size_t pool_min = 0;
+	size_t pool_max = 0;
+	size_t coroutines = 0;
+	bool use_stealing = false;
+	int busy_poll_cpus[BUSY_POLL_MAX_WORKERS];
+	size_t busy_poll_cpus_len = 0;
+	uint64_t busy_poll_spin_us = 1000;
+	size_t socket_groups = 0;
+	bool replay_file = false;
+	const char* recording_file_name = NULL;
+	int option;
+	while ((option = getopt(argc, argv, "t:k:L:US:W:N:A:P:C:DB:b:G:Rr:")) != -1) {
+		switch (option) {
+			case 't': {
+				trace_file_name = optarg;
+				break;
+			}
+			case 'k': {
+				char* max_batch_end;
+				max_batch = strtoul(optarg, &max_batch_end, 0);
+				if (max_batch_end[0] != '\0' || max_batch == 0 || max_batch > 1024) {
+					fprintf(stderr, "Maximum batch must be between 1 and 1024\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'L': {
+				char* lease_ms_end;
+				unsigned long value = strtoul(optarg, &lease_ms_end, 0);
+				if (lease_ms_end[0] != '\0' || value > UINT32_MAX) {
+					fprintf(stderr, "Unable to parse lease duration\n");
+					return EXIT_FAILURE;
+				}
+				lease_ms = (uint32_t)value;
+				break;
+			}
+			case 'U': {
+				use_uring = false;
+				break;
+			}
+			case 'S': {
+				session_socket_path = optarg;
+				break;
+			}
+			case 'W': {
+				if (sscanf(optarg, "%zu:%zu:%zu", &lanes[0], &lanes[1], &lanes[2]) != 3 || lanes[0] == 0 ||
+					lanes[1] == 0 || lanes[2] == 0) {
+					fprintf(stderr, "Lanes must be given as <read>:<write>:<background>, each at least 1\n");
+					return EXIT_FAILURE;
+				}
+				use_lanes = true;
+				break;
+			}
+			case 'N': {
+				char* background_nice_end;
+				long value = strtol(optarg, &background_nice_end, 0);
+				if (background_nice_end[0] != '\0' || value < -20 || value > 19) {
+					fprintf(stderr, "Background nice value must be between -20 and 19\n");
+					return EXIT_FAILURE;
+				}
+				background_nice = (int)value;
+				break;
+			}
+			case 'A': {
+				char* admission_queue_len_end;
+				admission_queue_len = strtoul(optarg, &admission_queue_len_end, 0);
+				if (admission_queue_len_end[0] != '\0' || admission_queue_len == 0) {
+					fprintf(stderr, "Admission queue length must be at least 1\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'P': {
+				if (sscanf(optarg, "%zu:%zu", &pool_min, &pool_max) != 2 || pool_min == 0 || pool_max < pool_min ||
+					pool_max >= TFS_PROTOCOL_POOL_ADAPT) {
+					fprintf(stderr, "Pool bounds must be given as <min>:<max>, with 1 <= min <= max\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'C': {
+				char* coroutines_end;
+				coroutines = strtoul(optarg, &coroutines_end, 0);
+				if (coroutines_end[0] != '\0' || coroutines == 0) {
+					fprintf(stderr, "Coroutines per worker must be at least 1\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'D': {
+				use_stealing = true;
+				break;
+			}
+			case 'B': {
+				// Note: Cpus are given as a comma-separated list, one for each busy-polling worker.
+				char* cpu_str = optarg;
+				busy_poll_cpus_len = 0;
+				while (1) {
+					char* cpu_end;
+					unsigned long cpu = strtoul(cpu_str, &cpu_end, 0);
+					if (cpu_end == cpu_str || (cpu_end[0] != ',' && cpu_end[0] != '\0') || cpu >= CPU_SETSIZE ||
+						busy_poll_cpus_len == BUSY_POLL_MAX_WORKERS) {
+						fprintf(stderr,
+							"Busy-polling cpus must be given as <cpu>[,<cpu>...], with at most %d cpus\n",
+							BUSY_POLL_MAX_WORKERS);
+						return EXIT_FAILURE;
+					}
+					busy_poll_cpus[busy_poll_cpus_len++] = (int)cpu;
+					if (cpu_end[0] == '\0') { break; }
+					cpu_str = cpu_end + 1;
+				}
+				break;
+			}
+			case 'b': {
+				char* busy_poll_spin_us_end;
+				busy_poll_spin_us = strtoull(optarg, &busy_poll_spin_us_end, 0);
+				if (busy_poll_spin_us_end[0] != '\0') {
+					fprintf(stderr, "Unable to parse busy-polling idle period\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'G': {
+				char* socket_groups_end;
+				socket_groups = strtoul(optarg, &socket_groups_end, 0);
+				if (socket_groups_end[0] != '\0' || socket_groups == 0) {
+					fprintf(stderr, "Number of socket groups must be at least 1\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			case 'R': {
+				replay_file = true;
+				break;
+			}
+			case 'r': {
+				recording_file_name = optarg;
+				break;
+			}
+			default: {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	// Note: Given a command file and an output file as well, we execute the file instead of serving.
+	bool run_file = argc - optind == 3;
+	if (argc - optind != 2 && !run_file) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+	if (replay_file && !run_file) {
+		fprintf(stderr, "Replaying may only be used when executing a command file\n");
+		return EXIT_FAILURE;
+	}
+	if (recording_file_name != NULL && run_file) {
+		fprintf(stderr, "Recording may only be used when serving\n");
+		return EXIT_FAILURE;
+	}
+	if ((use_lanes ? 1 : 0) + (admission_queue_len != 0 ? 1 : 0) + (pool_max != 0 ? 1 : 0) + (coroutines != 0 ? 1 : 0) +
+			(use_stealing ? 1 : 0) >
+		1) {
+		fprintf(stderr,
+			"Only one of lanes, admission control, an adaptive pool, coroutines and work-stealing may be used\n");
+		return EXIT_FAILURE;
+	}
+
+	// Get number of threads
+	char* num_threads_end;
+	size_t num_threads = strtoul(argv[run_file ? optind + 2 : optind], &num_threads_end, 0);
+	if (num_threads_end == NULL || num_threads_end[0] != '\0' || (ssize_t)num_threads <= 0) {
+		fprintf(stderr, "Unable to parse number of threads\n");
+		return EXIT_FAILURE;
+	}
+	if (socket_groups > num_threads) {
+		fprintf(stderr, "Only as many socket groups as threads may be used\n");
+		return EXIT_FAILURE;
+	}
+	if (busy_poll_cpus_len > num_threads) {
+		fprintf(stderr, "Only as many busy-polling cpus as threads may be given\n");
+		return EXIT_FAILURE;
+	}
+	if (busy_poll_cpus_len != 0 && (coroutines != 0 || use_stealing)) {
+		fprintf(stderr, "Busy-polling may not be used with coroutines or work-stealing\n");
+		return EXIT_FAILURE;
+	}
+	if (busy_poll_cpus_len != 0 && sched_getaffinity(0, sizeof(session_cpus), &session_cpus) < 0) {
+		fprintf(stderr, "Unable to get the server's cpus\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	// Block `SIGUSR2`, as it's instead waited on by the statistics thread
+	// Note: This must happen before any thread is created, including the tracer's, as they inherit our mask.
+	sigset_t report_signals;
+	sigemptyset(&report_signals);
+	sigaddset(&report_signals, SIGUSR2);
+	pthread_sigmask(SIG_BLOCK, &report_signals, NULL);
+
+	// Open the tracer, if requested
+	// Note: `SIGUSR1` toggles tracing on and off from then on.
+	if (trace_file_name != NULL) {
+		TfsTraceOpenResult trace_result = tfs_trace_open(trace_file_name, true);
+		if (!trace_result.success) {
+			fprintf(stderr, "Unable to open trace file '%s'\n", trace_file_name);
+			tfs_trace_open_error_print(&trace_result.data.err, stderr);
+			return EXIT_FAILURE;
+		}
+
+		struct sigaction toggle_action;
+		bzero(&toggle_action, sizeof(toggle_action));
+		toggle_action.sa_handler = toggle_trace_handler;
+		toggle_action.sa_flags = SA_RESTART;
+		sigemptyset(&toggle_action.sa_mask);
+		sigaction(SIGUSR1, &toggle_action, NULL);
+	}
+
+	// Create the file system, it's leases and lookups in flight
+	// Note: A lease duration of `0` grants no leases, as when executing a file, without any clients.
+	TfsFs fs = tfs_fs_new();
+	TfsServerLeases leases = tfs_server_leases_new(MAX_LEASES, run_file ? 0 : lease_ms);
+	TfsServerSingleflight singleflight = tfs_server_singleflight_new();
+
+	report_singleflight = &singleflight;
+
+	// If given a command file, execute it in-process, without any sockets
+	// Note: `SIGUSR2` prints the lookup coalescing statistics while executing it.
+	if (run_file) {
+		WorkerData data = (WorkerData){
+			.fs = &fs,
+			.server_socket = -1,
+			.max_batch = max_batch,
+			.leases = &leases,
+			.use_uring = false,
+			.uring = NULL,
+			.session_socket = -1,
+			.session_epoll = -1,
+			.scheduler = NULL,
+			.singleflight = &singleflight,
+			.coalesce = true,
+			.admission = NULL,
+			.pool = NULL,
+			.coroutines = 0,
+			.stealing = NULL,
+			.busy_poll_cpu = -1,
+			.busy_poll_spin_ns = 0,
+			.command_queue = NULL,
+			.recorder = NULL,
+		};
+		pthread_t report_thread = report_stats_start();
+		int res = run_command_file(&data, argv[optind], argv[optind + 1], num_threads, replay_file);
+		report_stats_stop(report_thread);
+
+		tfs_server_singleflight_destroy(&singleflight);
+		tfs_server_leases_destroy(&leases);
+		tfs_fs_destroy(&fs);
+		tfs_trace_close();
+		return res;
+	}
+
+	// Create the server sockets, a single one, or one for each group
+	// Note: Anything not received by a worker, such as queued messages' replies, goes through the first one.
+	size_t server_sockets_len = socket_groups == 0 ? 1 : socket_groups;
+	int server_sockets[server_sockets_len];
+	char server_socket_paths[server_sockets_len][108];
+	for (size_t n = 0; n < server_sockets_len; n++) {
+		int path_len = socket_groups == 0
+						   ? snprintf(server_socket_paths[n], 108, "%s", argv[optind + 1])
+						   : snprintf(server_socket_paths[n], 108, "%s.%zu", argv[optind + 1], n);
+		if (path_len < 0 || path_len >= 108) {
+			fprintf(stderr, "Server socket path is too long\n");
+			return EXIT_FAILURE;
+		}
+		server_sockets[n] = bind_server_socket(server_socket_paths[n]);
+	}
+	int server_socket = server_sockets[0];
+
+	// Note: Clients prefer a socket at the path itself, so we remove any left over from a previous server.
+	if (socket_groups != 0) { unlink(argv[optind + 1]); }
+
+	// Create the session socket and it's epoll, if requested
+	// Note: The session socket is non-blocking, as all session threads wake up to accept, but only one will.
+	int session_socket = -1;
+	int session_epoll = -1;
+	if (session_socket_path != NULL) {
+		session_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (session_socket < 0) {
+			fprintf(stderr, "Unable to create session socket\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+
+		struct sockaddr_un session_address;
+		bzero(&session_address, sizeof(struct sockaddr_un));
+		session_address.sun_family = AF_UNIX;
+		int path_len = snprintf(session_address.sun_path, 108, "%s", session_socket_path);
+		if (path_len < 0 || path_len >= 108) {
+			fprintf(stderr, "Session socket path is too long\n");
+			return EXIT_FAILURE;
+		}
+		unlink(session_socket_path);
+		if (bind(session_socket, (struct sockaddr*)&session_address, (socklen_t)SUN_LEN(&session_address)) < 0 ||
+			listen(session_socket, SESSION_BACKLOG) < 0) {
+			fprintf(stderr, "Unable to bind session socket\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+
+		// Note: The session socket is the only one registered without a session.
+		session_epoll = epoll_create1(EPOLL_CLOEXEC);
+		struct epoll_event event = {.events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL};
+		if (session_epoll < 0 || epoll_ctl(session_epoll, EPOLL_CTL_ADD, session_socket, &event) < 0) {
+			fprintf(stderr, "Unable to create session epoll\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Create the scheduler, if scheduling messages to lanes
+	// Note: Workers only receive and push messages then, so we use the batched receives.
+	TfsServerScheduler scheduler;
+	if (use_lanes) {
+		scheduler = tfs_server_scheduler_new(SCHEDULER_CAPACITY);
+		use_uring = false;
+	}
+
+	// Create the admission control, if requested
+	// Note: Just like with lanes, workers only receive and admit messages then.
+	TfsServerAdmission admission;
+	if (admission_queue_len != 0) {
+		admission = tfs_server_admission_new(ADMISSION_MAX_CLIENTS, admission_queue_len, ADMISSION_QUANTUM);
+		report_admission = &admission;
+		use_uring = false;
+	}
+	if (pool_max != 0 || coroutines != 0) { use_uring = false; }
+
+	// Create the workers' deques, if stealing work
+	// Note: Workers must be able to wait on the socket and the other workers at once, so we use the batched receives.
+	TfsServerStealing stealing;
+	if (use_stealing) {
+		stealing = tfs_server_stealing_new(num_threads, DEQUE_CAPACITY);
+		report_stealing = &stealing;
+		use_uring = false;
+	}
+
+	// Start the recorder, if requested
+	// Note: The recording file is only closed once the recorder is, as it's writer writes to it until then.
+	FILE* recording_file = NULL;
+	TfsServerRecorder recorder;
+	if (recording_file_name != NULL) {
+		recording_file = fopen(recording_file_name, "wb");
+		if (recording_file == NULL) {
+			fprintf(stderr, "Unable to open recording file '%s'\n", recording_file_name);
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		recorder = tfs_server_recorder_new(recording_file);
+		tfs_server_recorder_start(&recorder);
+	}
+
+	// Bundle up the worker data
+	WorkerData data = (WorkerData){
+		.fs = &fs,
+		.server_socket = server_socket,
+		.max_batch = max_batch,
+		.leases = &leases,
+		.use_uring = use_uring,
+		.uring = NULL,
+		.session_socket = session_socket,
+		.session_epoll = session_epoll,
+		.scheduler = use_lanes ? &scheduler : NULL,
+		.singleflight = &singleflight,
+		.coalesce = true,
+		.admission = admission_queue_len != 0 ? &admission : NULL,
+		.pool = NULL,
+		.coroutines = coroutines,
+		.stealing = use_stealing ? &stealing : NULL,
+		.busy_poll_cpu = -1,
+		.busy_poll_spin_ns = busy_poll_spin_us * 1000,
+		.command_queue = NULL,
+		.recorder = recording_file_name != NULL ? &recorder : NULL,
+	};
+
+	// Start the adaptive pool, if requested
+	// Note: Just like with lanes, workers only receive and push messages then.
+	TfsServerPool pool;
+	if (pool_max != 0) {
+		pool = tfs_server_pool_new(pool_min, pool_max, POOL_CAPACITY, pool_execute, &data);
+		data.pool = &pool;
+		report_pool = &pool;
+		tfs_server_pool_start(&pool);
+	}
+
+	// Note: `SIGUSR2` prints the lookup coalescing, admission, pool and work-stealing statistics from then on.
+	pthread_t report_thread = report_stats_start();
+
+	// Create all threads
+	// Note: Each worker gets it's own copy of the data, so it may have it's own socket and busy-poll.
+	pthread_t worker_threads[num_threads];
+	WorkerData worker_data[num_threads];
+	for (size_t n = 0; n < num_threads; n++) {
+		worker_data[n] = data;
+		worker_data[n].server_socket = server_sockets[n % server_sockets_len];
+		if (n < busy_poll_cpus_len) { worker_data[n].busy_poll_cpu = busy_poll_cpus[n]; }
+		int res = pthread_create(&worker_threads[n], NULL, worker_thread_fn, &worker_data[n]);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Along with as many session threads, if serving sessions
+	size_t num_session_threads = session_socket_path != NULL ? num_threads : 0;
+	pthread_t session_threads[num_threads];
+	for (size_t n = 0; n < num_session_threads; n++) {
+		int res = pthread_create(&session_threads[n], NULL, session_loop_thread_fn, &data);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create session thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// And all lanes, if scheduling messages to them
+	size_t num_lanes = use_lanes ? lanes[0] + lanes[1] + lanes[2] : 0;
+	pthread_t lane_threads[num_lanes + 1];
+	LaneData lane_data[num_lanes + 1];
+	size_t lane_idx = 0;
+	for (size_t class = 0; class < TFS_SERVER_SCHEDULER_CLASSES && use_lanes; class++) {
+		for (size_t n = 0; n < lanes[class]; n++, lane_idx++) {
+			lane_data[lane_idx] = (LaneData){
+				.worker_data = &data,
+				.class = (TfsServerSchedulerClass)class,
+				.nice = class == TfsServerSchedulerClassBackground ? background_nice : 0,
+			};
+			int res = pthread_create(&lane_threads[lane_idx], NULL, lane_thread_fn, &lane_data[lane_idx]);
+			if (res != 0) {
+				fprintf(stderr,
+					"Unable to create %s lane #%zu: %d\n",
+					tfs_server_scheduler_class_str((TfsServerSchedulerClass)class),
+					n,
+					res);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// And as many executors, if admitting messages
+	size_t num_executors = admission_queue_len != 0 ? num_threads : 0;
+	pthread_t executor_threads[num_threads];
+	for (size_t n = 0; n < num_executors; n++) {
+		int res = pthread_create(&executor_threads[n], NULL, admission_thread_fn, &data);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create executor thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Then join them
+	for (size_t n = 0; n < num_threads; n++) {
+		int res = pthread_join(worker_threads[n], NULL);
+		if (res != 0) {
+			fprintf(stderr, "Unable to join thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+	for (size_t n = 0; n < num_session_threads; n++) {
+		int res = pthread_join(session_threads[n], NULL);
+		if (res != 0) {
+			fprintf(stderr, "Unable to join session thread #%zu: %d\n", n, res);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (use_lanes) {
+		tfs_server_scheduler_close(&scheduler);
+		for (size_t n = 0; n < num_lanes; n++) {
+			int res = pthread_join(lane_threads[n], NULL);
+			if (res != 0) {
+				fprintf(stderr, "Unable to join lane #%zu: %d\n", n, res);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (admission_queue_len != 0) {
+		tfs_server_admission_close(&admission);
+		for (size_t n = 0; n < num_executors; n++) {
+			int res = pthread_join(executor_threads[n], NULL);
+			if (res != 0) {
+				fprintf(stderr, "Unable to join executor thread #%zu: %d\n", n, res);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (pool_max != 0) { tfs_server_pool_close(&pool); }
+
+	if (recording_file_name != NULL) {
+		if (!tfs_server_recorder_close(&recorder)) {
+			fprintf(stderr, "Unable to write all of the recording to '%s'\n", recording_file_name);
+		}
+		uint64_t dropped = tfs_server_recorder_dropped(&recorder);
+		if (dropped != 0) {
+			fprintf(stderr, "Dropped %" PRIu64 " commands from the recording, as it fell behind\n", dropped);
+		}
+	}
+
+	// Destroy all resources in reverse order of creation.
+	// Note: The statistics thread is stopped first, as it reads some of them.
+	report_stats_stop(report_thread);
+	if (use_stealing) { tfs_server_stealing_destroy(&stealing); }
+	if (pool_max != 0) { tfs_server_pool_destroy(&pool); }
+	if (admission_queue_len != 0) { tfs_server_admission_destroy(&admission); }
+	if (use_lanes) { tfs_server_scheduler_destroy(&scheduler); }
+	if (recording_file_name != NULL) {
+		tfs_server_recorder_destroy(&recorder);
+		fclose(recording_file);
+	}
+	if (session_socket_path != NULL) {
+		close(session_epoll);
+		close(session_socket);
+		unlink(session_socket_path);
+	}
+	for (size_t n = 0; n < server_sockets_len; n++) {
+		close(server_sockets[n]);
+		unlink(server_socket_paths[n]);
+	}
+	tfs_server_singleflight_destroy(&singleflight);
+	tfs_server_leases_destroy(&leases);
+	tfs_fs_destroy(&fs);
+	tfs_trace_close();
+
+	return EXIT_SUCCESS;
+}
+
+static void toggle_trace_handler(int signal) {
+	(void)signal;
+	tfs_trace_set_enabled(!tfs_trace_is_enabled());
+}
+
+static void* report_stats_thread_fn(void* arg) {
+	(void)arg;
+	sigset_t report_signals;
+	sigemptyset(&report_signals);
+	sigaddset(&report_signals, SIGUSR2);
+
+	while (1) {
+		int signal;
+		if (sigwait(&report_signals, &signal) != 0) { continue; }
+		if (__atomic_load_n(&report_stats_stopped, __ATOMIC_ACQUIRE)) { break; }
+
+		TfsServerSingleflightStats stats = tfs_server_singleflight_stats(report_singleflight);
+		tfs_server_singleflight_stats_print(&stats, stderr);
+		if (report_admission != NULL) { tfs_server_admission_stats_print(report_admission, stderr); }
+		if (report_pool != NULL) { tfs_server_pool_stats_print(report_pool, stderr); }
+		if (report_stealing != NULL) { tfs_server_stealing_stats_print(report_stealing, stderr); }
+	}
+
+	return NULL;
+}
+
+static pthread_t report_stats_start(void) {
+	pthread_t report_thread;
+	int res = pthread_create(&report_thread, NULL, report_stats_thread_fn, NULL);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create statistics thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+
+	return report_thread;
+}
+
+static void report_stats_stop(pthread_t report_thread) {
+	// Note: The thread only wakes up on `SIGUSR2`, so we send it one ourselves.
+	__atomic_store_n(&report_stats_stopped, true, __ATOMIC_RELEASE);
+	pthread_kill(report_thread, SIGUSR2);
+	pthread_join(report_thread, NULL);
+}
+
+static void print_usage(void) {
+	fprintf(stderr,
+		"Usage: ./tecnicofs [-t <trace-file>] [-k <max-batch>] [-L <lease-ms>] [-U] [-S <session-socket-name>]\n"
+		"                  [-W <read-lanes>:<write-lanes>:<background-lanes>] [-N <background-nice>]\n"
+		"                  [-A <client-queue-len>] [-P <min-threads>:<max-threads>] [-C <coroutines-per-worker>]\n"
+		"                  [-D] [-B <cpu>[,<cpu>...]] [-b <busy-poll-idle-us>]\n"
+		"                  [-G <socket-groups>] [-r <recording-file>] <num-threads> <socket-name>\n"
+		"       ./tecnicofs [-t <trace-file>] [-R] <input-file> <output-file> <num-threads>\n");
+}
+
+static int run_command_file(const WorkerData* data,
+	const char* input_path,
+	const char* output_path,
+	size_t num_threads,
+	bool replay) {
+	int in = open(input_path, O_RDONLY);
+	if (in == -1) {
+		fprintf(stderr, "Unable to open command file '%s'\n", input_path);
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	// Parse all commands, with as many threads as will execute them
+	// Note: Parsing is timed as well, as it used to be interleaved with executing.
+	struct timespec start_time;
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	TfsCommandFileParseResult parse_result = tfs_command_file_parse(in, num_threads);
+	close(in);
+	if (!parse_result.success) {
+		fprintf(stderr, "Unable to parse command file '%s'\n", input_path);
+		tfs_command_file_parse_error_print(&parse_result.data.err, stderr);
+		return EXIT_FAILURE;
+	}
+	TfsCommandFile file = parse_result.data.file;
+
+	// Then execute them
+	if (replay) { replay_command_file(data, &file, num_threads); }
+	else {
+		queue_command_file(data, &file, num_threads);
+	}
+	struct timespec end_time;
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	size_t commands = file.len;
+	tfs_command_file_destroy(&file);
+
+	// Report the time taken and throughput
+	double elapsed_secs =
+		(double)(end_time.tv_sec - start_time.tv_sec) + (double)(end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+	fprintf(stdout,
+		"TecnicoFS completed in %.4f seconds (%zu commands, %.0f commands/s).\n",
+		elapsed_secs,
+		commands,
+		elapsed_secs > 0 ? (double)commands / elapsed_secs : 0.0);
+
+	// And print the final file system
+	TfsFsPrintResult print_result = tfs_fs_print(data->fs, output_path);
+	if (!print_result.success) {
+		fprintf(stderr, "Unable to print filesystem to '%s'\n", output_path);
+		tfs_fs_print_error_print(&print_result.data.err, stderr);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static void queue_command_file(const WorkerData* shared_data, TfsCommandFile* file, size_t num_threads) {
+	// Note: Consumers share the data, as none of them own anything but the queue, which they share as well.
+	TfsCommandQueue queue = tfs_command_queue_new(COMMAND_QUEUE_CAPACITY);
+	WorkerData data = *shared_data;
+	data.command_queue = &queue;
+	ProducerData producer_data = (ProducerData){
+		.file = file,
+		.queue = &queue,
+	};
+
+	// Start the producer, then all consumers
+	pthread_t producer_thread;
+	int res = pthread_create(&producer_thread, NULL, producer_thread_fn, &producer_data);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create producer thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+	pthread_t consumer_threads[num_threads];
+	for (size_t n = 0; n < num_threads; n++) {
+		res = pthread_create(&consumer_threads[n], NULL, consumer_thread_fn, &data);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create consumer thread #%zu: %d\n", n, res);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// Then join them, once the producer closes the queue and the consumers empty it
+	res = pthread_join(producer_thread, NULL);
+	if (res != 0) {
+		fprintf(stderr, "Unable to join producer thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+	for (size_t n = 0; n < num_threads; n++) {
+		res = pthread_join(consumer_threads[n], NULL);
+		if (res != 0) {
+			fprintf(stderr, "Unable to join consumer thread #%zu: %d\n", n, res);
+			exit(EXIT_FAILURE);
+		}
+	}
+	tfs_command_queue_destroy(&queue);
+}
+
+static void replay_command_file(const WorkerData* shared_data, const TfsCommandFile* file, size_t num_threads) {
+	// Note: The whole file is already parsed, as it's needed to know which commands conflict.
+	WorkerData data = *shared_data;
+	TfsCommandReplay replay = tfs_command_replay_new(file->commands, file->len, replay_execute, &data);
+	fprintf(stdout,
+		"Replaying %zu commands with %zu dependencies, at most %zu in a chain.\n",
+		file->len,
+		replay.edges,
+		replay.depth);
+	pthread_t replay_threads[num_threads];
+	for (size_t n = 0; n < num_threads; n++) {
+		int res = pthread_create(&replay_threads[n], NULL, replay_thread_fn, &replay);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create replay thread #%zu: %d\n", n, res);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (size_t n = 0; n < num_threads; n++) {
+		int res = pthread_join(replay_threads[n], NULL);
+		if (res != 0) {
+			fprintf(stderr, "Unable to join replay thread #%zu: %d\n", n, res);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	tfs_command_replay_destroy(&replay);
+}
+
+static void* producer_thread_fn(void* arg) {
+	ProducerData* data = arg;
+
+	for (size_t n = 0; n < data->file->len; n++) {
+		if (!tfs_command_queue_push(data->queue, data->file->commands[n])) { break; }
+	}
+
+	tfs_command_queue_close(data->queue);
+	return NULL;
+}
+
+static void* consumer_thread_fn(void* arg) {
+	const WorkerData* data = arg;
+
+	// Note: Failed commands already report their errors, so we just move on.
+	TfsCommand command;
+	while (tfs_command_queue_pop(data->command_queue, &command)) {
+		execute_command(data, &command, true);
+		tfs_command_destroy(&command);
+	}
+
+	return NULL;
+}
+
+static void* replay_thread_fn(void* arg) {
+	tfs_command_replay_run(arg);
+	return NULL;
+}
+
+static bool replay_execute(const TfsCommand* command, void* arg) {
+	return execute_command(arg, command, true);
+}
+
+static int bind_server_socket(const char* path) {
+	int server_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (server_socket < 0) {
+		fprintf(stderr, "Unable to create server socket\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	// Create the socket address for ourselves
+	struct sockaddr_un server_address;
+	bzero(&server_address, sizeof(struct sockaddr_un));
+	server_address.sun_family = AF_UNIX;
+	strcpy(server_address.sun_path, path);
+
+	// Unlink and bind our socket
+	socklen_t server_address_len = (socklen_t)SUN_LEN(&server_address);
+	unlink(path);
+	int bind_res = bind(server_socket, (struct sockaddr*)&server_address, server_address_len);
+	if (bind_res < 0) {
+		fprintf(stderr, "Unable to bind server socket '%s'\n", path);
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	return server_socket;
+}
+
+static void* worker_thread_fn(void* arg) {
+	const WorkerData* data = arg;
+
+	// If we busy-poll, pin ourselves to our cpu
+	// Note: We always use the batched receives then, as the io_uring would only block in the kernel.
+	if (data->busy_poll_cpu >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET((size_t)data->busy_poll_cpu, &cpus);
+		int res = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		if (res != 0) {
+			fprintf(stderr, "Unable to pin worker to cpu %d\n", data->busy_poll_cpu);
+			fprintf(stderr, "(%d) %s\n", res, strerror(res));
+			exit(EXIT_FAILURE);
+		}
+
+		run_batch_worker(data);
+		return NULL;
+	}
+
+	// Note: Each worker has it's own ring, with a slot for each message of a batch, and one for it's prints.
+	if (data->use_uring) {
+		TfsServerUringNewResult uring_result = tfs_server_uring_new((unsigned)(2 * data->max_batch));
+		TfsServerUringNewResult print_uring_result = uring_result;
+		if (uring_result.success) {
+			print_uring_result = tfs_server_uring_new(1);
+			if (print_uring_result.success) {
+				run_uring_worker(data, uring_result.data.uring, print_uring_result.data.uring);
+				return NULL;
+			}
+			tfs_server_uring_destroy(&uring_result.data.uring);
+		}
+
+		fprintf(stderr, "Unable to use io_uring, falling back to batched receives\n");
+		tfs_server_uring_new_error_print(&print_uring_result.data.err, stderr);
+	}
+
+	if (data->coroutines != 0) { run_coroutine_worker(data); }
+	else if (data->stealing != NULL) {
+		run_stealing_worker(data);
+	}
+	else {
+		run_batch_worker(data);
+	}
+	return NULL;
+}
+
+static void run_batch_worker(const WorkerData* data) {
+	TfsServerMessageBatch batch = tfs_server_message_batch_new(data->max_batch);
+
+	while (1) {
+		// Receive as many messages as are waiting
+		TfsTraceSpan recv_span = tfs_trace_begin();
+		TfsServerMessageBatchRecvResult recv_result =
+			data->busy_poll_cpu >= 0
+				? tfs_server_message_batch_poll_recv(&batch, data->server_socket, data->busy_poll_spin_ns)
+				: tfs_server_message_batch_recv(&batch, data->server_socket);
+		if (!recv_result.success) {
+			fprintf(stderr, "Failed to receive command\n");
+			tfs_server_message_batch_recv_error_print(&recv_result.data.err, stderr);
+			exit(EXIT_FAILURE);
+		}
+		tfs_trace_end_arg(recv_span, "recv", "messages", batch.len);
+
+		// Process each of them
+		for (size_t n = 0; n < batch.len; n++) {
+			TfsTraceSpan request_span = tfs_trace_begin();
+			size_t message_len;
+			char* message = tfs_server_message_batch_message(&batch, n, &message_len);
+			char* reply = tfs_server_message_batch_reply(&batch, n);
+			socklen_t address_len;
+			const struct sockaddr_un* address = tfs_server_message_batch_address(&batch, n, &address_len);
+			int fd = tfs_server_message_batch_fd(&batch, n);
+
+			// Note: Scheduled messages are replied to by their lane.
+			if (data->scheduler != NULL && schedule_message(data, message, message_len, address, address_len)) {
+				tfs_server_message_batch_set_reply_len(&batch, n, 0);
+				tfs_trace_end(request_span, "schedule");
+				continue;
+			}
+
+			// Note: Admitted messages are replied to by their executor, while rejected ones are replied to right away.
+			size_t admit_reply_len;
+			if (data->admission != NULL &&
+				admit_message(data, message, message_len, address, address_len, reply, &admit_reply_len)) {
+				tfs_server_message_batch_set_reply_len(&batch, n, admit_reply_len);
+				tfs_trace_end(request_span, "admit");
+				continue;
+			}
+
+			// Note: Pushed messages are replied to by their executor.
+			if (data->pool != NULL && pool_message(data, message, message_len, address, address_len)) {
+				tfs_server_message_batch_set_reply_len(&batch, n, 0);
+				tfs_trace_end(request_span, "pool");
+				continue;
+			}
+
+			size_t reply_len = process_message(data, message, message_len, address, address_len, fd, reply);
+			tfs_server_message_batch_set_reply_len(&batch, n, reply_len);
+			tfs_trace_end(request_span, "request");
+		}
+
+		// And send all replies
+		TfsTraceSpan reply_span = tfs_trace_begin();
+		tfs_server_message_batch_send(&batch, data->server_socket);
+		tfs_trace_end(reply_span, "reply");
+	}
+
+	tfs_server_message_batch_destroy(&batch);
+}
+
+static void run_coroutine_worker(const WorkerData* shared_data) {
+	// Note: Lookups aren't coalesced, as waiting on another coroutine's lookup would sleep the whole thread.
+	WorkerData data = *shared_data;
+	data.coalesce = false;
+
+	// Create all slots, all of them idle
+	size_t slots_len = data.coroutines;
+	CoroutineSlot* slots = malloc(slots_len * sizeof(CoroutineSlot));
+	size_t* idle_slots = malloc(slots_len * sizeof(size_t));
+	size_t* running_slots = malloc(slots_len * sizeof(size_t));
+	if (slots == NULL || idle_slots == NULL || running_slots == NULL) {
+		fprintf(stderr, "Unable to allocate %zu coroutines\n", slots_len);
+		exit(EXIT_FAILURE);
+	}
+	for (size_t n = 0; n < slots_len; n++) {
+		slots[n].data = &data;
+		slots[n].fd = -1;
+		slots[n].coroutine = tfs_coroutine_new(COROUTINE_STACK_SIZE);
+		idle_slots[n] = slots_len - 1 - n;
+	}
+	size_t idle_slots_len = slots_len;
+	size_t running_slots_len = 0;
+
+	size_t parked_rounds = 0;
+	while (1) {
+		// Start a coroutine for each message waiting
+		// Note: We only wait for one if no coroutines are parked, as they need to be resumed.
+		bool progressed = false;
+		while (idle_slots_len != 0) {
+			size_t idx = idle_slots[idle_slots_len - 1];
+			if (!coroutine_recv(&data, &slots[idx], running_slots_len == 0)) { break; }
+
+			idle_slots_len--;
+			running_slots[running_slots_len++] = idx;
+			tfs_coroutine_start(&slots[idx].coroutine, coroutine_execute, &slots[idx]);
+			progressed = true;
+		}
+
+		// Then resume each coroutine until it parks, replying to those done
+		for (size_t n = 0; n < running_slots_len;) {
+			size_t idx = running_slots[n];
+			CoroutineSlot* slot = &slots[idx];
+			if (!tfs_coroutine_resume(&slot->coroutine)) {
+				n++;
+				continue;
+			}
+
+			// Note: Just like the batched replies, any reply we can't send is skipped.
+			sendto(data.server_socket, slot->reply, slot->reply_len, 0, (struct sockaddr*)&slot->address,
+				slot->address_len);
+			if (slot->fd >= 0) {
+				close(slot->fd);
+				slot->fd = -1;
+			}
+			running_slots[n] = running_slots[--running_slots_len];
+			idle_slots[idle_slots_len++] = idx;
+			progressed = true;
+		}
+
+		// If every coroutine stayed parked, their locks are held by other workers,
+		// so give them the cpu, and, if they don't release them soon, sleep for a bit.
+		if (progressed) { parked_rounds = 0; }
+		else if (parked_rounds++ < COROUTINE_MAX_YIELDS) {
+			sched_yield();
+		}
+		else {
+			struct timespec parked_sleep = {.tv_sec = 0, .tv_nsec = COROUTINE_PARKED_SLEEP_NS};
+			nanosleep(&parked_sleep, NULL);
+		}
+	}
+
+	for (size_t n = 0; n < slots_len; n++) { tfs_coroutine_destroy(&slots[n].coroutine); }
+	free(running_slots);
+	free(idle_slots);
+	free(slots);
+}
+
+static bool coroutine_recv(const WorkerData* data, CoroutineSlot* slot, bool wait) {
+	// Note: Messages leave a byte at the end for a nul terminator.
+	struct iovec message_iovec = {.iov_base = slot->message, .iov_len = sizeof(slot->message) - 1};
+	struct msghdr header = {
+		.msg_name = &slot->address,
+		.msg_namelen = sizeof(slot->address),
+		.msg_iov = &message_iovec,
+		.msg_iovlen = 1,
+		.msg_control = slot->control,
+		.msg_controllen = sizeof(slot->control),
+		.msg_flags = 0,
+	};
+	ssize_t message_len;
+	while ((message_len = recvmsg(data->server_socket, &header, MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT))) < 0 &&
+		   errno == EINTR) {}
+	if (message_len < 0 && errno == EAGAIN) { return false; }
+
+	// Note: A shut down socket receives empty messages
+	if (message_len <= 0) {
+		fprintf(stderr, "Failed to receive command\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	slot->message_len = (size_t)message_len;
+	slot->address_len = header.msg_namelen;
+	slot->fd = tfs_server_message_fd(&header);
+	return true;
+}
+
+static void coroutine_execute(void* arg) {
+	CoroutineSlot* slot = arg;
+
+	TfsTraceSpan request_span = tfs_trace_begin();
+	slot->reply_len = process_message(
+		slot->data, slot->message, slot->message_len, &slot->address, slot->address_len, slot->fd, slot->reply);
+	tfs_trace_end(request_span, "request");
+}
+
+static void run_stealing_worker(const WorkerData* data) {
+	TfsServerStealing* stealing = data->stealing;
+	size_t worker = tfs_server_stealing_join(stealing);
+	uint64_t seed = 0x9e3779b97f4a7c15u * (worker + 1);
+	TfsServerMessageBatch batch = tfs_server_message_batch_new(data->max_batch);
+
+	while (1) {
+		// Execute messages until there are none left, our own first, then other workers'
+		QueuedMessage* job;
+		while ((job = tfs_server_stealing_take(stealing, worker, &seed)) != NULL) {
+			execute_queued_message(data, job);
+		}
+
+		// Then receive as many messages as are waiting, without blocking
+		TfsTraceSpan recv_span = tfs_trace_begin();
+		TfsServerMessageBatchRecvResult recv_result = tfs_server_message_batch_try_recv(&batch, data->server_socket);
+		if (!recv_result.success) {
+			fprintf(stderr, "Failed to receive command\n");
+			tfs_server_message_batch_recv_error_print(&recv_result.data.err, stderr);
+			exit(EXIT_FAILURE);
+		}
+		tfs_trace_end_arg(recv_span, "recv", "messages", batch.len);
+
+		// If there were none, wait until there are, or until another worker has some to steal
+		if (batch.len == 0) {
+			tfs_server_stealing_wait(stealing, data->server_socket);
+			continue;
+		}
+
+		// Else push each of them to our deque
+		// Note: Messages carrying a file descriptor are executed right away, as the batch owns it,
+		//       as are any that don't fit in our deque.
+		size_t pushed = 0;
+		for (size_t n = 0; n < batch.len; n++) {
+			size_t message_len;
+			char* message = tfs_server_message_batch_message(&batch, n, &message_len);
+			socklen_t address_len;
+			const struct sockaddr_un* address = tfs_server_message_batch_address(&batch, n, &address_len);
+			int fd = tfs_server_message_batch_fd(&batch, n);
+			if (fd < 0) {
+				job = queued_message_new(message, message_len, address, address_len);
+				if (tfs_server_stealing_push(stealing, worker, job)) {
+					tfs_server_message_batch_set_reply_len(&batch, n, 0);
+					pushed++;
+					continue;
+				}
+				free(job);
+			}
+
+			TfsTraceSpan request_span = tfs_trace_begin();
+			char* reply = tfs_server_message_batch_reply(&batch, n);
+			size_t reply_len = process_message(data, message, message_len, address, address_len, fd, reply);
+			tfs_server_message_batch_set_reply_len(&batch, n, reply_len);
+			tfs_trace_end(request_span, "request");
+		}
+		if (pushed != 0) { tfs_server_stealing_notify(stealing); }
 
-/// @brief Filesystem worker to run in each thread.
-static void* worker_thread_fn(void* arg);
+		// And send the replies of those executed right away
+		TfsTraceSpan reply_span = tfs_trace_begin();
+		tfs_server_message_batch_send(&batch, data->server_socket);
+		tfs_trace_end(reply_span, "reply");
+	}
 
-int main(int argc, char** argv) {
-	if (argc != 3) {
-		fprintf(stderr, "Usage: ./tecnicofs <num-threads> <socket-name>\n");
-		return EXIT_FAILURE;
+	tfs_server_message_batch_destroy(&batch);
+}
+
+static void run_uring_worker(const WorkerData* shared_data, TfsServerUring uring, TfsServerUring print_uring) {
+	UringWorker worker = {
+		.uring = uring,
+		.print_uring = print_uring,
+		.slots = malloc(shared_data->max_batch * sizeof(UringSlot)),
+		.slots_len = shared_data->max_batch,
+		.target = 1,
+		.recvs_posted = 0,
+		.idle_slots = malloc(shared_data->max_batch * sizeof(size_t)),
+		.idle_slots_len = 0,
+	};
+	if (worker.slots == NULL || worker.idle_slots == NULL) {
+		fprintf(stderr, "Unable to allocate %zu io_uring slots\n", shared_data->max_batch);
+		exit(EXIT_FAILURE);
 	}
+	WorkerData data = *shared_data;
+	data.uring = &worker;
 
-	// Get number of threads
-	char* num_threads_end;
-	size_t num_threads = strtoul(argv[1], &num_threads_end, 0);
-	if (num_threads_end == NULL || num_threads_end[0] != '\0' || (ssize_t)num_threads <= 0) {
-		fprintf(stderr, "Unable to parse number of threads\n");
-		return EXIT_FAILURE;
+	// Post receives up to the target, idling all other slots
+	// Note: Every receive posted is woken up by each message, so, like the message batch, the number
+	//       of receives posted adapts to the depth of the socket's backlog, instead of posting one per slot.
+	for (size_t n = 0; n < worker.slots_len; n++) {
+		UringSlot* slot = &worker.slots[n];
+		slot->message_iovec = (struct iovec){.iov_base = slot->message, .iov_len = sizeof(slot->message) - 1};
+		uring_recycle_slot(&worker, &data, n);
 	}
 
-	// Create the file system
-	TfsFs fs = tfs_fs_new();
+	while (1) {
+		// Hand everything posted to the kernel and wait for a completion
+		// Note: All replies and receives posted since the last call are submitted at once.
+		if (tfs_server_uring_submit(&worker.uring, 1) < 0 && errno != EINTR) {
+			fprintf(stderr, "Unable to submit to io_uring\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 
-	// Create the server socket
-	int server_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
-	if (server_socket < 0) {
-		fprintf(stderr, "Unable to create server socket\n");
+		struct io_uring_cqe* cqe;
+		size_t received = 0;
+		while ((cqe = tfs_server_uring_peek_cqe(&worker.uring)) != NULL) {
+			uint64_t user_data = cqe->user_data;
+			int res = cqe->res;
+			tfs_server_uring_cqe_seen(&worker.uring);
+
+			switch ((UringOp)(user_data & URING_OP_MASK)) {
+				case UringOpRecv: {
+					size_t idx = (size_t)(user_data >> URING_OP_BITS);
+					UringSlot* slot = &worker.slots[idx];
+					worker.recvs_posted--;
+					if (res == -EINTR || res == -EAGAIN) {
+						uring_recycle_slot(&worker, &data, idx);
+						break;
+					}
+					if (res < 0) {
+						fprintf(stderr, "Failed to receive command\n");
+						fprintf(stderr, "(%d) %s\n", -res, strerror(-res));
+						exit(EXIT_FAILURE);
+					}
+					if (res == 0) {
+						fprintf(stderr, "Failed to receive command\n");
+						fprintf(stderr, "Socket was shut down\n");
+						exit(EXIT_FAILURE);
+					}
+
+					// Note: Any file descriptor is only borrowed by `process_message`.
+					received++;
+					TfsTraceSpan request_span = tfs_trace_begin();
+					int fd = tfs_server_message_fd(&slot->message_header);
+					size_t reply_len = process_message(&data,
+						slot->message,
+						(size_t)res,
+						&slot->address,
+						slot->message_header.msg_namelen,
+						fd,
+						slot->reply);
+					if (fd >= 0) { close(fd); }
+					tfs_trace_end(request_span, "request");
+
+					slot->reply_iovec = (struct iovec){.iov_base = slot->reply, .iov_len = reply_len};
+					uring_post_reply(&worker, &data, idx, reply_len);
+					break;
+				}
+
+				// Note: Replies that can't be sent, such as to a client that has since disconnected, are skipped.
+				case UringOpSend: {
+					size_t idx = (size_t)(user_data >> URING_OP_BITS);
+					if (res == -EAGAIN) { sendmsg(data.server_socket, &worker.slots[idx].reply_header, 0); }
+					uring_recycle_slot(&worker, &data, idx);
+					break;
+				}
+
+				default: {
+					break;
+				}
+			}
+		}
+
+		// Adapt the target to the backlog, posting receives on idle slots if it grew
+		if (received >= worker.target) {
+			worker.target = worker.target * 2 > worker.slots_len ? worker.slots_len : worker.target * 2;
+		}
+		else if (received < worker.target / 2) {
+			worker.target /= 2;
+		}
+		while (worker.recvs_posted < worker.target && worker.idle_slots_len > 0) {
+			uring_post_recv(&worker, &data, worker.idle_slots[--worker.idle_slots_len]);
+		}
+	}
+
+	free(worker.idle_slots);
+	free(worker.slots);
+	tfs_server_uring_destroy(&worker.print_uring);
+	tfs_server_uring_destroy(&worker.uring);
+}
+
+static void uring_post_recv(UringWorker* worker, const WorkerData* data, size_t idx) {
+	// Reset the address, ancillary data and their lengths, as the last receive overwrote them
+	UringSlot* slot = &worker->slots[idx];
+	memset(&slot->message_header, 0, sizeof(struct msghdr));
+	slot->message_header.msg_name = &slot->address;
+	slot->message_header.msg_namelen = sizeof(struct sockaddr_un);
+	slot->message_header.msg_iov = &slot->message_iovec;
+	slot->message_header.msg_iovlen = 1;
+	slot->message_header.msg_control = slot->control;
+	slot->message_header.msg_controllen = sizeof(slot->control);
+
+	tfs_server_uring_recvmsg(&worker->uring,
+		data->server_socket,
+		&slot->message_header,
+		MSG_CMSG_CLOEXEC,
+		(uint64_t)idx << URING_OP_BITS | UringOpRecv);
+	worker->recvs_posted++;
+}
+
+static void uring_recycle_slot(UringWorker* worker, const WorkerData* data, size_t idx) {
+	if (worker->recvs_posted < worker->target) { uring_post_recv(worker, data, idx); }
+	else {
+		worker->idle_slots[worker->idle_slots_len++] = idx;
+	}
+}
+
+static void uring_post_reply(UringWorker* worker, const WorkerData* data, size_t idx, size_t reply_len) {
+	UringSlot* slot = &worker->slots[idx];
+	if (reply_len == 0) {
+		uring_recycle_slot(worker, data, idx);
+		return;
+	}
+
+	memset(&slot->reply_header, 0, sizeof(struct msghdr));
+	slot->reply_header.msg_name = &slot->address;
+	slot->reply_header.msg_namelen = slot->message_header.msg_namelen;
+	slot->reply_header.msg_iov = &slot->reply_iovec;
+	slot->reply_header.msg_iovlen = 1;
+
+	// Note: If the client's queue is full, io_uring would retry the send after the kernel already consumed the
+	//       reply, sending it empty, so we don't let it wait, and instead send it ourselves once it fails.
+	tfs_server_uring_sendmsg(&worker->uring,
+		data->server_socket,
+		&slot->reply_header,
+		MSG_DONTWAIT,
+		(uint64_t)idx << URING_OP_BITS | UringOpSend);
+}
+
+static TfsFsPrintResult uring_print(UringWorker* worker, TfsFs* fs, const char* file_name) {
+	int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		return (TfsFsPrintResult){
+			.success = false,
+			.data.err.kind = TfsFsPrintErrorCreate,
+		};
+	}
+
+	// Render the filesystem into memory, so the root is only locked while rendering, not writing
+	char* contents = NULL;
+	size_t contents_len = 0;
+	FILE* out = open_memstream(&contents, &contents_len);
+	if (out == NULL) {
+		fprintf(stderr, "Unable to allocate print of '%s'\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	tfs_fs_print_to(fs, out);
+	fclose(out);
+
+	// Then write it all, continuing any short writes
+	// Note: A write that fails, or that writes nothing, fails the whole print.
+	size_t written = 0;
+	bool failed = false;
+	while (written < contents_len && !failed) {
+		// Note: Interrupted submissions may return before the write completes, so we submit until it does.
+		tfs_server_uring_write(
+			&worker->print_uring, fd, contents + written, (unsigned)(contents_len - written), written, 0);
+		struct io_uring_cqe* cqe;
+		while ((cqe = tfs_server_uring_peek_cqe(&worker->print_uring)) == NULL) {
+			if (tfs_server_uring_submit(&worker->print_uring, 1) < 0 && errno != EINTR) {
+				fprintf(stderr, "Unable to submit to io_uring\n");
+				fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+		}
+		int res = cqe->res;
+		tfs_server_uring_cqe_seen(&worker->print_uring);
+
+		if (res <= 0) { failed = true; }
+		else {
+			written += (size_t)res;
+		}
+	}
+	free(contents);
+
+	if (close(fd) < 0 || failed) {
+		return (TfsFsPrintResult){
+			.success = false,
+			.data.err.kind = TfsFsPrintErrorWrite,
+		};
+	}
+
+	return (TfsFsPrintResult){.success = true};
+}
+
+static void* session_loop_thread_fn(void* arg) {
+	const WorkerData* data = arg;
+
+	// Note: We only take a single event at a time, so other threads may serve the remaining ready sessions.
+	while (1) {
+		struct epoll_event event;
+		int events_len = epoll_wait(data->session_epoll, &event, 1, -1);
+		if (events_len < 0) {
+			if (errno == EINTR) { continue; }
+			fprintf(stderr, "Unable to wait for sessions\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (event.data.ptr == NULL) { session_accept(data); }
+		else {
+			session_serve(data, event.data.ptr);
+		}
+	}
+
+	return NULL;
+}
+
+/// @brief Id of the next session accepted
+static size_t next_session_id = 0;
+
+static void session_accept(const WorkerData* data) {
+	while (1) {
+		int socket = accept4(data->session_socket, NULL, NULL, SOCK_CLOEXEC);
+		if (socket < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) { continue; }
+			if (errno == EAGAIN) { break; }
+			fprintf(stderr, "Unable to accept session\n");
+			fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+			break;
+		}
+
+		size_t id = __atomic_fetch_add(&next_session_id, 1, __ATOMIC_RELAXED);
+		TfsServerSession* session = tfs_server_session_new(socket, id);
+		session_arm(data, session, EPOLL_CTL_ADD);
+	}
+}
+
+static void session_serve(const WorkerData* data, TfsServerSession* session) {
+	char message[TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY];
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+	char control[TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY];
+
+	// Note: Sessions have no address to send invalidations to, so their lookups aren't leased.
+	struct sockaddr_un address;
+	bzero(&address, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+
+	// Note: The session is armed with `EPOLLONESHOT`, so until we re-arm it, no other thread will serve it.
+	for (size_t n = 0; n < SESSION_MAX_MESSAGES; n++) {
+		// Note: We leave space for the nul terminator of legacy messages.
+		struct iovec message_iovec = {.iov_base = message, .iov_len = TFS_PROTOCOL_MAX_MESSAGE_LEN};
+		struct msghdr message_header = {
+			.msg_name = NULL,
+			.msg_namelen = 0,
+			.msg_iov = &message_iovec,
+			.msg_iovlen = 1,
+			.msg_control = control,
+			.msg_controllen = sizeof(control),
+			.msg_flags = 0,
+		};
+		ssize_t message_len = recvmsg(session->socket, &message_header, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+		if (message_len < 0 && errno == EINTR) { continue; }
+		if (message_len < 0 && errno == EAGAIN) {
+			session_arm(data, session, EPOLL_CTL_MOD);
+			return;
+		}
+
+		// Note: An empty message is the client disconnecting.
+		bool sent = false;
+		if (message_len > 0) {
+			TfsTraceSpan request_span = tfs_trace_begin();
+			int fd = tfs_server_message_fd(&message_header);
+			size_t reply_len =
+				process_message(data, message, (size_t)message_len, &address, sizeof(sa_family_t), fd, reply);
+			if (fd >= 0) { close(fd); }
+			tfs_trace_end(request_span, "request");
+
+			sent = send(session->socket, reply, reply_len, MSG_NOSIGNAL) == (ssize_t)reply_len;
+			tfs_server_session_record(session, reply, reply_len);
+		}
+		if (!sent) {
+			epoll_ctl(data->session_epoll, EPOLL_CTL_DEL, session->socket, NULL);
+			tfs_server_session_print(session, stderr);
+			tfs_server_session_destroy(session);
+			return;
+		}
+	}
+
+	session_arm(data, session, EPOLL_CTL_MOD);
+}
+
+static void session_arm(const WorkerData* data, TfsServerSession* session, int op) {
+	struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, .data.ptr = session};
+	if (epoll_ctl(data->session_epoll, op, session->socket, &event) < 0) {
+		fprintf(stderr, "Unable to arm session #%zu\n", session->id);
 		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
-		return EXIT_FAILURE;
+		exit(EXIT_FAILURE);
 	}
+}
 
-	// Create the socket address for ourselves
-	const char* server_socket_path = argv[2];
-	struct sockaddr_un server_address;
-	bzero(&server_address, sizeof(struct sockaddr_un));
-	server_address.sun_family = AF_UNIX;
-	strcpy(server_address.sun_path, server_socket_path);
+static void* lane_thread_fn(void* arg) {
+	const LaneData* lane = arg;
+	const WorkerData* data = lane->worker_data;
 
-	// Unlink and bind our socket
-	socklen_t server_address_len = (socklen_t)SUN_LEN(&server_address);
-	unlink(server_socket_path);
-	int bind_res = bind(server_socket, (struct sockaddr*)&server_address, server_address_len);
-	if (bind_res < 0) {
-		fprintf(stderr, "Unable to bind server socket\n");
+	// Note: Unlike `nice`, `setpriority` on a thread id only affects that thread.
+	if (lane->nice != 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), lane->nice) < 0) {
+		fprintf(stderr, "Unable to set %s lane priority\n", tfs_server_scheduler_class_str(lane->class));
 		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
-		return EXIT_FAILURE;
 	}
 
-	// Bundle up the worker data
-	WorkerData data = (WorkerData){
-		.fs = &fs,
-		.server_socket = server_socket,
-	};
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+	QueuedMessage* job;
+	while ((job = tfs_server_scheduler_pop(data->scheduler, lane->class)) != NULL) {
+		TfsTraceSpan request_span = tfs_trace_begin();
+		size_t reply_len =
+			process_message(data, job->message, job->message_len, &job->address, job->address_len, -1, reply);
+		tfs_trace_end(request_span, "request");
 
-	// Create all threads
-	pthread_t worker_threads[num_threads];
-	for (size_t n = 0; n < num_threads; n++) {
-		int res = pthread_create(&worker_threads[n], NULL, worker_thread_fn, &data);
-		if (res != 0) {
-			fprintf(stderr, "Unable to create thread #%zu: %d\n", n, res);
-			return EXIT_FAILURE;
-		}
+		// Note: Just like the batched replies, any reply we can't send is skipped.
+		sendto(data->server_socket, reply, reply_len, 0, (struct sockaddr*)&job->address, job->address_len);
+		free(job);
 	}
 
-	// Then join them
-	for (size_t n = 0; n < num_threads; n++) {
-		int res = pthread_join(worker_threads[n], NULL);
-		if (res != 0) {
-			fprintf(stderr, "Unable to join thread #%zu: %d\n", n, res);
-			return EXIT_FAILURE;
+	return NULL;
+}
+
+static bool schedule_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len) {
+	// Classify the message by the lowest priority class of all it's commands
+	TfsServerSchedulerClass class;
+	if (!tfs_protocol_is_framed(message, message_len)) { class = tfs_server_scheduler_classify(message, message_len); }
+	else {
+		TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+		if (!header_result.success || header_result.data.header.kind == TfsProtocolKindAttach) { return false; }
+
+		class = TfsServerSchedulerClassRead;
+		const char* command_str = message + TFS_PROTOCOL_HEADER_LEN;
+		const char* message_end = message + message_len;
+		while (command_str < message_end) {
+			const char* command_str_end = memchr(command_str, '\n', (size_t)(message_end - command_str));
+			if (command_str_end == NULL) { command_str_end = message_end; }
+			TfsServerSchedulerClass command_class =
+				tfs_server_scheduler_classify(command_str, (size_t)(command_str_end - command_str));
+			if (command_class > class) { class = command_class; }
+			command_str = command_str_end + 1;
 		}
 	}
 
-	// Destroy all resources in reverse order of creation.
-	close(server_socket);
-	unlink(argv[1]);
-	tfs_fs_destroy(&fs);
+	// Note: We only fail to push once the scheduler is closed, when no lane would reply anyway.
+	QueuedMessage* job = queued_message_new(message, message_len, address, address_len);
+	if (!tfs_server_scheduler_push(data->scheduler, class, job)) { free(job); }
+	return true;
+}
 
-	return EXIT_SUCCESS;
+static void* admission_thread_fn(void* arg) {
+	const WorkerData* data = arg;
+
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+	QueuedMessage* job;
+	while ((job = tfs_server_admission_pop(data->admission)) != NULL) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		TfsTraceSpan request_span = tfs_trace_begin();
+		size_t reply_len =
+			process_message(data, job->message, job->message_len, &job->address, job->address_len, -1, reply);
+		tfs_trace_end(request_span, "request");
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		tfs_server_admission_record(data->admission,
+			(uint64_t)((end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec)));
+
+		// Note: Just like the batched replies, any reply we can't send is skipped.
+		sendto(data->server_socket, reply, reply_len, 0, (struct sockaddr*)&job->address, job->address_len);
+		free(job);
+	}
+
+	return NULL;
 }
 
-static void* worker_thread_fn(void* arg) {
-	WorkerData* data = arg;
+static QueuedMessage* queued_message_new(
+	const char* message, size_t message_len, const struct sockaddr_un* address, socklen_t address_len) {
+	QueuedMessage* job = malloc(sizeof(QueuedMessage) + message_len + 1);
+	if (job == NULL) {
+		fprintf(stderr, "Unable to allocate queued message\n");
+		exit(EXIT_FAILURE);
+	}
+	job->address = *address;
+	job->address_len = address_len;
+	job->message_len = message_len;
+	memcpy(job->message, message, message_len);
+
+	return job;
+}
+
+static bool admit_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	char* reply,
+	size_t* reply_len) {
+	// Each message costs as many commands as it has
+	bool framed = tfs_protocol_is_framed(message, message_len);
+	TfsProtocolHeader header = {.kind = TfsProtocolKindBatch, .count = 1, .id = 0};
+	if (framed) {
+		TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+		if (!header_result.success || header_result.data.header.kind == TfsProtocolKindAttach) { return false; }
+		header = header_result.data.header;
+	}
+
+	QueuedMessage* job = queued_message_new(message, message_len, address, address_len);
+	uint32_t retry_after_ms;
+	size_t cost = header.count == 0 ? 1 : header.count;
+	if (tfs_server_admission_push(data->admission, address, address_len, job, cost, &retry_after_ms)) {
+		*reply_len = 0;
+		return true;
+	}
+	free(job);
+
+	// Note: Legacy messages can't be told to retry, so they're simply failed.
+	if (!framed) {
+		reply[0] = '\0';
+		*reply_len = 1;
+		return true;
+	}
+
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindBusy, .count = 0, .id = header.id}, reply);
+	tfs_protocol_u32_write(retry_after_ms, reply + TFS_PROTOCOL_HEADER_LEN);
+	*reply_len = TFS_PROTOCOL_BUSY_REPLY_LEN;
+	return true;
+}
+
+static void execute_queued_message(const WorkerData* data, QueuedMessage* job) {
+	char reply[TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY];
+	TfsTraceSpan request_span = tfs_trace_begin();
+	size_t reply_len =
+		process_message(data, job->message, job->message_len, &job->address, job->address_len, -1, reply);
+	tfs_trace_end(request_span, "request");
+
+	// Note: Just like the batched replies, any reply we can't send is skipped.
+	sendto(data->server_socket, reply, reply_len, 0, (struct sockaddr*)&job->address, job->address_len);
+	free(job);
+}
+
+static void pool_execute(void* item, void* arg) {
+	execute_queued_message(arg, item);
+}
+
+static bool pool_message(const WorkerData* data,
+	const char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len) {
+	// Note: Pool requests are processed right away, so the pool can be administered even while overloaded.
+	if (tfs_protocol_is_framed(message, message_len)) {
+		TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+		if (!header_result.success || header_result.data.header.kind == TfsProtocolKindAttach ||
+			header_result.data.header.kind == TfsProtocolKindPool) {
+			return false;
+		}
+	}
+
+	// Note: We only fail to push once the pool is closed, when no executor would reply anyway.
+	QueuedMessage* job = queued_message_new(message, message_len, address, address_len);
+	if (!tfs_server_pool_push(data->pool, job)) { free(job); }
+	return true;
+}
+
+static void* session_thread_fn(void* arg) {
+	SessionData* session = arg;
+	TfsShmRing* ring = &session->ring;
+	const WorkerData* data = &session->worker_data;
 
+	// Note: Both `peek` and `reserve` only fail once the client closes the ring.
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN + 1];
 	while (1) {
-		// Receive the command
-		char command_str[512];
-		struct sockaddr_un client_address;
-		socklen_t client_address_len = sizeof(client_address);
-		ssize_t command_str_len = recvfrom(data->server_socket,
-			command_str,
-			sizeof(command_str) - 1,
-			0,
-			(struct sockaddr*)&client_address,
-			&client_address_len //
-		);
-		if (command_str_len <= 0) {
-			fprintf(stderr, "Failed to receive command\n");
-			exit(EXIT_FAILURE);
+		size_t message_len;
+		const char* slot = session_peek(data, ring, &message_len);
+		if (slot == NULL) { break; }
+		char* reply = tfs_shm_ring_queue_reserve(&ring->completions, true);
+		if (reply == NULL) { break; }
+
+		// Note: The client may still write to the slot, so we parse a copy of it, rather than the slot itself,
+		//       and can't trust it's length to leave space for the nul terminator.
+		TfsTraceSpan request_span = tfs_trace_begin();
+		if (message_len > TFS_PROTOCOL_MAX_MESSAGE_LEN) { message_len = TFS_PROTOCOL_MAX_MESSAGE_LEN; }
+		memcpy(message, slot, message_len);
+		message[message_len] = '\0';
+		size_t reply_len =
+			process_message(data, message, message_len, &session->address, session->address_len, -1, reply);
+		tfs_shm_ring_queue_commit(&ring->completions, reply_len);
+		tfs_shm_ring_queue_release(&ring->submissions);
+		tfs_trace_end(request_span, "request");
+	}
+
+	tfs_shm_ring_unmap(ring);
+	free(session);
+	return NULL;
+}
+
+static char* session_peek(const WorkerData* data, TfsShmRing* ring, size_t* message_len) {
+	// Busy-poll the ring for a while, if we do
+	if (data->busy_poll_cpu >= 0) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		while (!tfs_shm_ring_is_closed(ring)) {
+			char* message = tfs_shm_ring_queue_peek(&ring->submissions, false, message_len);
+			if (message != NULL) { return message; }
+
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			uint64_t elapsed_ns = (uint64_t)((now.tv_sec - start.tv_sec) * 1000000000 + (now.tv_nsec - start.tv_nsec));
+			if (elapsed_ns >= data->busy_poll_spin_ns) { break; }
 		}
+	}
+
+	return tfs_shm_ring_queue_peek(&ring->submissions, true, message_len);
+}
+
+static size_t process_message(const WorkerData* data,
+	char* message,
+	size_t message_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	int fd,
+	char* reply) {
+	// If it's a legacy message, execute it's single command
+	if (!tfs_protocol_is_framed(message, message_len)) {
+		message[message_len] = '\0';
+		reply[0] = execute_command_str(data, message, message_len, address, address_len) ? '\1' : '\0';
+		return 1;
+	}
 
-		// Parse the command string
-		command_str[command_str_len] = '\0';
-		FILE* command_input = fmemopen(command_str, (size_t)command_str_len, "r");
-		TfsCommandParseResult parse_result = tfs_command_parse(command_input);
-		fclose(command_input);
-		if (!parse_result.success) {
-			// Respond with negative
-			char response = '\0';
-			sendto(data->server_socket, &response, 1, 0, (struct sockaddr*)&client_address, client_address_len);
+	// Else read the header
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+	if (!header_result.success) {
+		// Note: We reply with an empty batch, which the client will reject.
+		fprintf(stderr, "Unable to read message header\n");
+		tfs_protocol_header_read_error_print(&header_result.data.err, stderr);
+		tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindBatch, .count = 0}, reply);
+		return TFS_PROTOCOL_HEADER_LEN;
+	}
+	TfsProtocolHeader header = header_result.data.header;
+
+	// If it's an attach request, start a session on the ring
+	if (header.kind == TfsProtocolKindAttach) {
+		bool attached = process_attach(data, fd, address, address_len);
+		tfs_protocol_header_write(
+			(TfsProtocolHeader){.kind = TfsProtocolKindAttach, .count = 1, .id = header.id}, reply);
+		reply[TFS_PROTOCOL_HEADER_LEN] = attached ? '\1' : '\0';
+		return TFS_PROTOCOL_ATTACH_REPLY_LEN;
+	}
+
+	// If it's a pool request, read or pin the pool's size
+	if (header.kind == TfsProtocolKindPool) {
+		tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindPool, .count = 0, .id = header.id}, reply);
+		return process_pool(data, message, message_len, reply);
+	}
+
+	// If it's a lease request, execute it's lookup
+	if (header.kind == TfsProtocolKindLease) {
+		message[message_len] = '\0';
+		uint32_t lease_ms = 0;
+		bool executed_successfully = process_lease(data,
+			message + TFS_PROTOCOL_HEADER_LEN,
+			message_len - TFS_PROTOCOL_HEADER_LEN,
+			address,
+			address_len,
+			&lease_ms);
+		tfs_protocol_header_write(
+			(TfsProtocolHeader){.kind = TfsProtocolKindLease, .count = 1, .id = header.id}, reply);
+		reply[TFS_PROTOCOL_HEADER_LEN] = executed_successfully ? '\1' : '\0';
+		tfs_protocol_u32_write(lease_ms, reply + TFS_PROTOCOL_HEADER_LEN + 1);
+		return TFS_PROTOCOL_LEASE_REPLY_LEN;
+	}
 
-			fprintf(stderr, "Unable to parse command: \"%s\"\n", command_str);
-			tfs_command_parse_error_print(&parse_result.data.err, stderr);
+	// Then execute each command in order
+	// Note: Each command is terminated by a newline, which we replace with a nul.
+	char* command_str = message + TFS_PROTOCOL_HEADER_LEN;
+	char* message_end = message + message_len;
+	for (size_t n = 0; n < header.count; n++) {
+		char* command_str_end = memchr(command_str, '\n', (size_t)(message_end - command_str));
+		if (command_str_end == NULL) {
+			fprintf(stderr, "Message is missing command #%zu\n", n);
+			reply[TFS_PROTOCOL_HEADER_LEN + n] = '\0';
 			continue;
 		}
-		TfsCommand command = parse_result.data.command;
-
-		// Execute each command on the file system
-		// Note: On error we print the error backtrace and simply continue
-		//       on to the next command
-		bool executed_successfully;
-		switch (command.kind) {
-			case TfsCommandCreate: {
-				TfsInodeType inode_type = command.data.create.type;
-				TfsPath path = tfs_path_owned_borrow(command.data.create.path);
-
-				fprintf(stderr, "Creating %s '%.*s'\n", tfs_inode_type_str(inode_type), (int)path.len, path.chars);
-
-				// Lock the filesystem and create the file
-				TfsFsCreateResult result = tfs_fs_create(data->fs, path, inode_type);
-				executed_successfully = result.success;
-				if (!executed_successfully) {
-					fprintf(stderr,
-						"Unable to create %s '%.*s'\n",
-						tfs_inode_type_str(inode_type),
-						(int)path.len,
-						path.chars);
-					tfs_fs_create_error_print(&result.data.err, stderr);
-				}
-				else {
-					TfsInodeIdx idx = result.data.idx;
-					fprintf(stderr,
-						"Successfully created %s '%.*s' (Inode %zu)\n",
-						tfs_inode_type_str(inode_type),
-						(int)path.len,
-						path.chars,
-						idx.idx);
-					tfs_fs_unlock_inode(data->fs, idx);
-				}
-				break;
-			}
 
-			// Delete path
-			case TfsCommandRemove: {
-				TfsPath path = tfs_path_owned_borrow(command.data.remove.path);
+		*command_str_end = '\0';
+		bool executed_successfully =
+			execute_command_str(data, command_str, (size_t)(command_str_end - command_str), address, address_len);
+		reply[TFS_PROTOCOL_HEADER_LEN + n] = executed_successfully ? '\1' : '\0';
+		command_str = command_str_end + 1;
+	}
 
-				fprintf(stderr, "Removing '%.*s'\n", (int)path.len, path.chars);
+	tfs_protocol_header_write(header, reply);
+	return TFS_PROTOCOL_HEADER_LEN + header.count;
+}
 
-				TfsFsRemoveResult result = tfs_fs_remove(data->fs, path);
-				executed_successfully = result.success;
-				if (!executed_successfully) {
-					fprintf(stderr, "Unable to remove '%.*s'\n", (int)path.len, path.chars);
-					tfs_fs_remove_error_print(&result.data.err, stderr);
-				}
-				else {
-					// Note: No need to unlock anything, as we just remove the inode
-					fprintf(stderr, "Successfully removed '%.*s'\n", (int)path.len, path.chars);
-				}
-				break;
-			}
+static bool process_attach(const WorkerData* data, int fd, const struct sockaddr_un* address, socklen_t address_len) {
+	if (fd < 0) {
+		fprintf(stderr, "Attach request is missing it's ring\n");
+		return false;
+	}
 
-			case TfsCommandSearch: {
-				TfsPath path = tfs_path_owned_borrow(command.data.search.path);
+	// Note: The descriptor is closed along with the message batch, so we map our own.
+	TfsShmRingMapResult map_result = tfs_shm_ring_map(dup(fd));
+	if (!map_result.success) {
+		fprintf(stderr, "Unable to map client ring\n");
+		tfs_shm_ring_map_error_print(&map_result.data.err, stderr);
+		return false;
+	}
 
-				fprintf(stderr, "Searching '%.*s'\n", (int)path.len, path.chars);
+	SessionData* session = malloc(sizeof(SessionData));
+	if (session == NULL) {
+		fprintf(stderr, "Unable to allocate ring session\n");
+		tfs_shm_ring_unmap(&map_result.data.ring);
+		return false;
+	}
+	*session = (SessionData){
+		.worker_data = *data,
+		.ring = map_result.data.ring,
+		.address = *address,
+		.address_len = address_len,
+	};
+	session->worker_data.uring = NULL;
 
-				TfsFsFindResult result = tfs_fs_find(data->fs, path, TfsRwLockAccessShared);
-				executed_successfully = result.success;
-				if (!executed_successfully) {
-					fprintf(stderr, "Unable to find '%.*s'\n", (int)path.len, path.chars);
-					tfs_fs_find_error_print(&result.data.err, stderr);
-				}
-				else {
-					TfsLockedInode inode = result.data.inode;
-					fprintf(stderr,
-						"Found %s '%.*s' (Inode %zu)\n",
-						tfs_inode_type_str(inode.type),
-						(int)path.len,
-						path.chars,
-						inode.idx.idx);
-					tfs_fs_unlock_inode(data->fs, inode.idx);
-				}
-				break;
+	// Note: Sessions are detached, as they end whenever their client closes the ring.
+	pthread_t session_thread;
+	pthread_attr_t session_attr;
+	pthread_attr_init(&session_attr);
+	pthread_attr_setdetachstate(&session_attr, PTHREAD_CREATE_DETACHED);
+	if (data->busy_poll_cpu >= 0) { pthread_attr_setaffinity_np(&session_attr, sizeof(session_cpus), &session_cpus); }
+	int res = pthread_create(&session_thread, &session_attr, session_thread_fn, session);
+	pthread_attr_destroy(&session_attr);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create ring session thread: %d\n", res);
+		tfs_shm_ring_close(&session->ring);
+		tfs_shm_ring_unmap(&session->ring);
+		free(session);
+		return false;
+	}
+
+	fprintf(stderr, "Attached ring of '%.*s'\n", (int)sizeof(address->sun_path), address->sun_path);
+	return true;
+}
+
+static size_t process_pool(const WorkerData* data, const char* message, size_t message_len, char* reply) {
+	char* body = reply + TFS_PROTOCOL_HEADER_LEN;
+	memset(body, 0, TFS_PROTOCOL_POOL_REPLY_LEN - TFS_PROTOCOL_HEADER_LEN);
+	if (data->pool == NULL) { return TFS_PROTOCOL_POOL_REPLY_LEN; }
+
+	// Note: Requests without a size only read it.
+	uint32_t size = message_len == TFS_PROTOCOL_POOL_REQUEST_LEN
+					  ? tfs_protocol_u32_read(message + TFS_PROTOCOL_HEADER_LEN)
+					  : 0;
+	if (size == TFS_PROTOCOL_POOL_ADAPT) {
+		fprintf(stderr, "Letting the pool adapt it's size\n");
+		tfs_server_pool_pin(data->pool, 0);
+	}
+	else if (size != 0) {
+		fprintf(stderr, "Pinning the pool to %" PRIu32 " threads\n", size);
+		tfs_server_pool_pin(data->pool, size);
+	}
+
+	TfsServerPoolInfo info = tfs_server_pool_info(data->pool);
+	tfs_protocol_u32_write((uint32_t)info.size, body);
+	tfs_protocol_u32_write((uint32_t)info.live, body + 4);
+	tfs_protocol_u32_write((uint32_t)info.min, body + 8);
+	tfs_protocol_u32_write((uint32_t)info.max, body + 12);
+	body[16] = info.pinned ? '\1' : '\0';
+	return TFS_PROTOCOL_POOL_REPLY_LEN;
+}
+
+static bool process_lease(const WorkerData* data,
+	char* commands_str,
+	size_t commands_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	uint32_t* lease_ms) {
+	// Note: The command is terminated by a newline, which we replace with a nul.
+	char* command_str_end = memchr(commands_str, '\n', commands_str_len);
+	if (command_str_end == NULL) {
+		fprintf(stderr, "Lease request is missing it's command\n");
+		return false;
+	}
+	*command_str_end = '\0';
+
+	TfsCommand command;
+	if (!parse_command_str(commands_str, (size_t)(command_str_end - commands_str), &command)) { return false; }
+	record_command_str(data, commands_str, (size_t)(command_str_end - commands_str), address, address_len);
+
+	// Only lookups from clients we can send invalidations to are leased
+	// Note: The lease must be granted before the lookup, so any changes after it invalidate it.
+	if (command.kind == TfsCommandSearch && address_len > sizeof(sa_family_t)) {
+		*lease_ms = tfs_server_leases_grant(
+			data->leases, tfs_path_owned_borrow(command.data.search.path), address, address_len);
+	}
+	bool executed_successfully = execute_command(data, &command, *lease_ms == 0);
+	tfs_command_destroy(&command);
+
+	return executed_successfully;
+}
+
+static bool parse_command_str(char* command_str, size_t command_str_len, TfsCommand* command) {
+	TfsTraceSpan parse_span = tfs_trace_begin();
+	TfsCommandParseResult parse_result = tfs_command_parse_line(command_str, command_str_len);
+	tfs_trace_end(parse_span, "parse");
+	if (!parse_result.success) {
+		fprintf(stderr, "Unable to parse command: \"%s\"\n", command_str);
+		tfs_command_parse_error_print(&parse_result.data.err, stderr);
+		return false;
+	}
+
+	*command = parse_result.data.command;
+	return true;
+}
+
+static bool execute_command_str(const WorkerData* data,
+	char* command_str,
+	size_t command_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len) {
+	// Parse the command string
+	TfsCommand command;
+	if (!parse_command_str(command_str, command_str_len, &command)) { return false; }
+	record_command_str(data, command_str, command_str_len, address, address_len);
+
+	// Then execute it
+	bool executed_successfully = execute_command(data, &command, true);
+	tfs_command_destroy(&command);
+
+	return executed_successfully;
+}
+
+static void record_command_str(const WorkerData* data,
+	const char* command_str,
+	size_t command_str_len,
+	const struct sockaddr_un* address,
+	socklen_t address_len) {
+	if (data->recorder == NULL) { return; }
+
+	TfsTraceSpan record_span = tfs_trace_begin();
+	tfs_server_recorder_record(data->recorder, address, address_len, command_str, command_str_len);
+	tfs_trace_end(record_span, "record");
+}
+
+static bool execute_command(const WorkerData* data, const TfsCommand* command, bool coalesce) {
+	TfsFs* fs = data->fs;
+
+	// Execute the command on the file system
+	// Note: On error we print the error backtrace and simply continue
+	//       on to the next command
+	TfsTraceSpan exec_span = tfs_trace_begin();
+	const char* exec_span_name = "exec";
+	bool executed_successfully = false;
+	switch (command->kind) {
+		case TfsCommandCreate: {
+			exec_span_name = "exec create";
+			TfsInodeType inode_type = command->data.create.type;
+			TfsPath path = tfs_path_owned_borrow(command->data.create.path);
+
+			fprintf(stderr, "Creating %s '%.*s'\n", tfs_inode_type_str(inode_type), (int)path.len, path.chars);
+
+			// Lock the filesystem and create the file
+			TfsFsCreateResult result = tfs_fs_create(fs, path, inode_type);
+			executed_successfully = result.success;
+			if (!executed_successfully) {
+				fprintf(stderr,
+					"Unable to create %s '%.*s'\n",
+					tfs_inode_type_str(inode_type),
+					(int)path.len,
+					path.chars);
+				tfs_fs_create_error_print(&result.data.err, stderr);
+			}
+			else {
+				TfsInodeIdx idx = result.data.idx;
+				fprintf(stderr,
+					"Successfully created %s '%.*s' (Inode %zu)\n",
+					tfs_inode_type_str(inode_type),
+					(int)path.len,
+					path.chars,
+					idx.idx);
+				tfs_fs_unlock_inode(fs, idx);
+				tfs_server_leases_invalidate(data->leases, path, data->server_socket);
+				tfs_server_singleflight_written(data->singleflight);
 			}
+			break;
+		}
 
-			case TfsCommandMove: {
-				TfsPath source = tfs_path_owned_borrow(command.data.move.source);
-				TfsPath dest = tfs_path_owned_borrow(command.data.move.dest);
+		// Delete path
+		case TfsCommandRemove: {
+			exec_span_name = "exec remove";
+			TfsPath path = tfs_path_owned_borrow(command->data.remove.path);
 
-				fprintf(stderr, "Moving '%.*s' to '%.*s'\n", (int)source.len, source.chars, (int)dest.len, dest.chars);
+			fprintf(stderr, "Removing '%.*s'\n", (int)path.len, path.chars);
 
-				TfsFsMoveResult result = tfs_fs_move(data->fs, source, dest, TfsRwLockAccessUnique);
-				executed_successfully = result.success;
-				if (!executed_successfully) {
-					fprintf(stderr,
-						"Unable to move '%.*s' to '%.*s'\n",
-						(int)source.len,
-						source.chars,
-						(int)dest.len,
-						dest.chars);
-					tfs_fs_move_error_print(&result.data.err, stderr);
-				}
-				else {
-					TfsLockedInode inode = result.data.inode;
-					fprintf(stderr,
-						"Successfully moved %s '%.*s' (Inode %zu) to '%.*s'\n",
-						tfs_inode_type_str(inode.type),
-						(int)source.len,
-						source.chars,
-						inode.idx.idx,
-						(int)dest.len,
-						dest.chars);
-					tfs_fs_unlock_inode(data->fs, inode.idx);
-				}
-				break;
+			TfsFsRemoveResult result = tfs_fs_remove(fs, path);
+			executed_successfully = result.success;
+			if (!executed_successfully) {
+				fprintf(stderr, "Unable to remove '%.*s'\n", (int)path.len, path.chars);
+				tfs_fs_remove_error_print(&result.data.err, stderr);
 			}
+			else {
+				// Note: No need to unlock anything, as we just remove the inode
+				fprintf(stderr, "Successfully removed '%.*s'\n", (int)path.len, path.chars);
+				tfs_server_leases_invalidate(data->leases, path, data->server_socket);
+				tfs_server_singleflight_written(data->singleflight);
+			}
+			break;
+		}
 
-			case TfsCommandPrint: {
-				const char* file_name = command.data.print.path;
+		case TfsCommandSearch: {
+			exec_span_name = "exec lookup";
+			TfsPath path = tfs_path_owned_borrow(command->data.search.path);
 
-				fprintf(stderr, "Printing filesystem to '%s'\n", file_name);
+			fprintf(stderr, "Searching '%.*s'\n", (int)path.len, path.chars);
 
-				TfsFsPrintResult result = tfs_fs_print(data->fs, file_name);
-				executed_successfully = result.success;
-				if (!executed_successfully) {
-					fprintf(stderr, "Unable to print filesystem to '%s'\n", file_name);
-					tfs_fs_print_error_print(&result.data.err, stderr);
-				}
-				else {
-					fprintf(stderr, "Successfully printed filesystem to '%s'\n", file_name);
-				}
-				break;
+			// Note: Coalesced lookups return the inode already unlocked.
+			if (!data->coalesce) { coalesce = false; }
+			TfsFsFindResult result = coalesce ? tfs_server_singleflight_find(data->singleflight, fs, path)
+											  : tfs_fs_find(fs, path, TfsRwLockAccessShared);
+			executed_successfully = result.success;
+			if (!executed_successfully) {
+				fprintf(stderr, "Unable to find '%.*s'\n", (int)path.len, path.chars);
+				tfs_fs_find_error_print(&result.data.err, stderr);
+			}
+			else {
+				TfsLockedInode inode = result.data.inode;
+				fprintf(stderr,
+					"Found %s '%.*s' (Inode %zu)\n",
+					tfs_inode_type_str(inode.type),
+					(int)path.len,
+					path.chars,
+					inode.idx.idx);
+				if (!coalesce) { tfs_fs_unlock_inode(fs, inode.idx); }
 			}
+			break;
+		}
 
-			default: {
+		case TfsCommandMove: {
+			exec_span_name = "exec move";
+			TfsPath source = tfs_path_owned_borrow(command->data.move.source);
+			TfsPath dest = tfs_path_owned_borrow(command->data.move.dest);
+
+			fprintf(stderr, "Moving '%.*s' to '%.*s'\n", (int)source.len, source.chars, (int)dest.len, dest.chars);
+
+			TfsFsMoveResult result = tfs_fs_move(fs, source, dest, TfsRwLockAccessUnique);
+			executed_successfully = result.success;
+			if (!executed_successfully) {
+				fprintf(stderr,
+					"Unable to move '%.*s' to '%.*s'\n",
+					(int)source.len,
+					source.chars,
+					(int)dest.len,
+					dest.chars);
+				tfs_fs_move_error_print(&result.data.err, stderr);
 			}
+			else {
+				TfsLockedInode inode = result.data.inode;
+				fprintf(stderr,
+					"Successfully moved %s '%.*s' (Inode %zu) to '%.*s'\n",
+					tfs_inode_type_str(inode.type),
+					(int)source.len,
+					source.chars,
+					inode.idx.idx,
+					(int)dest.len,
+					dest.chars);
+				tfs_fs_unlock_inode(fs, inode.idx);
+				tfs_server_leases_invalidate(data->leases, source, data->server_socket);
+				tfs_server_leases_invalidate(data->leases, dest, data->server_socket);
+				tfs_server_singleflight_written(data->singleflight);
+			}
+			break;
 		}
 
-		// Free the command
-		tfs_command_destroy(&command);
+		case TfsCommandPrint: {
+			exec_span_name = "exec print";
+			const char* file_name = command->data.print.path;
 
-		// Respond if we were successful
-		char response = executed_successfully ? '\1' : '\0';
-		sendto(data->server_socket, &response, 1, 0, (struct sockaddr*)&client_address, client_address_len);
+			fprintf(stderr, "Printing filesystem to '%s'\n", file_name);
+
+			TfsFsPrintResult result =
+				data->uring != NULL ? uring_print(data->uring, fs, file_name) : tfs_fs_print(fs, file_name);
+			executed_successfully = result.success;
+			if (!executed_successfully) {
+				fprintf(stderr, "Unable to print filesystem to '%s'\n", file_name);
+				tfs_fs_print_error_print(&result.data.err, stderr);
+			}
+			else {
+				fprintf(stderr, "Successfully printed filesystem to '%s'\n", file_name);
+			}
+			break;
+		}
+
+		default: {
+		}
 	}
 
-	return NULL;
+	tfs_trace_end(exec_span, exec_span_name);
+
+	return executed_successfully;
 }
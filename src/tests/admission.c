@@ -0,0 +1,105 @@
+/// @file
+/// @brief Admission control tests
+
+// Imports
+#include <stdio.h>				  // printf
+#include <stdlib.h>				  // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				  // strcpy, strcmp
+#include <tfs/server/admission.h> // tfs_server_admission_*
+#include <tfs/test/assert.h>	  // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		  // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Pushes @p item from the client named @p name
+static bool push(TfsServerAdmission* admission, const char* name, void* item, size_t cost) {
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	strcpy(address.sun_path, name);
+	uint32_t retry_after_ms;
+	return tfs_server_admission_push(admission, &address, (socklen_t)sizeof(address), item, cost, &retry_after_ms);
+}
+
+static TfsTestResult round_robin(void) {
+	TfsServerAdmission admission = tfs_server_admission_new(2, 2, 1);
+	int items[4];
+
+	// A flooding client only fills it's own queue
+	TFS_ASSERT_OR_RETURN(push(&admission, "a", &items[0], 1));
+	TFS_ASSERT_OR_RETURN(push(&admission, "a", &items[1], 1));
+	TFS_ASSERT_OR_RETURN(!push(&admission, "a", &items[2], 1));
+	TFS_ASSERT_OR_RETURN(push(&admission, "b", &items[2], 1));
+	TFS_ASSERT_OR_RETURN(push(&admission, "b", &items[3], 1));
+	TFS_ASSERT_OR_RETURN(admission.clients[0].stats.admitted == 2);
+	TFS_ASSERT_OR_RETURN(admission.clients[0].stats.rejected == 1);
+	TFS_ASSERT_OR_RETURN(admission.clients[1].stats.max_queued == 2);
+
+	// And clients are served in turns
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[2]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[3]);
+
+	tfs_server_admission_destroy(&admission);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult deficit(void) {
+	TfsServerAdmission admission = tfs_server_admission_new(2, 2, 1);
+	int items[4];
+
+	// Costly messages wait for their client to build up enough deficit
+	TFS_ASSERT_OR_RETURN(push(&admission, "a", &items[0], 3));
+	TFS_ASSERT_OR_RETURN(push(&admission, "b", &items[1], 1));
+	TFS_ASSERT_OR_RETURN(push(&admission, "b", &items[2], 1));
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[2]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[0]);
+
+	// Idle clients don't keep their deficit
+	TFS_ASSERT_OR_RETURN(admission.clients[0].deficit == 0);
+	TFS_ASSERT_OR_RETURN(admission.clients[1].deficit == 0);
+
+	tfs_server_admission_destroy(&admission);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult clients(void) {
+	TfsServerAdmission admission = tfs_server_admission_new(2, 2, 1);
+	int items[4];
+
+	// Clients beyond the capacity are rejected while all others are busy
+	TFS_ASSERT_OR_RETURN(push(&admission, "a", &items[0], 1));
+	TFS_ASSERT_OR_RETURN(push(&admission, "b", &items[1], 1));
+	TFS_ASSERT_OR_RETURN(!push(&admission, "c", &items[2], 1));
+	TFS_ASSERT_OR_RETURN(admission.untracked_rejected == 1);
+
+	// But take over idle ones
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[0]);
+	TFS_ASSERT_OR_RETURN(push(&admission, "c", &items[2], 1));
+	TFS_ASSERT_OR_RETURN(strcmp(admission.clients[0].address.sun_path, "c") == 0);
+
+	// Until closed
+	tfs_server_admission_close(&admission);
+	TFS_ASSERT_OR_RETURN(!push(&admission, "b", &items[3], 1));
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == &items[2]);
+	TFS_ASSERT_OR_RETURN(tfs_server_admission_pop(&admission) == NULL);
+
+	tfs_server_admission_destroy(&admission);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = round_robin, .name = "admission/round_robin"},
+		(TfsTest){.fn = deficit    , .name = "admission/deficit"    },
+		(TfsTest){.fn = clients    , .name = "admission/clients"    },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
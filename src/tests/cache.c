@@ -0,0 +1,90 @@
+/// @file
+/// @brief Client lookup cache tests
+
+// Imports
+#include <stdio.h>			  // printf
+#include <stdlib.h>			  // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/client/cache.h> // tfs_client_cache_*
+#include <tfs/test/assert.h>  // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	  // TfsTest, TfsTestFn, TfsTestResult
+
+static TfsTestResult hit(void) {
+	TfsClientCache cache = tfs_client_cache_new(16);
+	tfs_client_cache_set_enabled(&cache, true);
+
+	// Equal paths share their entry
+	bool exists;
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a/b"), &exists));
+	tfs_client_cache_insert(&cache, tfs_path_from_cstr("/a/b"), true, tfs_client_cache_ticket(&cache), 60000);
+	TFS_ASSERT_OR_RETURN(tfs_client_cache_get(&cache, tfs_path_from_cstr(" a // b/"), &exists) && exists);
+	tfs_client_cache_insert(&cache, tfs_path_from_cstr("/c"), false, tfs_client_cache_ticket(&cache), 60000);
+	TFS_ASSERT_OR_RETURN(tfs_client_cache_get(&cache, tfs_path_from_cstr("/c"), &exists) && !exists);
+
+	TfsClientCacheStats stats = tfs_client_cache_stats(&cache);
+	TFS_ASSERT_OR_RETURN(stats.hits == 2 && stats.misses == 1);
+
+	// Disabling it drops all entries
+	tfs_client_cache_set_enabled(&cache, false);
+	tfs_client_cache_set_enabled(&cache, true);
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a/b"), &exists));
+
+	tfs_client_cache_destroy(&cache);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult invalidate(void) {
+	TfsClientCache cache = tfs_client_cache_new(16);
+	tfs_client_cache_set_enabled(&cache, true);
+
+	const char* paths[] = {"/a", "/a/b", "/a/b/c", "/ab", NULL};
+	for (size_t n = 0; paths[n] != NULL; n++) {
+		tfs_client_cache_insert(&cache, tfs_path_from_cstr(paths[n]), true, tfs_client_cache_ticket(&cache), 60000);
+	}
+
+	// Only the path and those within it are invalidated
+	tfs_client_cache_invalidate(&cache, tfs_path_from_cstr("/a/b"));
+	bool exists;
+	TFS_ASSERT_OR_RETURN(tfs_client_cache_get(&cache, tfs_path_from_cstr("/a"), &exists));
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a/b"), &exists));
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a/b/c"), &exists));
+	TFS_ASSERT_OR_RETURN(tfs_client_cache_get(&cache, tfs_path_from_cstr("/ab"), &exists));
+
+	tfs_client_cache_destroy(&cache);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult stale_ticket(void) {
+	TfsClientCache cache = tfs_client_cache_new(16);
+	tfs_client_cache_set_enabled(&cache, true);
+
+	// A result whose lookup was sent before an invalidation isn't cached
+	TfsClientCacheTicket ticket = tfs_client_cache_ticket(&cache);
+	tfs_client_cache_invalidate(&cache, tfs_path_from_cstr("/b"));
+	tfs_client_cache_insert(&cache, tfs_path_from_cstr("/a"), true, ticket, 60000);
+	bool exists;
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a"), &exists));
+
+	// Nor is one without a lease
+	tfs_client_cache_insert(&cache, tfs_path_from_cstr("/a"), true, tfs_client_cache_ticket(&cache), 0);
+	TFS_ASSERT_OR_RETURN(!tfs_client_cache_get(&cache, tfs_path_from_cstr("/a"), &exists));
+
+	tfs_client_cache_destroy(&cache);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = hit         , .name = "cache/hit"         },
+		(TfsTest){.fn = invalidate  , .name = "cache/invalidate"  },
+		(TfsTest){.fn = stale_ticket, .name = "cache/stale_ticket"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
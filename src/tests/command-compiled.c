@@ -0,0 +1,158 @@
+/// @file
+/// @brief Compiled command file tests
+
+// Imports
+#include <stdio.h>				  // printf, open_memstream
+#include <stdlib.h>				  // size_t, free, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				  // memcpy, strcmp
+#include <tfs/command/compiled.h> // tfs_command_compiled_*
+#include <tfs/command/file.h>	  // tfs_command_file_*
+#include <tfs/path.h>			  // tfs_path_eq, tfs_path_owned_borrow
+#include <tfs/test/assert.h>	  // TFS_ASSERT_OR_RETURN
+#include <tfs/test/file.h>		  // tfs_test_temp_file
+#include <tfs/test/test.h>		  // TfsTest, TfsTestFn, TfsTestResult
+#include <unistd.h>				  // close
+
+/// @brief Text command file compiled by all tests
+static const char TEXT[] = "# Comment\n"
+						   "c /a d\n"
+						   "c /a/x f\n"
+						   "\n"
+						   "l /a/x\n"
+						   "m /a/x /a/y\n"
+						   "d /a/y\n"
+						   "l /a/x\n"
+						   "p out.txt\n";
+
+/// @brief Number of commands in #TEXT
+#define TEXT_COMMANDS 7
+
+/// @brief Number of distinct paths in #TEXT
+#define TEXT_PATHS 4
+
+/// @brief Parses a command file from @p contents
+static TfsCommandFileParseResult parse_contents(const char* contents, size_t contents_len) {
+	int fd = tfs_test_temp_file(contents, contents_len);
+	if (fd == -1) {
+		return (TfsCommandFileParseResult){
+			.success = false,
+			.data.err.kind = TfsCommandFileParseErrorRead,
+		};
+	}
+
+	TfsCommandFileParseResult result = tfs_command_file_parse(fd, 1);
+	close(fd);
+	return result;
+}
+
+/// @brief Checks if two commands are the same
+static bool command_eq(const TfsCommand* lhs, const TfsCommand* rhs) {
+	if (lhs->kind != rhs->kind) { return false; }
+	switch (lhs->kind) {
+		case TfsCommandCreate:
+			return lhs->data.create.type == rhs->data.create.type &&
+				   tfs_path_eq(tfs_path_owned_borrow(lhs->data.create.path),
+					   tfs_path_owned_borrow(rhs->data.create.path));
+		case TfsCommandSearch:
+			return tfs_path_eq(
+				tfs_path_owned_borrow(lhs->data.search.path), tfs_path_owned_borrow(rhs->data.search.path));
+		case TfsCommandRemove:
+			return tfs_path_eq(
+				tfs_path_owned_borrow(lhs->data.remove.path), tfs_path_owned_borrow(rhs->data.remove.path));
+		case TfsCommandMove:
+			return tfs_path_eq(
+					   tfs_path_owned_borrow(lhs->data.move.source), tfs_path_owned_borrow(rhs->data.move.source)) &&
+				   tfs_path_eq(tfs_path_owned_borrow(lhs->data.move.dest), tfs_path_owned_borrow(rhs->data.move.dest));
+		case TfsCommandPrint:
+		default: return strcmp(lhs->data.print.path, rhs->data.print.path) == 0;
+	}
+}
+
+/// @brief Compiles #TEXT to a new string
+/// @return The compiled file, which must be freed
+static char* compile_text(size_t* compiled_len) {
+	TfsCommandFileParseResult text_result = parse_contents(TEXT, sizeof(TEXT) - 1);
+	if (!text_result.success) { return NULL; }
+
+	char* compiled = NULL;
+	FILE* out = open_memstream(&compiled, compiled_len);
+	bool written = tfs_command_compiled_write(
+		text_result.data.file.commands, text_result.data.file.lines, text_result.data.file.len, out);
+	fclose(out);
+	tfs_command_file_destroy(&text_result.data.file);
+	if (!written) {
+		free(compiled);
+		return NULL;
+	}
+
+	return compiled;
+}
+
+static TfsTestResult round_trip(void) {
+	size_t compiled_len;
+	char* compiled = compile_text(&compiled_len);
+	TFS_ASSERT_OR_RETURN(compiled != NULL);
+
+	// Each distinct path must only be stored once
+	TfsCommandCompiledHeader header;
+	memcpy(&header, compiled, sizeof(header));
+	TFS_ASSERT_OR_RETURN(header.commands_len == TEXT_COMMANDS && header.strings_len == TEXT_PATHS);
+
+	// And loading it must yield the same commands, on the same lines, as parsing the text
+	TfsCommandFileParseResult text_result = parse_contents(TEXT, sizeof(TEXT) - 1);
+	TfsCommandFileParseResult compiled_result = parse_contents(compiled, compiled_len);
+	TFS_ASSERT_OR_RETURN(text_result.success && compiled_result.success);
+	TfsCommandFile* text = &text_result.data.file;
+	TfsCommandFile* loaded = &compiled_result.data.file;
+	TFS_ASSERT_OR_RETURN(loaded->len == TEXT_COMMANDS);
+	for (size_t n = 0; n < TEXT_COMMANDS; n++) {
+		TFS_ASSERT_OR_RETURN(command_eq(&text->commands[n], &loaded->commands[n]));
+		TFS_ASSERT_OR_RETURN(text->lines[n] == loaded->lines[n]);
+	}
+
+	tfs_command_file_destroy(loaded);
+	tfs_command_file_destroy(text);
+	free(compiled);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult corrupt(void) {
+	size_t compiled_len;
+	char* compiled = compile_text(&compiled_len);
+	TFS_ASSERT_OR_RETURN(compiled != NULL);
+
+	// A truncated file must be rejected
+	TfsCommandFileParseResult result = parse_contents(compiled, compiled_len - 1);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsCommandFileParseErrorCompiled);
+	TFS_ASSERT_OR_RETURN(result.data.err.data.compiled.err.kind == TfsCommandCompiledOpenErrorTruncated);
+
+	// As must a record with a path past the string table
+	TfsCommandCompiledRecord record;
+	char* second_record = compiled + sizeof(TfsCommandCompiledHeader) + sizeof(TfsCommandCompiledRecord);
+	memcpy(&record, second_record, sizeof(record));
+	record.path = TEXT_PATHS;
+	memcpy(second_record, &record, sizeof(record));
+	result = parse_contents(compiled, compiled_len);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsCommandFileParseErrorCompiled);
+	TFS_ASSERT_OR_RETURN(result.data.err.data.compiled.err.kind == TfsCommandCompiledOpenErrorInvalidRecord);
+	TFS_ASSERT_OR_RETURN(result.data.err.data.compiled.err.data.invalid.idx == 1);
+
+	free(compiled);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = round_trip, .name = "command-compiled/round-trip"},
+		(TfsTest){.fn = corrupt   , .name = "command-compiled/corrupt"   },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,161 @@
+/// @file
+/// @brief Command file tests
+
+// Imports
+#include <stdio.h>			  // printf, snprintf
+#include <stdlib.h>			  // size_t, malloc, free, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			  // memset, strcmp
+#include <tfs/command/file.h> // tfs_command_file_*
+#include <tfs/path.h>		  // tfs_path_eq, tfs_path_owned_borrow
+#include <tfs/test/assert.h>  // TFS_ASSERT_OR_RETURN
+#include <tfs/test/file.h>	  // tfs_test_temp_file
+#include <tfs/test/test.h>	  // TfsTest, TfsTestFn, TfsTestResult
+#include <unistd.h>			  // write, close, pipe
+
+/// @brief Length of the long path in the long paths test
+#define LONG_PATH_LEN 4000
+
+/// @brief Number of commands in the chunks test
+#define CHUNKS_COMMANDS 100000
+
+/// @brief Maximum number of threads in the chunks test
+#define CHUNKS_THREADS 8
+
+/// @brief Line of the invalid command in the chunks test
+#define CHUNKS_INVALID_LINE 77777
+
+/// @brief Generates @p len search commands, one per line, with an invalid one at @p invalid_line if not `0`
+/// @return The contents, which must be freed
+static char* gen_commands(size_t len, size_t invalid_line, size_t* contents_len) {
+	char* contents = malloc(len * 16);
+	if (contents == NULL) { return NULL; }
+
+	*contents_len = 0;
+	for (size_t n = 0; n < len; n++) {
+		char command_char = n + 1 == invalid_line ? 'x' : 'l';
+		int line_len = snprintf(contents + *contents_len, 16, "%c /f%zu\n", command_char, n % 1000);
+		*contents_len += (size_t)line_len;
+	}
+
+	return contents;
+}
+
+static TfsTestResult long_paths(void) {
+	// A comment, an empty line, a path longer than any line buffer, trailing
+	// whitespace and a last line without a newline.
+	static char contents[LONG_PATH_LEN + 64];
+	size_t contents_len = 0;
+	contents_len += (size_t)sprintf(contents + contents_len, "# Comment\n\n  c /");
+	memset(contents + contents_len, 'a', LONG_PATH_LEN);
+	contents_len += LONG_PATH_LEN;
+	contents_len += (size_t)sprintf(contents + contents_len, " d\nl /x\r\np out.txt");
+
+	int fd = tfs_test_temp_file(contents, contents_len);
+	TFS_ASSERT_OR_RETURN(fd != -1);
+	TfsCommandFileParseResult result = tfs_command_file_parse(fd, 1);
+	close(fd);
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsCommandFile* file = &result.data.file;
+
+	TFS_ASSERT_OR_RETURN(file->len == 3);
+	TFS_ASSERT_OR_RETURN(file->commands[0].kind == TfsCommandCreate);
+	TFS_ASSERT_OR_RETURN(file->commands[0].data.create.path.len == LONG_PATH_LEN + 1);
+	TFS_ASSERT_OR_RETURN(file->commands[0].data.create.type == TfsInodeTypeDir);
+	TFS_ASSERT_OR_RETURN(file->commands[1].kind == TfsCommandSearch);
+	TFS_ASSERT_OR_RETURN(
+		tfs_path_eq(tfs_path_owned_borrow(file->commands[1].data.search.path), tfs_path_from_cstr("/x")));
+	TFS_ASSERT_OR_RETURN(file->commands[2].kind == TfsCommandPrint);
+	TFS_ASSERT_OR_RETURN(strcmp(file->commands[2].data.print.path, "out.txt") == 0);
+	TFS_ASSERT_OR_RETURN(file->lines[0] == 3 && file->lines[1] == 4 && file->lines[2] == 5);
+
+	tfs_command_file_destroy(file);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult chunks(void) {
+	size_t contents_len;
+	char* contents = gen_commands(CHUNKS_COMMANDS, 0, &contents_len);
+	TFS_ASSERT_OR_RETURN(contents != NULL);
+	int fd = tfs_test_temp_file(contents, contents_len);
+	TFS_ASSERT_OR_RETURN(fd != -1);
+
+	// Parsing with many threads must yield the same commands as with one
+	TfsCommandFileParseResult single_result = tfs_command_file_parse(fd, 1);
+	TfsCommandFileParseResult multi_result = tfs_command_file_parse(fd, CHUNKS_THREADS);
+	close(fd);
+	TFS_ASSERT_OR_RETURN(single_result.success && multi_result.success);
+	TfsCommandFile* single = &single_result.data.file;
+	TfsCommandFile* multi = &multi_result.data.file;
+
+	TFS_ASSERT_OR_RETURN(single->len == CHUNKS_COMMANDS && multi->len == CHUNKS_COMMANDS);
+	for (size_t n = 0; n < CHUNKS_COMMANDS; n++) {
+		TFS_ASSERT_OR_RETURN(single->lines[n] == n + 1 && multi->lines[n] == n + 1);
+		TFS_ASSERT_OR_RETURN(multi->commands[n].kind == TfsCommandSearch);
+		TFS_ASSERT_OR_RETURN(tfs_path_eq(tfs_path_owned_borrow(single->commands[n].data.search.path),
+			tfs_path_owned_borrow(multi->commands[n].data.search.path)));
+	}
+
+	tfs_command_file_destroy(multi);
+	tfs_command_file_destroy(single);
+	free(contents);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult invalid(void) {
+	size_t contents_len;
+	char* contents = gen_commands(CHUNKS_COMMANDS, CHUNKS_INVALID_LINE, &contents_len);
+	TFS_ASSERT_OR_RETURN(contents != NULL);
+	int fd = tfs_test_temp_file(contents, contents_len);
+	TFS_ASSERT_OR_RETURN(fd != -1);
+
+	// The invalid line must be reported by it's line in the whole file, not it's chunk
+	TfsCommandFileParseResult result = tfs_command_file_parse(fd, CHUNKS_THREADS);
+	close(fd);
+	TFS_ASSERT_OR_RETURN(!result.success);
+	TFS_ASSERT_OR_RETURN(result.data.err.kind == TfsCommandFileParseErrorCommand);
+	TFS_ASSERT_OR_RETURN(result.data.err.data.command.line == CHUNKS_INVALID_LINE);
+	TFS_ASSERT_OR_RETURN(result.data.err.data.command.err.kind == TfsCommandParseErrorInvalidCommand);
+
+	free(contents);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult pipe_input(void) {
+	// Pipes can't be mapped, so they're read instead
+	int fds[2];
+	TFS_ASSERT_OR_RETURN(pipe(fds) == 0);
+	const char contents[] = "c /a d\nm /a /b\n";
+	TFS_ASSERT_OR_RETURN(write(fds[1], contents, sizeof(contents) - 1) == sizeof(contents) - 1);
+	close(fds[1]);
+
+	TfsCommandFileParseResult result = tfs_command_file_parse(fds[0], CHUNKS_THREADS);
+	close(fds[0]);
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsCommandFile* file = &result.data.file;
+	TFS_ASSERT_OR_RETURN(file->mapping_len == 0);
+	TFS_ASSERT_OR_RETURN(file->len == 2);
+	TFS_ASSERT_OR_RETURN(file->commands[1].kind == TfsCommandMove);
+	TFS_ASSERT_OR_RETURN(
+		tfs_path_eq(tfs_path_owned_borrow(file->commands[1].data.move.dest), tfs_path_from_cstr("/b")));
+
+	tfs_command_file_destroy(file);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = long_paths, .name = "command-file/long-paths"},
+		(TfsTest){.fn = chunks    , .name = "command-file/chunks"    },
+		(TfsTest){.fn = invalid   , .name = "command-file/invalid"   },
+		(TfsTest){.fn = pipe_input, .name = "command-file/pipe-input"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
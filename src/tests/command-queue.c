@@ -0,0 +1,130 @@
+/// @file
+/// @brief Command queue tests
+
+// Imports
+#include <pthread.h>		   // pthread_create, pthread_join
+#include <stdio.h>			   // printf, snprintf
+#include <stdlib.h>			   // size_t, strtoul, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			   // strdup, strcmp
+#include <tfs/command/queue.h> // tfs_command_queue_*
+#include <tfs/test/assert.h>   // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	   // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Number of commands pushed by the concurrent test
+#define CONCURRENT_COMMANDS 10000
+
+/// @brief Number of consumers in the concurrent test
+#define CONCURRENT_CONSUMERS 3
+
+/// @brief Creates a print command to @p path
+static TfsCommand print_command(const char* path) {
+	return (TfsCommand){.kind = TfsCommandPrint, .data.print.path = strdup(path)};
+}
+
+/// @brief Pops a command, checking it prints to @p path
+static bool pop_print(TfsCommandQueue* queue, const char* path) {
+	TfsCommand command;
+	if (!tfs_command_queue_pop(queue, &command)) { return false; }
+
+	bool matches = command.kind == TfsCommandPrint && strcmp(command.data.print.path, path) == 0;
+	tfs_command_destroy(&command);
+	return matches;
+}
+
+static TfsTestResult order(void) {
+	TfsCommandQueue queue = tfs_command_queue_new(2);
+
+	// Commands are popped in order, wrapping around the buffer
+	TFS_ASSERT_OR_RETURN(tfs_command_queue_push(&queue, print_command("a")));
+	TFS_ASSERT_OR_RETURN(tfs_command_queue_push(&queue, print_command("b")));
+	TFS_ASSERT_OR_RETURN(pop_print(&queue, "a"));
+	TFS_ASSERT_OR_RETURN(tfs_command_queue_push(&queue, print_command("c")));
+	TFS_ASSERT_OR_RETURN(pop_print(&queue, "b"));
+	TFS_ASSERT_OR_RETURN(pop_print(&queue, "c"));
+
+	// Once closed, nothing is pushed, but the commands left are still popped
+	TFS_ASSERT_OR_RETURN(tfs_command_queue_push(&queue, print_command("d")));
+	TFS_ASSERT_OR_RETURN(tfs_command_queue_push(&queue, print_command("e")));
+	tfs_command_queue_close(&queue);
+	TfsCommand rejected = print_command("f");
+	TFS_ASSERT_OR_RETURN(!tfs_command_queue_push(&queue, rejected));
+	tfs_command_destroy(&rejected);
+	TFS_ASSERT_OR_RETURN(pop_print(&queue, "d"));
+
+	// Note: The command left is destroyed along with the queue.
+	tfs_command_queue_destroy(&queue);
+	return TfsTestResultSuccess;
+}
+
+/// @brief Shared state of the concurrent test
+typedef struct ConcurrentData {
+	/// @brief The queue
+	TfsCommandQueue queue;
+
+	/// @brief Number of times each command was popped
+	size_t popped[CONCURRENT_COMMANDS];
+} ConcurrentData;
+
+/// @brief Pushes all commands, then closes the queue
+static void* producer_thread_fn(void* arg) {
+	ConcurrentData* data = arg;
+	for (size_t n = 0; n < CONCURRENT_COMMANDS; n++) {
+		char path[32];
+		snprintf(path, sizeof(path), "%zu", n);
+		if (!tfs_command_queue_push(&data->queue, print_command(path))) { break; }
+	}
+	tfs_command_queue_close(&data->queue);
+
+	return NULL;
+}
+
+/// @brief Pops commands until the queue is closed and empty
+static void* consumer_thread_fn(void* arg) {
+	ConcurrentData* data = arg;
+	TfsCommand command;
+	while (tfs_command_queue_pop(&data->queue, &command)) {
+		size_t idx = strtoul(command.data.print.path, NULL, 10);
+		if (idx < CONCURRENT_COMMANDS) { __atomic_fetch_add(&data->popped[idx], 1, __ATOMIC_RELAXED); }
+		tfs_command_destroy(&command);
+	}
+
+	return NULL;
+}
+
+static TfsTestResult concurrent(void) {
+	ConcurrentData* data = calloc(1, sizeof(ConcurrentData));
+	TFS_ASSERT_OR_RETURN(data != NULL);
+	data->queue = tfs_command_queue_new(4);
+
+	pthread_t producer;
+	pthread_t consumers[CONCURRENT_CONSUMERS];
+	TFS_ASSERT_OR_RETURN(pthread_create(&producer, NULL, producer_thread_fn, data) == 0);
+	for (size_t n = 0; n < CONCURRENT_CONSUMERS; n++) {
+		TFS_ASSERT_OR_RETURN(pthread_create(&consumers[n], NULL, consumer_thread_fn, data) == 0);
+	}
+	TFS_ASSERT_OR_RETURN(pthread_join(producer, NULL) == 0);
+	for (size_t n = 0; n < CONCURRENT_CONSUMERS; n++) { TFS_ASSERT_OR_RETURN(pthread_join(consumers[n], NULL) == 0); }
+
+	// Every command must have been popped exactly once
+	for (size_t n = 0; n < CONCURRENT_COMMANDS; n++) { TFS_ASSERT_OR_RETURN(data->popped[n] == 1); }
+
+	tfs_command_queue_destroy(&data->queue);
+	free(data);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = order     , .name = "command-queue/order"     },
+		(TfsTest){.fn = concurrent, .name = "command-queue/concurrent"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
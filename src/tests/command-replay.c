@@ -0,0 +1,214 @@
+/// @file
+/// @brief Conflict-aware replay tests
+
+// Imports
+#include <pthread.h>			// pthread_create, pthread_join
+#include <stdio.h>				// printf, fmemopen, open_memstream
+#include <stdlib.h>				// size_t, free, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				// strlen, strcmp
+#include <tfs/command/replay.h>	// tfs_command_replay_*
+#include <tfs/fs.h>				// tfs_fs_*
+#include <tfs/test/assert.h>	// TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		// TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Number of commands in the sequential test
+#define SEQUENTIAL_COMMANDS 4000
+
+/// @brief Number of threads replaying the sequential test
+#define SEQUENTIAL_THREADS 4
+
+/// @brief Parses one command from each line of @p lines
+/// @return The number of commands parsed, or `0` if any line is invalid
+static size_t parse_commands(char* lines, TfsCommand* commands, size_t capacity) {
+	FILE* in = fmemopen(lines, strlen(lines), "r");
+	size_t len = 0;
+	while (len < capacity) {
+		TfsCommandParseResult result = tfs_command_parse(in);
+		if (!result.success) { break; }
+		commands[len++] = result.data.command;
+	}
+	fclose(in);
+
+	return len;
+}
+
+/// @brief Checks if command @p idx depends directly on command @p dep
+static bool depends_on(const TfsCommandReplay* replay, size_t idx, size_t dep) {
+	const TfsCommandReplayNode* node = &replay->nodes[dep];
+	for (size_t n = 0; n < node->dependents_len; n++) {
+		if (node->dependents[n] == idx) { return true; }
+	}
+
+	return false;
+}
+
+static TfsTestResult dag(void) {
+	char lines[] = "c /a d\n"
+				   "c /b d\n"
+				   "c /a/x f\n"
+				   "c /b/y f\n"
+				   "l /a/x\n"
+				   "l /b/y\n"
+				   "m /a /c\n"
+				   "l /c/x\n"
+				   "p out\n";
+	TfsCommand commands[9];
+	TFS_ASSERT_OR_RETURN(parse_commands(lines, commands, 9) == 9);
+	TfsCommandReplay replay = tfs_command_replay_new(commands, 9, NULL, NULL);
+
+	// Creates in the same directory are ordered, as it's entries are
+	TFS_ASSERT_OR_RETURN(replay.nodes[0].dependencies == 0);
+	TFS_ASSERT_OR_RETURN(replay.nodes[1].dependencies == 1 && depends_on(&replay, 1, 0));
+
+	// But creates and lookups in disjoint subtrees aren't
+	TFS_ASSERT_OR_RETURN(replay.nodes[2].dependencies == 1 && depends_on(&replay, 2, 0));
+	TFS_ASSERT_OR_RETURN(replay.nodes[3].dependencies == 1 && depends_on(&replay, 3, 1));
+	TFS_ASSERT_OR_RETURN(replay.nodes[4].dependencies == 2 && depends_on(&replay, 4, 2));
+	TFS_ASSERT_OR_RETURN(replay.nodes[5].dependencies == 2 && depends_on(&replay, 5, 3));
+
+	// A move conflicts with everything under both paths, and lookups under it with the move
+	TFS_ASSERT_OR_RETURN(replay.nodes[6].dependencies == 4);
+	TFS_ASSERT_OR_RETURN(depends_on(&replay, 6, 1) && depends_on(&replay, 6, 2) && depends_on(&replay, 6, 4));
+	TFS_ASSERT_OR_RETURN(!depends_on(&replay, 6, 5));
+	TFS_ASSERT_OR_RETURN(replay.nodes[7].dependencies == 1 && depends_on(&replay, 7, 6));
+
+	// While prints depend on all writes, but no lookups
+	TFS_ASSERT_OR_RETURN(replay.nodes[8].dependencies == 5 && !depends_on(&replay, 8, 7));
+	TFS_ASSERT_OR_RETURN(replay.depth == 5);
+	TFS_ASSERT_OR_RETURN(replay.ready_len == 1 && replay.ready[0] == 0);
+
+	tfs_command_replay_destroy(&replay);
+	for (size_t n = 0; n < 9; n++) { tfs_command_destroy(&commands[n]); }
+	return TfsTestResultSuccess;
+}
+
+/// @brief Executes a command on the file system @p arg
+static bool execute(const TfsCommand* command, void* arg) {
+	TfsFs* fs = arg;
+	switch (command->kind) {
+		case TfsCommandCreate: {
+			TfsFsCreateResult result =
+				tfs_fs_create(fs, tfs_path_owned_borrow(command->data.create.path), command->data.create.type);
+			if (result.success) { tfs_fs_unlock_inode(fs, result.data.idx); }
+			return result.success;
+		}
+		case TfsCommandRemove: {
+			return tfs_fs_remove(fs, tfs_path_owned_borrow(command->data.remove.path)).success;
+		}
+		case TfsCommandSearch: {
+			TfsFsFindResult result =
+				tfs_fs_find(fs, tfs_path_owned_borrow(command->data.search.path), TfsRwLockAccessShared);
+			if (result.success) { tfs_fs_unlock_inode(fs, result.data.inode.idx); }
+			return result.success;
+		}
+		case TfsCommandMove: {
+			TfsFsMoveResult result = tfs_fs_move(fs,
+				tfs_path_owned_borrow(command->data.move.source),
+				tfs_path_owned_borrow(command->data.move.dest),
+				TfsRwLockAccessUnique);
+			if (result.success) { tfs_fs_unlock_inode(fs, result.data.inode.idx); }
+			return result.success;
+		}
+		case TfsCommandPrint:
+		default: {
+			return false;
+		}
+	}
+}
+
+/// @brief Replays all commands in @p arg
+static void* replay_thread_fn(void* arg) {
+	tfs_command_replay_run(arg);
+	return NULL;
+}
+
+/// @brief Prints the file system to a new string
+static char* print_fs(TfsFs* fs) {
+	char* str = NULL;
+	size_t str_len = 0;
+	FILE* out = open_memstream(&str, &str_len);
+	tfs_fs_print_to(fs, out);
+	fclose(out);
+
+	return str;
+}
+
+static TfsTestResult sequential(void) {
+	// Generate commands over a few nested paths, so they often conflict
+	static char lines[SEQUENTIAL_COMMANDS * 32];
+	size_t lines_len = 0;
+	uint64_t seed = 1;
+	for (size_t n = 0; n < SEQUENTIAL_COMMANDS; n++) {
+		seed = seed * 6364136223846793005u + 1442695040888963407u;
+		unsigned dir = (unsigned)(seed >> 33) % 3;
+		unsigned file = (unsigned)(seed >> 40) % 4;
+		unsigned dest_dir = (unsigned)(seed >> 48) % 3;
+		char* line = lines + lines_len;
+		size_t line_capacity = sizeof(lines) - lines_len;
+		int line_len = 0;
+		switch ((seed >> 56) % 6) {
+			case 0: line_len = snprintf(line, line_capacity, "c /d%u d\n", dir); break;
+			case 1: line_len = snprintf(line, line_capacity, "c /d%u/f%u f\n", dir, file); break;
+			case 2: line_len = snprintf(line, line_capacity, "l /d%u/f%u\n", dir, file); break;
+			case 3: line_len = snprintf(line, line_capacity, "d /d%u\n", dir); break;
+			case 4: line_len = snprintf(line, line_capacity, "d /d%u/f%u\n", dir, file); break;
+			default:
+				line_len = snprintf(line, line_capacity, "m /d%u/f%u /d%u/f%u\n", dir, file, dest_dir, file);
+				break;
+		}
+		lines_len += (size_t)line_len;
+	}
+
+	TfsCommand* commands = malloc(SEQUENTIAL_COMMANDS * sizeof(TfsCommand));
+	TFS_ASSERT_OR_RETURN(commands != NULL);
+	TFS_ASSERT_OR_RETURN(parse_commands(lines, commands, SEQUENTIAL_COMMANDS) == SEQUENTIAL_COMMANDS);
+
+	// Execute them in sequence
+	TfsFs sequential_fs = tfs_fs_new();
+	bool* sequential_results = malloc(SEQUENTIAL_COMMANDS * sizeof(bool));
+	TFS_ASSERT_OR_RETURN(sequential_results != NULL);
+	for (size_t n = 0; n < SEQUENTIAL_COMMANDS; n++) { sequential_results[n] = execute(&commands[n], &sequential_fs); }
+
+	// Then replay them in parallel
+	TfsFs replay_fs = tfs_fs_new();
+	TfsCommandReplay replay = tfs_command_replay_new(commands, SEQUENTIAL_COMMANDS, execute, &replay_fs);
+	pthread_t threads[SEQUENTIAL_THREADS];
+	for (size_t n = 0; n < SEQUENTIAL_THREADS; n++) {
+		TFS_ASSERT_OR_RETURN(pthread_create(&threads[n], NULL, replay_thread_fn, &replay) == 0);
+	}
+	for (size_t n = 0; n < SEQUENTIAL_THREADS; n++) { TFS_ASSERT_OR_RETURN(pthread_join(threads[n], NULL) == 0); }
+
+	// Each result and the final file system must be the same
+	for (size_t n = 0; n < SEQUENTIAL_COMMANDS; n++) {
+		TFS_ASSERT_OR_RETURN(replay.results[n] == sequential_results[n]);
+	}
+	char* sequential_str = print_fs(&sequential_fs);
+	char* replay_str = print_fs(&replay_fs);
+	TFS_ASSERT_OR_RETURN(strcmp(sequential_str, replay_str) == 0);
+
+	free(replay_str);
+	free(sequential_str);
+	tfs_command_replay_destroy(&replay);
+	tfs_fs_destroy(&replay_fs);
+	tfs_fs_destroy(&sequential_fs);
+	free(sequential_results);
+	for (size_t n = 0; n < SEQUENTIAL_COMMANDS; n++) { tfs_command_destroy(&commands[n]); }
+	free(commands);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = dag       , .name = "command-replay/dag"       },
+		(TfsTest){.fn = sequential, .name = "command-replay/sequential"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,87 @@
+/// @file
+/// @brief Coroutine tests
+
+// Imports
+#include <stdio.h>			 // printf
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/coroutine.h>	 // tfs_coroutine_*
+#include <tfs/test/assert.h> // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	 // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Size of the stacks of all coroutines
+#define STACK_SIZE (64 * 1024)
+
+/// @brief Steps taken by all coroutines, in order
+static char steps[16];
+
+/// @brief Number of steps taken
+static size_t steps_len = 0;
+
+/// @brief Takes a step, parks, and takes another step
+/// @param arg The step's name, as a `char*`
+static void step_twice(void* arg) {
+	char name = *(char*)arg;
+	steps[steps_len++] = name;
+	tfs_coroutine_park();
+	steps[steps_len++] = (char)(name - 'a' + 'A');
+}
+
+static TfsTestResult park_resume(void) {
+	steps_len = 0;
+	TfsCoroutine first = tfs_coroutine_new(STACK_SIZE);
+	TfsCoroutine second = tfs_coroutine_new(STACK_SIZE);
+	TFS_ASSERT_OR_RETURN(tfs_coroutine_current() == NULL);
+
+	// Both coroutines park after their first step and return after the second
+	char first_name = 'a';
+	char second_name = 'b';
+	tfs_coroutine_start(&first, step_twice, &first_name);
+	tfs_coroutine_start(&second, step_twice, &second_name);
+	TFS_ASSERT_OR_RETURN(!tfs_coroutine_resume(&first));
+	TFS_ASSERT_OR_RETURN(!tfs_coroutine_resume(&second));
+	TFS_ASSERT_OR_RETURN(tfs_coroutine_resume(&second));
+	TFS_ASSERT_OR_RETURN(tfs_coroutine_resume(&first));
+	TFS_ASSERT_OR_RETURN(tfs_coroutine_current() == NULL);
+
+	TFS_ASSERT_OR_RETURN(steps_len == 4);
+	TFS_ASSERT_OR_RETURN(steps[0] == 'a' && steps[1] == 'b' && steps[2] == 'B' && steps[3] == 'A');
+
+	tfs_coroutine_destroy(&second);
+	tfs_coroutine_destroy(&first);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult reuse(void) {
+	steps_len = 0;
+	TfsCoroutine coroutine = tfs_coroutine_new(STACK_SIZE);
+
+	// Once done, a coroutine may run another function on the same stack
+	char names[3] = {'a', 'b', 'c'};
+	for (size_t n = 0; n < 3; n++) {
+		tfs_coroutine_start(&coroutine, step_twice, &names[n]);
+		TFS_ASSERT_OR_RETURN(!tfs_coroutine_resume(&coroutine));
+		TFS_ASSERT_OR_RETURN(tfs_coroutine_resume(&coroutine));
+	}
+
+	TFS_ASSERT_OR_RETURN(steps_len == 6);
+	TFS_ASSERT_OR_RETURN(steps[0] == 'a' && steps[1] == 'A' && steps[4] == 'c' && steps[5] == 'C');
+
+	tfs_coroutine_destroy(&coroutine);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = park_resume, .name = "coroutine/park_resume"},
+		(TfsTest){.fn = reuse      , .name = "coroutine/reuse"      },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,142 @@
+/// @file
+/// @brief Work-stealing deque tests
+
+// Imports
+#include <pthread.h>			 // pthread_create, pthread_join
+#include <stdio.h>				 // printf
+#include <stdlib.h>				 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/server/deque.h>	 // tfs_server_deque_*
+#include <tfs/server/stealing.h> // tfs_server_stealing_*
+#include <tfs/test/assert.h>	 // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		 // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Number of items pushed by the concurrent test
+#define CONCURRENT_ITEMS 100000
+
+/// @brief Number of thieves in the concurrent test
+#define CONCURRENT_THIEVES 3
+
+static TfsTestResult ends(void) {
+	TfsServerDeque deque = tfs_server_deque_new(4);
+	int items[5];
+
+	// The owner pops the newest items, thieves steal the oldest
+	for (size_t n = 0; n < 4; n++) { TFS_ASSERT_OR_RETURN(tfs_server_deque_push(&deque, &items[n])); }
+	TFS_ASSERT_OR_RETURN(!tfs_server_deque_push(&deque, &items[4]));
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_len(&deque) == 4);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_pop(&deque) == &items[3]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_steal(&deque) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_steal(&deque) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_pop(&deque) == &items[2]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_pop(&deque) == NULL);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_steal(&deque) == NULL);
+
+	// Slots are reused once freed, wrapping around the buffer
+	for (size_t n = 0; n < 4; n++) { TFS_ASSERT_OR_RETURN(tfs_server_deque_push(&deque, &items[n])); }
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_steal(&deque) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_push(&deque, &items[4]));
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_pop(&deque) == &items[4]);
+	TFS_ASSERT_OR_RETURN(tfs_server_deque_len(&deque) == 3);
+
+	tfs_server_deque_destroy(&deque);
+	return TfsTestResultSuccess;
+}
+
+/// @brief Shared state of the concurrent test
+typedef struct ConcurrentData {
+	/// @brief The deque
+	TfsServerDeque deque;
+
+	/// @brief Number of times each item was taken
+	size_t taken[CONCURRENT_ITEMS];
+
+	/// @brief If the owner is done pushing
+	bool done;
+} ConcurrentData;
+
+/// @brief Steals items until the owner is done and the deque is empty
+static void* thief_thread_fn(void* arg) {
+	ConcurrentData* data = arg;
+	while (1) {
+		size_t* item = tfs_server_deque_steal(&data->deque);
+		if (item != NULL) {
+			__atomic_fetch_add(item, 1, __ATOMIC_RELAXED);
+			continue;
+		}
+		if (__atomic_load_n(&data->done, __ATOMIC_ACQUIRE) && tfs_server_deque_len(&data->deque) == 0) { break; }
+	}
+
+	return NULL;
+}
+
+static TfsTestResult concurrent(void) {
+	ConcurrentData* data = calloc(1, sizeof(ConcurrentData));
+	TFS_ASSERT_OR_RETURN(data != NULL);
+	data->deque = tfs_server_deque_new(64);
+
+	pthread_t thieves[CONCURRENT_THIEVES];
+	for (size_t n = 0; n < CONCURRENT_THIEVES; n++) {
+		TFS_ASSERT_OR_RETURN(pthread_create(&thieves[n], NULL, thief_thread_fn, data) == 0);
+	}
+
+	// Push all items, popping every other one ourselves, or when full
+	for (size_t n = 0; n < CONCURRENT_ITEMS; n++) {
+		while (!tfs_server_deque_push(&data->deque, &data->taken[n])) {
+			size_t* item = tfs_server_deque_pop(&data->deque);
+			if (item != NULL) { __atomic_fetch_add(item, 1, __ATOMIC_RELAXED); }
+		}
+		if (n % 2 == 0) {
+			size_t* item = tfs_server_deque_pop(&data->deque);
+			if (item != NULL) { __atomic_fetch_add(item, 1, __ATOMIC_RELAXED); }
+		}
+	}
+	size_t* item;
+	while ((item = tfs_server_deque_pop(&data->deque)) != NULL) { __atomic_fetch_add(item, 1, __ATOMIC_RELAXED); }
+	__atomic_store_n(&data->done, true, __ATOMIC_RELEASE);
+	for (size_t n = 0; n < CONCURRENT_THIEVES; n++) { TFS_ASSERT_OR_RETURN(pthread_join(thieves[n], NULL) == 0); }
+
+	// Every item must have been taken exactly once
+	for (size_t n = 0; n < CONCURRENT_ITEMS; n++) { TFS_ASSERT_OR_RETURN(data->taken[n] == 1); }
+
+	tfs_server_deque_destroy(&data->deque);
+	free(data);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult workers(void) {
+	TfsServerStealing stealing = tfs_server_stealing_new(2, 4);
+	size_t first = tfs_server_stealing_join(&stealing);
+	size_t second = tfs_server_stealing_join(&stealing);
+	TFS_ASSERT_OR_RETURN(first == 0 && second == 1);
+	uint64_t first_seed = 1;
+	uint64_t second_seed = 2;
+
+	// Workers take their own newest messages, then steal the oldest of others
+	int items[2];
+	TFS_ASSERT_OR_RETURN(tfs_server_stealing_push(&stealing, first, &items[0]));
+	TFS_ASSERT_OR_RETURN(tfs_server_stealing_push(&stealing, first, &items[1]));
+	TFS_ASSERT_OR_RETURN(tfs_server_stealing_take(&stealing, second, &second_seed) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_stealing_take(&stealing, first, &first_seed) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_stealing_take(&stealing, first, &first_seed) == NULL);
+	TFS_ASSERT_OR_RETURN(stealing.stats[first].popped == 1 && stealing.stats[second].stolen == 1);
+
+	tfs_server_stealing_destroy(&stealing);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = ends      , .name = "deque/ends"      },
+		(TfsTest){.fn = concurrent, .name = "deque/concurrent"},
+		(TfsTest){.fn = workers   , .name = "deque/workers"   },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
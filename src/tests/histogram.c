@@ -0,0 +1,89 @@
+/// @file
+/// @brief `TfsBenchHistogram` tests
+
+// Imports
+#include <stdint.h>				 // uint64_t
+#include <stdio.h>				 // printf
+#include <stdlib.h>				 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/bench/histogram.h> // TfsBenchHistogram
+#include <tfs/test/assert.h>	 // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		 // TfsTest, TfsTestFn, TfsTestResult
+
+static TfsTestResult empty(void) {
+	TfsBenchHistogram histogram = tfs_bench_histogram_new();
+
+	TFS_ASSERT_OR_RETURN(histogram.count == 0);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&histogram, 50) == 0);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult small_values(void) {
+	// Values below the sub-bucket count are recorded exactly
+	TfsBenchHistogram histogram = tfs_bench_histogram_new();
+	for (uint64_t value = 1; value <= 10; value++) { tfs_bench_histogram_record(&histogram, value); }
+
+	TFS_ASSERT_OR_RETURN(histogram.count == 10);
+	TFS_ASSERT_OR_RETURN(histogram.min == 1);
+	TFS_ASSERT_OR_RETURN(histogram.max == 10);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&histogram, 0) == 1);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&histogram, 50) == 5);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&histogram, 90) == 9);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&histogram, 100) == 10);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult precision(void) {
+	// Every value must be reported within `1 / SUB_BUCKETS` of itself
+	const uint64_t values[] = {17, 100, 1000, 12345, 1000000, 987654321, (uint64_t)1 << 62, 0};
+
+	for (size_t n = 0; values[n] != 0; n++) {
+		TfsBenchHistogram histogram = tfs_bench_histogram_new();
+
+		// Note: We record a value below and above, so the reported value isn't clamped.
+		tfs_bench_histogram_record(&histogram, 0);
+		tfs_bench_histogram_record(&histogram, values[n]);
+		tfs_bench_histogram_record(&histogram, UINT64_MAX);
+
+		uint64_t reported = tfs_bench_histogram_percentile(&histogram, 50);
+		uint64_t error = reported > values[n] ? reported - values[n] : values[n] - reported;
+		TFS_ASSERT_OR_RETURN(error <= values[n] / TFS_BENCH_HISTOGRAM_SUB_BUCKETS);
+	}
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult merge(void) {
+	TfsBenchHistogram lhs = tfs_bench_histogram_new();
+	TfsBenchHistogram rhs = tfs_bench_histogram_new();
+	for (uint64_t value = 1; value <= 5; value++) { tfs_bench_histogram_record(&lhs, value); }
+	for (uint64_t value = 6; value <= 10; value++) { tfs_bench_histogram_record(&rhs, value); }
+
+	tfs_bench_histogram_merge(&lhs, &rhs);
+	TFS_ASSERT_OR_RETURN(lhs.count == 10);
+	TFS_ASSERT_OR_RETURN(lhs.sum == 55);
+	TFS_ASSERT_OR_RETURN(lhs.min == 1);
+	TFS_ASSERT_OR_RETURN(lhs.max == 10);
+	TFS_ASSERT_OR_RETURN(tfs_bench_histogram_percentile(&lhs, 50) == 5);
+
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = empty       , .name = "histogram/empty"       },
+		(TfsTest){.fn = small_values, .name = "histogram/small_values"},
+		(TfsTest){.fn = precision   , .name = "histogram/precision"   },
+		(TfsTest){.fn = merge       , .name = "histogram/merge"       },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
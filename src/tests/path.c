@@ -170,6 +170,36 @@ static TfsTestResult common_ancestor(void) {
 	return TfsTestResultSuccess;
 }
 
+static TfsTestResult starts_with(void) {
+	// All paths to test
+	// Order: Path, Prefix, Expected
+	const char** paths[] = {
+		// clang-format off
+		(const char*[]){"a/b/c"    , "a"    , "y"},
+		(const char*[]){"a/b/c"    , "/a/b/", "y"},
+		(const char*[]){"a/b/c"    , "a/b/c", "y"},
+		(const char*[]){"a/b/c"    , ""     , "y"},
+		(const char*[]){" / a // b", "a/b"  , "y"},
+		(const char*[]){""         , ""     , "y"},
+		(const char*[]){"a/bc"     , "a/b"  , "n"},
+		(const char*[]){"a/b"      , "a/b/c", "n"},
+		(const char*[]){"a"        , "b"    , "n"},
+		(const char*[]){""         , "a"    , "n"},
+		// clang-format on
+		NULL,
+	};
+
+	for (size_t n = 0; paths[n] != NULL; n++) {
+		TfsPath path = tfs_path_from_cstr(paths[n][0]);
+		TfsPath prefix = tfs_path_from_cstr(paths[n][1]);
+		bool expected = paths[n][2][0] == 'y';
+
+		TFS_ASSERT_OR_RETURN(tfs_path_starts_with(path, prefix) == expected);
+	}
+
+	return TfsTestResultSuccess;
+}
+
 int main(void) {
 	// All tests
 	// clang-format off
@@ -180,6 +210,7 @@ int main(void) {
 		(TfsTest){.fn = pop_last       , .name = "path/pop_last"       },
 		(TfsTest){.fn = pop_first      , .name = "path/pop_first"      },
 		(TfsTest){.fn = common_ancestor, .name = "path/common_ancestor"},
+		(TfsTest){.fn = starts_with    , .name = "path/starts_with"    },
 		(TfsTest){.fn = NULL},
 	};
 	// clang-format on
@@ -0,0 +1,97 @@
+/// @file
+/// @brief Adaptive pool tests
+
+// Imports
+#include <stdio.h>			 // printf
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/server/pool.h> // tfs_server_pool_*
+#include <tfs/test/assert.h> // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	 // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Length of the intervals sampled
+#define INTERVAL_NS (TFS_SERVER_POOL_INTERVAL_MS * 1000000u)
+
+static TfsTestResult decide(void) {
+	// Idle pools shrink
+	TfsServerPoolSample idle = {.executed = 0, .delay_ns = 0, .busy_ns = 0, .blocked_ns = 0, .cpu_ns = 0};
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_decide(&idle, INTERVAL_NS, 4, 2) == 3);
+
+	// Busy pools whose items barely wait stay the same
+	TfsServerPoolSample busy = {
+		.executed = 100,
+		.delay_ns = 100 * 500000u,
+		.busy_ns = 4 * INTERVAL_NS,
+		.blocked_ns = 0,
+		.cpu_ns = INTERVAL_NS,
+	};
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_decide(&busy, INTERVAL_NS, 4, 2) == 4);
+
+	// Pools whose items wait grow, by a thread for each thread's worth of blocking
+	TfsServerPoolSample blocked = {
+		.executed = 100,
+		.delay_ns = 100 * 2000000u,
+		.busy_ns = 4 * INTERVAL_NS,
+		.blocked_ns = 2 * INTERVAL_NS,
+		.cpu_ns = INTERVAL_NS,
+	};
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_decide(&blocked, INTERVAL_NS, 4, 2) == 7);
+
+	// Unless the CPUs are saturated, in which case they shrink if threads wait for them
+	TfsServerPoolSample saturated = {
+		.executed = 100,
+		.delay_ns = 100 * 2000000u,
+		.busy_ns = 4 * INTERVAL_NS,
+		.blocked_ns = 0,
+		.cpu_ns = 2 * INTERVAL_NS,
+	};
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_decide(&saturated, INTERVAL_NS, 4, 2) == 3);
+	saturated.busy_ns = 2 * INTERVAL_NS;
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_decide(&saturated, INTERVAL_NS, 2, 2) == 2);
+
+	return TfsTestResultSuccess;
+}
+
+/// @brief Counts the items executed
+static void count_execute(void* item, void* data) {
+	(void)item;
+	__atomic_fetch_add((size_t*)data, 1, __ATOMIC_RELAXED);
+}
+
+static TfsTestResult execute(void) {
+	size_t executed = 0;
+	TfsServerPool pool = tfs_server_pool_new(1, 4, 2, count_execute, &executed);
+	tfs_server_pool_start(&pool);
+
+	// Pinning clamps the size to the bounds
+	tfs_server_pool_pin(&pool, 8);
+	TfsServerPoolInfo info = tfs_server_pool_info(&pool);
+	TFS_ASSERT_OR_RETURN(info.size == 4 && info.live == 4 && info.pinned);
+
+	// All items are executed before the pool closes
+	int items[8];
+	for (size_t n = 0; n < 8; n++) { TFS_ASSERT_OR_RETURN(tfs_server_pool_push(&pool, &items[n])); }
+	tfs_server_pool_pin(&pool, 1);
+	tfs_server_pool_close(&pool);
+	TFS_ASSERT_OR_RETURN(executed == 8);
+	TFS_ASSERT_OR_RETURN(!tfs_server_pool_push(&pool, &items[0]));
+	TFS_ASSERT_OR_RETURN(tfs_server_pool_info(&pool).live == 0);
+
+	tfs_server_pool_destroy(&pool);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = decide , .name = "pool/decide" },
+		(TfsTest){.fn = execute, .name = "pool/execute"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
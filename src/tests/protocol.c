@@ -0,0 +1,161 @@
+/// @file
+/// @brief Client-server protocol tests
+
+// Imports
+#include <stdint.h>			 // uint32_t, UINT32_MAX
+#include <stdio.h>			 // printf, fmemopen
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			 // memset, strlen
+#include <tfs/protocol.h>	 // tfs_protocol_*
+#include <tfs/test/assert.h> // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	 // TfsTest, TfsTestFn, TfsTestResult
+
+static TfsTestResult legacy(void) {
+	// All legacy messages, which must not be mistaken for framed ones
+	const char* messages[] = {
+		"c /a f",
+		"l /a",
+		"d /a",
+		"m /a /b",
+		"p out.txt",
+		NULL,
+	};
+
+	for (size_t n = 0; messages[n] != NULL; n++) {
+		TFS_ASSERT_OR_RETURN(!tfs_protocol_is_framed(messages[n], strlen(messages[n]) + 1));
+	}
+	TFS_ASSERT_OR_RETURN(!tfs_protocol_is_framed("", 0));
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult header(void) {
+	const size_t counts[] = {0, 1, 255, 256, TFS_PROTOCOL_MAX_BATCH_LEN};
+	const uint32_t ids[] = {0, 1, 0xff, 0x12345678, UINT32_MAX};
+
+	for (size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++) {
+		char message[TFS_PROTOCOL_HEADER_LEN];
+		tfs_protocol_header_write(
+			(TfsProtocolHeader){.kind = TfsProtocolKindBatch, .count = counts[n], .id = ids[n]}, message);
+		TFS_ASSERT_OR_RETURN(tfs_protocol_is_framed(message, sizeof(message)));
+
+		TfsProtocolHeaderReadResult result = tfs_protocol_header_read(message, sizeof(message));
+		TFS_ASSERT_OR_RETURN(result.success);
+		TFS_ASSERT_OR_RETURN(result.data.header.kind == TfsProtocolKindBatch);
+		TFS_ASSERT_OR_RETURN(result.data.header.count == counts[n]);
+		TFS_ASSERT_OR_RETURN(result.data.header.id == ids[n]);
+	}
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult header_errors(void) {
+	char message[TFS_PROTOCOL_HEADER_LEN];
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindBatch, .count = 1}, message);
+
+	// Too short
+	TfsProtocolHeaderReadResult result = tfs_protocol_header_read(message, TFS_PROTOCOL_HEADER_LEN - 1);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsProtocolHeaderReadErrorTooShort);
+
+	// Unknown kind
+	message[1] = 0x7f;
+	result = tfs_protocol_header_read(message, sizeof(message));
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsProtocolHeaderReadErrorUnknownKind);
+
+	// Too many commands
+	tfs_protocol_header_write(
+		(TfsProtocolHeader){.kind = TfsProtocolKindBatch, .count = TFS_PROTOCOL_MAX_BATCH_LEN + 1}, message);
+	result = tfs_protocol_header_read(message, sizeof(message));
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsProtocolHeaderReadErrorTooManyCommands);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult batch_write(void) {
+	char a[] = "/a";
+	char b[] = "/b";
+	TfsCommand commands[] = {
+		{.kind = TfsCommandCreate, .data.create.path = {.chars = a, .len = 2}, .data.create.type = TfsInodeTypeDir},
+		{.kind = TfsCommandSearch, .data.search.path = {.chars = a, .len = 2}},
+		{.kind = TfsCommandMove, .data.move.source = {.chars = a, .len = 2}, .data.move.dest = {.chars = b, .len = 2}},
+	};
+	const size_t commands_len = sizeof(commands) / sizeof(commands[0]);
+
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	size_t message_len;
+	TFS_ASSERT_OR_RETURN(tfs_protocol_batch_write(commands, commands_len, 7, message, sizeof(message), &message_len));
+
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+	TFS_ASSERT_OR_RETURN(header_result.success);
+	TFS_ASSERT_OR_RETURN(header_result.data.header.count == commands_len);
+	TFS_ASSERT_OR_RETURN(header_result.data.header.id == 7);
+
+	// Make sure each command parses back to the original
+	FILE* in = fmemopen(message + TFS_PROTOCOL_HEADER_LEN, message_len - TFS_PROTOCOL_HEADER_LEN, "r");
+	for (size_t n = 0; n < commands_len; n++) {
+		TfsCommandParseResult parse_result = tfs_command_parse(in);
+		TFS_ASSERT_OR_RETURN(parse_result.success);
+		TFS_ASSERT_OR_RETURN(parse_result.data.command.kind == commands[n].kind);
+		tfs_command_destroy(&parse_result.data.command);
+	}
+	fclose(in);
+
+	// And that it doesn't write a batch that doesn't fit
+	TFS_ASSERT_OR_RETURN(!tfs_protocol_batch_write(commands, commands_len, 0, message, 16, &message_len));
+
+	// Nor cut a long command short, while writing it whole if it fits
+	char long_path[2000];
+	memset(long_path, 'a', sizeof(long_path));
+	long_path[0] = '/';
+	TfsCommand long_command = {
+		.kind = TfsCommandCreate,
+		.data.create.path = {.chars = long_path, .len = sizeof(long_path)},
+		.data.create.type = TfsInodeTypeDir,
+	};
+	TFS_ASSERT_OR_RETURN(!tfs_protocol_batch_write(&long_command, 1, 0, message, 1024, &message_len));
+	TFS_ASSERT_OR_RETURN(tfs_protocol_batch_write(&long_command, 1, 0, message, sizeof(message), &message_len));
+	TFS_ASSERT_OR_RETURN(message_len == TFS_PROTOCOL_HEADER_LEN + sizeof(long_path) + 5);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult lease_write(void) {
+	char a[] = "/a";
+	TfsCommand command = {.kind = TfsCommandSearch, .data.search.path = {.chars = a, .len = 2}};
+
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	size_t message_len;
+	TFS_ASSERT_OR_RETURN(tfs_protocol_lease_write(&command, 3, message, sizeof(message), &message_len));
+
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(message, message_len);
+	TFS_ASSERT_OR_RETURN(header_result.success);
+	TFS_ASSERT_OR_RETURN(header_result.data.header.kind == TfsProtocolKindLease);
+	TFS_ASSERT_OR_RETURN(header_result.data.header.count == 1);
+	TFS_ASSERT_OR_RETURN(header_result.data.header.id == 3);
+
+	// And that lease durations round trip
+	char bytes[4];
+	tfs_protocol_u32_write(0xdeadbeef, bytes);
+	TFS_ASSERT_OR_RETURN(tfs_protocol_u32_read(bytes) == 0xdeadbeef);
+
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = legacy       , .name = "protocol/legacy"       },
+		(TfsTest){.fn = header       , .name = "protocol/header"       },
+		(TfsTest){.fn = header_errors, .name = "protocol/header_errors"},
+		(TfsTest){.fn = batch_write  , .name = "protocol/batch_write"  },
+		(TfsTest){.fn = lease_write  , .name = "protocol/lease_write"  },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
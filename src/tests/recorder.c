@@ -0,0 +1,203 @@
+/// @file
+/// @brief Recorder tests
+
+// Imports
+#include <pthread.h>			   // pthread_create, pthread_join
+#include <stdio.h>				   // printf, fmemopen, open_memstream
+#include <stdlib.h>				   // size_t, free, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>				   // strcpy, strcmp, strlen
+#include <tfs/command/recording.h> // tfs_command_recording_*
+#include <tfs/path.h>			   // tfs_path_eq, tfs_path_from_cstr, tfs_path_owned_borrow
+#include <tfs/server/recorder.h>   // tfs_server_recorder_*
+#include <tfs/test/assert.h>	   // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		   // TfsTest, TfsTestFn, TfsTestResult
+
+/// @brief Records @p command_str from the client named @p name, or from an unnamed client if `NULL`
+static void record(TfsServerRecorder* recorder, const char* name, const char* command_str) {
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	socklen_t address_len = sizeof(sa_family_t);
+	if (name != NULL) {
+		strcpy(address.sun_path, name);
+		address_len = (socklen_t)sizeof(address);
+	}
+	tfs_server_recorder_record(recorder, &address, address_len, command_str, strlen(command_str));
+}
+
+/// @brief Records a few commands from a few clients to a new string
+/// @return The recording, which must be freed, or `NULL` if unable to write it
+static char* record_all(size_t* recording_len) {
+	char* recording = NULL;
+	FILE* out = open_memstream(&recording, recording_len);
+	TfsServerRecorder recorder = tfs_server_recorder_new(out);
+	tfs_server_recorder_start(&recorder);
+	record(&recorder, "a", "c /a d");
+	record(&recorder, "b", "l /a");
+	record(&recorder, NULL, "c /a/x f");
+	record(&recorder, "a", "m /a/x /a/y");
+	record(&recorder, NULL, "p out.txt");
+	bool written = tfs_server_recorder_close(&recorder);
+	tfs_server_recorder_destroy(&recorder);
+	fclose(out);
+	if (!written) {
+		free(recording);
+		return NULL;
+	}
+
+	return recording;
+}
+
+static TfsTestResult round_trip(void) {
+	size_t recording_len;
+	char* recording = record_all(&recording_len);
+	TFS_ASSERT_OR_RETURN(recording != NULL);
+
+	FILE* in = fmemopen(recording, recording_len, "rb");
+	TfsCommandRecordingLoadResult result = tfs_command_recording_load(in);
+	fclose(in);
+	free(recording);
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsCommandRecording* loaded = &result.data.recording;
+
+	// Clients are numbered in the order they were first seen, with unnamed ones sharing a number
+	TFS_ASSERT_OR_RETURN(loaded->len == 5 && loaded->clients == 3);
+	TFS_ASSERT_OR_RETURN(loaded->entries[0].client == 0 && loaded->entries[3].client == 0);
+	TFS_ASSERT_OR_RETURN(loaded->entries[1].client == 1);
+	TFS_ASSERT_OR_RETURN(loaded->entries[2].client == 2 && loaded->entries[4].client == 2);
+
+	// And entries are in the order, and with the commands, they were recorded
+	for (size_t n = 1; n < loaded->len; n++) {
+		TFS_ASSERT_OR_RETURN(loaded->entries[n - 1].time_ns <= loaded->entries[n].time_ns);
+	}
+	const TfsCommand* move = &loaded->entries[3].command;
+	TFS_ASSERT_OR_RETURN(move->kind == TfsCommandMove);
+	TFS_ASSERT_OR_RETURN(tfs_path_eq(tfs_path_owned_borrow(move->data.move.source), tfs_path_from_cstr("/a/x")));
+	TFS_ASSERT_OR_RETURN(tfs_path_eq(tfs_path_owned_borrow(move->data.move.dest), tfs_path_from_cstr("/a/y")));
+	const TfsCommand* print = &loaded->entries[4].command;
+	TFS_ASSERT_OR_RETURN(print->kind == TfsCommandPrint && strcmp(print->data.print.path, "out.txt") == 0);
+
+	tfs_command_recording_destroy(loaded);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult truncated(void) {
+	size_t recording_len;
+	char* recording = record_all(&recording_len);
+	TFS_ASSERT_OR_RETURN(recording != NULL);
+
+	// A recording cut short in the middle of it's last entry only loses that entry
+	FILE* in = fmemopen(recording, recording_len - 1, "rb");
+	TfsCommandRecordingLoadResult result = tfs_command_recording_load(in);
+	fclose(in);
+	TFS_ASSERT_OR_RETURN(result.success && result.data.recording.len == 4);
+	tfs_command_recording_destroy(&result.data.recording);
+
+	// But one without it's header is rejected
+	in = fmemopen(recording + 1, recording_len - 1, "rb");
+	result = tfs_command_recording_load(in);
+	fclose(in);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsCommandRecordingLoadErrorHeader);
+
+	free(recording);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult dropped(void) {
+	char* recording = NULL;
+	size_t recording_len;
+	FILE* out = open_memstream(&recording, &recording_len);
+
+	// Until the writer starts, nothing is collected, so commands past the buffer's capacity are dropped
+	TfsServerRecorder recorder = tfs_server_recorder_new(out);
+	size_t recorded = 2 * TFS_SERVER_RECORDER_BUFFER_CAPACITY / sizeof("l /a");
+	for (size_t n = 0; n < recorded; n++) { record(&recorder, "a", "l /a"); }
+	uint64_t dropped = tfs_server_recorder_dropped(&recorder);
+	tfs_server_recorder_start(&recorder);
+	bool written = tfs_server_recorder_close(&recorder);
+	tfs_server_recorder_destroy(&recorder);
+	fclose(out);
+	TFS_ASSERT_OR_RETURN(written && dropped != 0 && dropped < recorded);
+
+	// While the rest are all written
+	FILE* in = fmemopen(recording, recording_len, "rb");
+	TfsCommandRecordingLoadResult result = tfs_command_recording_load(in);
+	fclose(in);
+	free(recording);
+	TFS_ASSERT_OR_RETURN(result.success && result.data.recording.len == recorded - dropped);
+	tfs_command_recording_destroy(&result.data.recording);
+
+	return TfsTestResultSuccess;
+}
+
+/// @brief Data of each thread of #threads
+typedef struct RecordThreadData {
+	/// @brief The recorder
+	TfsServerRecorder* recorder;
+
+	/// @brief Name of the thread's client
+	const char* name;
+} RecordThreadData;
+
+/// @brief Records a few commands from the client of a #RecordThreadData
+static void* record_thread_fn(void* arg) {
+	RecordThreadData* data = arg;
+	for (size_t n = 0; n < 1000; n++) { record(data->recorder, data->name, "l /a"); }
+
+	return NULL;
+}
+
+static TfsTestResult threads(void) {
+	char* recording = NULL;
+	size_t recording_len;
+	FILE* out = open_memstream(&recording, &recording_len);
+
+	// Record from a few threads at once, each into it's own buffer
+	TfsServerRecorder recorder = tfs_server_recorder_new(out);
+	tfs_server_recorder_start(&recorder);
+	RecordThreadData data[4] = {
+		{.recorder = &recorder, .name = "a"},
+		{.recorder = &recorder, .name = "b"},
+		{.recorder = &recorder, .name = "c"},
+		{.recorder = &recorder, .name = "d"},
+	};
+	pthread_t record_threads[4];
+	for (size_t n = 0; n < 4; n++) { pthread_create(&record_threads[n], NULL, record_thread_fn, &data[n]); }
+	for (size_t n = 0; n < 4; n++) { pthread_join(record_threads[n], NULL); }
+	bool written = tfs_server_recorder_close(&recorder);
+	tfs_server_recorder_destroy(&recorder);
+	fclose(out);
+	TFS_ASSERT_OR_RETURN(written);
+
+	FILE* in = fmemopen(recording, recording_len, "rb");
+	TfsCommandRecordingLoadResult result = tfs_command_recording_load(in);
+	fclose(in);
+	free(recording);
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsCommandRecording* loaded = &result.data.recording;
+
+	// All commands are loaded in order, even if the threads' buffers were written interleaved
+	TFS_ASSERT_OR_RETURN(loaded->len == 4000 && loaded->clients == 4);
+	for (size_t n = 1; n < loaded->len; n++) {
+		TFS_ASSERT_OR_RETURN(loaded->entries[n - 1].time_ns <= loaded->entries[n].time_ns);
+	}
+
+	tfs_command_recording_destroy(loaded);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = round_trip, .name = "recorder/round-trip"},
+		(TfsTest){.fn = truncated , .name = "recorder/truncated" },
+		(TfsTest){.fn = dropped   , .name = "recorder/dropped"   },
+		(TfsTest){.fn = threads   , .name = "recorder/threads"   },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
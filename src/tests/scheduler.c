@@ -0,0 +1,78 @@
+/// @file
+/// @brief Scheduler tests
+
+// Imports
+#include <stdio.h>				  // printf
+#include <stdlib.h>				  // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/server/scheduler.h> // tfs_server_scheduler_*
+#include <tfs/test/assert.h>	  // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>		  // TfsTest, TfsTestFn, TfsTestResult
+
+static TfsTestResult classify(void) {
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("l /a", 4) == TfsServerSchedulerClassRead);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("c /a f", 6) == TfsServerSchedulerClassWrite);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("d /a", 4) == TfsServerSchedulerClassWrite);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("m /a /b", 7) == TfsServerSchedulerClassWrite);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("p out", 5) == TfsServerSchedulerClassBackground);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("", 0) == TfsServerSchedulerClassWrite);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult classify_whitespace(void) {
+	// Commands are classified by their kind even if preceded by whitespace, as the parser accepts them
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify(" l /a", 5) == TfsServerSchedulerClassRead);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("\t\tp out", 7) == TfsServerSchedulerClassBackground);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("  c /a f", 8) == TfsServerSchedulerClassWrite);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_classify("   ", 3) == TfsServerSchedulerClassWrite);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult lanes(void) {
+	TfsServerScheduler scheduler = tfs_server_scheduler_new(4);
+	int items[4];
+
+	// Writers help with reads, in order
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassRead, &items[0]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassRead, &items[1]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassWrite) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassRead) == &items[1]);
+
+	// But prefer their own writes
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassRead, &items[2]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassWrite, &items[3]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassWrite) == &items[3]);
+
+	// While nobody else helps with writes or the background
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassWrite, &items[0]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassBackground, &items[1]));
+	tfs_server_scheduler_close(&scheduler);
+	TFS_ASSERT_OR_RETURN(!tfs_server_scheduler_push(&scheduler, TfsServerSchedulerClassRead, &items[0]));
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassRead) == &items[2]);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassRead) == NULL);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassBackground) == &items[1]);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassBackground) == NULL);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassWrite) == &items[0]);
+	TFS_ASSERT_OR_RETURN(tfs_server_scheduler_pop(&scheduler, TfsServerSchedulerClassWrite) == NULL);
+
+	tfs_server_scheduler_destroy(&scheduler);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = classify           , .name = "scheduler/classify"           },
+		(TfsTest){.fn = classify_whitespace, .name = "scheduler/classify-whitespace"},
+		(TfsTest){.fn = lanes              , .name = "scheduler/lanes"              },
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,207 @@
+/// @file
+/// @brief Server tests
+/// @details
+/// These tests run the server binary, `build/bin/tecnicofs`, and send it
+/// commands through the client api, so they must be run from the root of
+/// the repository, just like `make test` does.
+
+// Imports
+#include <fcntl.h>			 // open, O_WRONLY
+#include <signal.h>			 // kill, SIGKILL
+#include <stdio.h>			 // printf, snprintf
+#include <stdlib.h>			 // size_t, exit, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			 // memset
+#include <sys/stat.h>		 // stat
+#include <sys/wait.h>		 // waitpid
+#include <tfs/client-api.h>	 // tfs_client_server_connection_*
+#include <tfs/protocol.h>	 // TFS_PROTOCOL_MAX_MESSAGE_LEN
+#include <tfs/test/assert.h> // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	 // TfsTest, TfsTestFn, TfsTestResult
+#include <time.h>			 // nanosleep
+#include <unistd.h>			 // fork, execl, dup2, unlink, getpid
+
+/// @brief Path of the server binary
+#define SERVER_PATH "build/bin/tecnicofs"
+
+/// @brief Length of the long paths, longer than any line buffer, but short enough to fit in a message
+#define LONG_PATH_LEN 1500
+
+/// @brief Length of a path too long to fit in a message
+#define HUGE_PATH_LEN (TFS_PROTOCOL_MAX_MESSAGE_LEN + 1)
+
+/// @brief A running server
+typedef struct Server {
+	/// @brief Process id
+	pid_t pid;
+
+	/// @brief Path of it's socket
+	char socket_path[64];
+} Server;
+
+/// @brief Starts a server with a single worker, waiting until it's socket exists
+/// @return If started
+static bool server_start(Server* server) {
+	snprintf(server->socket_path, sizeof(server->socket_path), "/tmp/tfs-test-server-%d", (int)getpid());
+	unlink(server->socket_path);
+
+	server->pid = fork();
+	if (server->pid == -1) { return false; }
+	if (server->pid == 0) {
+		// Note: The server reports every command it executes, which we don't need.
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		execl(SERVER_PATH, SERVER_PATH, "1", server->socket_path, (char*)NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t n = 0; n < 200; n++) {
+		struct stat socket_stat;
+		if (stat(server->socket_path, &socket_stat) == 0) { return true; }
+
+		struct timespec delay = {.tv_sec = 0, .tv_nsec = 10 * 1000000L};
+		nanosleep(&delay, NULL);
+	}
+
+	kill(server->pid, SIGKILL);
+	waitpid(server->pid, NULL, 0);
+	return false;
+}
+
+/// @brief Stops a server
+static void server_stop(Server* server) {
+	kill(server->pid, SIGKILL);
+	waitpid(server->pid, NULL, 0);
+	unlink(server->socket_path);
+}
+
+/// @brief Returns a command creating the directory @p path
+static TfsCommand create_dir(char* path, size_t path_len) {
+	return (TfsCommand){
+		.kind = TfsCommandCreate,
+		.data.create.path = {.chars = path, .len = path_len},
+		.data.create.type = TfsInodeTypeDir,
+		.borrowed = true,
+	};
+}
+
+/// @brief Returns a command searching for @p path
+static TfsCommand search(char* path, size_t path_len) {
+	return (TfsCommand){
+		.kind = TfsCommandSearch,
+		.data.search.path = {.chars = path, .len = path_len},
+		.borrowed = true,
+	};
+}
+
+/// @brief Returns a command moving @p source to @p dest
+static TfsCommand move(char* source, size_t source_len, char* dest, size_t dest_len) {
+	return (TfsCommand){
+		.kind = TfsCommandMove,
+		.data.move.source = {.chars = source, .len = source_len},
+		.data.move.dest = {.chars = dest, .len = dest_len},
+		.borrowed = true,
+	};
+}
+
+/// @brief Sends a command
+static TfsClientServerConnectionSendCommandResult send_command(
+	TfsClientServerConnection* connection, TfsCommand command) {
+	return tfs_client_server_connection_send_command(connection, &command);
+}
+
+/// @brief Checks if a command was sent and executed successfully
+static bool succeeds(TfsClientServerConnectionSendCommandResult result) {
+	return result.success && result.data.command_successful;
+}
+
+/// @brief Checks if a command was sent, but failed to execute
+static bool fails(TfsClientServerConnectionSendCommandResult result) {
+	return result.success && !result.data.command_successful;
+}
+
+static TfsTestResult long_paths(void) {
+	Server server;
+	TFS_ASSERT_OR_RETURN(server_start(&server));
+	TfsClientServerConnectionNewResult connection_result = tfs_client_server_connection_new(server.socket_path);
+	if (!connection_result.success) { server_stop(&server); }
+	TFS_ASSERT_OR_RETURN(connection_result.success);
+	TfsClientServerConnection* connection = &connection_result.data.connection;
+
+	static char source[LONG_PATH_LEN];
+	static char dest[LONG_PATH_LEN];
+	memset(source, 'a', sizeof(source));
+	memset(dest, 'b', sizeof(dest));
+	source[0] = '/';
+	dest[0] = '/';
+
+	// The whole path must reach the server, and not just the start of it
+	bool created = succeeds(send_command(connection, create_dir(source, LONG_PATH_LEN)));
+	bool found = succeeds(send_command(connection, search(source, LONG_PATH_LEN)));
+	bool prefix_found = !fails(send_command(connection, search(source, 1000)));
+
+	// Including a move's destination, which must not be cut short into another valid path
+	bool moved = succeeds(send_command(connection, move(source, LONG_PATH_LEN, dest, LONG_PATH_LEN)));
+	bool dest_found = succeeds(send_command(connection, search(dest, LONG_PATH_LEN)));
+	bool source_found = !fails(send_command(connection, search(source, LONG_PATH_LEN)));
+
+	tfs_client_server_connection_destroy(connection);
+	server_stop(&server);
+	TFS_ASSERT_OR_RETURN(created && found && !prefix_found);
+	TFS_ASSERT_OR_RETURN(moved && dest_found && !source_found);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult too_large(void) {
+	Server server;
+	TFS_ASSERT_OR_RETURN(server_start(&server));
+	TfsClientServerConnectionNewResult connection_result = tfs_client_server_connection_new(server.socket_path);
+	if (!connection_result.success) { server_stop(&server); }
+	TFS_ASSERT_OR_RETURN(connection_result.success);
+	TfsClientServerConnection* connection = &connection_result.data.connection;
+
+	// A command that doesn't fit in a message must fail, rather than being sent cut short
+	static char path[HUGE_PATH_LEN];
+	memset(path, 'a', sizeof(path));
+	path[0] = '/';
+	TfsClientServerConnectionSendCommandResult result = send_command(connection, create_dir(path, HUGE_PATH_LEN));
+	bool rejected = !result.success && result.data.err.kind == TfsClientServerConnectionSendCommandErrorTooLarge;
+	bool created = !fails(send_command(connection, search(path, TFS_PROTOCOL_MAX_MESSAGE_LEN / 2)));
+
+	tfs_client_server_connection_destroy(connection);
+	server_stop(&server);
+	TFS_ASSERT_OR_RETURN(rejected && !created);
+
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult long_socket_path(void) {
+	// Paths that don't fit in a socket address are rejected, rather than cut short into another path
+	static char socket_path[200];
+	memset(socket_path, 'a', sizeof(socket_path) - 1);
+	socket_path[0] = '/';
+	TfsClientServerConnectionNewResult result = tfs_client_server_connection_new(socket_path);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsClientServerConnectionNewErrorPathTooLong);
+	result = tfs_client_server_connection_connect(socket_path);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsClientServerConnectionNewErrorPathTooLong);
+
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = long_paths      , .name = "server/long-paths"      },
+		(TfsTest){.fn = too_large       , .name = "server/too-large"       },
+		(TfsTest){.fn = long_socket_path, .name = "server/long-socket-path"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
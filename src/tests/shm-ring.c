@@ -0,0 +1,110 @@
+/// @file
+/// @brief Shared-memory ring tests
+
+// Imports
+#include <stdio.h>			 // printf
+#include <stdlib.h>			 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>			 // memcpy, memcmp
+#include <sys/mman.h>		 // memfd_create
+#include <tfs/shm-ring.h>	 // tfs_shm_ring_*
+#include <tfs/test/assert.h> // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>	 // TfsTest, TfsTestFn, TfsTestResult
+#include <unistd.h>			 // ftruncate, close
+
+static TfsTestResult fifo(void) {
+	TfsShmRingMapResult result = tfs_shm_ring_create();
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsShmRing ring = result.data.ring;
+
+	// Fill the queue, wrapping around it a few times
+	for (size_t round = 0; round < 3; round++) {
+		for (size_t n = 0; n < TFS_SHM_RING_SLOTS; n++) {
+			char* slot = tfs_shm_ring_queue_reserve(&ring.submissions, false);
+			TFS_ASSERT_OR_RETURN(slot != NULL);
+			memcpy(slot, &n, sizeof(size_t));
+			tfs_shm_ring_queue_commit(&ring.submissions, sizeof(size_t));
+		}
+		TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_reserve(&ring.submissions, false) == NULL);
+
+		// Then drain it, in order
+		for (size_t n = 0; n < TFS_SHM_RING_SLOTS; n++) {
+			size_t len;
+			char* slot = tfs_shm_ring_queue_peek(&ring.submissions, false, &len);
+			TFS_ASSERT_OR_RETURN(slot != NULL && len == sizeof(size_t) && memcmp(slot, &n, sizeof(size_t)) == 0);
+			tfs_shm_ring_queue_release(&ring.submissions);
+		}
+		size_t len;
+		TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_peek(&ring.submissions, false, &len) == NULL);
+	}
+
+	// The completions queue is independent
+	size_t len;
+	TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_peek(&ring.completions, false, &len) == NULL);
+
+	tfs_shm_ring_close(&ring);
+	tfs_shm_ring_unmap(&ring);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult closed(void) {
+	TfsShmRingMapResult result = tfs_shm_ring_create();
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsShmRing ring = result.data.ring;
+
+	char* slot = tfs_shm_ring_queue_reserve(&ring.completions, true);
+	TFS_ASSERT_OR_RETURN(slot != NULL);
+	tfs_shm_ring_queue_commit(&ring.completions, 0);
+
+	// Slots committed before closing may still be consumed, but no more waits
+	tfs_shm_ring_close(&ring);
+	TFS_ASSERT_OR_RETURN(tfs_shm_ring_is_closed(&ring));
+	TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_reserve(&ring.completions, true) == NULL);
+	size_t len;
+	TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_peek(&ring.completions, true, &len) != NULL && len == 0);
+	tfs_shm_ring_queue_release(&ring.completions);
+	TFS_ASSERT_OR_RETURN(tfs_shm_ring_queue_peek(&ring.completions, true, &len) == NULL);
+
+	tfs_shm_ring_unmap(&ring);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult sealed(void) {
+	TfsShmRingMapResult result = tfs_shm_ring_create();
+	TFS_ASSERT_OR_RETURN(result.success);
+	TfsShmRing ring = result.data.ring;
+
+	// The region's size can't be changed once created
+	bool shrunk = ftruncate(ring.fd, 0) == 0;
+	bool grown = ftruncate(ring.fd, 2 * (off_t)sizeof(TfsShmRingRegion)) == 0;
+	tfs_shm_ring_unmap(&ring);
+	TFS_ASSERT_OR_RETURN(!shrunk && !grown);
+
+	// And regions that could be are rejected, even with the right size
+	int fd = memfd_create("tfs-shm-ring-test", MFD_CLOEXEC);
+	TFS_ASSERT_OR_RETURN(fd >= 0);
+	if (ftruncate(fd, sizeof(TfsShmRingRegion)) < 0) {
+		close(fd);
+		return TfsTestResultFailure;
+	}
+	result = tfs_shm_ring_map(fd);
+	TFS_ASSERT_OR_RETURN(!result.success && result.data.err.kind == TfsShmRingMapErrorInvalid);
+
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = fifo  , .name = "shm-ring/fifo"  },
+		(TfsTest){.fn = closed, .name = "shm-ring/closed"},
+		(TfsTest){.fn = sealed, .name = "shm-ring/sealed"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,89 @@
+/// @file
+/// @brief Lookup coalescing tests
+
+// Imports
+#include <stdio.h>					 // printf
+#include <stdlib.h>					 // size_t, EXIT_SUCCESS, EXIT_FAILURE
+#include <tfs/fs.h>					 // tfs_fs_*
+#include <tfs/server/singleflight.h> // tfs_server_singleflight_*
+#include <tfs/test/assert.h>		 // TFS_ASSERT_OR_RETURN
+#include <tfs/test/test.h>			 // TfsTest, TfsTestFn, TfsTestResult
+
+static TfsTestResult find(void) {
+	TfsFs fs = tfs_fs_new();
+	TfsServerSingleflight singleflight = tfs_server_singleflight_new();
+
+	TfsFsCreateResult create_result = tfs_fs_create(&fs, tfs_path_from_cstr("/a"), TfsInodeTypeDir);
+	TFS_ASSERT_OR_RETURN(create_result.success);
+	tfs_fs_unlock_inode(&fs, create_result.data.idx);
+
+	// Lookups return their inode already unlocked, so it may be removed right after
+	TfsFsFindResult result = tfs_server_singleflight_find(&singleflight, &fs, tfs_path_from_cstr("/a"));
+	TFS_ASSERT_OR_RETURN(result.success && result.data.inode.idx.idx == create_result.data.idx.idx);
+	TFS_ASSERT_OR_RETURN(tfs_fs_remove(&fs, tfs_path_from_cstr("/a")).success);
+
+	result = tfs_server_singleflight_find(&singleflight, &fs, tfs_path_from_cstr("/a"));
+	TFS_ASSERT_OR_RETURN(!result.success);
+
+	// Sequential lookups never share an execution
+	TfsServerSingleflightStats stats = tfs_server_singleflight_stats(&singleflight);
+	TFS_ASSERT_OR_RETURN(stats.executed == 2 && stats.coalesced == 0 && stats.max_shared == 1);
+	TFS_ASSERT_OR_RETURN(singleflight.calls == NULL);
+
+	tfs_server_singleflight_destroy(&singleflight);
+	tfs_fs_destroy(&fs);
+	return TfsTestResultSuccess;
+}
+
+static TfsTestResult written(void) {
+	TfsFs fs = tfs_fs_new();
+	TfsServerSingleflight singleflight = tfs_server_singleflight_new();
+
+	TfsFsCreateResult create_result = tfs_fs_create(&fs, tfs_path_from_cstr("/a"), TfsInodeTypeDir);
+	TFS_ASSERT_OR_RETURN(create_result.success);
+	tfs_fs_unlock_inode(&fs, create_result.data.idx);
+
+	// Pretend a lookup of `/a`, that didn't find it, is still in flight
+	// Note: It's already done, so that joining it returns right away, rather than waiting forever.
+	TfsServerSingleflightCall call = {
+		.path = tfs_path_from_cstr("/a"),
+		.result = {.success = false, .data.err.kind = TfsFsFindErrorNameNotFound},
+		.generation = 0,
+		.done = true,
+		.refs = 1,
+		.done_cond = tfs_cond_var_new(),
+		.next = NULL,
+	};
+	singleflight.calls = &call;
+
+	// Lookups join it while no write finished since it started
+	TfsFsFindResult result = tfs_server_singleflight_find(&singleflight, &fs, tfs_path_from_cstr("/a"));
+	TFS_ASSERT_OR_RETURN(!result.success);
+
+	// But not once one did, as it may have missed the write
+	tfs_server_singleflight_written(&singleflight);
+	result = tfs_server_singleflight_find(&singleflight, &fs, tfs_path_from_cstr("/a"));
+	TFS_ASSERT_OR_RETURN(result.success && result.data.inode.idx.idx == create_result.data.idx.idx);
+	TFS_ASSERT_OR_RETURN(singleflight.calls == &call && call.refs == 1);
+
+	tfs_cond_var_destroy(&call.done_cond);
+	tfs_server_singleflight_destroy(&singleflight);
+	tfs_fs_destroy(&fs);
+	return TfsTestResultSuccess;
+}
+
+int main(void) {
+	// All tests
+	// clang-format off
+	TfsTest* tests = (TfsTest[]){
+		(TfsTest){.fn = find   , .name = "singleflight/find"   },
+		(TfsTest){.fn = written, .name = "singleflight/written"},
+		(TfsTest){.fn = NULL},
+	};
+	// clang-format on
+
+	if (tfs_test_all(tests, stdout) == TfsTestResultSuccess) { return EXIT_SUCCESS; }
+	else {
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,297 @@
+#include "bench.h"
+
+// Includes
+#include <math.h>	  // sqrt
+#include <pthread.h>  // pthread_create, pthread_join, pthread_barrier_t
+#include <stdlib.h>	  // strtoul, exit, EXIT_FAILURE
+#include <string.h>	  // strcmp
+#include <tfs/util.h> // tfs_max_size_t
+#include <time.h>	  // clock_gettime
+#include <unistd.h>	  // getopt, sysconf
+
+/// @brief Data shared by all threads of a repetition
+typedef struct TfsBenchShared {
+	/// @brief The benchmark
+	const TfsBench* bench;
+
+	/// @brief Barrier every thread waits on before starting, including the main thread
+	pthread_barrier_t start;
+
+	/// @brief Barrier every thread waits on after finishing, including the main thread
+	pthread_barrier_t end;
+} TfsBenchShared;
+
+/// @brief Data for each thread of a repetition
+typedef struct TfsBenchThread {
+	/// @brief Shared data
+	TfsBenchShared* shared;
+
+	/// @brief Index of this thread
+	size_t idx;
+} TfsBenchThread;
+
+/// @brief Two-sided 95% critical values of the student's t distribution, indexed by degrees of freedom
+static const double tfs_bench_t95[] = {
+	0.0,
+	12.706,
+	4.303,
+	3.182,
+	2.776,
+	2.571,
+	2.447,
+	2.365,
+	2.306,
+	2.262,
+	2.228,
+	2.201,
+	2.179,
+	2.160,
+	2.145,
+	2.131,
+	2.120,
+	2.110,
+	2.101,
+	2.093,
+	2.086,
+	2.080,
+	2.074,
+	2.069,
+	2.064,
+	2.060,
+	2.056,
+	2.052,
+	2.048,
+	2.045,
+	2.042,
+};
+
+/// @brief Returns the two-sided 95% critical value of the student's t distribution for @p df degrees of freedom
+static double tfs_bench_t95_critical(size_t df) {
+	// Note: Past the table, the normal distribution's value is close enough.
+	if (df < sizeof(tfs_bench_t95) / sizeof(tfs_bench_t95[0])) { return tfs_bench_t95[df]; }
+	return 1.960;
+}
+
+/// @brief Prints the usage of a benchmark binary and exits
+static void tfs_bench_usage(const char* program) {
+	fprintf(stderr, "Usage: %s [-w <warmup>] [-r <reps>] [-t <max-threads>] [-f <csv|json>] [-n]\n", program);
+	exit(EXIT_FAILURE);
+}
+
+/// @brief Parses a positive integer argument, exiting on error
+static size_t tfs_bench_parse_size(const char* program, const char* arg) {
+	char* end;
+	size_t value = strtoul(arg, &end, 0);
+	if (end == arg || end[0] != '\0') { tfs_bench_usage(program); }
+
+	return value;
+}
+
+/// @brief Thread function running a benchmark function between both barriers
+static void* tfs_bench_thread_fn(void* arg) {
+	TfsBenchThread* thread = arg;
+	const TfsBench* bench = thread->shared->bench;
+
+	pthread_barrier_wait(&thread->shared->start);
+	bench->fn(bench->data, thread->idx, bench->iters);
+	pthread_barrier_wait(&thread->shared->end);
+
+	return NULL;
+}
+
+/// @brief Runs a single repetition of a benchmark
+/// @return The time taken, in nanoseconds.
+static uint64_t tfs_bench_run_rep(const TfsBench* bench) {
+	// If we're single threaded, just run it on this thread
+	if (bench->threads <= 1) {
+		uint64_t start = tfs_bench_now();
+		bench->fn(bench->data, 0, bench->iters);
+		return tfs_bench_now() - start;
+	}
+
+	TfsBenchShared shared = {.bench = bench};
+	pthread_barrier_init(&shared.start, NULL, (unsigned)bench->threads + 1);
+	pthread_barrier_init(&shared.end, NULL, (unsigned)bench->threads + 1);
+
+	pthread_t threads[bench->threads];
+	TfsBenchThread threads_data[bench->threads];
+	for (size_t n = 0; n < bench->threads; n++) {
+		threads_data[n] = (TfsBenchThread){.shared = &shared, .idx = n};
+		if (pthread_create(&threads[n], NULL, tfs_bench_thread_fn, &threads_data[n]) != 0) {
+			fprintf(stderr, "Unable to create benchmark thread #%zu\n", n);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// Note: Timing starts once every thread is ready, so thread creation isn't measured.
+	pthread_barrier_wait(&shared.start);
+	uint64_t start = tfs_bench_now();
+	pthread_barrier_wait(&shared.end);
+	uint64_t elapsed = tfs_bench_now() - start;
+
+	for (size_t n = 0; n < bench->threads; n++) { pthread_join(threads[n], NULL); }
+	pthread_barrier_destroy(&shared.start);
+	pthread_barrier_destroy(&shared.end);
+
+	return elapsed;
+}
+
+/// @brief Prints a benchmark result
+static void tfs_bench_result_print(const TfsBench* bench, const TfsBenchConfig* config, const TfsBenchResult* result) {
+	switch (config->format) {
+		case TfsBenchFormatCsv: {
+			fprintf(config->out,
+				"%s,%s,%zu,%zu,%zu,%zu,%zu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f\n",
+				bench->suite,
+				bench->name,
+				bench->param,
+				bench->threads,
+				config->warmup,
+				config->reps,
+				bench->iters,
+				result->mean_ns,
+				result->stddev_ns,
+				result->ci95_low_ns,
+				result->ci95_high_ns,
+				result->min_ns,
+				result->max_ns,
+				result->ops_per_sec);
+			break;
+		}
+
+		case TfsBenchFormatJson: {
+			fprintf(config->out,
+				"{\"suite\":\"%s\",\"name\":\"%s\",\"param\":%zu,\"threads\":%zu,\"warmup\":%zu,\"reps\":%zu,"
+				"\"iters\":%zu,\"mean_ns\":%.2f,\"stddev_ns\":%.2f,\"ci95_low_ns\":%.2f,\"ci95_high_ns\":%.2f,"
+				"\"min_ns\":%.2f,\"max_ns\":%.2f,\"ops_per_sec\":%.0f}\n",
+				bench->suite,
+				bench->name,
+				bench->param,
+				bench->threads,
+				config->warmup,
+				config->reps,
+				bench->iters,
+				result->mean_ns,
+				result->stddev_ns,
+				result->ci95_low_ns,
+				result->ci95_high_ns,
+				result->min_ns,
+				result->max_ns,
+				result->ops_per_sec);
+			break;
+		}
+
+		default: {
+			break;
+		}
+	}
+	fflush(config->out);
+}
+
+TfsBenchConfig tfs_bench_config_from_args(int argc, char** argv) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	TfsBenchConfig config = {
+		.warmup = 2,
+		.reps = 10,
+		.max_threads = cpus > 0 ? (size_t)cpus : 1,
+		.format = TfsBenchFormatCsv,
+		.print_header = true,
+		.out = stdout,
+	};
+
+	int option;
+	while ((option = getopt(argc, argv, "w:r:t:f:n")) != -1) {
+		switch (option) {
+			case 'w': {
+				config.warmup = tfs_bench_parse_size(argv[0], optarg);
+				break;
+			}
+			case 'r': {
+				config.reps = tfs_bench_parse_size(argv[0], optarg);
+				break;
+			}
+			case 't': {
+				config.max_threads = tfs_bench_parse_size(argv[0], optarg);
+				break;
+			}
+			case 'f': {
+				if (strcmp(optarg, "csv") == 0) { config.format = TfsBenchFormatCsv; }
+				else if (strcmp(optarg, "json") == 0) {
+					config.format = TfsBenchFormatJson;
+				}
+				else {
+					tfs_bench_usage(argv[0]);
+				}
+				break;
+			}
+			case 'n': {
+				config.print_header = false;
+				break;
+			}
+			default: {
+				tfs_bench_usage(argv[0]);
+			}
+		}
+	}
+	if (optind != argc || config.reps == 0 || config.max_threads == 0) { tfs_bench_usage(argv[0]); }
+
+	if (config.format == TfsBenchFormatCsv && config.print_header) {
+		fprintf(config.out,
+			"suite,name,param,threads,warmup,reps,iters,"
+			"mean_ns,stddev_ns,ci95_low_ns,ci95_high_ns,min_ns,max_ns,ops_per_sec\n");
+	}
+
+	return config;
+}
+
+uint64_t tfs_bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+TfsBenchResult tfs_bench_run(const TfsBench* self, const TfsBenchConfig* config) {
+	// Warm up
+	for (size_t n = 0; n < config->warmup; n++) { tfs_bench_run_rep(self); }
+
+	// Then measure each repetition as nanoseconds per operation of a single thread
+	// Note: With multiple threads, this is the wall-clock time of each
+	//       thread's operation, so a perfectly scaling benchmark keeps it constant.
+	double samples[config->reps];
+	double total_ops_per_sec = 0;
+	for (size_t n = 0; n < config->reps; n++) {
+		uint64_t elapsed = tfs_bench_run_rep(self);
+		samples[n] = (double)elapsed / (double)self->iters;
+		total_ops_per_sec += (double)(self->iters * tfs_max_size_t(self->threads, 1)) * 1e9 / (double)elapsed;
+	}
+
+	// Calculate all statistics
+	double sum = 0;
+	double min = samples[0];
+	double max = samples[0];
+	for (size_t n = 0; n < config->reps; n++) {
+		sum += samples[n];
+		if (samples[n] < min) { min = samples[n]; }
+		if (samples[n] > max) { max = samples[n]; }
+	}
+	double mean = sum / (double)config->reps;
+
+	double sq_diff_sum = 0;
+	for (size_t n = 0; n < config->reps; n++) { sq_diff_sum += (samples[n] - mean) * (samples[n] - mean); }
+	double stddev = config->reps > 1 ? sqrt(sq_diff_sum / (double)(config->reps - 1)) : 0;
+	double ci95_half_width = config->reps > 1 ?
+		tfs_bench_t95_critical(config->reps - 1) * stddev / sqrt((double)config->reps) : 0;
+
+	TfsBenchResult result = {
+		.mean_ns = mean,
+		.stddev_ns = stddev,
+		.ci95_low_ns = mean - ci95_half_width,
+		.ci95_high_ns = mean + ci95_half_width,
+		.min_ns = min,
+		.max_ns = max,
+		.ops_per_sec = total_ops_per_sec / (double)config->reps,
+	};
+	tfs_bench_result_print(self, config, &result);
+
+	return result;
+}
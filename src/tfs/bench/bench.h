@@ -0,0 +1,130 @@
+/// @file
+/// @brief Benchmarking utilities
+/// @details
+/// This file defines various benchmarking utilities used by
+/// the benchmarks in `src/bench`.
+///
+/// Each benchmark is run for a number of warmup repetitions,
+/// which are discarded, followed by a number of measured repetitions.
+/// Every repetition runs the benchmark function for a fixed number of
+/// iterations on each thread, and yields a single nanoseconds-per-operation
+/// sample, from which the mean, standard deviation and 95% confidence interval
+/// are calculated.
+
+#ifndef TFS_BENCH_BENCH_H
+#define TFS_BENCH_BENCH_H
+
+// Imports
+#include <stdbool.h> // bool
+#include <stddef.h>	 // size_t
+#include <stdint.h>	 // uint64_t
+#include <stdio.h>	 // FILE
+
+/// @brief Output format of the results
+typedef enum TfsBenchFormat {
+	/// @brief Comma separated values, one result per line.
+	TfsBenchFormatCsv,
+
+	/// @brief Json objects, one result per line.
+	TfsBenchFormatJson,
+} TfsBenchFormat;
+
+/// @brief Benchmark configuration
+typedef struct TfsBenchConfig {
+	/// @brief Number of repetitions to run and discard before measuring
+	size_t warmup;
+
+	/// @brief Number of measured repetitions
+	size_t reps;
+
+	/// @brief Maximum number of threads for multi-threaded benchmarks
+	size_t max_threads;
+
+	/// @brief Output format
+	TfsBenchFormat format;
+
+	/// @brief If the csv header should be printed
+	bool print_header;
+
+	/// @brief File to output results to
+	FILE* out;
+} TfsBenchConfig;
+
+/// @brief A benchmark function
+/// @param data User data passed to #tfs_bench_run
+/// @param thread_idx Index of the thread running this function, from `0` to `threads - 1`.
+/// @param iters Number of operations to execute.
+typedef void (*TfsBenchFn)(void* data, size_t thread_idx, size_t iters);
+
+/// @brief A benchmark to run
+typedef struct TfsBench {
+	/// @brief Name of the suite this benchmark belongs to
+	const char* suite;
+
+	/// @brief Name of the benchmark
+	const char* name;
+
+	/// @brief Parameter of this run, such as the input size
+	size_t param;
+
+	/// @brief Number of threads to run the function on
+	size_t threads;
+
+	/// @brief Number of iterations each thread runs per repetition
+	size_t iters;
+
+	/// @brief The function
+	TfsBenchFn fn;
+
+	/// @brief User data passed to @ref fn
+	void* data;
+} TfsBench;
+
+/// @brief Benchmark results
+typedef struct TfsBenchResult {
+	/// @brief Mean time per operation, in nanoseconds
+	double mean_ns;
+
+	/// @brief Sample standard deviation of the time per operation, in nanoseconds
+	double stddev_ns;
+
+	/// @brief Lower bound of the 95% confidence interval of the mean, in nanoseconds
+	double ci95_low_ns;
+
+	/// @brief Upper bound of the 95% confidence interval of the mean, in nanoseconds
+	double ci95_high_ns;
+
+	/// @brief Fastest repetition's time per operation, in nanoseconds
+	double min_ns;
+
+	/// @brief Slowest repetition's time per operation, in nanoseconds
+	double max_ns;
+
+	/// @brief Mean throughput of all threads, in operations per second
+	double ops_per_sec;
+} TfsBenchResult;
+
+/// @brief Parses the benchmark configuration from the command line.
+/// @param argc
+/// @param argv
+/// @details
+/// Accepts `-w <warmup>`, `-r <reps>`, `-t <max-threads>`, `-f <csv|json>`
+/// and `-n` to skip the csv header. On invalid arguments, prints the
+/// usage and exits.
+TfsBenchConfig tfs_bench_config_from_args(int argc, char** argv);
+
+/// @brief Returns the current monotonic time in nanoseconds
+uint64_t tfs_bench_now(void);
+
+/// @brief Runs a benchmark and prints it's result
+/// @param self
+/// @param config Configuration to run with
+TfsBenchResult tfs_bench_run(const TfsBench* self, const TfsBenchConfig* config);
+
+/// @brief Prevents the compiler from optimizing away the computation of @p ptr
+/// @param ptr Pointer to the value to keep alive.
+inline static void tfs_bench_do_not_optimize(const void* ptr) {
+	__asm__ volatile("" : : "g"(ptr) : "memory");
+}
+
+#endif
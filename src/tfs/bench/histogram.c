@@ -0,0 +1,83 @@
+#include "histogram.h"
+
+// Imports
+#include <math.h> // ceil
+
+/// @brief Number of bits needed to index the sub buckets
+#define TFS_BENCH_HISTOGRAM_SUB_BUCKET_BITS 4
+
+/// @brief Returns the bucket index of @p value
+static size_t tfs_bench_histogram_bucket_idx(uint64_t value) {
+	if (value < TFS_BENCH_HISTOGRAM_SUB_BUCKETS) { return (size_t)value; }
+
+	// Note: `exponent >= SUB_BUCKET_BITS` here, as `value >= SUB_BUCKETS`.
+	size_t exponent = 63 - (size_t)__builtin_clzll(value);
+	size_t sub_bucket =
+		(size_t)(value >> (exponent - TFS_BENCH_HISTOGRAM_SUB_BUCKET_BITS)) & (TFS_BENCH_HISTOGRAM_SUB_BUCKETS - 1);
+	return (exponent - TFS_BENCH_HISTOGRAM_SUB_BUCKET_BITS + 1) * TFS_BENCH_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+/// @brief Returns the midpoint of the values stored in bucket @p idx
+static uint64_t tfs_bench_histogram_bucket_value(size_t idx) {
+	if (idx < TFS_BENCH_HISTOGRAM_SUB_BUCKETS) { return (uint64_t)idx; }
+
+	size_t exponent = idx / TFS_BENCH_HISTOGRAM_SUB_BUCKETS + TFS_BENCH_HISTOGRAM_SUB_BUCKET_BITS - 1;
+	size_t sub_bucket = idx % TFS_BENCH_HISTOGRAM_SUB_BUCKETS;
+	uint64_t width = (uint64_t)1 << (exponent - TFS_BENCH_HISTOGRAM_SUB_BUCKET_BITS);
+	uint64_t low = ((uint64_t)1 << exponent) + sub_bucket * width;
+
+	return low + width / 2;
+}
+
+TfsBenchHistogram tfs_bench_histogram_new(void) {
+	return (TfsBenchHistogram){
+		.buckets = {0},
+		.count = 0,
+		.sum = 0,
+		.min = UINT64_MAX,
+		.max = 0,
+	};
+}
+
+void tfs_bench_histogram_record(TfsBenchHistogram* self, uint64_t value) {
+	self->buckets[tfs_bench_histogram_bucket_idx(value)]++;
+	self->count++;
+	self->sum += value;
+	if (value < self->min) { self->min = value; }
+	if (value > self->max) { self->max = value; }
+}
+
+void tfs_bench_histogram_merge(TfsBenchHistogram* self, const TfsBenchHistogram* other) {
+	for (size_t n = 0; n < TFS_BENCH_HISTOGRAM_BUCKETS; n++) { self->buckets[n] += other->buckets[n]; }
+	self->count += other->count;
+	self->sum += other->sum;
+	if (other->min < self->min) { self->min = other->min; }
+	if (other->max > self->max) { self->max = other->max; }
+}
+
+double tfs_bench_histogram_mean(const TfsBenchHistogram* self) {
+	if (self->count == 0) { return 0; }
+
+	return (double)self->sum / (double)self->count;
+}
+
+uint64_t tfs_bench_histogram_percentile(const TfsBenchHistogram* self, double percentile) {
+	if (self->count == 0) { return 0; }
+
+	// Find the first bucket where the running count reaches the percentile's rank
+	double rank_real = ceil(percentile / 100.0 * (double)self->count);
+	uint64_t rank = (uint64_t)rank_real;
+	if (rank == 0) { rank = 1; }
+	uint64_t seen = 0;
+	for (size_t n = 0; n < TFS_BENCH_HISTOGRAM_BUCKETS; n++) {
+		seen += self->buckets[n];
+		if (seen < rank) { continue; }
+
+		uint64_t value = tfs_bench_histogram_bucket_value(n);
+		if (value < self->min) { return self->min; }
+		if (value > self->max) { return self->max; }
+		return value;
+	}
+
+	return self->max;
+}
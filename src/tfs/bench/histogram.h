@@ -0,0 +1,72 @@
+/// @file
+/// @brief Latency histograms
+/// @details
+/// This file defines the #TfsBenchHistogram type, a fixed-size
+/// log-linear histogram used to record latencies and report
+/// their percentiles.
+///
+/// Values are split into power-of-two ranges, each divided into
+/// #TFS_BENCH_HISTOGRAM_SUB_BUCKETS linear buckets, so every
+/// recorded value is within `1 / TFS_BENCH_HISTOGRAM_SUB_BUCKETS`
+/// of the value reported for it. As the histogram doesn't contain
+/// any pointers, it may be placed in memory shared between processes.
+
+#ifndef TFS_BENCH_HISTOGRAM_H
+#define TFS_BENCH_HISTOGRAM_H
+
+// Imports
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+/// @brief Number of linear buckets in each power-of-two range
+#define TFS_BENCH_HISTOGRAM_SUB_BUCKETS 16
+
+/// @brief Total number of buckets
+/// @details
+/// Values below #TFS_BENCH_HISTOGRAM_SUB_BUCKETS get a bucket each,
+/// and every power of two above it gets #TFS_BENCH_HISTOGRAM_SUB_BUCKETS.
+#define TFS_BENCH_HISTOGRAM_BUCKETS ((64 - 4 + 1) * TFS_BENCH_HISTOGRAM_SUB_BUCKETS)
+
+/// @brief A log-linear histogram
+typedef struct TfsBenchHistogram {
+	/// @brief Number of values in each bucket
+	uint64_t buckets[TFS_BENCH_HISTOGRAM_BUCKETS];
+
+	/// @brief Number of values recorded
+	uint64_t count;
+
+	/// @brief Sum of all values recorded
+	uint64_t sum;
+
+	/// @brief Smallest value recorded
+	uint64_t min;
+
+	/// @brief Largest value recorded
+	uint64_t max;
+} TfsBenchHistogram;
+
+/// @brief Creates a new, empty, histogram
+TfsBenchHistogram tfs_bench_histogram_new(void);
+
+/// @brief Records a value
+/// @param self
+/// @param value The value to record
+void tfs_bench_histogram_record(TfsBenchHistogram* self, uint64_t value);
+
+/// @brief Adds all values recorded in @p other to @p self
+/// @param self
+/// @param other The histogram to merge
+void tfs_bench_histogram_merge(TfsBenchHistogram* self, const TfsBenchHistogram* other);
+
+/// @brief Returns the mean of all values recorded, or `0` if empty.
+double tfs_bench_histogram_mean(const TfsBenchHistogram* self);
+
+/// @brief Returns the value at a given percentile, or `0` if empty.
+/// @param self
+/// @param percentile The percentile, between `0` and `100`.
+/// @details
+/// The returned value is the midpoint of the bucket containing the
+/// percentile, clamped between the smallest and largest values recorded.
+uint64_t tfs_bench_histogram_percentile(const TfsBenchHistogram* self, double percentile);
+
+#endif
@@ -1,9 +1,17 @@
 #include "client-api.h"
 
 // Imports
-#include <assert.h> // assert
-#include <stdlib.h> // exit, EXIT_FAILURE
-#include <unistd.h> // getpid, unlink, close, open
+#include <assert.h>			  // assert
+#include <errno.h>			  // errno, EAGAIN, EPIPE, EINTR
+#include <stdlib.h>			  // exit, EXIT_FAILURE, malloc, free
+#include <string.h>			  // memcpy, memset, strlen
+#include <sys/stat.h>		  // stat, S_ISSOCK
+#include <sys/uio.h>		  // iovec
+#include <tfs/client/async.h> // TfsClientAsync, tfs_client_async_*
+#include <tfs/protocol.h>	  // tfs_protocol_*
+#include <tfs/rw_lock.h>	  // TfsRwLock
+#include <time.h>			  // nanosleep
+#include <unistd.h>			  // getpid, unlink, close, open
 
 void tfs_client_server_connection_new_error_print(const TfsClientServerConnectionNewError* self, FILE* out) {
 	switch (self->kind) {
@@ -15,6 +23,14 @@ void tfs_client_server_connection_new_error_print(const TfsClientServerConnectio
 			fprintf(out, "Unable to bind socket\n");
 			break;
 		}
+		case TfsClientServerConnectionNewErrorConnectSocket: {
+			fprintf(out, "Unable to connect socket\n");
+			break;
+		}
+		case TfsClientServerConnectionNewErrorPathTooLong: {
+			fprintf(out, "Server socket path is too long\n");
+			break;
+		}
 		default: {
 			break;
 		}
@@ -34,13 +50,190 @@ void tfs_client_server_connection_send_command_error_print( //
 			fprintf(out, "Unable to receive response\n");
 			break;
 		}
+		case TfsClientServerConnectionSendCommandErrorTooLarge: {
+			fprintf(out, "Commands do not fit in a single message\n");
+			break;
+		}
+		case TfsClientServerConnectionSendCommandErrorInvalidResponse: {
+			fprintf(out, "Received an invalid response\n");
+			break;
+		}
+		case TfsClientServerConnectionSendCommandErrorWouldBlock: {
+			fprintf(out, "Server queue, or client window, is full\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+void tfs_client_server_connection_poll_error_print(const TfsClientServerConnectionPollError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsClientServerConnectionPollErrorEmpty: {
+			fprintf(out, "No request has completed\n");
+			break;
+		}
+		case TfsClientServerConnectionPollErrorReceive: {
+			fprintf(out, "Unable to receive response\n");
+			break;
+		}
+		case TfsClientServerConnectionPollErrorInvalidResponse: {
+			fprintf(out, "Received an invalid response\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+void tfs_client_server_connection_attach_error_print(const TfsClientServerConnectionAttachError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsClientServerConnectionAttachErrorCreateRing: {
+			fprintf(out, "Unable to create shared-memory ring\n");
+			break;
+		}
+		case TfsClientServerConnectionAttachErrorSend: {
+			fprintf(out, "Unable to send attach request\n");
+			break;
+		}
+		case TfsClientServerConnectionAttachErrorReceive: {
+			fprintf(out, "Unable to receive response\n");
+			break;
+		}
+		case TfsClientServerConnectionAttachErrorRefused: {
+			fprintf(out, "Server refused to attach the ring\n");
+			break;
+		}
 		default: {
 			break;
 		}
 	}
 }
 
+/// @brief Sends a message to the server, through the ring, if attached, else the socket
+/// @param self
+/// @param message The message to send
+/// @param message_len Length of @p message
+/// @param wait If the server's queue is full, whether to wait for it
+/// @return If the message was sent. On failure, `errno` is `EAGAIN` if the queue was full.
+static bool transport_send(TfsClientServerConnection* self, const char* message, size_t message_len, bool wait) {
+	assert(message_len <= TFS_PROTOCOL_MAX_MESSAGE_LEN);
+
+	if (self->ring != NULL) {
+		char* slot = tfs_shm_ring_queue_reserve(&self->ring->submissions, wait);
+		if (slot == NULL) {
+			errno = tfs_shm_ring_is_closed(self->ring) ? EPIPE : EAGAIN;
+			return false;
+		}
+		memcpy(slot, message, message_len);
+		tfs_shm_ring_queue_commit(&self->ring->submissions, message_len);
+		return true;
+	}
+
+	ssize_t characters_sent = sendto(self->client_socket,
+		message,
+		message_len,
+		wait ? 0 : MSG_DONTWAIT,
+		(struct sockaddr*)&self->server_address,
+		self->server_address_len //
+	);
+	if (characters_sent < 0) { return false; }
+	assert((size_t)characters_sent == message_len);
+
+	return true;
+}
+
+/// @brief Receives a message from the server, through the ring, if attached, else the socket
+/// @param self
+/// @param[out] buffer Buffer to receive to. Longer messages are truncated.
+/// @param buffer_capacity Capacity of @p buffer
+/// @param wait If no message has arrived yet, whether to wait for one
+/// @return Length of the message, or `-1` on failure, with `errno` as `EAGAIN` if no message arrived.
+static ssize_t transport_recv(TfsClientServerConnection* self, char* buffer, size_t buffer_capacity, bool wait) {
+	if (self->ring != NULL) {
+		size_t message_len;
+		const char* slot = tfs_shm_ring_queue_peek(&self->ring->completions, wait, &message_len);
+		if (slot == NULL) {
+			errno = tfs_shm_ring_is_closed(self->ring) ? EPIPE : EAGAIN;
+			return -1;
+		}
+		if (message_len > buffer_capacity) { message_len = buffer_capacity; }
+		memcpy(buffer, slot, message_len);
+		tfs_shm_ring_queue_release(&self->ring->completions);
+		return (ssize_t)message_len;
+	}
+
+	return recv(self->client_socket, buffer, buffer_capacity, wait ? 0 : MSG_DONTWAIT);
+}
+
+/// @brief Reads the time to wait for from a busy reply
+/// @return The time to wait for, in milliseconds, or `0` if @p response isn't a busy reply to request @p id
+static uint32_t busy_retry_after(const char* response, size_t response_len, uint32_t id) {
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(response, response_len);
+	if (!header_result.success || header_result.data.header.kind != TfsProtocolKindBusy ||
+		header_result.data.header.id != id || response_len != TFS_PROTOCOL_BUSY_REPLY_LEN) {
+		return 0;
+	}
+
+	// Note: We always wait for at least a millisecond, so `0` isn't ambiguous.
+	uint32_t retry_after_ms = tfs_protocol_u32_read(response + TFS_PROTOCOL_HEADER_LEN);
+	return retry_after_ms == 0 ? 1 : retry_after_ms;
+}
+
+/// @brief Sleeps for @p ms milliseconds
+static void sleep_ms(uint32_t ms) {
+	struct timespec duration = {.tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000000};
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR) {}
+}
+
+/// @brief Number of connections created by this process
+static size_t connections_created = 0;
+
+/// @brief Checks if a socket exists at @p path
+static bool socket_exists(const char* path) {
+	struct stat path_stat;
+	return stat(path, &path_stat) == 0 && S_ISSOCK(path_stat.st_mode);
+}
+
+/// @brief Picks the server socket a connection sends to
+/// @param server_path Path given for the server
+/// @param pid Our process id
+/// @param connection_idx Index of the connection within our process
+/// @param[out] path Path of the socket picked, with `108` bytes
+static void pick_server_path(const char* server_path, pid_t pid, size_t connection_idx, char* path) {
+	// If the server has a single socket, or none yet, use it
+	snprintf(path, 108, "%s", server_path);
+	if (socket_exists(server_path)) { return; }
+
+	// Else count the sockets of each group
+	char group_path[108];
+	size_t groups = 0;
+	while (snprintf(group_path, sizeof(group_path), "%s.%zu", server_path, groups) < (int)sizeof(group_path) &&
+		   socket_exists(group_path)) {
+		groups++;
+	}
+	if (groups == 0) { return; }
+
+	// And pick one of them by a hash of the process and connection
+	// Note: The hash is the finalizer of splitmix64, so consecutive connections are spread evenly.
+	uint64_t hash = ((uint64_t)pid << 32) ^ (uint64_t)connection_idx;
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9u;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebu;
+	hash ^= hash >> 31;
+	snprintf(path, 108, "%s.%zu", server_path, (size_t)(hash % groups));
+}
+
 TfsClientServerConnectionNewResult tfs_client_server_connection_new(const char* server_path) {
+	// Note: Group socket paths that don't fit are simply never picked, but the path itself must fit.
+	if (strlen(server_path) >= 108) {
+		return (TfsClientServerConnectionNewResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionNewErrorPathTooLong,
+		};
+	}
+
 	// Create our socket
 	int client_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
 	if (client_socket < 0) {
@@ -51,11 +244,14 @@ TfsClientServerConnectionNewResult tfs_client_server_connection_new(const char*
 	}
 
 	// Create the client address and get it's length
+	// Note: The address includes a per-process counter, so each connection
+	//       of a process, such as one per thread, gets it's own socket.
 	struct sockaddr_un client_address;
 	pid_t pid = getpid();
+	size_t connection_idx = __atomic_fetch_add(&connections_created, 1, __ATOMIC_RELAXED);
 	bzero(&client_address, sizeof(struct sockaddr_un));
 	client_address.sun_family = AF_UNIX;
-	snprintf(client_address.sun_path, 108, "/tmp/tfs-client-%d", pid);
+	snprintf(client_address.sun_path, 108, "/tmp/tfs-client-%d-%zu", pid, connection_idx);
 	socklen_t client_address_len = (socklen_t)SUN_LEN(&client_address);
 
 	// Unlink and bind our socket
@@ -72,7 +268,7 @@ TfsClientServerConnectionNewResult tfs_client_server_connection_new(const char*
 	struct sockaddr_un server_address;
 	bzero(&server_address, sizeof(struct sockaddr_un));
 	server_address.sun_family = AF_UNIX;
-	strcpy(server_address.sun_path, server_path);
+	pick_server_path(server_path, pid, connection_idx, server_address.sun_path);
 	socklen_t server_address_len = (socklen_t)SUN_LEN(&server_address);
 
 	return (TfsClientServerConnectionNewResult){
@@ -82,63 +278,398 @@ TfsClientServerConnectionNewResult tfs_client_server_connection_new(const char*
 		.data.connection.client_address_len = client_address_len,
 		.data.connection.server_address = server_address,
 		.data.connection.server_address_len = server_address_len,
+		.data.connection.next_request_id = 0,
+		.data.connection.requests_in_flight = 0,
+		.data.connection.ring = NULL,
+	};
+}
+
+TfsClientServerConnectionNewResult tfs_client_server_connection_connect(const char* server_path) {
+	// Create the server address
+	struct sockaddr_un server_address;
+	bzero(&server_address, sizeof(struct sockaddr_un));
+	server_address.sun_family = AF_UNIX;
+	int path_len = snprintf(server_address.sun_path, 108, "%s", server_path);
+	if (path_len < 0 || path_len >= 108) {
+		return (TfsClientServerConnectionNewResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionNewErrorPathTooLong,
+		};
+	}
+	socklen_t server_address_len = (socklen_t)SUN_LEN(&server_address);
+
+	// Create our socket
+	int client_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (client_socket < 0) {
+		return (TfsClientServerConnectionNewResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionNewErrorCreateSocket,
+		};
+	}
+
+	// Then connect to the server
+	// Note: We don't bind our socket, as the server replies on the connection itself.
+	if (connect(client_socket, (struct sockaddr*)&server_address, server_address_len) < 0) {
+		close(client_socket);
+		return (TfsClientServerConnectionNewResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionNewErrorConnectSocket,
+		};
+	}
+
+	// Note: The server address is ignored when sending on a connected socket, so it's
+	//       still passed along, and our address is left empty, so it isn't unlinked.
+	struct sockaddr_un client_address;
+	bzero(&client_address, sizeof(struct sockaddr_un));
+	client_address.sun_family = AF_UNIX;
+
+	return (TfsClientServerConnectionNewResult){
+		.success = true,
+		.data.connection.client_socket = client_socket,
+		.data.connection.client_address = client_address,
+		.data.connection.client_address_len = sizeof(sa_family_t),
+		.data.connection.server_address = server_address,
+		.data.connection.server_address_len = server_address_len,
+		.data.connection.next_request_id = 0,
+		.data.connection.requests_in_flight = 0,
+		.data.connection.ring = NULL,
 	};
 }
 
 void tfs_client_server_connection_destroy(TfsClientServerConnection* connection) {
+	// Close the ring, if attached, so the server stops serving it
+	if (connection->ring != NULL) {
+		tfs_shm_ring_close(connection->ring);
+		tfs_shm_ring_unmap(connection->ring);
+		free(connection->ring);
+	}
+
 	/// Close the socket
 	close(connection->client_socket);
 
-	/// And unlink our socket
-	unlink(connection->client_address.sun_path);
+	/// And unlink our socket, if bound
+	if (connection->client_address.sun_path[0] != '\0') { unlink(connection->client_address.sun_path); }
+}
+
+TfsClientServerConnectionAttachResult tfs_client_server_connection_attach(TfsClientServerConnection* self) {
+	assert(self->requests_in_flight == 0);
+	if (self->ring != NULL) {
+		return (TfsClientServerConnectionAttachResult){
+			.success = true,
+		};
+	}
+
+	// Create the ring
+	TfsShmRingMapResult ring_result = tfs_shm_ring_create();
+	if (!ring_result.success) {
+		return (TfsClientServerConnectionAttachResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionAttachErrorCreateRing,
+		};
+	}
+	TfsShmRing ring = ring_result.data.ring;
+
+	// Send the attach request, with the ring's file descriptor
+	char request[TFS_PROTOCOL_HEADER_LEN];
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindAttach, .count = 0, .id = 0}, request);
+	struct iovec request_iovec = {.iov_base = request, .iov_len = sizeof(request)};
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	memset(&control, 0, sizeof(control));
+	struct msghdr request_header = {
+		.msg_name = &self->server_address,
+		.msg_namelen = self->server_address_len,
+		.msg_iov = &request_iovec,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+	struct cmsghdr* control_header = CMSG_FIRSTHDR(&request_header);
+	control_header->cmsg_level = SOL_SOCKET;
+	control_header->cmsg_type = SCM_RIGHTS;
+	control_header->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(control_header), &ring.fd, sizeof(int));
+	if (sendmsg(self->client_socket, &request_header, 0) < 0) {
+		tfs_shm_ring_unmap(&ring);
+		return (TfsClientServerConnectionAttachResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionAttachErrorSend,
+		};
+	}
+
+	// Then check the server attached it
+	// Note: Servers that don't support rings reply with an empty batch.
+	char response[TFS_PROTOCOL_ATTACH_REPLY_LEN];
+	ssize_t response_len = recv(self->client_socket, response, sizeof(response), 0);
+	if (response_len < 0) {
+		tfs_shm_ring_unmap(&ring);
+		return (TfsClientServerConnectionAttachResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionAttachErrorReceive,
+		};
+	}
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(response, (size_t)response_len);
+	if (!header_result.success || header_result.data.header.kind != TfsProtocolKindAttach ||
+		(size_t)response_len != TFS_PROTOCOL_ATTACH_REPLY_LEN || response[TFS_PROTOCOL_HEADER_LEN] == '\0') {
+		tfs_shm_ring_unmap(&ring);
+		return (TfsClientServerConnectionAttachResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionAttachErrorRefused,
+		};
+	}
+
+	self->ring = malloc(sizeof(TfsShmRing));
+	if (self->ring == NULL) {
+		tfs_shm_ring_close(&ring);
+		tfs_shm_ring_unmap(&ring);
+		return (TfsClientServerConnectionAttachResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionAttachErrorCreateRing,
+		};
+	}
+	*self->ring = ring;
+
+	return (TfsClientServerConnectionAttachResult){
+		.success = true,
+	};
 }
 
 TfsClientServerConnectionSendCommandResult tfs_client_server_connection_send_command(TfsClientServerConnection* self,
 	const TfsCommand* command //
 ) {
-	// Build the command string
-	char command_str[1024];
-	tfs_command_to_string(command, command_str, sizeof(command_str));
-	size_t command_str_len = strlen(command_str);
-
-	// Send the string to the server
-	ssize_t characters_sent = sendto(self->client_socket,
-		command_str,
-		command_str_len + 1,
-		0,
-		(struct sockaddr*)&self->server_address,
-		self->server_address_len //
-	);
-	if (characters_sent < 0) {
+	// Note: We send it as a batch with a single command, rather than a legacy
+	//       message, so the server can tell us to retry it if busy.
+	bool command_successful;
+	TfsClientServerConnectionSendCommandsResult result =
+		tfs_client_server_connection_send_commands(self, command, 1, &command_successful);
+	if (!result.success) {
 		return (TfsClientServerConnectionSendCommandResult){
+			.success = false,
+			.data.err = result.data.err,
+		};
+	}
+
+	return (TfsClientServerConnectionSendCommandResult){
+		.success = true,
+		.data.command_successful = command_successful,
+	};
+}
+
+TfsClientServerConnectionSendCommandsResult tfs_client_server_connection_send_commands( //
+	TfsClientServerConnection* self,
+	const TfsCommand* commands,
+	size_t commands_len,
+	bool* commands_successful //
+) {
+	// Build the batch message
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	size_t message_len;
+	if (!tfs_protocol_batch_write(commands, commands_len, 0, message, sizeof(message), &message_len)) {
+		return (TfsClientServerConnectionSendCommandsResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionSendCommandErrorTooLarge,
+		};
+	}
+
+	// Send it to the server, until it isn't busy
+	// Note: The response has a header followed by the result of each command.
+	char response[TFS_PROTOCOL_HEADER_LEN + TFS_PROTOCOL_MAX_BATCH_LEN];
+	ssize_t response_len;
+	while (1) {
+		if (!transport_send(self, message, message_len, true)) {
+			return (TfsClientServerConnectionSendCommandsResult){
+				.success = false,
+				.data.err.kind = TfsClientServerConnectionSendCommandErrorSend,
+			};
+		}
+
+		response_len = transport_recv(self, response, sizeof(response), true);
+		if (response_len < 0) {
+			return (TfsClientServerConnectionSendCommandsResult){
+				.success = false,
+				.data.err.kind = TfsClientServerConnectionSendCommandErrorReceive,
+			};
+		}
+
+		uint32_t retry_after_ms = busy_retry_after(response, (size_t)response_len, 0);
+		if (retry_after_ms == 0) { break; }
+		sleep_ms(retry_after_ms);
+	}
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(response, (size_t)response_len);
+	if (!header_result.success || header_result.data.header.count != commands_len ||
+		(size_t)response_len != TFS_PROTOCOL_HEADER_LEN + commands_len) {
+		return (TfsClientServerConnectionSendCommandsResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionSendCommandErrorInvalidResponse,
+		};
+	}
+
+	for (size_t n = 0; n < commands_len; n++) {
+		commands_successful[n] = response[TFS_PROTOCOL_HEADER_LEN + n] != '\0';
+	}
+
+	return (TfsClientServerConnectionSendCommandsResult){
+		.success = true,
+	};
+}
+
+TfsClientServerConnectionSubmitResult tfs_client_server_connection_submit( //
+	TfsClientServerConnection* self,
+	const TfsCommand* command //
+) {
+	// Build the message, a batch with a single command
+	uint32_t id = self->next_request_id;
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	size_t message_len;
+	if (!tfs_protocol_batch_write(command, 1, id, message, sizeof(message), &message_len)) {
+		return (TfsClientServerConnectionSubmitResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionSendCommandErrorTooLarge,
+		};
+	}
+
+	// Send it without blocking
+	if (!transport_send(self, message, message_len, false)) {
+		return (TfsClientServerConnectionSubmitResult){
+			.success = false,
+			.data.err.kind = errno == EAGAIN ? TfsClientServerConnectionSendCommandErrorWouldBlock
+											 : TfsClientServerConnectionSendCommandErrorSend,
+		};
+	}
+
+	self->next_request_id++;
+	self->requests_in_flight++;
+	return (TfsClientServerConnectionSubmitResult){
+		.success = true,
+		.data.id = id,
+	};
+}
+
+TfsClientServerConnectionPollResult tfs_client_server_connection_poll(TfsClientServerConnection* self, bool wait) {
+	// Note: Without any requests in flight, we'd wait forever.
+	if (self->requests_in_flight == 0) {
+		return (TfsClientServerConnectionPollResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionPollErrorEmpty,
+		};
+	}
+
+	// Receive a reply
+	// Note: Busy replies are the longest we may receive.
+	char response[TFS_PROTOCOL_BUSY_REPLY_LEN];
+	ssize_t response_len = transport_recv(self, response, sizeof(response), wait);
+	if (response_len < 0) {
+		return (TfsClientServerConnectionPollResult){
+			.success = false,
+			.data.err.kind = errno == EAGAIN ? TfsClientServerConnectionPollErrorEmpty
+											 : TfsClientServerConnectionPollErrorReceive,
+		};
+	}
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(response, (size_t)response_len);
+	if (!header_result.success) {
+		return (TfsClientServerConnectionPollResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionPollErrorInvalidResponse,
+		};
+	}
+	uint32_t id = header_result.data.header.id;
+	uint32_t retry_after_ms = busy_retry_after(response, (size_t)response_len, id);
+	if (retry_after_ms == 0 &&
+		(header_result.data.header.count != 1 || (size_t)response_len != TFS_PROTOCOL_HEADER_LEN + 1)) {
+		return (TfsClientServerConnectionPollResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionPollErrorInvalidResponse,
+		};
+	}
+
+	self->requests_in_flight--;
+	return (TfsClientServerConnectionPollResult){
+		.success = true,
+		.data.completion.id = id,
+		.data.completion.command_successful = retry_after_ms == 0 && response[TFS_PROTOCOL_HEADER_LEN] != '\0',
+		.data.completion.retry_after_ms = retry_after_ms,
+	};
+}
+
+TfsClientServerConnectionPoolResult tfs_client_server_connection_pool(TfsClientServerConnection* self, uint32_t size) {
+	char request[TFS_PROTOCOL_POOL_REQUEST_LEN];
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindPool, .count = 0, .id = 0}, request);
+	tfs_protocol_u32_write(size, request + TFS_PROTOCOL_HEADER_LEN);
+	if (!transport_send(self, request, sizeof(request), true)) {
+		return (TfsClientServerConnectionPoolResult){
 			.success = false,
 			.data.err.kind = TfsClientServerConnectionSendCommandErrorSend,
 		};
 	}
-	assert((size_t)characters_sent == command_str_len + 1);
 
-	// Receive the response from the server.
-	// Note: Response is either '\x00' for failure, or '\x01' for success.
-	char response_buffer;
-	ssize_t characters_received = recv(self->client_socket, &response_buffer, 1, 0);
-	if (characters_received < 0) {
-		return (TfsClientServerConnectionSendCommandResult){
+	char response[TFS_PROTOCOL_POOL_REPLY_LEN];
+	ssize_t response_len = transport_recv(self, response, sizeof(response), true);
+	if (response_len < 0) {
+		return (TfsClientServerConnectionPoolResult){
 			.success = false,
 			.data.err.kind = TfsClientServerConnectionSendCommandErrorReceive,
 		};
 	}
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(response, (size_t)response_len);
+	if (!header_result.success || header_result.data.header.kind != TfsProtocolKindPool ||
+		(size_t)response_len != TFS_PROTOCOL_POOL_REPLY_LEN) {
+		return (TfsClientServerConnectionPoolResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionSendCommandErrorInvalidResponse,
+		};
+	}
 
-	return (TfsClientServerConnectionSendCommandResult){
+	const char* body = response + TFS_PROTOCOL_HEADER_LEN;
+	return (TfsClientServerConnectionPoolResult){
 		.success = true,
-		.data.command_successful = response_buffer != '\0',
+		.data.pool.size = tfs_protocol_u32_read(body),
+		.data.pool.live = tfs_protocol_u32_read(body + 4),
+		.data.pool.min = tfs_protocol_u32_read(body + 8),
+		.data.pool.max = tfs_protocol_u32_read(body + 12),
+		.data.pool.pinned = body[16] != '\0',
 	};
 }
 
-/// @brief Global client connection for the API.
-static TfsClientServerConnection global_client_connection;
+/// @brief Global client for the API, if mounted
+static TfsClientAsync* global_client = NULL;
+
+/// @brief Lock over the global client
+/// @details
+/// Commands hold shared access until they're replied to, so
+/// mounting and unmounting wait for all commands in flight.
+static TfsRwLock global_client_lock = {.rw_lock = PTHREAD_RWLOCK_INITIALIZER};
+
+/// @brief Sends a command on the global client and waits for it's reply
+/// @param command The command to send. It is destroyed afterwards.
+/// @return `0` on success, `1` if unable to send it and `2` if the server failed to execute it
+static int send_global_command(TfsCommand* command) {
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessShared);
+	if (global_client == NULL) {
+		tfs_rw_lock_unlock(&global_client_lock);
+		tfs_command_destroy(command);
+		return 1;
+	}
 
-/// @brief If the global client is currently initialized
-static bool global_client_connection_initialized = false;
+	// Note: We resubmit it for as long as the server is busy.
+	TfsClientFuture future;
+	bool replied;
+	while (1) {
+		future = tfs_client_future_new();
+		TfsClientAsyncSubmitResult result = tfs_client_async_submit(global_client, command, &future);
+		replied = result.success && tfs_client_async_wait(global_client, &future);
+		if (!replied || future.retry_after_ms == 0) { break; }
+		sleep_ms(future.retry_after_ms);
+	}
+	tfs_command_destroy(command);
+	tfs_rw_lock_unlock(&global_client_lock);
+	if (!replied) { return 1; }
+
+	if (!future.command_successful) { return 2; }
+
+	return 0;
+}
 
 int tfsCreate(char* path, char type) {
 	TfsInodeType new_type;
@@ -160,40 +691,38 @@ int tfsCreate(char* path, char type) {
 
 	TfsCommand command =
 		(TfsCommand){.kind = TfsCommandCreate, .data.create.path = new_path, .data.create.type = new_type};
-	TfsClientServerConnectionSendCommandResult result =
-		tfs_client_server_connection_send_command(&global_client_connection, &command);
-	tfs_command_destroy(&command);
-	if (!result.success) { return 1; }
-
-	if (!result.data.command_successful) { return 2; }
-
-	return 0;
+	return send_global_command(&command);
 }
 
 int tfsDelete(char* path) {
 	TfsPathOwned new_path = tfs_path_to_owned(tfs_path_from_cstr(path));
 
 	TfsCommand command = (TfsCommand){.kind = TfsCommandRemove, .data.remove.path = new_path};
-	TfsClientServerConnectionSendCommandResult result =
-		tfs_client_server_connection_send_command(&global_client_connection, &command);
-	tfs_command_destroy(&command);
-	if (!result.success) { return 1; }
-
-	if (!result.data.command_successful) { return 2; }
-
-	return 0;
+	return send_global_command(&command);
 }
 
 int tfsLookup(char* path) {
-	TfsPathOwned new_path = tfs_path_to_owned(tfs_path_from_cstr(path));
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessShared);
+	if (global_client == NULL) {
+		tfs_rw_lock_unlock(&global_client_lock);
+		return 1;
+	}
 
-	TfsCommand command = (TfsCommand){.kind = TfsCommandSearch, .data.search.path = new_path};
-	TfsClientServerConnectionSendCommandResult result =
-		tfs_client_server_connection_send_command(&global_client_connection, &command);
-	tfs_command_destroy(&command);
-	if (!result.success) { return 1; }
+	// Note: We resubmit it for as long as the server is busy.
+	TfsClientFuture future;
+	bool replied;
+	while (1) {
+		future = tfs_client_future_new();
+		TfsClientAsyncSubmitResult result =
+			tfs_client_async_submit_lookup(global_client, tfs_path_from_cstr(path), &future);
+		replied = result.success && tfs_client_async_wait(global_client, &future);
+		if (!replied || future.retry_after_ms == 0) { break; }
+		sleep_ms(future.retry_after_ms);
+	}
+	tfs_rw_lock_unlock(&global_client_lock);
+	if (!replied) { return 1; }
 
-	if (!result.data.command_successful) { return 2; }
+	if (!future.command_successful) { return 2; }
 
 	return 0;
 }
@@ -203,55 +732,73 @@ int tfsMove(char* from, char* to) {
 	TfsPathOwned new_to = tfs_path_to_owned(tfs_path_from_cstr(to));
 
 	TfsCommand command = (TfsCommand){.kind = TfsCommandMove, .data.move.source = new_from, .data.move.dest = new_to};
-	TfsClientServerConnectionSendCommandResult result =
-		tfs_client_server_connection_send_command(&global_client_connection, &command);
-	tfs_command_destroy(&command);
-	if (!result.success) { return 1; }
-
-	if (!result.data.command_successful) { return 2; }
-
-	return 0;
+	return send_global_command(&command);
 }
 
 int tfsPrint(char* path) {
 	char* new_path = strdup(path);
 
 	TfsCommand command = (TfsCommand){.kind = TfsCommandPrint, .data.print.path = new_path};
-	TfsClientServerConnectionSendCommandResult result =
-		tfs_client_server_connection_send_command(&global_client_connection, &command);
-	tfs_command_destroy(&command);
-	if (!result.success) { return 1; }
+	return send_global_command(&command);
+}
+
+int tfsSetLookupCache(int enabled) {
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessShared);
+	if (global_client == NULL) {
+		tfs_rw_lock_unlock(&global_client_lock);
+		return 1;
+	}
+
+	tfs_client_cache_set_enabled(&global_client->cache, enabled != 0);
+	tfs_rw_lock_unlock(&global_client_lock);
+
+	return 0;
+}
+
+int tfsLookupCacheStats(TfsClientCacheStats* stats) {
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessShared);
+	if (global_client == NULL) {
+		tfs_rw_lock_unlock(&global_client_lock);
+		return 1;
+	}
 
-	if (!result.data.command_successful) { return 2; }
+	*stats = tfs_client_cache_stats(&global_client->cache);
+	tfs_rw_lock_unlock(&global_client_lock);
 
 	return 0;
 }
 
 int tfsMount(char* server_path) {
-	if (global_client_connection_initialized) {
-		tfs_client_server_connection_destroy(&global_client_connection);
-		global_client_connection_initialized = false;
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessUnique);
+	if (global_client != NULL) {
+		tfs_client_async_destroy(global_client);
+		global_client = NULL;
 	}
 
-	TfsClientServerConnectionNewResult result = tfs_client_server_connection_new(server_path);
+	TfsClientAsyncNewResult result = tfs_client_async_new(server_path, TFS_CLIENT_ASYNC_DEFAULT_CAPACITY);
 	if (!result.success) {
 		fprintf(stderr, "Unable to initialize the client connections\n");
 		tfs_client_server_connection_new_error_print(&result.data.err, stderr);
+		tfs_rw_lock_unlock(&global_client_lock);
 		return 1;
 	}
-	global_client_connection = result.data.connection;
+	global_client = result.data.client;
+	tfs_rw_lock_unlock(&global_client_lock);
 
 	return 0;
 }
 
 int tfsUnmount(void) {
-	if (!global_client_connection_initialized) {
+	tfs_rw_lock_lock(&global_client_lock, TfsRwLockAccessUnique);
+	if (global_client == NULL) {
+		tfs_rw_lock_unlock(&global_client_lock);
 		fprintf(stderr, "Tried to unmount while no connection was alive");
 		return 1;
 	}
 
-	tfs_client_server_connection_destroy(&global_client_connection);
-	global_client_connection_initialized = false;
+	tfs_client_async_destroy(global_client);
+	global_client = NULL;
+	tfs_rw_lock_unlock(&global_client_lock);
 
 	return 0;
 }
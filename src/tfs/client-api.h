@@ -2,16 +2,48 @@
 /// @brief Client API
 /// @details
 /// API to be used by the clients to send requests to the server
+///
+/// Besides the blocking #tfs_client_server_connection_send_command, a
+/// connection may keep several requests in flight with the non-blocking
+/// #tfs_client_server_connection_submit, collecting their replies, which may
+/// arrive in any order, with #tfs_client_server_connection_poll. A connection
+/// must not have requests in flight while sending blocking commands.
+///
+/// Requests the server rejects as busy, see #TfsProtocolKindBusy, are retried
+/// by the blocking sends once the server asks them to, while submitted ones
+/// are completed with the time to wait for, and must be retried by the caller.
+///
+/// A connection may also be a session, created with #tfs_client_server_connection_connect,
+/// connected to the server's session socket instead of sending it datagrams.
+///
+/// A connection to a server on the same host may be attached to a shared-memory
+/// ring, see #TfsShmRing, with #tfs_client_server_connection_attach, after which
+/// all of it's messages are exchanged through the ring instead of the socket.
+/// If attaching fails, the connection keeps using the socket.
+///
+/// A server may also have a socket for each group of workers, in which case
+/// each connection sends to one of them, see #tfs_client_server_connection_new.
+///
+/// A #TfsClientServerConnection must not be used by several threads at
+/// once, as they could receive each other's replies.
+///
+/// The `tfs*` functions send their commands on a global
+/// #TfsClientAsync, waiting for each reply. As replies are matched to
+/// their commands by request id, these may be called from any number
+/// of threads at once.
 
 #ifndef TFS_CLIENT_API_H
 #define TFS_CLIENT_API_H
 
 // Imports
+#include <stdint.h>				 // uint32_t
 #include <stdio.h>				 // FILE
 #include <sys/socket.h>			 // socklen_t
 #include <sys/types.h>			 // <Compatibility>
 #include <sys/un.h>				 // sockaddr_un
+#include <tfs/client/cache.h>	 // TfsClientCacheStats
 #include <tfs/command/command.h> // TfsCommand
+#include <tfs/shm-ring.h>		 // TfsShmRing
 
 /// @brief A server connection
 typedef struct TfsClientServerConnection {
@@ -29,6 +61,15 @@ typedef struct TfsClientServerConnection {
 
 	/// @brief Our socket
 	int client_socket;
+
+	/// @brief Id of the next request submitted
+	uint32_t next_request_id;
+
+	/// @brief Number of submitted requests without a reply
+	size_t requests_in_flight;
+
+	/// @brief Shared-memory ring, if attached
+	TfsShmRing* ring;
 } TfsClientServerConnection;
 
 /// @brief Error type for #tfs_client_server_connection_new
@@ -40,6 +81,12 @@ typedef struct TfsClientServerConnectionNewError {
 
 		/// @brief Unable to bind client socket to path
 		TfsClientServerConnectionNewErrorBindSocket,
+
+		/// @brief Unable to connect to the server's session socket
+		TfsClientServerConnectionNewErrorConnectSocket,
+
+		/// @brief Server socket path doesn't fit in a socket address
+		TfsClientServerConnectionNewErrorPathTooLong,
 	} kind;
 } TfsClientServerConnectionNewError;
 
@@ -67,6 +114,15 @@ typedef struct TfsClientServerConnectionSendCommandError {
 
 		/// @brief Unable to receive message from server
 		TfsClientServerConnectionSendCommandErrorReceive,
+
+		/// @brief Commands don't fit in a single message
+		TfsClientServerConnectionSendCommandErrorTooLarge,
+
+		/// @brief Server sent an invalid response
+		TfsClientServerConnectionSendCommandErrorInvalidResponse,
+
+		/// @brief Sending would block, as the server's queue, or an asynchronous client's window, is full
+		TfsClientServerConnectionSendCommandErrorWouldBlock,
 	} kind;
 } TfsClientServerConnectionSendCommandError;
 
@@ -85,6 +141,138 @@ typedef struct TfsClientServerConnectionSendCommandResult {
 	} data;
 } TfsClientServerConnectionSendCommandResult;
 
+/// @brief Result type for #tfs_client_server_connection_send_commands
+typedef struct TfsClientServerConnectionSendCommandsResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Underlying error
+		TfsClientServerConnectionSendCommandError err;
+	} data;
+} TfsClientServerConnectionSendCommandsResult;
+
+/// @brief Result type for #tfs_client_server_connection_submit
+typedef struct TfsClientServerConnectionSubmitResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Id of the submitted request
+		uint32_t id;
+
+		/// @brief Underlying error
+		TfsClientServerConnectionSendCommandError err;
+	} data;
+} TfsClientServerConnectionSubmitResult;
+
+/// @brief A completed request
+typedef struct TfsClientServerConnectionCompletion {
+	/// @brief Id of the request
+	uint32_t id;
+
+	/// @brief If the command from the server was successful
+	bool command_successful;
+
+	/// @brief If the server was busy, how long to wait for, in milliseconds, before retrying it, else `0`
+	uint32_t retry_after_ms;
+} TfsClientServerConnectionCompletion;
+
+/// @brief Error type for #tfs_client_server_connection_poll
+typedef struct TfsClientServerConnectionPollError {
+	/// @brief Error kind
+	enum {
+		/// @brief No request has completed yet
+		TfsClientServerConnectionPollErrorEmpty,
+
+		/// @brief Unable to receive message from server
+		TfsClientServerConnectionPollErrorReceive,
+
+		/// @brief Server sent an invalid response
+		TfsClientServerConnectionPollErrorInvalidResponse,
+	} kind;
+} TfsClientServerConnectionPollError;
+
+/// @brief Result type for #tfs_client_server_connection_poll
+typedef struct TfsClientServerConnectionPollResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief The completed request
+		TfsClientServerConnectionCompletion completion;
+
+		/// @brief Underlying error
+		TfsClientServerConnectionPollError err;
+	} data;
+} TfsClientServerConnectionPollResult;
+
+/// @brief Error type for #tfs_client_server_connection_attach
+typedef struct TfsClientServerConnectionAttachError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to create the shared-memory ring
+		TfsClientServerConnectionAttachErrorCreateRing,
+
+		/// @brief Unable to send the attach request to server
+		TfsClientServerConnectionAttachErrorSend,
+
+		/// @brief Unable to receive message from server
+		TfsClientServerConnectionAttachErrorReceive,
+
+		/// @brief Server refused to attach the ring
+		TfsClientServerConnectionAttachErrorRefused,
+	} kind;
+} TfsClientServerConnectionAttachError;
+
+/// @brief Result type for #tfs_client_server_connection_attach
+typedef struct TfsClientServerConnectionAttachResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Underlying error
+		TfsClientServerConnectionAttachError err;
+	} data;
+} TfsClientServerConnectionAttachResult;
+
+/// @brief State of the server's executor pool
+typedef struct TfsClientServerConnectionPool {
+	/// @brief Size the pool is adapting to
+	uint32_t size;
+
+	/// @brief Number of executors currently running
+	uint32_t live;
+
+	/// @brief Minimum size
+	uint32_t min;
+
+	/// @brief Maximum size
+	uint32_t max;
+
+	/// @brief If the size was pinned
+	bool pinned;
+} TfsClientServerConnectionPool;
+
+/// @brief Result type for #tfs_client_server_connection_pool
+typedef struct TfsClientServerConnectionPoolResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief State of the pool, after any change
+		TfsClientServerConnectionPool pool;
+
+		/// @brief Underlying error
+		TfsClientServerConnectionSendCommandError err;
+	} data;
+} TfsClientServerConnectionPoolResult;
+
 /// @brief Prints a textual representation of @p self to @p out
 /// @param self
 /// @param out File to output to.
@@ -98,13 +286,43 @@ void tfs_client_server_connection_send_command_error_print( //
 	FILE* out //
 );
 
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_client_server_connection_poll_error_print(const TfsClientServerConnectionPollError* self, FILE* out);
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_client_server_connection_attach_error_print(const TfsClientServerConnectionAttachError* self, FILE* out);
+
 /// @brief Creates a new connection to the server
 /// @param server_path The path of the socket to connect to
+/// @details
+/// If the server has a socket for each group of workers, at `<server_path>.<n>`,
+/// rather than one at @p server_path, the connection picks one of them by a hash
+/// of it's process id and index within the process, so the connections of each
+/// process' threads are spread across all groups, while each sticks to one.
 TfsClientServerConnectionNewResult tfs_client_server_connection_new(const char* server_path);
 
+/// @brief Creates a new session connection to a server
+/// @details
+/// Instead of exchanging datagrams, the connection is connected to the server's
+/// `SOCK_SEQPACKET` session socket, on which the server keeps per-connection state
+/// until the connection is destroyed. Lookups on a session are never leased.
+/// @param server_path Path of the server's session socket
+TfsClientServerConnectionNewResult tfs_client_server_connection_connect(const char* server_path);
+
 /// @brief Destroys a connection to the server
 void tfs_client_server_connection_destroy(TfsClientServerConnection* connection);
 
+/// @brief Attaches a shared-memory ring to the connection
+/// @param self
+/// @details
+/// The connection must not have requests in flight.
+/// On failure, the connection keeps using the socket.
+TfsClientServerConnectionAttachResult tfs_client_server_connection_attach(TfsClientServerConnection* self);
+
 /// @brief Sends a message to the tfs server
 /// @param self
 /// @param command The command to send
@@ -113,39 +331,97 @@ TfsClientServerConnectionSendCommandResult tfs_client_server_connection_send_com
 	const TfsCommand* command //
 );
 
-/// @brief Sends a create command to the tfs server on the global client connection
+/// @brief Sends a batch of messages to the tfs server
+/// @param self
+/// @param commands The commands to send
+/// @param commands_len Number of commands to send
+/// @param[out] commands_successful If each command from the server was successful
+/// @details
+/// All commands are sent in a single message, and executed in order by the server.
+/// See #TFS_PROTOCOL_MAX_BATCH_LEN and #TFS_PROTOCOL_MAX_MESSAGE_LEN for the limits on a batch.
+TfsClientServerConnectionSendCommandsResult tfs_client_server_connection_send_commands( //
+	TfsClientServerConnection* self,
+	const TfsCommand* commands,
+	size_t commands_len,
+	bool* commands_successful //
+);
+
+/// @brief Submits a command to the tfs server without waiting for it's reply
+/// @param self
+/// @param command The command to submit
+/// @details
+/// If the server's queue is full, this fails with `WouldBlock`,
+/// in which case some replies should be polled before retrying.
+TfsClientServerConnectionSubmitResult tfs_client_server_connection_submit( //
+	TfsClientServerConnection* self,
+	const TfsCommand* command //
+);
+
+/// @brief Polls for the reply of any submitted command
+/// @param self
+/// @param wait If no reply has arrived yet, whether to wait for one
+/// @details
+/// Fails with `Empty` if no reply has arrived, when not waiting,
+/// or if there are no requests in flight.
+TfsClientServerConnectionPollResult tfs_client_server_connection_poll(TfsClientServerConnection* self, bool wait);
+
+/// @brief Reads, and optionally changes, the size of the server's executor pool
+/// @param self
+/// @param size `0` to only read the size, #TFS_PROTOCOL_POOL_ADAPT to let the server adapt it, or the size to pin
+/// @details
+/// Servers without an adaptive pool report all sizes as `0`.
+/// Just like blocking sends, there must be no requests in flight.
+TfsClientServerConnectionPoolResult tfs_client_server_connection_pool(TfsClientServerConnection* self, uint32_t size);
+
+/// @brief Sends a create command to the tfs server on the global client
 /// @param path Path to create
 /// @param type Type of inode to create
 /// @return `0` on success
 int tfsCreate(char* path, char type);
 
-/// @brief Sends a remove command to the tfs server on the global client connection
+/// @brief Sends a remove command to the tfs server on the global client
 /// @param path Path to remove
 /// @return `0` on success
 int tfsDelete(char* path);
 
-/// @brief Sends a search command to the tfs server on the global client connection
+/// @brief Sends a search command to the tfs server on the global client
 /// @param path Path to search
 /// @return `0` on success
+/// @details
+/// If the lookup cache is enabled, the result may come from the cache.
 int tfsLookup(char* path);
 
-/// @brief Sends a move command to the tfs server on the global client connection
+/// @brief Sends a move command to the tfs server on the global client
 /// @param source Source path to move
 /// @param dest Destination path to move
 /// @return `0` on success
 int tfsMove(char* from, char* to);
 
-/// @brief Sends a print command to the tfs server on the global client connection
+/// @brief Sends a print command to the tfs server on the global client
 /// @param source Output path to print to
 /// @return `0` on success
 int tfsPrint(char* path);
 
-/// @brief Mounts the global client connection with a server on `server_path`
+/// @brief Enables or disables the lookup cache of the global client
+/// @param enabled If the cache should be enabled
+/// @return `0` on success
+/// @details
+/// The cache is disabled by default. While enabled, lookups may return results
+/// up to a lease old, if the server was unable to deliver an invalidation,
+/// so callers that require strict consistency should leave it disabled.
+int tfsSetLookupCache(int enabled);
+
+/// @brief Retrieves the statistics of the lookup cache of the global client
+/// @param[out] stats The statistics
+/// @return `0` on success
+int tfsLookupCacheStats(TfsClientCacheStats* stats);
+
+/// @brief Mounts the global client with a server on `server_path`
 /// @param server_path Path of the server to mount on.
 /// @return `0` on success
 int tfsMount(char* server_path);
 
-/// @brief Unmounts server on the global client connection
+/// @brief Unmounts server on the global client
 /// @return `0` on success
 int tfsUnmount(void);
 
@@ -0,0 +1,286 @@
+#include "async.h"
+
+// Imports
+#include <assert.h>		  // assert
+#include <stdio.h>		  // fprintf, stderr
+#include <stdlib.h>		  // malloc, calloc, free, exit, EXIT_FAILURE
+#include <sys/socket.h>	  // sendto, recv, shutdown
+#include <tfs/protocol.h> // tfs_protocol_*
+
+/// @brief Completes @p future, firing it's callback, if any
+/// @details
+/// The client's lock must _not_ be held, as the callback may submit more commands.
+static void complete_future(TfsClientAsync* self,
+	TfsClientFuture* future,
+	bool replied,
+	bool command_successful,
+	uint32_t retry_after_ms) {
+	if (future->cache_path.chars != NULL) { tfs_path_owned_destroy(&future->cache_path); }
+
+	tfs_mutex_lock(&self->lock);
+	TfsClientFutureCallback callback = future->callback;
+	void* callback_data = future->callback_data;
+	future->replied = replied;
+	future->command_successful = command_successful;
+	future->retry_after_ms = retry_after_ms;
+	future->done = true;
+	tfs_cond_var_broadcast(&self->completed);
+	tfs_mutex_unlock(&self->lock);
+
+	// Note: Once done, the future might be freed by a waiter, so we can't touch it anymore,
+	//       unless it has a callback, in which case the callback is the one to free it.
+	if (callback != NULL) { callback(future, callback_data); }
+}
+
+/// @brief Completion thread function
+/// @param arg The client
+static void* completion_thread_fn(void* arg) {
+	TfsClientAsync* self = arg;
+
+	// Note: We stop once the socket is shut down.
+	while (1) {
+		char reply[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+		ssize_t reply_len = recv(self->connection.client_socket, reply, sizeof(reply), 0);
+		if (reply_len <= 0) { break; }
+
+		// Ignore any invalid replies
+		TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(reply, (size_t)reply_len);
+		if (!header_result.success) { continue; }
+
+		// If it's an invalidation, invalidate the cache
+		// Note: This must happen in the same thread as the replies, so that any lookup
+		//       sent before the invalidation, but replied after it, isn't cached.
+		TfsProtocolKind kind = header_result.data.header.kind;
+		if (kind == TfsProtocolKindInvalidate) {
+			tfs_client_cache_invalidate(&self->cache,
+				(TfsPath){.chars = reply + TFS_PROTOCOL_HEADER_LEN, .len = (size_t)reply_len - TFS_PROTOCOL_HEADER_LEN});
+			continue;
+		}
+
+		// Note: Busy replies carry the time to wait for instead of a result.
+		size_t expected_len = kind == TfsProtocolKindLease ? TFS_PROTOCOL_LEASE_REPLY_LEN
+							: kind == TfsProtocolKindBusy  ? TFS_PROTOCOL_BUSY_REPLY_LEN
+														   : TFS_PROTOCOL_HEADER_LEN + 1;
+		if ((kind != TfsProtocolKindBusy && header_result.data.header.count != 1) ||
+			(size_t)reply_len != expected_len) {
+			continue;
+		}
+		uint32_t retry_after_ms = 0;
+		if (kind == TfsProtocolKindBusy) {
+			retry_after_ms = tfs_protocol_u32_read(reply + TFS_PROTOCOL_HEADER_LEN);
+			if (retry_after_ms == 0) { retry_after_ms = 1; }
+		}
+		bool command_successful = kind != TfsProtocolKindBusy && reply[TFS_PROTOCOL_HEADER_LEN] != '\0';
+
+		// Take the future out of the pending ones
+		uint32_t id = header_result.data.header.id;
+		tfs_mutex_lock(&self->lock);
+		TfsClientFuture** slot = &self->pending[id % self->capacity];
+		TfsClientFuture* future = *slot;
+		*slot = NULL;
+		tfs_cond_var_broadcast(&self->completed);
+		tfs_mutex_unlock(&self->lock);
+
+		if (future == NULL) { continue; }
+
+		// Cache the result of lookups with a lease
+		if (kind == TfsProtocolKindLease && future->cache_path.chars != NULL) {
+			uint32_t lease_ms = tfs_protocol_u32_read(reply + TFS_PROTOCOL_HEADER_LEN + 1);
+			tfs_client_cache_insert(&self->cache,
+				tfs_path_owned_borrow(future->cache_path),
+				command_successful,
+				future->cache_ticket,
+				lease_ms);
+		}
+		// Note: If the server was busy, the path is freed with the future, rather than cached.
+		complete_future(self, future, true, command_successful, retry_after_ms);
+	}
+
+	return NULL;
+}
+
+TfsClientFuture tfs_client_future_new(void) {
+	return tfs_client_future_with_callback(NULL, NULL);
+}
+
+TfsClientFuture tfs_client_future_with_callback(TfsClientFutureCallback callback, void* data) {
+	return (TfsClientFuture){
+		.done = false,
+		.replied = false,
+		.command_successful = false,
+		.retry_after_ms = 0,
+		.callback = callback,
+		.callback_data = data,
+		.cache_path = {.chars = NULL, .len = 0},
+		.cache_ticket = {.generation = 0, .sent_ns = 0},
+	};
+}
+
+TfsClientAsyncNewResult tfs_client_async_new(const char* server_path, size_t capacity) {
+	assert(capacity >= 1);
+
+	TfsClientServerConnectionNewResult connection_result = tfs_client_server_connection_new(server_path);
+	if (!connection_result.success) {
+		return (TfsClientAsyncNewResult){
+			.success = false,
+			.data.err = connection_result.data.err,
+		};
+	}
+
+	TfsClientAsync* self = malloc(sizeof(TfsClientAsync));
+	TfsClientFuture** pending = calloc(capacity, sizeof(TfsClientFuture*));
+	if (self == NULL || pending == NULL) {
+		fprintf(stderr, "Unable to allocate asynchronous client with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+	*self = (TfsClientAsync){
+		.connection = connection_result.data.connection,
+		.pending = pending,
+		.capacity = capacity,
+		.next_id = 0,
+		.lock = tfs_mutex_new(),
+		.completed = tfs_cond_var_new(),
+		.cache = tfs_client_cache_new(TFS_CLIENT_CACHE_DEFAULT_CAPACITY),
+	};
+
+	int res = pthread_create(&self->completion_thread, NULL, completion_thread_fn, self);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create completion thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+
+	return (TfsClientAsyncNewResult){
+		.success = true,
+		.data.client = self,
+	};
+}
+
+void tfs_client_async_destroy(TfsClientAsync* self) {
+	// Stop the completion thread
+	shutdown(self->connection.client_socket, SHUT_RDWR);
+	pthread_join(self->completion_thread, NULL);
+
+	// Then complete all futures still in flight
+	for (size_t n = 0; n < self->capacity; n++) {
+		TfsClientFuture* future = self->pending[n];
+		self->pending[n] = NULL;
+		if (future != NULL) { complete_future(self, future, false, false, 0); }
+	}
+
+	tfs_client_server_connection_destroy(&self->connection);
+	tfs_client_cache_destroy(&self->cache);
+	tfs_cond_var_destroy(&self->completed);
+	tfs_mutex_destroy(&self->lock);
+	free(self->pending);
+	free(self);
+}
+
+/// @brief Submits a command, optionally as a lease request
+static TfsClientAsyncSubmitResult submit(
+	TfsClientAsync* self, const TfsCommand* command, bool lease, TfsClientFuture* future) {
+	// Reserve an id, waiting until it's slot is free
+	// Note: Only the completion thread frees slots, so if it's the one submitting, from
+	//       a callback, it can't wait for them, and must fail instead.
+	tfs_mutex_lock(&self->lock);
+	if (self->pending[self->next_id % self->capacity] != NULL &&
+		pthread_equal(pthread_self(), self->completion_thread)) {
+		tfs_mutex_unlock(&self->lock);
+		return (TfsClientAsyncSubmitResult){
+			.success = false,
+			.data.err.kind = TfsClientServerConnectionSendCommandErrorWouldBlock,
+		};
+	}
+	uint32_t id = self->next_id++;
+	TfsClientFuture** slot = &self->pending[id % self->capacity];
+	while (*slot != NULL) { tfs_cond_var_wait(&self->completed, &self->lock); }
+	*slot = future;
+	tfs_mutex_unlock(&self->lock);
+
+	// Then send the command
+	// Note: The reply may be received, and the future completed, before `sendto` even returns.
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	size_t message_len;
+	bool written = lease ? tfs_protocol_lease_write(command, id, message, sizeof(message), &message_len)
+						 : tfs_protocol_batch_write(command, 1, id, message, sizeof(message), &message_len);
+	TfsClientServerConnectionSendCommandError err;
+	if (!written) {
+		err.kind = TfsClientServerConnectionSendCommandErrorTooLarge;
+	}
+	else if (sendto(self->connection.client_socket,
+				 message,
+				 message_len,
+				 0,
+				 (struct sockaddr*)&self->connection.server_address,
+				 self->connection.server_address_len) < 0) {
+		err.kind = TfsClientServerConnectionSendCommandErrorSend;
+	}
+	else {
+		return (TfsClientAsyncSubmitResult){
+			.success = true,
+		};
+	}
+
+	// If we couldn't, release the slot
+	tfs_mutex_lock(&self->lock);
+	*slot = NULL;
+	tfs_cond_var_broadcast(&self->completed);
+	tfs_mutex_unlock(&self->lock);
+
+	return (TfsClientAsyncSubmitResult){
+		.success = false,
+		.data.err = err,
+	};
+}
+
+TfsClientAsyncSubmitResult tfs_client_async_submit(
+	TfsClientAsync* self, const TfsCommand* command, TfsClientFuture* future) {
+	return submit(self, command, false, future);
+}
+
+TfsClientAsyncSubmitResult tfs_client_async_submit_lookup(
+	TfsClientAsync* self, TfsPath path, TfsClientFuture* future) {
+	// If the cache is disabled, just submit the lookup
+	TfsPathOwned owned_path = tfs_path_to_owned(path);
+	TfsCommand command = {.kind = TfsCommandSearch, .data.search.path = owned_path};
+	if (!tfs_client_cache_is_enabled(&self->cache)) {
+		TfsClientAsyncSubmitResult result = submit(self, &command, false, future);
+		tfs_command_destroy(&command);
+		return result;
+	}
+
+	// Else if the cache has the result, complete the future immediately
+	bool exists;
+	if (tfs_client_cache_get(&self->cache, path, &exists)) {
+		tfs_command_destroy(&command);
+		complete_future(self, future, true, exists, 0);
+		return (TfsClientAsyncSubmitResult){
+			.success = true,
+		};
+	}
+
+	// Else ask for a lease on it
+	// Note: The future takes the path, to cache the result once it's replied to.
+	future->cache_path = owned_path;
+	future->cache_ticket = tfs_client_cache_ticket(&self->cache);
+	TfsClientAsyncSubmitResult result = submit(self, &command, true, future);
+	if (!result.success) { tfs_path_owned_destroy(&future->cache_path); }
+
+	return result;
+}
+
+bool tfs_client_async_wait(TfsClientAsync* self, TfsClientFuture* future) {
+	tfs_mutex_lock(&self->lock);
+	while (!future->done) { tfs_cond_var_wait(&self->completed, &self->lock); }
+	bool replied = future->replied;
+	tfs_mutex_unlock(&self->lock);
+
+	return replied;
+}
+
+bool tfs_client_async_is_done(TfsClientAsync* self, const TfsClientFuture* future) {
+	tfs_mutex_lock(&self->lock);
+	bool done = future->done;
+	tfs_mutex_unlock(&self->lock);
+
+	return done;
+}
@@ -0,0 +1,199 @@
+/// @file
+/// @brief Asynchronous client
+/// @details
+/// This file defines the #TfsClientAsync type, a server connection
+/// that may have many requests in flight at once.
+///
+/// Commands are submitted along with a #TfsClientFuture, which is
+/// completed by a completion thread once the server replies. The
+/// caller may then either wait on the future or have a callback
+/// fired from the completion thread.
+///
+/// Replies are matched to their futures by request id, so any number
+/// of threads may submit and wait on the same client at once.
+///
+/// Lookups submitted with #tfs_client_async_submit_lookup may also be
+/// answered by the client's #TfsClientCache, when enabled, which caches
+/// their results for as long as the server leases them.
+///
+/// The client always uses it's connection's socket, as the completion
+/// thread also receives the server's invalidations on it, so it's never
+/// attached to a shared-memory ring.
+
+#ifndef TFS_CLIENT_ASYNC_H
+#define TFS_CLIENT_ASYNC_H
+
+// Imports
+#include <pthread.h>		  // pthread_t
+#include <stdbool.h>		  // bool
+#include <stddef.h>			  // size_t
+#include <stdint.h>			  // uint32_t
+#include <tfs/client-api.h>	  // TfsClientServerConnection
+#include <tfs/client/cache.h> // TfsClientCache
+#include <tfs/cond_var.h>	  // TfsCondVar
+#include <tfs/mutex.h>		  // TfsMutex
+
+/// @brief Default maximum number of requests in flight
+#define TFS_CLIENT_ASYNC_DEFAULT_CAPACITY 256
+
+/// @brief A future
+typedef struct TfsClientFuture TfsClientFuture;
+
+/// @brief Callback fired once a future is completed
+/// @details
+/// Callbacks are called from the completion thread, or, for lookups
+/// answered by the cache, from the submitting thread, and so must not block. The future is not accessed after the
+/// callback is called, so the callback may free it.
+///
+/// Callbacks may submit more commands, but, as the completion thread can't wait for itself
+/// to free a slot, those fail with #TfsClientServerConnectionSendCommandErrorWouldBlock if
+/// the client already has `capacity` requests in flight. Callbacks fired by
+/// #tfs_client_async_destroy must not submit.
+typedef void (*TfsClientFutureCallback)(TfsClientFuture* future, void* data);
+
+/// @brief The result of a submitted command
+struct TfsClientFuture {
+	/// @brief If the future has completed
+	bool done;
+
+	/// @brief If the server replied
+	/// @details
+	/// Futures still in flight when the client is destroyed
+	/// are completed without a reply.
+	bool replied;
+
+	/// @brief If the command was executed successfully
+	bool command_successful;
+
+	/// @brief If the server was busy, how long to wait for, in milliseconds, before resubmitting it, else `0`
+	/// @details
+	/// Commands rejected by a busy server are completed as unsuccessful.
+	uint32_t retry_after_ms;
+
+	/// @brief Callback to fire once completed, if any
+	TfsClientFutureCallback callback;
+
+	/// @brief Data passed to the callback
+	void* callback_data;
+
+	/// @brief Path to cache the result of, for lookups sent with a lease request
+	/// @details
+	/// This is private to the client.
+	TfsPathOwned cache_path;
+
+	/// @brief Ticket taken before sending the lease request
+	/// @details
+	/// This is private to the client.
+	TfsClientCacheTicket cache_ticket;
+};
+
+/// @brief An asynchronous client
+typedef struct TfsClientAsync {
+	/// @brief Underlying connection
+	TfsClientServerConnection connection;
+
+	/// @brief Futures of all requests in flight, indexed by `id % capacity`
+	TfsClientFuture** pending;
+
+	/// @brief Maximum number of requests in flight
+	size_t capacity;
+
+	/// @brief Id of the next request submitted
+	uint32_t next_id;
+
+	/// @brief Lock over the pending futures and ids
+	TfsMutex lock;
+
+	/// @brief Signaled whenever a future completes
+	TfsCondVar completed;
+
+	/// @brief Completion thread
+	pthread_t completion_thread;
+
+	/// @brief Lookup cache, disabled by default
+	TfsClientCache cache;
+} TfsClientAsync;
+
+/// @brief Result type for #tfs_client_async_new
+typedef struct TfsClientAsyncNewResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief The client
+		/// @details
+		/// The client must not be moved, as the completion thread refers to it.
+		TfsClientAsync* client;
+
+		/// @brief Underlying error
+		TfsClientServerConnectionNewError err;
+	} data;
+} TfsClientAsyncNewResult;
+
+/// @brief Result type for #tfs_client_async_submit
+typedef struct TfsClientAsyncSubmitResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Underlying error
+		TfsClientServerConnectionSendCommandError err;
+	} data;
+} TfsClientAsyncSubmitResult;
+
+/// @brief Creates a future without a callback
+TfsClientFuture tfs_client_future_new(void);
+
+/// @brief Creates a future that fires @p callback once completed
+/// @param callback Callback to fire
+/// @param data Data passed to the callback
+TfsClientFuture tfs_client_future_with_callback(TfsClientFutureCallback callback, void* data);
+
+/// @brief Creates a new asynchronous client connected to the server
+/// @param server_path Path of the server socket
+/// @param capacity Maximum number of requests in flight. Must be at least `1`.
+TfsClientAsyncNewResult tfs_client_async_new(const char* server_path, size_t capacity);
+
+/// @brief Destroys and frees an asynchronous client
+/// @details
+/// Any futures still in flight are completed without a reply.
+void tfs_client_async_destroy(TfsClientAsync* self);
+
+/// @brief Submits a command to the server
+/// @param self
+/// @param command The command to submit
+/// @param future The future to complete once the server replies
+/// @details
+/// If the client already has `capacity` requests in flight, this waits
+/// for one of them to complete, unless called from a callback on the completion
+/// thread, in which case it fails with #TfsClientServerConnectionSendCommandErrorWouldBlock.
+/// The future must remain valid until completed.
+TfsClientAsyncSubmitResult tfs_client_async_submit(
+	TfsClientAsync* self, const TfsCommand* command, TfsClientFuture* future);
+
+/// @brief Submits a lookup of @p path to the server, or answers it from the cache
+/// @param self
+/// @param path The path to look up
+/// @param future The future to complete once the server replies
+/// @details
+/// If the cache is enabled, and has the result, the future is completed immediately.
+/// Otherwise, the server is asked for a lease on the result, which is then cached.
+/// Callers that require strict consistency should disable the cache, or submit
+/// lookups with #tfs_client_async_submit instead.
+TfsClientAsyncSubmitResult tfs_client_async_submit_lookup(
+	TfsClientAsync* self, TfsPath path, TfsClientFuture* future);
+
+/// @brief Waits until @p future is completed
+/// @param self
+/// @param future A future submitted to this client
+/// @return If the server replied
+bool tfs_client_async_wait(TfsClientAsync* self, TfsClientFuture* future);
+
+/// @brief Checks if @p future is completed, without waiting
+/// @param self
+/// @param future A future submitted to this client
+bool tfs_client_async_is_done(TfsClientAsync* self, const TfsClientFuture* future);
+
+#endif
@@ -0,0 +1,162 @@
+#include "cache.h"
+
+// Imports
+#include <assert.h>	  // assert
+#include <stdio.h>	  // fprintf, stderr
+#include <stdlib.h>	  // calloc, malloc, free, exit, EXIT_FAILURE
+#include <string.h>	  // memcmp, memcpy
+#include <tfs/util.h> // tfs_hash_bytes, tfs_now_ns
+#include <time.h>	  // CLOCK_MONOTONIC
+
+/// @brief Maximum length of a cached path
+#define MAX_PATH_LEN 1024
+
+/// @brief Writes the components of @p path, separated by a single slash, to @p buffer
+/// @return Length written, or `(size_t)-1` if it doesn't fit in #MAX_PATH_LEN bytes.
+/// @details
+/// All paths equal by #tfs_path_eq are written the same way.
+static size_t normalize(TfsPath path, char* buffer) {
+	size_t len = 0;
+	while (1) {
+		TfsPath component = tfs_path_pop_first(path, &path);
+		if (component.len == 0) { return len; }
+
+		if (len + 1 + component.len > MAX_PATH_LEN) { return (size_t)-1; }
+		if (len != 0) { buffer[len++] = '/'; }
+		memcpy(buffer + len, component.chars, component.len);
+		len += component.len;
+	}
+}
+
+/// @brief Returns the slot of a normalized path
+static size_t slot_of(const TfsClientCache* self, const char* path, size_t path_len) {
+	return (size_t)(tfs_hash_bytes(TFS_HASH_SEED, path, path_len) % self->capacity);
+}
+
+/// @brief Empties an entry
+static void clear_entry(TfsClientCacheEntry* entry) {
+	free(entry->path);
+	entry->path = NULL;
+	entry->path_len = 0;
+}
+
+TfsClientCache tfs_client_cache_new(size_t capacity) {
+	assert(capacity >= 1);
+
+	TfsClientCache cache = {
+		.entries = calloc(capacity, sizeof(TfsClientCacheEntry)),
+		.capacity = capacity,
+		.enabled = false,
+		.generation = 0,
+		.stats = {.hits = 0, .misses = 0, .invalidations = 0},
+		.lock = tfs_mutex_new(),
+	};
+	if (cache.entries == NULL) {
+		fprintf(stderr, "Unable to allocate cache with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	return cache;
+}
+
+void tfs_client_cache_destroy(TfsClientCache* self) {
+	for (size_t n = 0; n < self->capacity; n++) { clear_entry(&self->entries[n]); }
+	free(self->entries);
+	tfs_mutex_destroy(&self->lock);
+}
+
+void tfs_client_cache_set_enabled(TfsClientCache* self, bool enabled) {
+	tfs_mutex_lock(&self->lock);
+	self->enabled = enabled;
+	if (!enabled) {
+		for (size_t n = 0; n < self->capacity; n++) { clear_entry(&self->entries[n]); }
+	}
+	tfs_mutex_unlock(&self->lock);
+}
+
+bool tfs_client_cache_is_enabled(TfsClientCache* self) {
+	tfs_mutex_lock(&self->lock);
+	bool enabled = self->enabled;
+	tfs_mutex_unlock(&self->lock);
+
+	return enabled;
+}
+
+bool tfs_client_cache_get(TfsClientCache* self, TfsPath path, bool* exists) {
+	char normalized[MAX_PATH_LEN];
+	size_t normalized_len = normalize(path, normalized);
+
+	tfs_mutex_lock(&self->lock);
+	bool hit = false;
+	if (normalized_len != (size_t)-1) {
+		TfsClientCacheEntry* entry = &self->entries[slot_of(self, normalized, normalized_len)];
+		hit = entry->path != NULL && entry->path_len == normalized_len &&
+			  memcmp(entry->path, normalized, normalized_len) == 0 && entry->expires_ns > tfs_now_ns(CLOCK_MONOTONIC);
+		if (hit) { *exists = entry->exists; }
+	}
+	if (hit) { self->stats.hits++; }
+	else {
+		self->stats.misses++;
+	}
+	tfs_mutex_unlock(&self->lock);
+
+	return hit;
+}
+
+TfsClientCacheTicket tfs_client_cache_ticket(TfsClientCache* self) {
+	tfs_mutex_lock(&self->lock);
+	TfsClientCacheTicket ticket = {.generation = self->generation, .sent_ns = tfs_now_ns(CLOCK_MONOTONIC)};
+	tfs_mutex_unlock(&self->lock);
+
+	return ticket;
+}
+
+void tfs_client_cache_insert(
+	TfsClientCache* self, TfsPath path, bool exists, TfsClientCacheTicket ticket, uint32_t lease_ms) {
+	char normalized[MAX_PATH_LEN];
+	size_t normalized_len = normalize(path, normalized);
+	if (normalized_len == (size_t)-1 || lease_ms == 0) { return; }
+
+	char* entry_path = malloc(normalized_len == 0 ? 1 : normalized_len);
+	if (entry_path == NULL) { return; }
+	memcpy(entry_path, normalized, normalized_len);
+
+	// Note: The lease started after we sent the lookup, so expiring it from then on is safe.
+	tfs_mutex_lock(&self->lock);
+	if (!self->enabled || self->generation != ticket.generation) {
+		tfs_mutex_unlock(&self->lock);
+		free(entry_path);
+		return;
+	}
+	TfsClientCacheEntry* entry = &self->entries[slot_of(self, normalized, normalized_len)];
+	clear_entry(entry);
+	*entry = (TfsClientCacheEntry){
+		.path = entry_path,
+		.path_len = normalized_len,
+		.exists = exists,
+		.expires_ns = ticket.sent_ns + (uint64_t)lease_ms * 1000000u,
+	};
+	tfs_mutex_unlock(&self->lock);
+}
+
+void tfs_client_cache_invalidate(TfsClientCache* self, TfsPath path) {
+	tfs_mutex_lock(&self->lock);
+	self->generation++;
+	self->stats.invalidations++;
+	for (size_t n = 0; n < self->capacity; n++) {
+		TfsClientCacheEntry* entry = &self->entries[n];
+		if (entry->path == NULL) { continue; }
+
+		TfsPath entry_path = {.chars = entry->path, .len = entry->path_len};
+		if (tfs_path_starts_with(entry_path, path)) { clear_entry(entry); }
+	}
+	tfs_mutex_unlock(&self->lock);
+}
+
+TfsClientCacheStats tfs_client_cache_stats(TfsClientCache* self) {
+	tfs_mutex_lock(&self->lock);
+	TfsClientCacheStats stats = self->stats;
+	tfs_mutex_unlock(&self->lock);
+
+	return stats;
+}
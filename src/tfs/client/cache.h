@@ -0,0 +1,127 @@
+/// @file
+/// @brief Client lookup cache
+/// @details
+/// This file defines the #TfsClientCache type, which caches the
+/// results of lookups for as long as the server leases them.
+///
+/// The cache is direct-mapped, with each path having a single slot,
+/// chosen by a hash of it's components, so a lookup only ever checks
+/// one entry, and a new entry simply replaces whichever was in it's slot.
+///
+/// As an invalidation may arrive before the reply of a lookup that
+/// started before it, every lookup takes a #TfsClientCacheTicket when
+/// sent, and it's result is only cached if no invalidations arrived since.
+
+#ifndef TFS_CLIENT_CACHE_H
+#define TFS_CLIENT_CACHE_H
+
+// Imports
+#include <stdbool.h>   // bool
+#include <stddef.h>	   // size_t
+#include <stdint.h>	   // uint32_t, uint64_t
+#include <tfs/mutex.h> // TfsMutex
+#include <tfs/path.h>  // TfsPath
+
+/// @brief Default number of entries in the cache
+#define TFS_CLIENT_CACHE_DEFAULT_CAPACITY 1024
+
+/// @brief Cache statistics
+typedef struct TfsClientCacheStats {
+	/// @brief Number of lookups answered by the cache
+	uint64_t hits;
+
+	/// @brief Number of lookups sent to the server
+	uint64_t misses;
+
+	/// @brief Number of invalidations received
+	uint64_t invalidations;
+} TfsClientCacheStats;
+
+/// @brief A cache entry
+typedef struct TfsClientCacheEntry {
+	/// @brief Path of the entry, with it's components separated by a single slash, or `NULL` if empty
+	char* path;
+
+	/// @brief Length of the path
+	size_t path_len;
+
+	/// @brief If the path exists
+	bool exists;
+
+	/// @brief Time the entry expires at, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t expires_ns;
+} TfsClientCacheEntry;
+
+/// @brief Taken before sending a lookup, to validate it's result
+typedef struct TfsClientCacheTicket {
+	/// @brief Number of invalidations received before the lookup was sent
+	uint64_t generation;
+
+	/// @brief Time the lookup was sent at, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t sent_ns;
+} TfsClientCacheTicket;
+
+/// @brief The lookup cache
+typedef struct TfsClientCache {
+	/// @brief All entries
+	TfsClientCacheEntry* entries;
+
+	/// @brief Number of entries
+	size_t capacity;
+
+	/// @brief If enabled
+	bool enabled;
+
+	/// @brief Number of invalidations received
+	uint64_t generation;
+
+	/// @brief Statistics
+	TfsClientCacheStats stats;
+
+	/// @brief Lock over the whole cache
+	TfsMutex lock;
+} TfsClientCache;
+
+/// @brief Creates a new, disabled, cache
+/// @param capacity Number of entries. Must be at least `1`.
+TfsClientCache tfs_client_cache_new(size_t capacity);
+
+/// @brief Destroys a cache
+void tfs_client_cache_destroy(TfsClientCache* self);
+
+/// @brief Enables or disables the cache
+/// @details
+/// Disabling the cache drops all of it's entries.
+void tfs_client_cache_set_enabled(TfsClientCache* self, bool enabled);
+
+/// @brief Checks if the cache is enabled
+bool tfs_client_cache_is_enabled(TfsClientCache* self);
+
+/// @brief Looks up @p path in the cache
+/// @param self
+/// @param path The path to look up
+/// @param[out] exists If the path exists, on a hit
+/// @return If the cache had an unexpired entry for @p path
+bool tfs_client_cache_get(TfsClientCache* self, TfsPath path, bool* exists);
+
+/// @brief Takes a ticket before sending a lookup
+TfsClientCacheTicket tfs_client_cache_ticket(TfsClientCache* self);
+
+/// @brief Caches the result of a lookup
+/// @param self
+/// @param path The path looked up
+/// @param exists If the path exists
+/// @param ticket Ticket taken before sending the lookup
+/// @param lease_ms Duration of the lease granted on the result, in milliseconds
+/// @details
+/// If any invalidation arrived since @p ticket was taken, nothing is cached.
+void tfs_client_cache_insert(
+	TfsClientCache* self, TfsPath path, bool exists, TfsClientCacheTicket ticket, uint32_t lease_ms);
+
+/// @brief Invalidates @p path, and every path within it
+void tfs_client_cache_invalidate(TfsClientCache* self, TfsPath path);
+
+/// @brief Returns the statistics of the cache
+TfsClientCacheStats tfs_client_cache_stats(TfsClientCache* self);
+
+#endif
@@ -1,8 +1,9 @@
 #include "command.h"
 
 // Includes
-#include <stdlib.h> // free
-#include <string.h> // strlen
+#include <ctype.h>	// isspace
+#include <stdlib.h>	// free
+#include <string.h>	// strlen, strndup
 
 void tfs_command_parse_error_print(const TfsCommandParseError* self, FILE* out) {
 	switch (self->kind) {
@@ -47,27 +48,29 @@ void tfs_command_parse_error_print(const TfsCommandParseError* self, FILE* out)
 	}
 }
 
-TfsCommandParseResult tfs_command_parse(FILE* in) {
-	// Read a line
-	char line[1024];
-	if (fgets(line, sizeof(line), in) == NULL) {
-		return (TfsCommandParseResult){
-			.success = false,
-			.data.err.kind = TfsCommandParseErrorReadLine,
-		};
-	}
+/// @brief An argument of a command
+typedef struct CommandArg {
+	/// @brief All characters, not nul-terminated
+	char* chars;
 
-	// Read the arguments
-	char command_char;
-	char args[2][1024];
-	int tokens_read = sscanf(line, " %c %1023s %1023s", &command_char, args[0], args[1]);
-	if (tokens_read < 1) {
-		return (TfsCommandParseResult){
-			.success = false,
-			.data.err.kind = TfsCommandParseErrorNoCommand,
-		};
-	}
+	/// @brief Number of characters
+	size_t len;
+} CommandArg;
 
+/// @brief Returns the path of an argument, borrowing or copying it
+static TfsPathOwned arg_path(CommandArg arg, bool borrow) {
+	if (borrow) { return (TfsPathOwned){.chars = arg.chars, .len = arg.len}; }
+	return tfs_path_to_owned((TfsPath){.chars = arg.chars, .len = arg.len});
+}
+
+/// @brief Builds a command from it's tokens
+/// @param command_char The command's kind
+/// @param tokens_read Number of tokens read, including @p command_char
+/// @param args The arguments read
+/// @param borrow If the command should borrow it's paths from @p args, rather than copy them
+/// @details
+/// When borrowing, the byte after a print's path is overwritten with a nul terminator.
+static TfsCommandParseResult parse_tokens(char command_char, int tokens_read, const CommandArg args[2], bool borrow) {
 	switch (command_char) {
 		// Create path
 		// c <path> <inode-type>
@@ -81,16 +84,15 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 
 			// Get the type of what we're creating
 			TfsInodeType inode_type;
-			size_t type_len = strlen(args[1]);
-			if (type_len != 1) {
+			if (args[1].len != 1) {
 				return (TfsCommandParseResult){
 					.success = false,
 					.data.err.kind = TfsCommandParseErrorInvalidType,
 					.data.err.data.invalid_type.type = '\0',
-					.data.err.data.invalid_type.len = type_len,
+					.data.err.data.invalid_type.len = args[1].len,
 				};
 			}
-			switch (args[1][0]) {
+			switch (args[1].chars[0]) {
 				case 'f': {
 					inode_type = TfsInodeTypeFile;
 					break;
@@ -103,18 +105,18 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 					return (TfsCommandParseResult){
 						.success = false,
 						.data.err.kind = TfsCommandParseErrorInvalidType,
-						.data.err.data.invalid_type.type = args[1][0],
+						.data.err.data.invalid_type.type = args[1].chars[0],
 						.data.err.data.invalid_type.len = 1,
 					};
 				}
 			}
 
-			TfsPathOwned path = tfs_path_to_owned(tfs_path_from_cstr(args[0]));
 			return (TfsCommandParseResult){
 				.success = true,
 				.data.command.kind = TfsCommandCreate,
-				.data.command.data.create.path = path,
+				.data.command.data.create.path = arg_path(args[0], borrow),
 				.data.command.data.create.type = inode_type,
+				.data.command.borrowed = borrow,
 			};
 		}
 
@@ -128,11 +130,11 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 				};
 			}
 
-			TfsPathOwned path = tfs_path_to_owned(tfs_path_from_cstr(args[0]));
 			return (TfsCommandParseResult){
 				.success = true,
 				.data.command.kind = TfsCommandSearch,
-				.data.command.data.search.path = path,
+				.data.command.data.search.path = arg_path(args[0], borrow),
+				.data.command.borrowed = borrow,
 			};
 		}
 
@@ -146,11 +148,11 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 				};
 			}
 
-			TfsPathOwned path = tfs_path_to_owned(tfs_path_from_cstr(args[0]));
 			return (TfsCommandParseResult){
 				.success = true,
 				.data.command.kind = TfsCommandRemove,
-				.data.command.data.remove.path = path,
+				.data.command.data.remove.path = arg_path(args[0], borrow),
+				.data.command.borrowed = borrow,
 			};
 		}
 
@@ -164,13 +166,12 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 				};
 			}
 
-			TfsPathOwned source = tfs_path_to_owned(tfs_path_from_cstr(args[0]));
-			TfsPathOwned dest = tfs_path_to_owned(tfs_path_from_cstr(args[1]));
 			return (TfsCommandParseResult){
 				.success = true,
 				.data.command.kind = TfsCommandMove,
-				.data.command.data.move.source = source,
-				.data.command.data.move.dest = dest,
+				.data.command.data.move.source = arg_path(args[0], borrow),
+				.data.command.data.move.dest = arg_path(args[1], borrow),
+				.data.command.borrowed = borrow,
 			};
 		}
 		// Print path
@@ -183,28 +184,90 @@ TfsCommandParseResult tfs_command_parse(FILE* in) {
 				};
 			}
 
-			char* path = strdup(args[0]);
+			char* path = args[0].chars;
+			if (borrow) { path[args[0].len] = '\0'; }
+			else {
+				path = strndup(path, args[0].len);
+			}
 			return (TfsCommandParseResult){
 				.success = true,
 				.data.command.kind = TfsCommandPrint,
 				.data.command.data.print.path = path,
+				.data.command.borrowed = borrow,
 			};
 		}
 
 		default: {
 			return (TfsCommandParseResult){
 				.success = false,
-				.data.command.kind = TfsCommandParseErrorInvalidCommand,
+				.data.err.kind = TfsCommandParseErrorInvalidCommand,
 				.data.err.data.invalid_command.command = command_char,
 			};
 		}
 	}
 }
 
-void tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffer_len) {
+TfsCommandParseResult tfs_command_parse(FILE* in) {
+	// Read a line
+	char line[1024];
+	if (fgets(line, sizeof(line), in) == NULL) {
+		return (TfsCommandParseResult){
+			.success = false,
+			.data.err.kind = TfsCommandParseErrorReadLine,
+		};
+	}
+
+	// Read the arguments
+	char command_char;
+	char args[2][1024];
+	int tokens_read = sscanf(line, " %c %1023s %1023s", &command_char, args[0], args[1]);
+	if (tokens_read < 1) {
+		return (TfsCommandParseResult){
+			.success = false,
+			.data.err.kind = TfsCommandParseErrorNoCommand,
+		};
+	}
+
+	CommandArg command_args[2] = {
+		{.chars = args[0], .len = tokens_read >= 2 ? strlen(args[0]) : 0},
+		{.chars = args[1], .len = tokens_read >= 3 ? strlen(args[1]) : 0},
+	};
+	return parse_tokens(command_char, tokens_read, command_args, false);
+}
+
+TfsCommandParseResult tfs_command_parse_line(char* line, size_t line_len) {
+	// Split the line into the command and up to 2 arguments, at any whitespace
+	// Note: Just like with `sscanf`, the command needn't be followed by whitespace.
+	size_t pos = 0;
+	while (pos < line_len && isspace((unsigned char)line[pos])) { pos++; }
+	if (pos == line_len) {
+		return (TfsCommandParseResult){
+			.success = false,
+			.data.err.kind = TfsCommandParseErrorNoCommand,
+		};
+	}
+	char command_char = line[pos++];
+
+	int tokens_read = 1;
+	CommandArg args[2] = {{.chars = NULL, .len = 0}, {.chars = NULL, .len = 0}};
+	for (size_t n = 0; n < 2; n++) {
+		while (pos < line_len && isspace((unsigned char)line[pos])) { pos++; }
+		if (pos == line_len) { break; }
+
+		size_t start = pos;
+		while (pos < line_len && !isspace((unsigned char)line[pos])) { pos++; }
+		args[n] = (CommandArg){.chars = line + start, .len = pos - start};
+		tokens_read++;
+	}
+
+	return parse_tokens(command_char, tokens_read, args, true);
+}
+
+size_t tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffer_len) {
+	int len = 0;
 	switch (command->kind) {
 		case TfsCommandCreate: {
-			snprintf(buffer,
+			len = snprintf(buffer,
 				buffer_len,
 				"c %.*s %c",
 				(int)command->data.create.path.len,
@@ -214,15 +277,15 @@ void tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffe
 			break;
 		}
 		case TfsCommandSearch: {
-			snprintf(buffer, buffer_len, "l %.*s", (int)command->data.search.path.len, command->data.search.path.chars);
+			len = snprintf(buffer, buffer_len, "l %.*s", (int)command->data.search.path.len, command->data.search.path.chars);
 			break;
 		}
 		case TfsCommandRemove: {
-			snprintf(buffer, buffer_len, "d %.*s", (int)command->data.remove.path.len, command->data.remove.path.chars);
+			len = snprintf(buffer, buffer_len, "d %.*s", (int)command->data.remove.path.len, command->data.remove.path.chars);
 			break;
 		}
 		case TfsCommandMove: {
-			snprintf(buffer,
+			len = snprintf(buffer,
 				buffer_len,
 				"m %.*s %.*s",
 				(int)command->data.move.source.len,
@@ -233,16 +296,20 @@ void tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffe
 			break;
 		}
 		case TfsCommandPrint: {
-			snprintf(buffer, buffer_len, "p %s", command->data.print.path);
+			len = snprintf(buffer, buffer_len, "p %s", command->data.print.path);
 			break;
 		}
 		default: {
 			break;
 		}
 	}
+
+	return len < 0 ? 0 : (size_t)len;
 }
 
 void tfs_command_destroy(TfsCommand* command) {
+	if (command->borrowed) { return; }
+
 	switch (command->kind) {
 		case TfsCommandCreate: {
 			tfs_path_owned_destroy(&command->data.create.path);
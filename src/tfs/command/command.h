@@ -8,8 +8,9 @@
 #define TFS_COMMAND_COMMAND_H
 
 // Includes
+#include <stdbool.h>		// bool
 #include <stdio.h>			// FILE
-#include <tfs/inode/type.h> // TfsInodeType
+#include <tfs/inode/type.h>	// TfsInodeType
 #include <tfs/path.h>		// TfsPathOwned
 
 /// @brief All executable commands
@@ -83,6 +84,11 @@ typedef struct TfsCommand {
 			char* path;
 		} print;
 	} data;
+
+	/// @brief If the paths are borrowed, rather than owned
+	/// @details
+	/// Borrowed paths are never freed by #tfs_command_destroy.
+	bool borrowed;
 } TfsCommand;
 
 /// @brief Error type for #tfs_command_parse
@@ -160,8 +166,21 @@ void tfs_command_parse_error_print(const TfsCommandParseError* self, FILE* out);
 /// @param in The file to read from
 TfsCommandParseResult tfs_command_parse(FILE* in);
 
+/// @brief Parses a command from a line, borrowing it's paths from it
+/// @param line The line, without it's newline, followed by at least one writable byte
+/// @param line_len Length of @p line
+/// @details
+/// Unlike #tfs_command_parse, the line and it's paths may have any length.
+/// The command returned borrows it's paths from @p line, so it must outlive
+/// it. The byte after a print's path is overwritten with a nul terminator.
+TfsCommandParseResult tfs_command_parse_line(char* line, size_t line_len);
+
 /// @brief Serializes this command to a string
-void tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffer_len);
+/// @return Length of the whole string, without the nul terminator
+/// @details
+/// Just like `snprintf`, if the returned length is at least @p buffer_len,
+/// the string didn't fit, and only it's start was written.
+size_t tfs_command_to_string(const TfsCommand* command, char* buffer, size_t buffer_len);
 
 /// @brief Destroys a command
 void tfs_command_destroy(TfsCommand* command);
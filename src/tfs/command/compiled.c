@@ -0,0 +1,345 @@
+#include "compiled.h"
+
+// Imports
+#include <errno.h>	  // errno, EOVERFLOW
+#include <stdlib.h>	  // malloc, realloc, free, exit, EXIT_FAILURE
+#include <string.h>	  // memcmp, memcpy, strlen
+#include <tfs/path.h> // TfsPathOwned
+#include <tfs/util.h> // tfs_str_eq, tfs_hash_bytes, tfs_buckets_*
+
+/// @brief Initial number of buckets of the string table
+#define STRINGS_INITIAL_BUCKETS 64
+
+/// @brief Distinct strings, while compiling
+typedef struct Strings {
+	/// @brief Characters of each string, borrowed from a command
+	const char** chars;
+
+	/// @brief Length of each string
+	size_t* lens;
+
+	/// @brief Number of strings
+	size_t len;
+
+	/// @brief String of each bucket, or #TFS_BUCKET_EMPTY
+	/// @details
+	/// Buckets are probed linearly, and kept at most half full.
+	uint32_t* buckets;
+
+	/// @brief Number of buckets
+	size_t buckets_len;
+} Strings;
+
+void tfs_command_compiled_open_error_print(const TfsCommandCompiledOpenError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsCommandCompiledOpenErrorHeader: {
+			fprintf(out, "Missing compiled command file header, or of an unknown version\n");
+			break;
+		}
+		case TfsCommandCompiledOpenErrorTruncated: {
+			fprintf(out, "Compiled command file is truncated\n");
+			break;
+		}
+		case TfsCommandCompiledOpenErrorInvalidString: {
+			fprintf(out, "Invalid string #%zu in compiled command file\n", self->data.invalid.idx);
+			break;
+		}
+		case TfsCommandCompiledOpenErrorInvalidRecord: {
+			fprintf(out, "Invalid record #%zu in compiled command file\n", self->data.invalid.idx);
+			break;
+		}
+
+		default: {
+			break;
+		}
+	}
+}
+
+bool tfs_command_compiled_is(const char* contents, size_t contents_len) {
+	return contents_len >= sizeof(TfsCommandCompiledHeader) &&
+		   memcmp(contents, TFS_COMMAND_COMPILED_MAGIC, sizeof(TFS_COMMAND_COMPILED_MAGIC)) == 0;
+}
+
+/// @brief Checks if @p idx is the index of a string
+static bool valid_path(const TfsCommandCompiled* self, uint32_t idx) {
+	return idx < self->strings_len;
+}
+
+/// @brief Checks if a record is valid
+static bool valid_record(const TfsCommandCompiled* self, const TfsCommandCompiledRecord* record) {
+	switch (record->kind) {
+		case 'c': return (record->type == 'f' || record->type == 'd') && valid_path(self, record->path);
+		case 'l':
+		case 'd':
+		case 'p': return valid_path(self, record->path);
+		case 'm': return valid_path(self, record->path) && valid_path(self, record->dest);
+		default: return false;
+	}
+}
+
+TfsCommandCompiledOpenResult tfs_command_compiled_open(char* contents, size_t contents_len) {
+	if (!tfs_command_compiled_is(contents, contents_len)) {
+		return (TfsCommandCompiledOpenResult){
+			.success = false,
+			.data.err.kind = TfsCommandCompiledOpenErrorHeader,
+		};
+	}
+	TfsCommandCompiledHeader header;
+	memcpy(&header, contents, sizeof(header));
+	if (header.version != TFS_COMMAND_COMPILED_VERSION) {
+		return (TfsCommandCompiledOpenResult){
+			.success = false,
+			.data.err.kind = TfsCommandCompiledOpenErrorHeader,
+		};
+	}
+
+	// Check every section fits in what's left
+	// Note: Lengths are compared by division, so a corrupt header can't overflow them.
+	size_t remaining = contents_len - sizeof(header);
+	bool fits = header.commands_len <= remaining / sizeof(TfsCommandCompiledRecord);
+	if (fits) {
+		remaining -= (size_t)header.commands_len * sizeof(TfsCommandCompiledRecord);
+		fits = header.strings_len <= remaining / sizeof(TfsCommandCompiledString);
+	}
+	if (fits) {
+		remaining -= (size_t)header.strings_len * sizeof(TfsCommandCompiledString);
+		fits = header.chars_len <= remaining;
+	}
+	if (!fits) {
+		return (TfsCommandCompiledOpenResult){
+			.success = false,
+			.data.err.kind = TfsCommandCompiledOpenErrorTruncated,
+		};
+	}
+
+	// Note: Sections are all multiples of 8 bytes long, so each stays as aligned as the contents.
+	char* records = contents + sizeof(header);
+	char* strings = records + header.commands_len * sizeof(TfsCommandCompiledRecord);
+	char* chars = strings + header.strings_len * sizeof(TfsCommandCompiledString);
+	TfsCommandCompiled compiled = {
+		.records = (const void*)records,
+		.len = (size_t)header.commands_len,
+		.strings = (const void*)strings,
+		.strings_len = (size_t)header.strings_len,
+		.chars = chars,
+	};
+
+	// Then validate all strings and records, so getting them never fails
+	for (size_t n = 0; n < compiled.strings_len; n++) {
+		const TfsCommandCompiledString* string = &compiled.strings[n];
+		if (string->offset >= header.chars_len || string->len >= header.chars_len - string->offset ||
+			chars[string->offset + string->len] != '\0') {
+			return (TfsCommandCompiledOpenResult){
+				.success = false,
+				.data.err.kind = TfsCommandCompiledOpenErrorInvalidString,
+				.data.err.data.invalid.idx = n,
+			};
+		}
+	}
+	for (size_t n = 0; n < compiled.len; n++) {
+		if (!valid_record(&compiled, &compiled.records[n])) {
+			return (TfsCommandCompiledOpenResult){
+				.success = false,
+				.data.err.kind = TfsCommandCompiledOpenErrorInvalidRecord,
+				.data.err.data.invalid.idx = n,
+			};
+		}
+	}
+
+	return (TfsCommandCompiledOpenResult){
+		.success = true,
+		.data.compiled = compiled,
+	};
+}
+
+/// @brief Returns the string @p idx as a path
+static TfsPathOwned get_path(const TfsCommandCompiled* self, uint32_t idx) {
+	const TfsCommandCompiledString* string = &self->strings[idx];
+	return (TfsPathOwned){.chars = self->chars + string->offset, .len = (size_t)string->len};
+}
+
+TfsCommand tfs_command_compiled_get(const TfsCommandCompiled* self, size_t idx) {
+	const TfsCommandCompiledRecord* record = &self->records[idx];
+	switch (record->kind) {
+		case 'c': {
+			return (TfsCommand){
+				.kind = TfsCommandCreate,
+				.data.create.path = get_path(self, record->path),
+				.data.create.type = record->type == 'f' ? TfsInodeTypeFile : TfsInodeTypeDir,
+				.borrowed = true,
+			};
+		}
+		case 'l': {
+			return (TfsCommand){
+				.kind = TfsCommandSearch,
+				.data.search.path = get_path(self, record->path),
+				.borrowed = true,
+			};
+		}
+		case 'd': {
+			return (TfsCommand){
+				.kind = TfsCommandRemove,
+				.data.remove.path = get_path(self, record->path),
+				.borrowed = true,
+			};
+		}
+		case 'm': {
+			return (TfsCommand){
+				.kind = TfsCommandMove,
+				.data.move.source = get_path(self, record->path),
+				.data.move.dest = get_path(self, record->dest),
+				.borrowed = true,
+			};
+		}
+
+		// Note: Records were all validated when opened, so anything else is a print.
+		case 'p':
+		default: {
+			return (TfsCommand){
+				.kind = TfsCommandPrint,
+				.data.print.path = get_path(self, record->path).chars,
+				.borrowed = true,
+			};
+		}
+	}
+}
+
+/// @brief Resizes the buckets of @p strings, re-adding all strings
+static void strings_rehash(Strings* strings, size_t buckets_len) {
+	free(strings->buckets);
+	strings->buckets = malloc(buckets_len * sizeof(uint32_t));
+	strings->chars = realloc(strings->chars, buckets_len / 2 * sizeof(const char*));
+	strings->lens = realloc(strings->lens, buckets_len / 2 * sizeof(size_t));
+	if (strings->buckets == NULL || strings->chars == NULL || strings->lens == NULL) {
+		fprintf(stderr, "Unable to allocate strings\n");
+		exit(EXIT_FAILURE);
+	}
+	strings->buckets_len = buckets_len;
+
+	tfs_buckets_clear(strings->buckets, buckets_len);
+	for (size_t n = 0; n < strings->len; n++) {
+		uint64_t hash = tfs_hash_bytes(TFS_HASH_SEED, strings->chars[n], strings->lens[n]);
+		strings->buckets[tfs_buckets_find_empty(strings->buckets, buckets_len, hash)] = (uint32_t)n;
+	}
+}
+
+/// @brief Returns the index of a string, adding it if it's not yet in @p strings
+/// @return If found or added, or `false` if there are too many strings
+static bool strings_intern(Strings* strings, const char* chars, size_t len, uint32_t* idx) {
+	size_t bucket = (size_t)(tfs_hash_bytes(TFS_HASH_SEED, chars, len) % strings->buckets_len);
+	while (strings->buckets[bucket] != TFS_BUCKET_EMPTY) {
+		uint32_t cur = strings->buckets[bucket];
+		if (tfs_str_eq(strings->chars[cur], strings->lens[cur], chars, len)) {
+			*idx = cur;
+			return true;
+		}
+		bucket = (bucket + 1) % strings->buckets_len;
+	}
+
+	// Note: The last index is reserved for `TFS_COMMAND_COMPILED_NO_PATH`.
+	if (strings->len >= TFS_COMMAND_COMPILED_NO_PATH) { return false; }
+	*idx = (uint32_t)strings->len;
+	strings->buckets[bucket] = *idx;
+	strings->chars[strings->len] = chars;
+	strings->lens[strings->len] = len;
+	strings->len++;
+	if (2 * strings->len >= strings->buckets_len) { strings_rehash(strings, 2 * strings->buckets_len); }
+
+	return true;
+}
+
+/// @brief Builds the record of a command, adding it's paths to @p strings
+/// @return If built, or `false` if there are too many strings
+static bool build_record(const TfsCommand* command, size_t line, Strings* strings, TfsCommandCompiledRecord* record) {
+	*record = (TfsCommandCompiledRecord){
+		.kind = 0,
+		.type = 0,
+		.reserved = 0,
+		.line = (uint32_t)line,
+		.path = TFS_COMMAND_COMPILED_NO_PATH,
+		.dest = TFS_COMMAND_COMPILED_NO_PATH,
+	};
+
+	switch (command->kind) {
+		case TfsCommandCreate: {
+			record->kind = 'c';
+			record->type = command->data.create.type == TfsInodeTypeFile ? 'f' : 'd';
+			TfsPathOwned path = command->data.create.path;
+			return strings_intern(strings, path.chars, path.len, &record->path);
+		}
+		case TfsCommandSearch: {
+			record->kind = 'l';
+			TfsPathOwned path = command->data.search.path;
+			return strings_intern(strings, path.chars, path.len, &record->path);
+		}
+		case TfsCommandRemove: {
+			record->kind = 'd';
+			TfsPathOwned path = command->data.remove.path;
+			return strings_intern(strings, path.chars, path.len, &record->path);
+		}
+		case TfsCommandMove: {
+			record->kind = 'm';
+			TfsPathOwned source = command->data.move.source;
+			TfsPathOwned dest = command->data.move.dest;
+			return strings_intern(strings, source.chars, source.len, &record->path) &&
+				   strings_intern(strings, dest.chars, dest.len, &record->dest);
+		}
+		case TfsCommandPrint:
+		default: {
+			record->kind = 'p';
+			const char* path = command->data.print.path;
+			return strings_intern(strings, path, strlen(path), &record->path);
+		}
+	}
+}
+
+bool tfs_command_compiled_write(const TfsCommand* commands, const size_t* lines, size_t len, FILE* out) {
+	// Build all records, gathering the distinct strings
+	Strings strings = {.chars = NULL, .lens = NULL, .len = 0, .buckets = NULL, .buckets_len = 0};
+	strings_rehash(&strings, STRINGS_INITIAL_BUCKETS);
+	TfsCommandCompiledRecord* records = malloc(len * sizeof(TfsCommandCompiledRecord) + 1);
+	if (records == NULL) {
+		fprintf(stderr, "Unable to allocate records\n");
+		exit(EXIT_FAILURE);
+	}
+
+	bool built = true;
+	for (size_t n = 0; n < len && built; n++) {
+		built = lines[n] <= UINT32_MAX && build_record(&commands[n], lines[n], &strings, &records[n]);
+	}
+
+	// Then write everything, laying out the strings one after the other
+	bool written = false;
+	if (built) {
+		TfsCommandCompiledHeader header = {
+			.magic = TFS_COMMAND_COMPILED_MAGIC,
+			.version = TFS_COMMAND_COMPILED_VERSION,
+			.reserved = 0,
+			.commands_len = len,
+			.strings_len = strings.len,
+			.chars_len = 0,
+		};
+		for (size_t n = 0; n < strings.len; n++) { header.chars_len += strings.lens[n] + 1; }
+
+		written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+				  fwrite(records, sizeof(TfsCommandCompiledRecord), len, out) == len;
+		uint64_t offset = 0;
+		for (size_t n = 0; n < strings.len && written; n++) {
+			TfsCommandCompiledString string = {.offset = offset, .len = strings.lens[n]};
+			written = fwrite(&string, sizeof(string), 1, out) == 1;
+			offset += strings.lens[n] + 1;
+		}
+		for (size_t n = 0; n < strings.len && written; n++) {
+			written = fwrite(strings.chars[n], 1, strings.lens[n], out) == strings.lens[n] && fputc('\0', out) == 0;
+		}
+	}
+	else {
+		errno = EOVERFLOW;
+	}
+
+	free(records);
+	free(strings.buckets);
+	free(strings.lens);
+	free(strings.chars);
+	return written;
+}
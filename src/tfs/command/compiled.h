@@ -0,0 +1,182 @@
+/// @file
+/// @brief Compiled command files
+/// @details
+/// This file defines the #TfsCommandCompiled type, a binary form of a command
+/// file, which commands are read from without any parsing.
+///
+/// A compiled command file consists of, in order:
+/// - A #TfsCommandCompiledHeader.
+/// - A #TfsCommandCompiledRecord for each command.
+/// - A #TfsCommandCompiledString for each distinct path.
+/// - The characters of all paths, each followed by a nul byte.
+///
+/// Records refer to their paths by their index, so each distinct path is only
+/// stored once, however many commands use it. All integers are in the host's
+/// byte order, so compiled files are only meant to be replayed on the host that
+/// compiled them, or one just like it.
+///
+/// #tfs_command_file_parse loads compiled command files in place of text ones,
+/// so they may be used anywhere a command file is.
+
+#ifndef TFS_COMMAND_COMPILED_H
+#define TFS_COMMAND_COMPILED_H
+
+// Imports
+#include <stdbool.h>			 // bool
+#include <stddef.h>				 // size_t
+#include <stdint.h>				 // uint8_t, uint16_t, uint32_t, uint64_t
+#include <stdio.h>				 // FILE
+#include <tfs/command/command.h> // TfsCommand
+
+/// @brief Magic bytes that start all compiled command files, including the nul terminator
+#define TFS_COMMAND_COMPILED_MAGIC "TFSCMDC"
+
+/// @brief Version of the format written by #tfs_command_compiled_write
+#define TFS_COMMAND_COMPILED_VERSION 1
+
+/// @brief Path index of records without a path
+#define TFS_COMMAND_COMPILED_NO_PATH UINT32_MAX
+
+/// @brief Header of a compiled command file
+typedef struct TfsCommandCompiledHeader {
+	/// @brief #TFS_COMMAND_COMPILED_MAGIC
+	char magic[8];
+
+	/// @brief #TFS_COMMAND_COMPILED_VERSION
+	uint32_t version;
+
+	/// @brief Reserved, always `0`
+	uint32_t reserved;
+
+	/// @brief Number of records
+	uint64_t commands_len;
+
+	/// @brief Number of strings
+	uint64_t strings_len;
+
+	/// @brief Number of characters of all strings, including their nul bytes
+	uint64_t chars_len;
+} TfsCommandCompiledHeader;
+
+/// @brief A command in a compiled command file
+typedef struct TfsCommandCompiledRecord {
+	/// @brief Command character, just as in a text command
+	uint8_t kind;
+
+	/// @brief Inode type character of a create, or `0`
+	uint8_t type;
+
+	/// @brief Reserved, always `0`
+	uint16_t reserved;
+
+	/// @brief Line of the command in the text command file
+	uint32_t line;
+
+	/// @brief Index of the path
+	uint32_t path;
+
+	/// @brief Index of the destination path of a move, or #TFS_COMMAND_COMPILED_NO_PATH
+	uint32_t dest;
+} TfsCommandCompiledRecord;
+
+/// @brief A path in a compiled command file
+typedef struct TfsCommandCompiledString {
+	/// @brief Offset of the first character, relative to the first of all strings
+	uint64_t offset;
+
+	/// @brief Number of characters, without the nul byte
+	uint64_t len;
+} TfsCommandCompiledString;
+
+/// @brief A compiled command file
+/// @details
+/// All fields borrow from the file's contents.
+typedef struct TfsCommandCompiled {
+	/// @brief All records
+	const TfsCommandCompiledRecord* records;
+
+	/// @brief Number of records
+	size_t len;
+
+	/// @brief All strings
+	const TfsCommandCompiledString* strings;
+
+	/// @brief Number of strings
+	size_t strings_len;
+
+	/// @brief Characters of all strings
+	char* chars;
+} TfsCommandCompiled;
+
+/// @brief Error type for #tfs_command_compiled_open
+typedef struct TfsCommandCompiledOpenError {
+	/// @brief Error kind
+	enum {
+		/// @brief Missing header, or of an unknown version
+		TfsCommandCompiledOpenErrorHeader,
+
+		/// @brief Shorter than the header says
+		TfsCommandCompiledOpenErrorTruncated,
+
+		/// @brief A string lies outside the characters, or isn't nul-terminated
+		TfsCommandCompiledOpenErrorInvalidString,
+
+		/// @brief A record has an invalid kind, type or path
+		TfsCommandCompiledOpenErrorInvalidRecord,
+	} kind;
+
+	/// @brief Error data
+	union {
+		/// @brief Data for `InvalidString` and `InvalidRecord`.
+		struct {
+			/// @brief Index of the string or record
+			size_t idx;
+		} invalid;
+	} data;
+} TfsCommandCompiledOpenError;
+
+/// @brief Result type for #tfs_command_compiled_open
+typedef struct TfsCommandCompiledOpenResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Success compiled file
+		TfsCommandCompiled compiled;
+
+		/// @brief Underlying error
+		TfsCommandCompiledOpenError err;
+	} data;
+} TfsCommandCompiledOpenResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_command_compiled_open_error_print(const TfsCommandCompiledOpenError* self, FILE* out);
+
+/// @brief Checks if @p contents start like a compiled command file
+bool tfs_command_compiled_is(const char* contents, size_t contents_len);
+
+/// @brief Opens a compiled command file, validating all of it
+/// @param contents The file's contents. Must be aligned to 8 bytes, and outlive the compiled file.
+/// @param contents_len Length of @p contents
+/// @details
+/// As every record and string is validated here, #tfs_command_compiled_get
+/// never fails.
+TfsCommandCompiledOpenResult tfs_command_compiled_open(char* contents, size_t contents_len);
+
+/// @brief Returns the command of record @p idx
+/// @details
+/// The command borrows it's paths from the file's contents.
+TfsCommand tfs_command_compiled_get(const TfsCommandCompiled* self, size_t idx);
+
+/// @brief Compiles commands, writing them to @p out
+/// @param commands All commands, in order
+/// @param lines Line of each command
+/// @param len Number of commands
+/// @param out File to write to
+/// @return If written, or `false`, with `errno` set, if unable to
+bool tfs_command_compiled_write(const TfsCommand* commands, const size_t* lines, size_t len, FILE* out);
+
+#endif
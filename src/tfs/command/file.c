@@ -0,0 +1,342 @@
+#include "file.h"
+
+// Imports
+#include <ctype.h>	  // isspace
+#include <errno.h>	  // errno, EINTR
+#include <pthread.h>  // pthread_create, pthread_join
+#include <stdlib.h>	  // malloc, realloc, free, exit, EXIT_FAILURE
+#include <string.h>	  // memchr, memcpy, strerror
+#include <sys/mman.h> // mmap, munmap, PROT_*, MAP_*
+#include <sys/stat.h> // fstat, S_ISREG
+#include <tfs/util.h> // tfs_min_size_t, tfs_max_size_t
+#include <unistd.h>	  // read, sysconf
+
+/// @brief Minimum length of each chunk parsed by it's own thread
+#define MIN_CHUNK_LEN (64 * 1024)
+
+/// @brief Size of each read, when reading the file instead
+#define READ_LEN (64 * 1024)
+
+/// @brief A chunk of the file, parsed by a single thread
+typedef struct Chunk {
+	/// @brief Start of the chunk, at the start of a line
+	char* start;
+
+	/// @brief Length of the chunk, ending at the end of a line
+	size_t len;
+
+	/// @brief All commands parsed
+	TfsCommand* commands;
+
+	/// @brief Line of each command, relative to the chunk
+	size_t* lines;
+
+	/// @brief Number of commands parsed
+	size_t commands_len;
+
+	/// @brief Capacity of @ref commands and @ref lines
+	size_t commands_capacity;
+
+	/// @brief Number of lines in the chunk
+	size_t lines_len;
+
+	/// @brief If a command couldn't be parsed, after which the chunk isn't parsed further
+	bool failed;
+
+	/// @brief Line of the command that couldn't be parsed, relative to the chunk
+	size_t err_line;
+
+	/// @brief Error of the command that couldn't be parsed
+	TfsCommandParseError err;
+} Chunk;
+
+void tfs_command_file_parse_error_print(const TfsCommandFileParseError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsCommandFileParseErrorRead: {
+			fprintf(out, "Unable to read command file\n");
+			fprintf(out, "(%d) %s\n", self->data.read.err, strerror(self->data.read.err));
+			break;
+		}
+		case TfsCommandFileParseErrorCommand: {
+			fprintf(out, "Unable to parse line %zu\n", self->data.command.line);
+			tfs_command_parse_error_print(&self->data.command.err, out);
+			break;
+		}
+		case TfsCommandFileParseErrorCompiled: {
+			tfs_command_compiled_open_error_print(&self->data.compiled.err, out);
+			break;
+		}
+
+		default: {
+			break;
+		}
+	}
+}
+
+/// @brief Maps the regular file @p fd, followed by a nul byte
+/// @return If mapped
+/// @details
+/// The file is mapped over an anonymous mapping one byte longer, so
+/// the byte past it's end is always mapped and zero, even when the
+/// file's length is a multiple of the page size.
+static bool map_contents(TfsCommandFile* self, int fd, size_t len) {
+	size_t page_len = (size_t)sysconf(_SC_PAGESIZE);
+	size_t mapping_len = (len + 1 + page_len - 1) / page_len * page_len;
+	char* mapping = mmap(NULL, mapping_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) { return false; }
+	if (len != 0 && mmap(mapping, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(mapping, mapping_len);
+		return false;
+	}
+
+	self->contents = mapping;
+	self->contents_len = len;
+	self->mapping_len = mapping_len;
+	return true;
+}
+
+/// @brief Reads @p fd until it's end, followed by a nul byte
+/// @return If read
+static bool read_contents(TfsCommandFile* self, int fd) {
+	size_t len = 0;
+	size_t capacity = READ_LEN;
+	char* contents = malloc(capacity + 1);
+	while (contents != NULL) {
+		ssize_t read_len = read(fd, contents + len, capacity - len);
+		if (read_len < 0 && errno == EINTR) { continue; }
+		if (read_len < 0) {
+			free(contents);
+			return false;
+		}
+		if (read_len == 0) { break; }
+
+		len += (size_t)read_len;
+		if (len == capacity) {
+			capacity *= 2;
+			char* new_contents = realloc(contents, capacity + 1);
+			if (new_contents == NULL) { free(contents); }
+			contents = new_contents;
+		}
+	}
+	if (contents == NULL) {
+		errno = ENOMEM;
+		return false;
+	}
+	contents[len] = '\0';
+
+	self->contents = contents;
+	self->contents_len = len;
+	self->mapping_len = 0;
+	return true;
+}
+
+/// @brief Loads all commands of a compiled command file
+/// @return If loaded
+static bool load_compiled(TfsCommandFile* self, TfsCommandCompiledOpenError* err) {
+	TfsCommandCompiledOpenResult open_result = tfs_command_compiled_open(self->contents, self->contents_len);
+	if (!open_result.success) {
+		*err = open_result.data.err;
+		return false;
+	}
+	TfsCommandCompiled* compiled = &open_result.data.compiled;
+
+	self->commands = malloc(tfs_max_size_t(compiled->len, 1) * sizeof(TfsCommand));
+	self->lines = malloc(tfs_max_size_t(compiled->len, 1) * sizeof(size_t));
+	if (self->commands == NULL || self->lines == NULL) {
+		fprintf(stderr, "Unable to allocate commands\n");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t n = 0; n < compiled->len; n++) {
+		self->commands[n] = tfs_command_compiled_get(compiled, n);
+		self->lines[n] = compiled->records[n].line;
+	}
+	self->len = compiled->len;
+
+	return true;
+}
+
+/// @brief Adds a command to a chunk
+static void chunk_push(Chunk* chunk, TfsCommand command, size_t line) {
+	if (chunk->commands_len == chunk->commands_capacity) {
+		chunk->commands_capacity = chunk->commands_capacity == 0 ? 64 : 2 * chunk->commands_capacity;
+		chunk->commands = realloc(chunk->commands, chunk->commands_capacity * sizeof(TfsCommand));
+		chunk->lines = realloc(chunk->lines, chunk->commands_capacity * sizeof(size_t));
+		if (chunk->commands == NULL || chunk->lines == NULL) {
+			fprintf(stderr, "Unable to allocate commands\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	chunk->commands[chunk->commands_len] = command;
+	chunk->lines[chunk->commands_len] = line;
+	chunk->commands_len++;
+}
+
+/// @brief Parses all lines of a chunk
+static void* parse_chunk(void* arg) {
+	Chunk* chunk = arg;
+	char* cur = chunk->start;
+	char* end = chunk->start + chunk->len;
+
+	while (cur < end) {
+		char* newline = memchr(cur, '\n', (size_t)(end - cur));
+		char* line_end = newline != NULL ? newline : end;
+		chunk->lines_len++;
+
+		// Skip empty lines and comments
+		char* first = cur;
+		while (first < line_end && isspace((unsigned char)*first)) { first++; }
+		if (first != line_end && *first != '#') {
+			// Note: The line is always followed by it's newline, or the nul byte past the file.
+			TfsCommandParseResult result = tfs_command_parse_line(cur, (size_t)(line_end - cur));
+			if (!result.success) {
+				chunk->failed = true;
+				chunk->err_line = chunk->lines_len;
+				chunk->err = result.data.err;
+				return NULL;
+			}
+			chunk_push(chunk, result.data.command, chunk->lines_len);
+		}
+
+		cur = newline != NULL ? newline + 1 : end;
+	}
+
+	return NULL;
+}
+
+TfsCommandFileParseResult tfs_command_file_parse(int fd, size_t threads) {
+	TfsCommandFile file = {
+		.contents = NULL,
+		.contents_len = 0,
+		.mapping_len = 0,
+		.commands = NULL,
+		.lines = NULL,
+		.len = 0,
+	};
+
+	// Map the file, or read it, if it's not a regular file
+	struct stat stat;
+	bool loaded = fstat(fd, &stat) == 0 && S_ISREG(stat.st_mode) ? map_contents(&file, fd, (size_t)stat.st_size)
+																   : read_contents(&file, fd);
+	if (!loaded) {
+		return (TfsCommandFileParseResult){
+			.success = false,
+			.data.err.kind = TfsCommandFileParseErrorRead,
+			.data.err.data.read.err = errno,
+		};
+	}
+
+	// If it's compiled, load it instead of parsing it
+	if (tfs_command_compiled_is(file.contents, file.contents_len)) {
+		TfsCommandCompiledOpenError err;
+		if (!load_compiled(&file, &err)) {
+			tfs_command_file_destroy(&file);
+			return (TfsCommandFileParseResult){
+				.success = false,
+				.data.err.kind = TfsCommandFileParseErrorCompiled,
+				.data.err.data.compiled.err = err,
+			};
+		}
+
+		return (TfsCommandFileParseResult){
+			.success = true,
+			.data.file = file,
+		};
+	}
+
+	// Split it into chunks, each ending at the end of a line
+	size_t chunks_len = tfs_max_size_t(1, tfs_min_size_t(threads, file.contents_len / MIN_CHUNK_LEN));
+	Chunk chunks[chunks_len];
+	size_t chunk_start = 0;
+	for (size_t n = 0; n < chunks_len; n++) {
+		size_t chunk_end = file.contents_len;
+		if (n != chunks_len - 1) {
+			chunk_end = tfs_max_size_t(chunk_start, (n + 1) * file.contents_len / chunks_len);
+			char* newline = memchr(file.contents + chunk_end, '\n', file.contents_len - chunk_end);
+			chunk_end = newline != NULL ? (size_t)(newline - file.contents) + 1 : file.contents_len;
+		}
+
+		chunks[n] = (Chunk){
+			.start = file.contents + chunk_start,
+			.len = chunk_end - chunk_start,
+			.commands = NULL,
+			.lines = NULL,
+			.commands_len = 0,
+			.commands_capacity = 0,
+			.lines_len = 0,
+			.failed = false,
+			.err_line = 0,
+			.err = {.kind = TfsCommandParseErrorNoCommand},
+		};
+		chunk_start = chunk_end;
+	}
+
+	// Parse all chunks but the first in their own threads, and the first in ours
+	// Note: If we can't create a thread, we just parse it's chunk ourselves.
+	pthread_t chunk_threads[chunks_len];
+	bool chunk_threaded[chunks_len];
+	for (size_t n = 1; n < chunks_len; n++) {
+		chunk_threaded[n] = pthread_create(&chunk_threads[n], NULL, parse_chunk, &chunks[n]) == 0;
+		if (!chunk_threaded[n]) { parse_chunk(&chunks[n]); }
+	}
+	parse_chunk(&chunks[0]);
+	for (size_t n = 1; n < chunks_len; n++) {
+		if (chunk_threaded[n]) { pthread_join(chunk_threads[n], NULL); }
+	}
+
+	// Then gather all commands, offsetting each chunk's lines by those of the chunks before it
+	size_t commands_len = 0;
+	for (size_t n = 0; n < chunks_len; n++) { commands_len += chunks[n].commands_len; }
+	file.commands = malloc(tfs_max_size_t(commands_len, 1) * sizeof(TfsCommand));
+	file.lines = malloc(tfs_max_size_t(commands_len, 1) * sizeof(size_t));
+	if (file.commands == NULL || file.lines == NULL) {
+		fprintf(stderr, "Unable to allocate commands\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t line_offset = 0;
+	bool failed = false;
+	TfsCommandFileParseError err;
+	for (size_t n = 0; n < chunks_len; n++) {
+		Chunk* chunk = &chunks[n];
+		if (chunk->failed && !failed) {
+			failed = true;
+			err = (TfsCommandFileParseError){
+				.kind = TfsCommandFileParseErrorCommand,
+				.data.command.line = line_offset + chunk->err_line,
+				.data.command.err = chunk->err,
+			};
+		}
+
+		memcpy(file.commands + file.len, chunk->commands, chunk->commands_len * sizeof(TfsCommand));
+		for (size_t m = 0; m < chunk->commands_len; m++) { file.lines[file.len + m] = line_offset + chunk->lines[m]; }
+		file.len += chunk->commands_len;
+		line_offset += chunk->lines_len;
+
+		free(chunk->lines);
+		free(chunk->commands);
+	}
+
+	if (failed) {
+		tfs_command_file_destroy(&file);
+		return (TfsCommandFileParseResult){
+			.success = false,
+			.data.err = err,
+		};
+	}
+
+	return (TfsCommandFileParseResult){
+		.success = true,
+		.data.file = file,
+	};
+}
+
+void tfs_command_file_destroy(TfsCommandFile* self) {
+	// Note: Commands only borrow from the contents, so there's nothing to destroy in them.
+	free(self->lines);
+	free(self->commands);
+	if (self->mapping_len != 0) { munmap(self->contents, self->mapping_len); }
+	else {
+		free(self->contents);
+	}
+}
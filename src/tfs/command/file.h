@@ -0,0 +1,122 @@
+/// @file
+/// @brief Command files
+/// @details
+/// This file defines the #TfsCommandFile type, all commands of a command
+/// file, parsed at once.
+///
+/// Regular files are mapped into memory, rather than read, and split into
+/// chunks at line boundaries, each parsed by it's own thread. Commands borrow
+/// their paths from the mapping, see #tfs_command_parse_line, so neither
+/// lines nor paths are ever copied, or limited in length. The mapping is
+/// private, so the file itself is never changed.
+///
+/// Empty lines, and lines starting with `#`, are skipped.
+///
+/// Compiled command files, see #TfsCommandCompiled, are loaded instead,
+/// without any parsing.
+
+#ifndef TFS_COMMAND_FILE_H
+#define TFS_COMMAND_FILE_H
+
+// Imports
+#include <stdbool.h>			  // bool
+#include <stddef.h>				  // size_t
+#include <stdio.h>				  // FILE
+#include <tfs/command/command.h>  // TfsCommand, TfsCommandParseError
+#include <tfs/command/compiled.h> // TfsCommandCompiledOpenError
+
+/// @brief All commands of a command file
+typedef struct TfsCommandFile {
+	/// @brief Contents of the file, followed by a nul byte
+	char* contents;
+
+	/// @brief Length of @ref contents, without the nul byte
+	size_t contents_len;
+
+	/// @brief Length of the mapping of @ref contents, or `0` if read into a buffer instead
+	size_t mapping_len;
+
+	/// @brief All commands, in order
+	/// @details
+	/// These borrow their paths from @ref contents.
+	TfsCommand* commands;
+
+	/// @brief Line of each command, starting at `1`
+	size_t* lines;
+
+	/// @brief Number of commands
+	size_t len;
+} TfsCommandFile;
+
+/// @brief Error type for #tfs_command_file_parse
+typedef struct TfsCommandFileParseError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to map or read the file
+		TfsCommandFileParseErrorRead,
+
+		/// @brief Unable to parse a command
+		TfsCommandFileParseErrorCommand,
+
+		/// @brief Unable to open a compiled command file
+		TfsCommandFileParseErrorCompiled,
+	} kind;
+
+	/// @brief Error data
+	union {
+		/// @brief Data for `Read`.
+		struct {
+			/// @brief The `errno` value
+			int err;
+		} read;
+
+		/// @brief Data for `Command`.
+		struct {
+			/// @brief Line of the first command that couldn't be parsed
+			size_t line;
+
+			/// @brief Underlying error
+			TfsCommandParseError err;
+		} command;
+
+		/// @brief Data for `Compiled`.
+		struct {
+			/// @brief Underlying error
+			TfsCommandCompiledOpenError err;
+		} compiled;
+	} data;
+} TfsCommandFileParseError;
+
+/// @brief Result type for #tfs_command_file_parse
+typedef struct TfsCommandFileParseResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Success file
+		TfsCommandFile file;
+
+		/// @brief Underlying error
+		TfsCommandFileParseError err;
+	} data;
+} TfsCommandFileParseResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_command_file_parse_error_print(const TfsCommandFileParseError* self, FILE* out);
+
+/// @brief Parses all commands of a command file
+/// @param fd The file. Anything other than a regular file, such as a pipe, is read until it's end instead.
+/// @param threads Maximum number of threads to parse with
+/// @details
+/// The file descriptor may be closed right after.
+TfsCommandFileParseResult tfs_command_file_parse(int fd, size_t threads);
+
+/// @brief Destroys a command file
+/// @details
+/// All commands are destroyed as well, so none of them may be used afterwards.
+void tfs_command_file_destroy(TfsCommandFile* self);
+
+#endif
@@ -0,0 +1,76 @@
+#include "queue.h"
+
+// Imports
+#include <assert.h>	// assert
+#include <stdio.h>	// fprintf, stderr
+#include <stdlib.h>	// malloc, free, exit, EXIT_FAILURE
+
+TfsCommandQueue tfs_command_queue_new(size_t capacity) {
+	assert(capacity != 0);
+
+	TfsCommandQueue queue = {
+		.commands = malloc(capacity * sizeof(TfsCommand)),
+		.capacity = capacity,
+		.head = 0,
+		.len = 0,
+		.lock = tfs_mutex_new(),
+		.not_empty = tfs_cond_var_new(),
+		.not_full = tfs_cond_var_new(),
+		.closed = false,
+	};
+	if (queue.commands == NULL) {
+		fprintf(stderr, "Unable to allocate command queue with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	return queue;
+}
+
+void tfs_command_queue_destroy(TfsCommandQueue* self) {
+	for (size_t n = 0; n < self->len; n++) { tfs_command_destroy(&self->commands[(self->head + n) % self->capacity]); }
+	tfs_cond_var_destroy(&self->not_full);
+	tfs_cond_var_destroy(&self->not_empty);
+	tfs_mutex_destroy(&self->lock);
+	free(self->commands);
+}
+
+bool tfs_command_queue_push(TfsCommandQueue* self, TfsCommand command) {
+	tfs_mutex_lock(&self->lock);
+	while (!self->closed && self->len == self->capacity) { tfs_cond_var_wait(&self->not_full, &self->lock); }
+	if (self->closed) {
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+
+	self->commands[(self->head + self->len) % self->capacity] = command;
+	self->len++;
+	tfs_cond_var_signal(&self->not_empty);
+	tfs_mutex_unlock(&self->lock);
+
+	return true;
+}
+
+bool tfs_command_queue_pop(TfsCommandQueue* self, TfsCommand* command) {
+	tfs_mutex_lock(&self->lock);
+	while (!self->closed && self->len == 0) { tfs_cond_var_wait(&self->not_empty, &self->lock); }
+	if (self->len == 0) {
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+
+	*command = self->commands[self->head];
+	self->head = (self->head + 1) % self->capacity;
+	self->len--;
+	tfs_cond_var_signal(&self->not_full);
+	tfs_mutex_unlock(&self->lock);
+
+	return true;
+}
+
+void tfs_command_queue_close(TfsCommandQueue* self) {
+	tfs_mutex_lock(&self->lock);
+	self->closed = true;
+	tfs_cond_var_broadcast(&self->not_empty);
+	tfs_cond_var_broadcast(&self->not_full);
+	tfs_mutex_unlock(&self->lock);
+}
@@ -0,0 +1,78 @@
+/// @file
+/// @brief Bounded queue of commands
+/// @details
+/// This file defines the #TfsCommandQueue type, a bounded circular buffer of
+/// #TfsCommand, through which a producer hands the commands it parses to any
+/// number of consumers executing them.
+///
+/// The producer blocks while the queue is full, so it never parses further
+/// ahead of the consumers than the queue's capacity, and consumers block
+/// while it's empty. Once the producer closes the queue, consumers still
+/// pop the commands left, and only then stop.
+
+#ifndef TFS_COMMAND_QUEUE_H
+#define TFS_COMMAND_QUEUE_H
+
+// Imports
+#include <stdbool.h>			 // bool
+#include <stddef.h>				 // size_t
+#include <tfs/command/command.h> // TfsCommand
+#include <tfs/cond_var.h>		 // TfsCondVar
+#include <tfs/mutex.h>			 // TfsMutex
+
+/// @brief Bounded queue of commands
+typedef struct TfsCommandQueue {
+	/// @brief All commands, as a circular buffer
+	TfsCommand* commands;
+
+	/// @brief Capacity of @ref commands
+	size_t capacity;
+
+	/// @brief Index of the first command
+	size_t head;
+
+	/// @brief Number of commands
+	size_t len;
+
+	/// @brief Lock over the queue
+	TfsMutex lock;
+
+	/// @brief Signaled whenever a command is pushed or the queue is closed
+	TfsCondVar not_empty;
+
+	/// @brief Signaled whenever a command is popped or the queue is closed
+	TfsCondVar not_full;
+
+	/// @brief If the queue was closed
+	bool closed;
+} TfsCommandQueue;
+
+/// @brief Creates a new command queue
+/// @param capacity Maximum number of commands queued at once
+TfsCommandQueue tfs_command_queue_new(size_t capacity);
+
+/// @brief Destroys a command queue
+/// @details
+/// All commands still queued are destroyed.
+void tfs_command_queue_destroy(TfsCommandQueue* self);
+
+/// @brief Pushes a command to the queue, taking ownership of it
+/// @param self
+/// @param command The command
+/// @return If pushed. Fails only once the queue is closed, in which case the caller keeps ownership of @p command.
+/// @details
+/// Blocks while the queue is full.
+bool tfs_command_queue_push(TfsCommandQueue* self, TfsCommand command);
+
+/// @brief Pops the next command from the queue
+/// @param self
+/// @param[out] command The command popped, now owned by the caller
+/// @return If popped. Fails only once the queue is closed and no commands are left.
+/// @details
+/// Blocks while the queue is empty.
+bool tfs_command_queue_pop(TfsCommandQueue* self, TfsCommand* command);
+
+/// @brief Closes the queue, waking up all consumers
+void tfs_command_queue_close(TfsCommandQueue* self);
+
+#endif
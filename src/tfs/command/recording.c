@@ -0,0 +1,218 @@
+#include "recording.h"
+
+// Imports
+#include <errno.h>	  // errno, ENOMEM
+#include <stdlib.h>	  // malloc, realloc, free, exit, EXIT_FAILURE
+#include <string.h>	  // memcmp, memcpy, strerror
+#include <tfs/util.h> // tfs_max_size_t
+
+/// @brief Size of each read of the recording
+#define READ_LEN (64 * 1024)
+
+void tfs_command_recording_load_error_print(const TfsCommandRecordingLoadError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsCommandRecordingLoadErrorRead: {
+			fprintf(out, "Unable to read recording\n");
+			fprintf(out, "(%d) %s\n", self->data.read.err, strerror(self->data.read.err));
+			break;
+		}
+		case TfsCommandRecordingLoadErrorHeader: {
+			fprintf(out, "Missing recording header, or of an unknown version\n");
+			break;
+		}
+		case TfsCommandRecordingLoadErrorCommand: {
+			fprintf(out, "Unable to parse the command of entry #%zu\n", self->data.command.idx);
+			tfs_command_parse_error_print(&self->data.command.err, out);
+			break;
+		}
+
+		default: {
+			break;
+		}
+	}
+}
+
+/// @brief Reads @p in until it's end
+/// @return The contents, or `NULL`, with `errno` set, if unable to
+static char* read_contents(FILE* in, size_t* contents_len) {
+	size_t len = 0;
+	size_t capacity = READ_LEN;
+	char* contents = malloc(capacity);
+	while (contents != NULL) {
+		len += fread(contents + len, 1, capacity - len, in);
+		if (len != capacity) { break; }
+
+		capacity *= 2;
+		char* new_contents = realloc(contents, capacity);
+		if (new_contents == NULL) { free(contents); }
+		contents = new_contents;
+	}
+	if (contents == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (ferror(in)) {
+		free(contents);
+		return NULL;
+	}
+
+	*contents_len = len;
+	return contents;
+}
+
+/// @brief Merges the sorted entries @p left and @p right into @p out, keeping the order of those with the same time
+static void merge_entries(const TfsCommandRecordingEntry* left,
+	size_t left_len,
+	const TfsCommandRecordingEntry* right,
+	size_t right_len,
+	TfsCommandRecordingEntry* out) {
+	size_t l = 0;
+	size_t r = 0;
+	while (l < left_len && r < right_len) {
+		if (right[r].time_ns < left[l].time_ns) { *out++ = right[r++]; }
+		else {
+			*out++ = left[l++];
+		}
+	}
+	memcpy(out, left + l, (left_len - l) * sizeof(TfsCommandRecordingEntry));
+	memcpy(out + (left_len - l), right + r, (right_len - r) * sizeof(TfsCommandRecordingEntry));
+}
+
+/// @brief Sorts entries by their time, keeping the order of those with the same time
+/// @return The sorted entries, either @p entries or @p spare, which must both have room for @p len entries
+/// @details
+/// Entries are recorded in runs that are already sorted, so this merges
+/// adjacent pairs of runs, until a single one is left.
+static TfsCommandRecordingEntry* sort_entries(TfsCommandRecordingEntry* entries,
+	TfsCommandRecordingEntry* spare,
+	size_t len) {
+	// Find where each run ends
+	size_t* run_ends = malloc(tfs_max_size_t(1, len) * sizeof(size_t));
+	if (run_ends == NULL) {
+		fprintf(stderr, "Unable to allocate recording entries\n");
+		exit(EXIT_FAILURE);
+	}
+	size_t runs = 0;
+	for (size_t n = 1; n <= len; n++) {
+		if (n == len || entries[n].time_ns < entries[n - 1].time_ns) { run_ends[runs++] = n; }
+	}
+
+	// Then merge them in pairs, back and forth between both buffers
+	while (runs > 1) {
+		size_t merged_runs = 0;
+		size_t start = 0;
+		for (size_t n = 0; n < runs; n += 2) {
+			size_t mid = run_ends[n];
+			size_t end = n + 1 < runs ? run_ends[n + 1] : mid;
+			merge_entries(entries + start, mid - start, entries + mid, end - mid, spare + start);
+			run_ends[merged_runs++] = end;
+			start = end;
+		}
+		runs = merged_runs;
+
+		TfsCommandRecordingEntry* merged = spare;
+		spare = entries;
+		entries = merged;
+	}
+
+	free(run_ends);
+	return entries;
+}
+
+TfsCommandRecordingLoadResult tfs_command_recording_load(FILE* in) {
+	size_t contents_len;
+	char* contents = read_contents(in, &contents_len);
+	if (contents == NULL) {
+		return (TfsCommandRecordingLoadResult){
+			.success = false,
+			.data.err.kind = TfsCommandRecordingLoadErrorRead,
+			.data.err.data.read.err = errno,
+		};
+	}
+
+	TfsCommandRecordingHeader header;
+	if (contents_len < sizeof(header)) {
+		free(contents);
+		return (TfsCommandRecordingLoadResult){
+			.success = false,
+			.data.err.kind = TfsCommandRecordingLoadErrorHeader,
+		};
+	}
+	memcpy(&header, contents, sizeof(header));
+	if (memcmp(header.magic, TFS_COMMAND_RECORDING_MAGIC, sizeof(TFS_COMMAND_RECORDING_MAGIC)) != 0 ||
+		header.version != TFS_COMMAND_RECORDING_VERSION) {
+		free(contents);
+		return (TfsCommandRecordingLoadResult){
+			.success = false,
+			.data.err.kind = TfsCommandRecordingLoadErrorHeader,
+		};
+	}
+
+	// Parse every whole entry
+	// Note: Each command is followed by it's newline, which parsing may overwrite, so it's never past the contents.
+	TfsCommandRecording recording = {
+		.contents = contents,
+		.entries = NULL,
+		.len = 0,
+		.clients = 0,
+	};
+	size_t capacity = 0;
+	size_t pos = sizeof(header);
+	while (1) {
+		TfsCommandRecordingEntryHeader entry_header;
+		if (contents_len - pos < sizeof(entry_header)) { break; }
+		memcpy(&entry_header, contents + pos, sizeof(entry_header));
+		if (contents_len - pos - sizeof(entry_header) < (size_t)entry_header.len + 1) { break; }
+		char* command_str = contents + pos + sizeof(entry_header);
+		pos += sizeof(entry_header) + entry_header.len + 1;
+
+		TfsCommandParseResult parse_result = tfs_command_parse_line(command_str, entry_header.len);
+		if (!parse_result.success) {
+			TfsCommandRecordingLoadError err = {
+				.kind = TfsCommandRecordingLoadErrorCommand,
+				.data.command.idx = recording.len,
+				.data.command.err = parse_result.data.err,
+			};
+			tfs_command_recording_destroy(&recording);
+			return (TfsCommandRecordingLoadResult){
+				.success = false,
+				.data.err = err,
+			};
+		}
+
+		if (recording.len == capacity) {
+			capacity = tfs_max_size_t(64, 2 * capacity);
+			recording.entries = realloc(recording.entries, capacity * sizeof(TfsCommandRecordingEntry));
+			if (recording.entries == NULL) {
+				fprintf(stderr, "Unable to allocate recording entries\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		recording.entries[recording.len++] = (TfsCommandRecordingEntry){
+			.time_ns = entry_header.time_ns,
+			.client = entry_header.client,
+			.command = parse_result.data.command,
+		};
+		recording.clients = tfs_max_size_t(recording.clients, (size_t)entry_header.client + 1);
+	}
+
+	// Note: Each of the server's threads records into it's own buffer, so their entries may be interleaved.
+	TfsCommandRecordingEntry* spare = malloc(tfs_max_size_t(1, recording.len) * sizeof(TfsCommandRecordingEntry));
+	if (spare == NULL) {
+		fprintf(stderr, "Unable to allocate recording entries\n");
+		exit(EXIT_FAILURE);
+	}
+	TfsCommandRecordingEntry* sorted = sort_entries(recording.entries, spare, recording.len);
+	free(sorted == spare ? recording.entries : spare);
+	recording.entries = sorted;
+
+	return (TfsCommandRecordingLoadResult){
+		.success = true,
+		.data.recording = recording,
+	};
+}
+
+void tfs_command_recording_destroy(TfsCommandRecording* self) {
+	free(self->entries);
+	free(self->contents);
+}
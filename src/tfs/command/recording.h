@@ -0,0 +1,152 @@
+/// @file
+/// @brief Recorded command traffic
+/// @details
+/// This file defines the #TfsCommandRecording type, all commands a server
+/// received, along with when and from which client, as recorded by a
+/// #TfsServerRecorder.
+///
+/// A recording consists of a #TfsCommandRecordingHeader, followed by an
+/// entry for each command. Each entry is a #TfsCommandRecordingEntryHeader
+/// followed by the command, as text, and a newline, which lets commands be
+/// parsed in place, see #tfs_command_parse_line.
+///
+/// Entries are written in batches, one per server thread, so they're only
+/// in order within each batch, and are sorted by their time once loaded.
+/// All integers are in the host's byte order.
+
+#ifndef TFS_COMMAND_RECORDING_H
+#define TFS_COMMAND_RECORDING_H
+
+// Imports
+#include <stdbool.h>			 // bool
+#include <stddef.h>				 // size_t
+#include <stdint.h>				 // uint32_t, uint64_t
+#include <stdio.h>				 // FILE
+#include <tfs/command/command.h> // TfsCommand, TfsCommandParseError
+
+/// @brief Magic bytes that start all recordings, including the nul terminator
+#define TFS_COMMAND_RECORDING_MAGIC "TFSRECD"
+
+/// @brief Version of the format
+#define TFS_COMMAND_RECORDING_VERSION 1
+
+/// @brief Header of a recording
+typedef struct TfsCommandRecordingHeader {
+	/// @brief #TFS_COMMAND_RECORDING_MAGIC
+	char magic[8];
+
+	/// @brief #TFS_COMMAND_RECORDING_VERSION
+	uint32_t version;
+
+	/// @brief Reserved, always `0`
+	uint32_t reserved;
+} TfsCommandRecordingHeader;
+
+/// @brief Header of each entry of a recording
+/// @details
+/// Entries aren't aligned, so this must be copied out, rather than accessed in place.
+typedef struct TfsCommandRecordingEntryHeader {
+	/// @brief Time the command was received, in nanoseconds since the recording started
+	uint64_t time_ns;
+
+	/// @brief Client that sent the command, numbered from `0` in the order they were first written
+	uint32_t client;
+
+	/// @brief Length of the command, without the newline
+	uint32_t len;
+} TfsCommandRecordingEntryHeader;
+
+/// @brief A recorded command
+typedef struct TfsCommandRecordingEntry {
+	/// @brief Time the command was received, in nanoseconds since the recording started
+	uint64_t time_ns;
+
+	/// @brief Client that sent the command
+	uint32_t client;
+
+	/// @brief The command, borrowing it's paths from the recording
+	TfsCommand command;
+} TfsCommandRecordingEntry;
+
+/// @brief All commands of a recording
+typedef struct TfsCommandRecording {
+	/// @brief Contents of the recording
+	char* contents;
+
+	/// @brief All entries, in the order they were recorded, by their time
+	TfsCommandRecordingEntry* entries;
+
+	/// @brief Number of entries
+	size_t len;
+
+	/// @brief Number of clients, one more than the highest client of any entry
+	size_t clients;
+} TfsCommandRecording;
+
+/// @brief Error type for #tfs_command_recording_load
+typedef struct TfsCommandRecordingLoadError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to read the recording
+		TfsCommandRecordingLoadErrorRead,
+
+		/// @brief Missing header, or of an unknown version
+		TfsCommandRecordingLoadErrorHeader,
+
+		/// @brief Unable to parse an entry's command
+		TfsCommandRecordingLoadErrorCommand,
+	} kind;
+
+	/// @brief Error data
+	union {
+		/// @brief Data for `Read`.
+		struct {
+			/// @brief The `errno` value
+			int err;
+		} read;
+
+		/// @brief Data for `Command`.
+		struct {
+			/// @brief Index of the entry
+			size_t idx;
+
+			/// @brief Underlying error
+			TfsCommandParseError err;
+		} command;
+	} data;
+} TfsCommandRecordingLoadError;
+
+/// @brief Result type for #tfs_command_recording_load
+typedef struct TfsCommandRecordingLoadResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Success recording
+		TfsCommandRecording recording;
+
+		/// @brief Underlying error
+		TfsCommandRecordingLoadError err;
+	} data;
+} TfsCommandRecordingLoadResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_command_recording_load_error_print(const TfsCommandRecordingLoadError* self, FILE* out);
+
+/// @brief Loads a recording, parsing all of it's commands
+/// @param in The recording, read until it's end
+/// @details
+/// A recording cut short in the middle of it's last entry, such as by the
+/// server being killed while recording, has that entry dropped, instead of
+/// failing.
+TfsCommandRecordingLoadResult tfs_command_recording_load(FILE* in);
+
+/// @brief Destroys a recording
+/// @details
+/// All commands are destroyed as well, so none of them may be used afterwards.
+void tfs_command_recording_destroy(TfsCommandRecording* self);
+
+#endif
@@ -0,0 +1,413 @@
+#include "replay.h"
+
+// Imports
+#include <stdint.h>	  // uint64_t
+#include <stdio.h>	  // fprintf, stderr
+#include <stdlib.h>	  // malloc, calloc, realloc, free, exit, EXIT_FAILURE
+#include <tfs/path.h> // TfsPath, tfs_path_*
+#include <tfs/util.h> // tfs_str_eq, tfs_max_size_t, tfs_hash_bytes
+
+/// @brief No command, or no node
+#define NONE ((size_t)-1)
+
+/// @brief Initial number of buckets of the trie
+#define TRIE_INITIAL_BUCKETS 64
+
+/// @brief A path in the trie
+typedef struct TrieNode {
+	/// @brief Parent node, or #NONE for the root
+	size_t parent;
+
+	/// @brief Last component of the path, borrowed from a command
+	const char* name;
+
+	/// @brief Length of @ref name
+	size_t name_len;
+
+	/// @brief First child node, or #NONE
+	size_t first_child;
+
+	/// @brief Next sibling node, or #NONE
+	size_t next_sibling;
+
+	/// @brief Next node in the same bucket, or #NONE
+	size_t next_in_bucket;
+
+	/// @brief Last command that wrote this path's subtree, or #NONE
+	size_t last_write;
+
+	/// @brief Last command that wrote this path's entries, or #NONE
+	size_t last_entries;
+
+	/// @brief Commands that read this path since it was last written
+	size_t* readers;
+
+	/// @brief Number of commands in @ref readers
+	size_t readers_len;
+
+	/// @brief Capacity of @ref readers
+	size_t readers_capacity;
+} TrieNode;
+
+/// @brief State while building the DAG
+typedef struct Builder {
+	/// @brief The replay being built
+	TfsCommandReplay* replay;
+
+	/// @brief All nodes, the first being the root
+	TrieNode* nodes;
+
+	/// @brief Number of nodes
+	size_t nodes_len;
+
+	/// @brief Capacity of @ref nodes
+	size_t nodes_capacity;
+
+	/// @brief First node of each bucket, or #NONE
+	size_t* buckets;
+
+	/// @brief Number of buckets
+	size_t buckets_len;
+
+	/// @brief Last print, or #NONE
+	size_t last_print;
+
+	/// @brief Commands that wrote anything since the last print
+	size_t* since_print;
+
+	/// @brief Number of commands in @ref since_print
+	size_t since_print_len;
+
+	/// @brief Capacity of @ref since_print
+	size_t since_print_capacity;
+
+	/// @brief Last command that depended on each command, to not depend on it twice
+	size_t* marks;
+
+	/// @brief Length of the longest chain ending at each command
+	size_t* depths;
+
+	/// @brief The command being added
+	size_t cur;
+} Builder;
+
+/// @brief Pushes @p item to a growable array
+static void push_item(size_t** items, size_t* len, size_t* capacity, size_t item) {
+	if (*len == *capacity) {
+		*capacity = *capacity == 0 ? 4 : 2 * *capacity;
+		*items = realloc(*items, *capacity * sizeof(size_t));
+		if (*items == NULL) {
+			fprintf(stderr, "Unable to allocate replay dependencies\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	(*items)[(*len)++] = item;
+}
+
+/// @brief Returns the bucket of a node's name
+/// @details
+/// The parent is mixed into the hash, so the same name under different parents is spread out.
+static size_t bucket_of(const Builder* b, size_t parent, const char* name, size_t name_len) {
+	return (size_t)(tfs_hash_bytes(TFS_HASH_SEED ^ (uint64_t)parent, name, name_len) % b->buckets_len);
+}
+
+/// @brief Rebuilds all buckets, with @p buckets_len buckets
+static void rehash(Builder* b, size_t buckets_len) {
+	free(b->buckets);
+	b->buckets_len = buckets_len;
+	b->buckets = malloc(buckets_len * sizeof(size_t));
+	if (b->buckets == NULL) {
+		fprintf(stderr, "Unable to allocate replay trie\n");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t n = 0; n < buckets_len; n++) { b->buckets[n] = NONE; }
+
+	// Note: The root is never in a bucket, as it has no parent.
+	for (size_t n = 1; n < b->nodes_len; n++) {
+		TrieNode* node = &b->nodes[n];
+		size_t bucket = bucket_of(b, node->parent, node->name, node->name_len);
+		node->next_in_bucket = b->buckets[bucket];
+		b->buckets[bucket] = n;
+	}
+}
+
+/// @brief Adds a node, returning it's index
+static size_t add_node(Builder* b, size_t parent, const char* name, size_t name_len) {
+	if (b->nodes_len == b->nodes_capacity) {
+		b->nodes_capacity = 2 * b->nodes_capacity;
+		b->nodes = realloc(b->nodes, b->nodes_capacity * sizeof(TrieNode));
+		if (b->nodes == NULL) {
+			fprintf(stderr, "Unable to allocate replay trie\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	size_t idx = b->nodes_len++;
+	b->nodes[idx] = (TrieNode){
+		.parent = parent,
+		.name = name,
+		.name_len = name_len,
+		.first_child = NONE,
+		.next_sibling = NONE,
+		.next_in_bucket = NONE,
+		.last_write = NONE,
+		.last_entries = NONE,
+		.readers = NULL,
+		.readers_len = 0,
+		.readers_capacity = 0,
+	};
+	if (parent == NONE) { return idx; }
+
+	b->nodes[idx].next_sibling = b->nodes[parent].first_child;
+	b->nodes[parent].first_child = idx;
+	if (b->nodes_len > 2 * b->buckets_len) { rehash(b, 2 * b->buckets_len); }
+	else {
+		size_t bucket = bucket_of(b, parent, name, name_len);
+		b->nodes[idx].next_in_bucket = b->buckets[bucket];
+		b->buckets[bucket] = idx;
+	}
+
+	return idx;
+}
+
+/// @brief Returns the child of @p parent named @p name, adding it if it doesn't exist
+static size_t child_of(Builder* b, size_t parent, TfsPath name) {
+	size_t idx = b->buckets[bucket_of(b, parent, name.chars, name.len)];
+	while (idx != NONE) {
+		const TrieNode* node = &b->nodes[idx];
+		if (node->parent == parent && tfs_str_eq(node->name, node->name_len, name.chars, name.len)) { return idx; }
+		idx = node->next_in_bucket;
+	}
+
+	return add_node(b, parent, name.chars, name.len);
+}
+
+/// @brief Makes the current command depend on command @p dep
+/// @details
+/// Does nothing if @p dep is #NONE, the current command itself, or already depended on.
+static void add_dependency(Builder* b, size_t dep) {
+	if (dep == NONE || dep == b->cur || b->marks[dep] == b->cur) { return; }
+	b->marks[dep] = b->cur;
+
+	TfsCommandReplayNode* dep_node = &b->replay->nodes[dep];
+	push_item(&dep_node->dependents, &dep_node->dependents_len, &dep_node->dependents_capacity, b->cur);
+	b->replay->nodes[b->cur].dependencies++;
+	b->replay->edges++;
+	b->depths[b->cur] = tfs_max_size_t(b->depths[b->cur], b->depths[dep] + 1);
+}
+
+/// @brief Walks @p path from the root, depending on every write of it and it's ancestors, returning it's node
+static size_t walk_path(Builder* b, TfsPath path) {
+	size_t idx = 0;
+	add_dependency(b, b->nodes[idx].last_write);
+
+	path = tfs_path_trim(path);
+	while (path.len != 0) {
+		TfsPath name = tfs_path_pop_first(path, &path);
+		idx = child_of(b, idx, name);
+		add_dependency(b, b->nodes[idx].last_write);
+	}
+
+	return idx;
+}
+
+/// @brief Depends on every access to the subtree of @p idx, then forgets them
+/// @details
+/// Every later access to the subtree depends on the write of it's root, so these needn't be kept.
+static void take_subtree(Builder* b, size_t idx) {
+	TrieNode* node = &b->nodes[idx];
+	add_dependency(b, node->last_write);
+	add_dependency(b, node->last_entries);
+	for (size_t n = 0; n < node->readers_len; n++) { add_dependency(b, node->readers[n]); }
+	node->last_write = NONE;
+	node->last_entries = NONE;
+	node->readers_len = 0;
+
+	for (size_t child = node->first_child; child != NONE; child = b->nodes[child].next_sibling) {
+		take_subtree(b, child);
+	}
+}
+
+/// @brief Depends on the last print, and marks the current command as written since
+static void add_write_since_print(Builder* b) {
+	add_dependency(b, b->last_print);
+	if (b->since_print_len == 0 || b->since_print[b->since_print_len - 1] != b->cur) {
+		push_item(&b->since_print, &b->since_print_len, &b->since_print_capacity, b->cur);
+	}
+}
+
+/// @brief Adds a read of @p path
+static void add_read(Builder* b, TfsPath path) {
+	size_t idx = walk_path(b, path);
+	TrieNode* node = &b->nodes[idx];
+	push_item(&node->readers, &node->readers_len, &node->readers_capacity, b->cur);
+}
+
+/// @brief Adds a write of the subtree of @p path
+static void add_write(Builder* b, TfsPath path) {
+	size_t idx = walk_path(b, path);
+	take_subtree(b, idx);
+	b->nodes[idx].last_write = b->cur;
+	add_write_since_print(b);
+}
+
+/// @brief Adds a write of the entries of the parent of @p path
+static void add_parent_entries_write(Builder* b, TfsPath path) {
+	TfsPath parent;
+	tfs_path_pop_last(tfs_path_trim(path), &parent);
+
+	size_t idx = walk_path(b, parent);
+	add_dependency(b, b->nodes[idx].last_entries);
+	b->nodes[idx].last_entries = b->cur;
+	add_write_since_print(b);
+}
+
+/// @brief Adds a print, which reads everything
+static void add_print(Builder* b) {
+	add_dependency(b, b->last_print);
+	for (size_t n = 0; n < b->since_print_len; n++) { add_dependency(b, b->since_print[n]); }
+	b->since_print_len = 0;
+	b->last_print = b->cur;
+}
+
+/// @brief Adds the current command to the DAG
+static void add_command(Builder* b, const TfsCommand* command) {
+	switch (command->kind) {
+		case TfsCommandCreate: {
+			TfsPath path = tfs_path_owned_borrow(command->data.create.path);
+			add_write(b, path);
+			add_parent_entries_write(b, path);
+			break;
+		}
+		case TfsCommandRemove: {
+			TfsPath path = tfs_path_owned_borrow(command->data.remove.path);
+			add_write(b, path);
+			add_parent_entries_write(b, path);
+			break;
+		}
+		case TfsCommandSearch: {
+			add_read(b, tfs_path_owned_borrow(command->data.search.path));
+			break;
+		}
+		case TfsCommandMove: {
+			TfsPath source = tfs_path_owned_borrow(command->data.move.source);
+			TfsPath dest = tfs_path_owned_borrow(command->data.move.dest);
+			add_write(b, source);
+			add_write(b, dest);
+			add_parent_entries_write(b, source);
+			add_parent_entries_write(b, dest);
+			break;
+		}
+		case TfsCommandPrint: {
+			add_print(b);
+			break;
+		}
+
+		default: {
+			break;
+		}
+	}
+}
+
+TfsCommandReplay tfs_command_replay_new(const TfsCommand* commands, size_t len, TfsCommandReplayFn fn, void* arg) {
+	TfsCommandReplay replay = {
+		.commands = commands,
+		.len = len,
+		.nodes = calloc(len, sizeof(TfsCommandReplayNode)),
+		.results = calloc(len, sizeof(bool)),
+		.edges = 0,
+		.depth = 0,
+		.ready = malloc(len * sizeof(size_t)),
+		.ready_len = 0,
+		.remaining = len,
+		.lock = tfs_mutex_new(),
+		.cond = tfs_cond_var_new(),
+		.fn = fn,
+		.arg = arg,
+	};
+	Builder b = {
+		.replay = &replay,
+		.nodes = malloc(TRIE_INITIAL_BUCKETS * sizeof(TrieNode)),
+		.nodes_len = 0,
+		.nodes_capacity = TRIE_INITIAL_BUCKETS,
+		.buckets = NULL,
+		.buckets_len = 0,
+		.last_print = NONE,
+		.since_print = NULL,
+		.since_print_len = 0,
+		.since_print_capacity = 0,
+		.marks = malloc(len * sizeof(size_t)),
+		.depths = calloc(len, sizeof(size_t)),
+		.cur = 0,
+	};
+	if ((len != 0 && (replay.nodes == NULL || replay.results == NULL || replay.ready == NULL || b.marks == NULL ||
+						 b.depths == NULL)) ||
+		b.nodes == NULL) {
+		fprintf(stderr, "Unable to allocate replay of %zu commands\n", len);
+		exit(EXIT_FAILURE);
+	}
+	rehash(&b, TRIE_INITIAL_BUCKETS);
+	add_node(&b, NONE, "", 0);
+
+	// Add each command, in order
+	for (size_t n = 0; n < len; n++) {
+		b.marks[n] = NONE;
+		b.depths[n] = 1;
+		b.cur = n;
+		add_command(&b, &commands[n]);
+		replay.depth = tfs_max_size_t(replay.depth, b.depths[n]);
+	}
+
+	// Then mark every command without dependencies as ready
+	for (size_t n = 0; n < len; n++) {
+		replay.nodes[n].pending = replay.nodes[n].dependencies;
+		if (replay.nodes[n].pending == 0) { replay.ready[replay.ready_len++] = n; }
+	}
+
+	for (size_t n = 0; n < b.nodes_len; n++) { free(b.nodes[n].readers); }
+	free(b.nodes);
+	free(b.buckets);
+	free(b.since_print);
+	free(b.marks);
+	free(b.depths);
+
+	return replay;
+}
+
+void tfs_command_replay_destroy(TfsCommandReplay* self) {
+	for (size_t n = 0; n < self->len; n++) { free(self->nodes[n].dependents); }
+	tfs_cond_var_destroy(&self->cond);
+	tfs_mutex_destroy(&self->lock);
+	free(self->ready);
+	free(self->results);
+	free(self->nodes);
+}
+
+void tfs_command_replay_run(TfsCommandReplay* self) {
+	tfs_mutex_lock(&self->lock);
+	while (1) {
+		while (self->ready_len == 0 && self->remaining != 0) { tfs_cond_var_wait(&self->cond, &self->lock); }
+		if (self->remaining == 0) { break; }
+
+		// Execute the newest ready command
+		// Note: It's the most likely to share paths with the one just executed.
+		size_t idx = self->ready[--self->ready_len];
+		tfs_mutex_unlock(&self->lock);
+		bool result = self->fn(&self->commands[idx], self->arg);
+		tfs_mutex_lock(&self->lock);
+		self->results[idx] = result;
+
+		// Then release it's dependents, waking up a thread for each one ready
+		const TfsCommandReplayNode* node = &self->nodes[idx];
+		for (size_t n = 0; n < node->dependents_len; n++) {
+			size_t dependent = node->dependents[n];
+			if (--self->nodes[dependent].pending == 0) {
+				self->ready[self->ready_len++] = dependent;
+				tfs_cond_var_signal(&self->cond);
+			}
+		}
+		self->remaining--;
+		if (self->remaining == 0) { tfs_cond_var_broadcast(&self->cond); }
+	}
+	tfs_mutex_unlock(&self->lock);
+}
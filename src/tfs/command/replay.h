@@ -0,0 +1,116 @@
+/// @file
+/// @brief Conflict-aware parallel replay of commands
+/// @details
+/// This file defines the #TfsCommandReplay type, which executes a sequence
+/// of commands in parallel, while leaving the file system, and the result
+/// of each command, just as if they were executed in sequence.
+///
+/// Each command is analysed into the paths it accesses:
+/// - Lookups read their path, which only creates, removes and moves of the
+///   path itself, or of any of it's ancestors, may change.
+/// - Creates and removes write the whole subtree of their path, along with
+///   the entries of their parent directory, as directories keep their entries
+///   in the order of the slots they were added to.
+/// - Moves write the subtrees of both paths, along with both parents' entries.
+/// - Prints read the whole file system, and are executed in order among
+///   themselves, as they may print to the same file.
+///
+/// A command depends on every earlier command it conflicts with, forming a
+/// DAG, and is only executed once all of them were. Rather than comparing
+/// every pair of commands, paths are kept in a trie, each node with the
+/// last command that wrote it, the last one that wrote it's entries and the
+/// lookups since, so a command depends on just those, which in turn depend
+/// on any other conflicting commands before them.
+
+#ifndef TFS_COMMAND_REPLAY_H
+#define TFS_COMMAND_REPLAY_H
+
+// Imports
+#include <stdbool.h>			 // bool
+#include <stddef.h>				 // size_t
+#include <tfs/command/command.h> // TfsCommand
+#include <tfs/cond_var.h>		 // TfsCondVar
+#include <tfs/mutex.h>			 // TfsMutex
+
+/// @brief Function executing a command, returning if executed successfully
+typedef bool (*TfsCommandReplayFn)(const TfsCommand* command, void* arg);
+
+/// @brief A command in the DAG
+typedef struct TfsCommandReplayNode {
+	/// @brief Commands depending on this one
+	size_t* dependents;
+
+	/// @brief Number of commands in @ref dependents
+	size_t dependents_len;
+
+	/// @brief Capacity of @ref dependents
+	size_t dependents_capacity;
+
+	/// @brief Number of commands this one depends on
+	size_t dependencies;
+
+	/// @brief Number of commands this one depends on still to be executed
+	size_t pending;
+} TfsCommandReplayNode;
+
+/// @brief Conflict-aware parallel replay of commands
+typedef struct TfsCommandReplay {
+	/// @brief All commands, in order
+	/// @details
+	/// These are borrowed, and must outlive the replay.
+	const TfsCommand* commands;
+
+	/// @brief Number of commands
+	size_t len;
+
+	/// @brief Node of each command
+	TfsCommandReplayNode* nodes;
+
+	/// @brief Result of each command, once executed
+	bool* results;
+
+	/// @brief Number of dependencies between all commands
+	size_t edges;
+
+	/// @brief Number of commands in the longest chain of dependencies
+	size_t depth;
+
+	/// @brief Commands ready to be executed, as a stack
+	size_t* ready;
+
+	/// @brief Number of commands in @ref ready
+	size_t ready_len;
+
+	/// @brief Number of commands not yet executed
+	size_t remaining;
+
+	/// @brief Lock over the ready commands
+	TfsMutex lock;
+
+	/// @brief Signaled whenever a command becomes ready, or all were executed
+	TfsCondVar cond;
+
+	/// @brief Function executing each command
+	TfsCommandReplayFn fn;
+
+	/// @brief Argument passed to @ref fn
+	void* arg;
+} TfsCommandReplay;
+
+/// @brief Creates a new replay, building the DAG of @p commands
+/// @param commands All commands, in order. Must outlive the replay.
+/// @param len Number of commands
+/// @param fn Function executing each command
+/// @param arg Argument passed to @p fn
+TfsCommandReplay tfs_command_replay_new(const TfsCommand* commands, size_t len, TfsCommandReplayFn fn, void* arg);
+
+/// @brief Destroys a replay
+void tfs_command_replay_destroy(TfsCommandReplay* self);
+
+/// @brief Executes commands as they become ready, until all were executed
+/// @details
+/// Should be called by each thread executing the commands. The result
+/// of each command is stored in @ref TfsCommandReplay::results.
+void tfs_command_replay_run(TfsCommandReplay* self);
+
+#endif
@@ -2,6 +2,7 @@
 
 // Imports
 #include <assert.h>
+#include <errno.h> // ETIMEDOUT
 
 TfsCondVar tfs_cond_var_new(void) {
 	return (TfsCondVar){
@@ -17,6 +18,12 @@ void tfs_cond_var_wait(TfsCondVar* self, TfsMutex* mutex) {
 	assert(pthread_cond_wait(&self->cond, &mutex->mutex) == 0);
 }
 
+bool tfs_cond_var_timed_wait(TfsCondVar* self, TfsMutex* mutex, const struct timespec* deadline) {
+	int err = pthread_cond_timedwait(&self->cond, &mutex->mutex, deadline);
+	assert(err == 0 || err == ETIMEDOUT);
+	return err == 0;
+}
+
 void tfs_cond_var_signal(TfsCondVar* self) {
 	assert(pthread_cond_signal(&self->cond) == 0);
 }
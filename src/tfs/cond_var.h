@@ -9,7 +9,9 @@
 
 // Imports
 #include <pthread.h>   // pthread
+#include <stdbool.h>   // bool
 #include <tfs/mutex.h> // TfsMutex
+#include <time.h>	   // timespec
 
 /// @brief Synchronization condition variable
 /// @details
@@ -34,6 +36,15 @@ void tfs_cond_var_destroy(TfsCondVar* self);
 /// condition.
 void tfs_cond_var_wait(TfsCondVar* self, TfsMutex* mutex);
 
+/// @brief Waits on this cond var until a signal is emmitted or @p deadline passes.
+/// @param self
+/// @param mutex The mutex to wait on. _MUST_ be locked.
+/// @param deadline Absolute `CLOCK_REALTIME` time to stop waiting at.
+/// @return If woken up before the deadline
+/// @note
+/// Just like #tfs_cond_var_wait, spurious wake ups may occur.
+bool tfs_cond_var_timed_wait(TfsCondVar* self, TfsMutex* mutex, const struct timespec* deadline);
+
 /// @brief Signals to a single thread waiting on this cond var.
 void tfs_cond_var_signal(TfsCondVar* self);
 
@@ -0,0 +1,89 @@
+#include "coroutine.h"
+
+// Imports
+#include <assert.h>	  // assert
+#include <stdio.h>	  // fprintf, stderr
+#include <stdlib.h>	  // exit, EXIT_FAILURE
+#include <sys/mman.h> // mmap, mprotect, munmap
+#include <unistd.h>	  // sysconf
+
+/// @brief Coroutine running on this thread, if any
+static __thread TfsCoroutine* current = NULL;
+
+/// @brief Returns the size of a page
+static size_t page_size(void) {
+	long size = sysconf(_SC_PAGESIZE);
+	return size <= 0 ? 4096 : (size_t)size;
+}
+
+TfsCoroutine tfs_coroutine_new(size_t stack_size) {
+	// Note: The stack is rounded up to whole pages, with an extra guard page below it.
+	size_t page = page_size();
+	stack_size = (stack_size + page - 1) / page * page;
+	char* mapping =
+		mmap(NULL, stack_size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mapping == MAP_FAILED || mprotect(mapping, page, PROT_NONE) < 0) {
+		fprintf(stderr, "Unable to allocate coroutine stack of %zu bytes\n", stack_size);
+		exit(EXIT_FAILURE);
+	}
+
+	return (TfsCoroutine){
+		.stack = mapping + page,
+		.stack_size = stack_size,
+		.fn = NULL,
+		.arg = NULL,
+		.done = true,
+	};
+}
+
+void tfs_coroutine_destroy(TfsCoroutine* self) {
+	size_t page = page_size();
+	munmap((char*)self->stack - page, self->stack_size + page);
+}
+
+/// @brief Entry point of all coroutines
+/// @details
+/// As `makecontext` can only pass integers, the coroutine is taken from #current instead.
+static void trampoline(void) {
+	TfsCoroutine* self = current;
+	self->fn(self->arg);
+	self->done = true;
+
+	// Note: We return through `uc_link`, which is the caller's context.
+}
+
+void tfs_coroutine_start(TfsCoroutine* self, TfsCoroutineFn fn, void* arg) {
+	assert(self->done);
+
+	getcontext(&self->context);
+	self->context.uc_stack.ss_sp = self->stack;
+	self->context.uc_stack.ss_size = self->stack_size;
+	self->context.uc_link = &self->caller;
+	makecontext(&self->context, trampoline, 0);
+
+	self->fn = fn;
+	self->arg = arg;
+	self->done = false;
+}
+
+bool tfs_coroutine_resume(TfsCoroutine* self) {
+	assert(!self->done);
+	assert(current == NULL);
+
+	current = self;
+	swapcontext(&self->caller, &self->context);
+	current = NULL;
+
+	return self->done;
+}
+
+void tfs_coroutine_park(void) {
+	TfsCoroutine* self = current;
+	assert(self != NULL);
+
+	swapcontext(&self->context, &self->caller);
+}
+
+TfsCoroutine* tfs_coroutine_current(void) {
+	return current;
+}
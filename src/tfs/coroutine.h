@@ -0,0 +1,75 @@
+/// @file
+/// @brief User-space coroutines
+/// @details
+/// This file defines the #TfsCoroutine type, a function running on it's own
+/// stack, which may park itself, returning control to the thread that resumed
+/// it, and be resumed later from where it parked.
+///
+/// Coroutines are never moved between threads, as they may park while holding
+/// locks, such as pthread rw locks, which must be unlocked by the same thread.
+
+#ifndef TFS_COROUTINE_H
+#define TFS_COROUTINE_H
+
+// Imports
+#include <stdbool.h>  // bool
+#include <stddef.h>	  // size_t
+#include <ucontext.h> // ucontext_t
+
+/// @brief Function run by a coroutine
+typedef void (*TfsCoroutineFn)(void* arg);
+
+/// @brief A coroutine
+typedef struct TfsCoroutine {
+	/// @brief Context of the coroutine, while parked
+	ucontext_t context;
+
+	/// @brief Context of the thread that resumed the coroutine, while running
+	ucontext_t caller;
+
+	/// @brief The coroutine's stack
+	void* stack;
+
+	/// @brief Size of @ref stack, without it's guard page
+	size_t stack_size;
+
+	/// @brief Function being run
+	TfsCoroutineFn fn;
+
+	/// @brief Argument to @ref fn
+	void* arg;
+
+	/// @brief If the function returned
+	bool done;
+} TfsCoroutine;
+
+/// @brief Creates a new coroutine, with nothing to run
+/// @param stack_size Size of it's stack
+/// @details
+/// The stack is reserved, but only committed as it's used, and has a guard
+/// page below it, so an overflow crashes rather than corrupting memory.
+TfsCoroutine tfs_coroutine_new(size_t stack_size);
+
+/// @brief Destroys a coroutine
+/// @details
+/// The coroutine must not be parked, as anything on it's stack is lost.
+void tfs_coroutine_destroy(TfsCoroutine* self);
+
+/// @brief Sets the function the coroutine runs, once resumed
+/// @details
+/// The coroutine must not be parked, and it's stack is reused.
+void tfs_coroutine_start(TfsCoroutine* self, TfsCoroutineFn fn, void* arg);
+
+/// @brief Resumes the coroutine until it parks or returns
+/// @return If the function returned
+bool tfs_coroutine_resume(TfsCoroutine* self);
+
+/// @brief Parks the current coroutine, returning control to the thread that resumed it
+/// @details
+/// Must be called from within a coroutine.
+void tfs_coroutine_park(void);
+
+/// @brief Returns the coroutine running on this thread, if any
+TfsCoroutine* tfs_coroutine_current(void);
+
+#endif
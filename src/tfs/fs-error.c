@@ -135,6 +135,11 @@ void tfs_fs_print_error_print(const TfsFsPrintError* self, FILE* out) {
 			break;
 		}
 
+		case TfsFsPrintErrorWrite: {
+			fprintf(out, "Unable to write file\n");
+			break;
+		}
+
 		default: {
 			break;
 		}
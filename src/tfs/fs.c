@@ -545,6 +545,7 @@ TfsFsMoveResult tfs_fs_move(TfsFs* self, TfsPath orig_path, TfsPath dest_path, T
 		for (size_t n = 0; n < locked_dest_inodes_len; n++) {
 			tfs_inode_table_unlock_inode(&self->inode_table, locked_dest_inodes[n].idx);
 		}
+		tfs_inode_table_unlock_inode(&self->inode_table, orig.idx);
 
 		return (TfsFsMoveResult){
 			.success = false,
@@ -586,6 +587,23 @@ TfsFsPrintResult tfs_fs_print(TfsFs* self, const char* file_name) {
 		};
 	}
 
+	// Print the filesystem to it
+	tfs_fs_print_to(self, out);
+
+	// Close the file
+	// Note: Closing flushes whatever is still buffered, so it also fails if any write did.
+	bool written = !ferror(out);
+	if (fclose(out) != 0 || !written) {
+		return (TfsFsPrintResult){
+			.success = false,
+			.data.err.kind = TfsFsPrintErrorWrite,
+		};
+	}
+
+	return (TfsFsPrintResult){.success = true};
+}
+
+void tfs_fs_print_to(TfsFs* self, FILE* out) {
 	// Lock the root for unique access
 	tfs_inode_table_lock(&self->inode_table, TFS_FS_ROOT_IDX, TfsRwLockAccessUnique);
 
@@ -593,13 +611,8 @@ TfsFsPrintResult tfs_fs_print(TfsFs* self, const char* file_name) {
 	// Note: We start off with '' as the root, instead of '/'.
 	tfs_inode_table_print_tree(&self->inode_table, TFS_FS_ROOT_IDX, out, "");
 
-	// Lock the root for unique access
+	// Unlock the root
 	tfs_inode_table_unlock_inode(&self->inode_table, TFS_FS_ROOT_IDX);
-
-	// Close the file and unlock
-	assert(fclose(out) == 0);
-
-	return (TfsFsPrintResult){.success = true};
 }
 
 void tfs_fs_unlock_inode(TfsFs* self, TfsInodeIdx idx) {
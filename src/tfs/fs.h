@@ -290,6 +290,9 @@ typedef struct TfsFsPrintError {
 	enum {
 		/// @brief Unable to create file
 		TfsFsPrintErrorCreate,
+
+		/// @brief Unable to write the whole file
+		TfsFsPrintErrorWrite,
 	} kind;
 } TfsFsPrintError;
 
@@ -371,6 +374,14 @@ TfsFsMoveResult tfs_fs_move(TfsFs* self, TfsPath orig_path, TfsPath dest_path, T
 /// @param file_name File to output to.
 TfsFsPrintResult tfs_fs_print(TfsFs* self, const char* file_name);
 
+/// @brief Prints the contents of the filesystem to an open file
+/// @param self
+/// @param out File to output to.
+/// @details
+/// Unlike #tfs_fs_print, this neither creates nor closes the file,
+/// so it may be used to render the contents into memory.
+void tfs_fs_print_to(TfsFs* self, FILE* out);
+
 /// @brief Unlocks an inode
 /// @param self
 /// @param idx The index of the inode to unlock. _Must_ be valid.
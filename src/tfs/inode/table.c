@@ -1,10 +1,12 @@
 #include "table.h"
 
 // Includes
-#include <stdio.h>	  // stderr, fprintf
-#include <stdlib.h>	  // exit, EXIT_FAILURE
-#include <string.h>	  // strlen, strncpy
-#include <tfs/util.h> // tfs_min_size_t
+#include <stdio.h>		   // stderr, fprintf
+#include <stdlib.h>		   // exit, EXIT_FAILURE
+#include <string.h>		   // strlen, strncpy
+#include <tfs/coroutine.h> // tfs_coroutine_current, tfs_coroutine_park
+#include <tfs/trace.h>	   // tfs_trace_begin, tfs_trace_end_arg
+#include <tfs/util.h>	   // tfs_min_size_t
 
 TfsInodeTable tfs_inode_table_new(size_t size) {
 	// Create all inodes
@@ -68,7 +70,18 @@ TfsLockedInode tfs_inode_table_lock(TfsInodeTable* const self, TfsInodeIdx idx,
 	assert(idx.idx < self->capacity);
 
 	// Lock the inode
-	tfs_rw_lock_lock(&self->inodes[idx.idx].lock, access);
+	// Note: The span's name includes the access type so contention
+	//       on shared and unique locks can be told apart in the trace.
+	// Note: Within a coroutine, we park it until the lock is free, rather than blocking the
+	//       whole thread, as the lock's holder may be another coroutine on the same thread.
+	TfsTraceSpan span = tfs_trace_begin();
+	if (tfs_coroutine_current() != NULL) {
+		while (!tfs_rw_lock_try_lock(&self->inodes[idx.idx].lock, access)) { tfs_coroutine_park(); }
+	}
+	else {
+		tfs_rw_lock_lock(&self->inodes[idx.idx].lock, access);
+	}
+	tfs_trace_end_arg(span, access == TfsRwLockAccessShared ? "lock shared" : "lock unique", "inode", idx.idx);
 
 	// Make sure it's not empty
 	assert(self->inodes[idx.idx].type != TfsInodeTypeNone);
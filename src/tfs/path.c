@@ -71,6 +71,19 @@ bool tfs_path_eq(TfsPath lhs, TfsPath rhs) {
 	} while (1);
 }
 
+bool tfs_path_starts_with(TfsPath self, TfsPath prefix) {
+	do {
+		// If the prefix ran out of components, it's a prefix
+		TfsPath prefix_first = tfs_path_pop_first(prefix, &prefix);
+		if (prefix_first.len == 0) { return true; }
+
+		// Else the component must be the same
+		// Note: They've been trimmed by `pop_first`.
+		TfsPath self_first = tfs_path_pop_first(self, &self);
+		if (!tfs_str_eq(self_first.chars, self_first.len, prefix_first.chars, prefix_first.len)) { return false; }
+	} while (1);
+}
+
 TfsPath tfs_path_trim(TfsPath self) {
 	// Remove any leading slashes and whitespace
 	while (self.len > 0 && is_slash_or_space(self.chars[0])) {
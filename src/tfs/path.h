@@ -56,6 +56,14 @@ TfsPathOwned tfs_path_to_owned(TfsPath self);
 /// contain the same components.
 bool tfs_path_eq(TfsPath lhs, TfsPath rhs);
 
+/// @brief Checks if a path starts with another.
+/// @details
+/// A path starts with @p prefix if it's first components are
+/// all of the components of @p prefix, that is, if it is
+/// @p prefix itself or one of it's descendants.
+/// All paths start with the empty path.
+bool tfs_path_starts_with(TfsPath self, TfsPath prefix);
+
 /// @brief Trims this path.
 /// @details
 /// This will remove any leading and trailing whitespace
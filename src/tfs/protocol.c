@@ -0,0 +1,146 @@
+#include "protocol.h"
+
+void tfs_protocol_header_read_error_print(const TfsProtocolHeaderReadError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsProtocolHeaderReadErrorTooShort: {
+			fprintf(out, "Message is too short to contain a header\n");
+			break;
+		}
+		case TfsProtocolHeaderReadErrorMagic: {
+			fprintf(out, "Message does not start with the magic byte\n");
+			break;
+		}
+		case TfsProtocolHeaderReadErrorUnknownKind: {
+			fprintf(out, "Unknown message kind\n");
+			break;
+		}
+		case TfsProtocolHeaderReadErrorTooManyCommands: {
+			fprintf(out, "Message has more than %d commands\n", TFS_PROTOCOL_MAX_BATCH_LEN);
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+bool tfs_protocol_is_framed(const char* message, size_t message_len) {
+	return message_len > 0 && (unsigned char)message[0] == TFS_PROTOCOL_MAGIC;
+}
+
+TfsProtocolHeaderReadResult tfs_protocol_header_read(const char* message, size_t message_len) {
+	if (message_len < TFS_PROTOCOL_HEADER_LEN) {
+		return (TfsProtocolHeaderReadResult){
+			.success = false,
+			.data.err.kind = TfsProtocolHeaderReadErrorTooShort,
+		};
+	}
+	if (!tfs_protocol_is_framed(message, message_len)) {
+		return (TfsProtocolHeaderReadResult){
+			.success = false,
+			.data.err.kind = TfsProtocolHeaderReadErrorMagic,
+		};
+	}
+
+	// Note: The header is `magic, kind, count (2 bytes), id (4 bytes)`, all little endian.
+	const unsigned char* bytes = (const unsigned char*)message;
+	size_t count = (size_t)bytes[2] | (size_t)bytes[3] << 8;
+	uint32_t id = tfs_protocol_u32_read(message + 4);
+	switch (bytes[1]) {
+		case TfsProtocolKindBatch:
+		case TfsProtocolKindLease:
+		case TfsProtocolKindInvalidate:
+		case TfsProtocolKindAttach:
+		case TfsProtocolKindBusy:
+		case TfsProtocolKindPool: break;
+		default: {
+			return (TfsProtocolHeaderReadResult){
+				.success = false,
+				.data.err.kind = TfsProtocolHeaderReadErrorUnknownKind,
+			};
+		}
+	}
+	if (count > TFS_PROTOCOL_MAX_BATCH_LEN) {
+		return (TfsProtocolHeaderReadResult){
+			.success = false,
+			.data.err.kind = TfsProtocolHeaderReadErrorTooManyCommands,
+		};
+	}
+
+	return (TfsProtocolHeaderReadResult){
+		.success = true,
+		.data.header.kind = (TfsProtocolKind)bytes[1],
+		.data.header.count = count,
+		.data.header.id = id,
+	};
+}
+
+void tfs_protocol_header_write(TfsProtocolHeader header, char* message) {
+	unsigned char* bytes = (unsigned char*)message;
+	bytes[0] = TFS_PROTOCOL_MAGIC;
+	bytes[1] = (unsigned char)header.kind;
+	bytes[2] = (unsigned char)(header.count & 0xff);
+	bytes[3] = (unsigned char)(header.count >> 8);
+	tfs_protocol_u32_write(header.id, message + 4);
+}
+
+uint32_t tfs_protocol_u32_read(const char* bytes) {
+	const unsigned char* unsigned_bytes = (const unsigned char*)bytes;
+	return (uint32_t)unsigned_bytes[0] | (uint32_t)unsigned_bytes[1] << 8 | (uint32_t)unsigned_bytes[2] << 16 |
+		   (uint32_t)unsigned_bytes[3] << 24;
+}
+
+void tfs_protocol_u32_write(uint32_t value, char* bytes) {
+	unsigned char* unsigned_bytes = (unsigned char*)bytes;
+	for (size_t n = 0; n < 4; n++) { unsigned_bytes[n] = (unsigned char)(value >> (8 * n)); }
+}
+
+/// @brief Writes a request of kind @p kind with several commands
+static bool commands_write( //
+	TfsProtocolKind kind,
+	const TfsCommand* commands,
+	size_t commands_len,
+	uint32_t id,
+	char* message,
+	size_t message_capacity,
+	size_t* message_len //
+) {
+	if (commands_len > TFS_PROTOCOL_MAX_BATCH_LEN || message_capacity < TFS_PROTOCOL_HEADER_LEN) { return false; }
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = kind, .count = commands_len, .id = id}, message);
+
+	// Write each command, followed by a newline
+	// Note: Each command is written in place, and a command that doesn't fit, along with it's newline, fails the
+	//       whole message, rather than being sent cut short.
+	size_t len = TFS_PROTOCOL_HEADER_LEN;
+	for (size_t n = 0; n < commands_len; n++) {
+		size_t command_str_len = tfs_command_to_string(&commands[n], message + len, message_capacity - len);
+		if (command_str_len + 1 > message_capacity - len) { return false; }
+
+		message[len + command_str_len] = '\n';
+		len += command_str_len + 1;
+	}
+
+	*message_len = len;
+	return true;
+}
+
+bool tfs_protocol_batch_write( //
+	const TfsCommand* commands,
+	size_t commands_len,
+	uint32_t id,
+	char* message,
+	size_t message_capacity,
+	size_t* message_len //
+) {
+	return commands_write(TfsProtocolKindBatch, commands, commands_len, id, message, message_capacity, message_len);
+}
+
+bool tfs_protocol_lease_write( //
+	const TfsCommand* command,
+	uint32_t id,
+	char* message,
+	size_t message_capacity,
+	size_t* message_len //
+) {
+	return commands_write(TfsProtocolKindLease, command, 1, id, message, message_capacity, message_len);
+}
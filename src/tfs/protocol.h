@@ -0,0 +1,216 @@
+/// @file
+/// @brief Client-server message framing
+/// @details
+/// This file defines the framing of messages exchanged between
+/// the tfs clients and server.
+///
+/// A legacy message is a single nul-terminated text command, as
+/// produced by #tfs_command_to_string, and it's reply is a single
+/// byte, `'\0'` on failure and `'\1'` on success.
+///
+/// A framed message starts with a #TFS_PROTOCOL_HEADER_LEN byte header,
+/// whose first byte is #TFS_PROTOCOL_MAGIC. As text commands always
+/// start with a printable character, it can't be mistaken for a legacy message.
+///
+/// A batch request's body holds `count` text commands, each terminated
+/// by a newline, which are executed in order. It's reply holds `count`
+/// bytes, the result of each command, in the same format as a legacy reply.
+///
+/// Every framed request carries an id, chosen by the client, which the server
+/// copies to it's reply. As workers execute requests concurrently, replies may
+/// arrive in a different order than their requests were sent, and clients with
+/// several requests in flight match them by their id.
+///
+/// A lease request's body holds a single lookup command, just like a batch.
+/// It's reply holds the result of the lookup followed by the duration, in
+/// milliseconds, of a lease the server grants on it, or `0` if none. Until the
+/// lease expires, the server sends the client an invalidation message whenever
+/// a command might change the result, whose body is the path affected. Every
+/// path within the affected path should also be considered invalidated.
+///
+/// An attach request has no body, and carries the file descriptor of a
+/// shared-memory region, see #TfsShmRing, as ancillary data. It's reply holds
+/// a single byte, `'\1'` if the server attached the region. From then on, the
+/// client may exchange messages through the region instead of the socket.
+///
+/// Instead of executing a request, an overloaded server may reply with a busy
+/// message, with the request's id, no results and a body holding the number
+/// of milliseconds, as a 32-bit integer, the client should wait for before
+/// retrying the request. Legacy requests, which can't be told to retry, are
+/// failed instead.
+///
+/// A pool request's body holds a 32-bit integer, `0` to only read the size
+/// of the server's executor pool, #TFS_PROTOCOL_POOL_ADAPT to let the server
+/// adapt it again, or else the size to pin it to. It's reply holds the
+/// resulting size, number of running executors, minimum and maximum sizes,
+/// all as 32-bit integers, followed by a byte, `'\1'` if the size is pinned.
+/// A server without an adaptive pool replies with all of them `0`.
+
+#ifndef TFS_PROTOCOL_H
+#define TFS_PROTOCOL_H
+
+// Imports
+#include <stdbool.h>			 // bool
+#include <stddef.h>				 // size_t
+#include <stdint.h>				 // uint32_t, UINT32_MAX
+#include <stdio.h>				 // FILE
+#include <tfs/command/command.h> // TfsCommand
+
+/// @brief Magic byte that starts all framed messages
+#define TFS_PROTOCOL_MAGIC 0xf5
+
+/// @brief Length of the header of all framed messages
+#define TFS_PROTOCOL_HEADER_LEN 8
+
+/// @brief Maximum length of any message
+#define TFS_PROTOCOL_MAX_MESSAGE_LEN 16384
+
+/// @brief Maximum number of commands in a batch
+#define TFS_PROTOCOL_MAX_BATCH_LEN 1024
+
+/// @brief Length of the reply to a lease request
+#define TFS_PROTOCOL_LEASE_REPLY_LEN (TFS_PROTOCOL_HEADER_LEN + 1 + 4)
+
+/// @brief Length of the reply to an attach request
+#define TFS_PROTOCOL_ATTACH_REPLY_LEN (TFS_PROTOCOL_HEADER_LEN + 1)
+
+/// @brief Length of a busy reply
+#define TFS_PROTOCOL_BUSY_REPLY_LEN (TFS_PROTOCOL_HEADER_LEN + 4)
+
+/// @brief Length of a pool request
+#define TFS_PROTOCOL_POOL_REQUEST_LEN (TFS_PROTOCOL_HEADER_LEN + 4)
+
+/// @brief Length of the reply to a pool request
+#define TFS_PROTOCOL_POOL_REPLY_LEN (TFS_PROTOCOL_HEADER_LEN + 4 * 4 + 1)
+
+/// @brief Size in a pool request that lets the server adapt the size again
+#define TFS_PROTOCOL_POOL_ADAPT UINT32_MAX
+
+/// @brief Framed message kinds
+typedef enum TfsProtocolKind {
+	/// @brief Batch of commands
+	TfsProtocolKindBatch = 1,
+
+	/// @brief Lookup with a lease on it's result
+	TfsProtocolKindLease = 2,
+
+	/// @brief Invalidation of leased results
+	TfsProtocolKindInvalidate = 3,
+
+	/// @brief Attachment of a shared-memory region
+	TfsProtocolKindAttach = 4,
+
+	/// @brief Rejection of a request by an overloaded server
+	TfsProtocolKindBusy = 5,
+
+	/// @brief Administration of the server's executor pool
+	TfsProtocolKindPool = 6,
+} TfsProtocolKind;
+
+/// @brief Header of a framed message
+typedef struct TfsProtocolHeader {
+	/// @brief Message kind
+	TfsProtocolKind kind;
+
+	/// @brief Number of commands, or results, in the message
+	size_t count;
+
+	/// @brief Request id
+	uint32_t id;
+} TfsProtocolHeader;
+
+/// @brief Error type for #tfs_protocol_header_read
+typedef struct TfsProtocolHeaderReadError {
+	/// @brief Error kind
+	enum {
+		/// @brief Message is shorter than a header
+		TfsProtocolHeaderReadErrorTooShort,
+
+		/// @brief Message doesn't start with the magic byte
+		TfsProtocolHeaderReadErrorMagic,
+
+		/// @brief Unknown message kind
+		TfsProtocolHeaderReadErrorUnknownKind,
+
+		/// @brief Message has too many commands
+		TfsProtocolHeaderReadErrorTooManyCommands,
+	} kind;
+} TfsProtocolHeaderReadError;
+
+/// @brief Result type for #tfs_protocol_header_read
+typedef struct TfsProtocolHeaderReadResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Success header
+		TfsProtocolHeader header;
+
+		/// @brief Underlying error
+		TfsProtocolHeaderReadError err;
+	} data;
+} TfsProtocolHeaderReadResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_protocol_header_read_error_print(const TfsProtocolHeaderReadError* self, FILE* out);
+
+/// @brief Checks if a message is framed
+/// @param message The message
+/// @param message_len Length of @p message
+bool tfs_protocol_is_framed(const char* message, size_t message_len);
+
+/// @brief Reads the header of a framed message
+/// @param message The message
+/// @param message_len Length of @p message
+TfsProtocolHeaderReadResult tfs_protocol_header_read(const char* message, size_t message_len);
+
+/// @brief Writes a header to the start of a message
+/// @param header The header to write
+/// @param[out] message The message. Must have at least #TFS_PROTOCOL_HEADER_LEN bytes.
+void tfs_protocol_header_write(TfsProtocolHeader header, char* message);
+
+/// @brief Reads a little endian 32-bit integer
+/// @param bytes The bytes to read from. Must have at least `4` bytes.
+uint32_t tfs_protocol_u32_read(const char* bytes);
+
+/// @brief Writes a little endian 32-bit integer
+/// @param value The value to write
+/// @param[out] bytes The bytes to write to. Must have at least `4` bytes.
+void tfs_protocol_u32_write(uint32_t value, char* bytes);
+
+/// @brief Writes a batch request with several commands
+/// @param commands The commands
+/// @param commands_len Number of commands
+/// @param id Request id
+/// @param[out] message The message to write to
+/// @param message_capacity Capacity of @p message
+/// @param[out] message_len Length of the message written
+/// @return If the whole batch fit in the message
+bool tfs_protocol_batch_write( //
+	const TfsCommand* commands,
+	size_t commands_len,
+	uint32_t id,
+	char* message,
+	size_t message_capacity,
+	size_t* message_len //
+);
+
+/// @brief Writes a lease request
+/// @param command The lookup command
+/// @param id Request id
+/// @param[out] message The message to write to
+/// @param message_capacity Capacity of @p message
+/// @param[out] message_len Length of the message written
+/// @return If the command fit in the message
+bool tfs_protocol_lease_write( //
+	const TfsCommand* command,
+	uint32_t id,
+	char* message,
+	size_t message_capacity,
+	size_t* message_len //
+);
+
+#endif
@@ -1,9 +1,14 @@
 #include "rw_lock.h"
 
 // Imports
-#include <assert.h> // assert
-#include <errno.h>	// EBUSY
-#include <stdlib.h> // exit, EXIT_FAILURE
+#include <assert.h>	  // assert
+#include <errno.h>	  // EBUSY
+#include <stdlib.h>	  // exit, EXIT_FAILURE
+#include <tfs/util.h> // tfs_now_ns
+#include <time.h>	  // CLOCK_MONOTONIC
+
+/// @brief Total time this thread spent blocked on rw locks, in nanoseconds
+static __thread uint64_t blocked_ns = 0;
 
 TfsRwLock tfs_rw_lock_new(void) {
 	return (TfsRwLock){
@@ -16,6 +21,10 @@ void tfs_rw_lock_destroy(TfsRwLock* self) { //
 }
 
 void tfs_rw_lock_lock(TfsRwLock* self, TfsRwLockAccess access) {
+	// Note: We only read the clock if we'd block, so uncontended locks stay as cheap as before.
+	if (tfs_rw_lock_try_lock(self, access)) { return; }
+	uint64_t start_ns = tfs_now_ns(CLOCK_MONOTONIC);
+
 	switch (access) {
 		case TfsRwLockAccessShared: {
 			int err = pthread_rwlock_rdlock(&self->rw_lock);
@@ -32,6 +41,8 @@ void tfs_rw_lock_lock(TfsRwLock* self, TfsRwLockAccess access) {
 			break;
 		}
 	}
+
+	blocked_ns += tfs_now_ns(CLOCK_MONOTONIC) - start_ns;
 }
 
 bool tfs_rw_lock_try_lock(TfsRwLock* self, TfsRwLockAccess access) {
@@ -67,3 +78,7 @@ bool tfs_rw_lock_try_lock(TfsRwLock* self, TfsRwLockAccess access) {
 void tfs_rw_lock_unlock(TfsRwLock* self) { //
 	assert(pthread_rwlock_unlock(&self->rw_lock) == 0);
 }
+
+uint64_t tfs_rw_lock_blocked_ns(void) {
+	return blocked_ns;
+}
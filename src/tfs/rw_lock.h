@@ -10,6 +10,7 @@
 // Imports
 #include <pthread.h> // pthread
 #include <stdbool.h> // bool
+#include <stdint.h>	 // uint64_t
 
 /// @brief Lock access
 typedef enum TfsRwLockAccess {
@@ -42,6 +43,9 @@ void tfs_rw_lock_destroy(TfsRwLock* self);
 /// @brief Locks this rw lock.
 /// @param self
 /// @param access Access type to lock the lock with
+/// @details
+/// If the lock is contended, the time spent blocked on it
+/// is accounted to the calling thread, see #tfs_rw_lock_blocked_ns.
 void tfs_rw_lock_lock(TfsRwLock* self, TfsRwLockAccess access);
 
 /// @brief Attempts to lock this rw lock.
@@ -53,4 +57,7 @@ bool tfs_rw_lock_try_lock(TfsRwLock* self, TfsRwLockAccess access);
 /// @brief Unlocks this rw lock
 void tfs_rw_lock_unlock(TfsRwLock* self);
 
+/// @brief Returns the total time the calling thread spent blocked on rw locks, in nanoseconds
+uint64_t tfs_rw_lock_blocked_ns(void);
+
 #endif
@@ -0,0 +1,200 @@
+#include "admission.h"
+
+// Imports
+#include <inttypes.h> // PRIu64
+#include <stdlib.h>	  // malloc, calloc, free, exit, EXIT_FAILURE
+#include <string.h>	  // memcmp
+
+TfsServerAdmission tfs_server_admission_new(size_t clients_capacity, size_t queue_capacity, size_t quantum) {
+	TfsServerAdmission admission = {
+		.clients = calloc(clients_capacity, sizeof(TfsServerAdmissionClient)),
+		.clients_capacity = clients_capacity,
+		.active = malloc(clients_capacity * sizeof(size_t)),
+		.active_head = 0,
+		.active_len = 0,
+		.queue_capacity = queue_capacity,
+		.quantum = quantum,
+		.average_ns = 0,
+		.untracked_rejected = 0,
+		.lock = tfs_mutex_new(),
+		.not_empty = tfs_cond_var_new(),
+		.closed = false,
+	};
+	if (admission.clients == NULL || admission.active == NULL) {
+		fprintf(stderr, "Unable to allocate admission for %zu clients\n", clients_capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t n = 0; n < clients_capacity; n++) {
+		admission.clients[n].entries = malloc(queue_capacity * sizeof(TfsServerAdmissionEntry));
+		if (admission.clients[n].entries == NULL) {
+			fprintf(stderr, "Unable to allocate admission queue with capacity %zu\n", queue_capacity);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	return admission;
+}
+
+void tfs_server_admission_destroy(TfsServerAdmission* self) {
+	for (size_t n = 0; n < self->clients_capacity; n++) { free(self->clients[n].entries); }
+	free(self->active);
+	free(self->clients);
+	tfs_cond_var_destroy(&self->not_empty);
+	tfs_mutex_destroy(&self->lock);
+}
+
+/// @brief Finds the client with address @p address, tracking it if new
+/// @return The client, or `NULL` if every client is tracked and none is idle
+/// @details
+/// Must be called with the lock held.
+static TfsServerAdmissionClient* find_client(
+	TfsServerAdmission* self, const struct sockaddr_un* address, socklen_t address_len) {
+	TfsServerAdmissionClient* idle = NULL;
+	for (size_t n = 0; n < self->clients_capacity; n++) {
+		TfsServerAdmissionClient* client = &self->clients[n];
+		if (client->address_len != 0 && client->address_len == address_len &&
+			memcmp(&client->address, address, address_len) == 0) {
+			return client;
+		}
+
+		// Note: We prefer unused clients over idle ones, so we keep the statistics of the latter for longer.
+		if (client->len == 0 && (idle == NULL || (idle->address_len != 0 && client->address_len == 0))) {
+			idle = client;
+		}
+	}
+	if (idle == NULL) { return NULL; }
+
+	idle->address = *address;
+	__atomic_store_n(&idle->address_len, address_len, __ATOMIC_RELAXED);
+	idle->head = 0;
+	idle->deficit = 0;
+	idle->stats = (TfsServerAdmissionStats){
+		.admitted = 0,
+		.rejected = 0,
+		.dispatched = 0,
+		.queued = 0,
+		.max_queued = 0,
+	};
+	return idle;
+}
+
+bool tfs_server_admission_push(TfsServerAdmission* self,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	void* item,
+	size_t cost,
+	uint32_t* retry_after_ms) {
+	tfs_mutex_lock(&self->lock);
+
+	// Note: We ask clients to retry after about as long as a full queue takes to be drained.
+	uint64_t drain_ns = self->average_ns * self->queue_capacity;
+	*retry_after_ms = drain_ns < 1000000u ? 1 : (uint32_t)(drain_ns / 1000000u);
+
+	TfsServerAdmissionClient* client = self->closed ? NULL : find_client(self, address, address_len);
+	if (client == NULL) {
+		__atomic_fetch_add(&self->untracked_rejected, 1, __ATOMIC_RELAXED);
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+	if (client->len == self->queue_capacity) {
+		__atomic_fetch_add(&client->stats.rejected, 1, __ATOMIC_RELAXED);
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+
+	// Queue the message, activating the client if it was idle
+	client->entries[(client->head + client->len) % self->queue_capacity] =
+		(TfsServerAdmissionEntry){.item = item, .cost = cost};
+	client->len++;
+	if (client->len == 1) {
+		self->active[(self->active_head + self->active_len) % self->clients_capacity] =
+			(size_t)(client - self->clients);
+		self->active_len++;
+	}
+
+	__atomic_fetch_add(&client->stats.admitted, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&client->stats.queued, client->len, __ATOMIC_RELAXED);
+	if (client->len > client->stats.max_queued) {
+		__atomic_store_n(&client->stats.max_queued, client->len, __ATOMIC_RELAXED);
+	}
+
+	tfs_cond_var_signal(&self->not_empty);
+	tfs_mutex_unlock(&self->lock);
+
+	return true;
+}
+
+void* tfs_server_admission_pop(TfsServerAdmission* self) {
+	tfs_mutex_lock(&self->lock);
+	while (1) {
+		while (self->active_len == 0 && !self->closed) { tfs_cond_var_wait(&self->not_empty, &self->lock); }
+		if (self->active_len == 0) {
+			tfs_mutex_unlock(&self->lock);
+			return NULL;
+		}
+
+		// If the first active client's next message doesn't fit in it's deficit, give
+		// it it's quantum for the next round and move on to the next client
+		size_t client_idx = self->active[self->active_head];
+		TfsServerAdmissionClient* client = &self->clients[client_idx];
+		TfsServerAdmissionEntry entry = client->entries[client->head];
+		if (entry.cost > client->deficit) {
+			client->deficit += self->quantum;
+			self->active_head = (self->active_head + 1) % self->clients_capacity;
+			self->active[(self->active_head + self->active_len - 1) % self->clients_capacity] = client_idx;
+			continue;
+		}
+
+		// Else hand it out, deactivating the client if it has no more messages
+		// Note: Idle clients don't keep their deficit, so they can't build up a burst.
+		client->deficit -= entry.cost;
+		client->head = (client->head + 1) % self->queue_capacity;
+		client->len--;
+		if (client->len == 0) {
+			client->deficit = 0;
+			self->active_head = (self->active_head + 1) % self->clients_capacity;
+			self->active_len--;
+		}
+		__atomic_fetch_add(&client->stats.dispatched, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&client->stats.queued, client->len, __ATOMIC_RELAXED);
+
+		tfs_mutex_unlock(&self->lock);
+		return entry.item;
+	}
+}
+
+void tfs_server_admission_record(TfsServerAdmission* self, uint64_t elapsed_ns) {
+	tfs_mutex_lock(&self->lock);
+	self->average_ns = self->average_ns == 0 ? elapsed_ns : (7 * self->average_ns + elapsed_ns) / 8;
+	tfs_mutex_unlock(&self->lock);
+}
+
+void tfs_server_admission_close(TfsServerAdmission* self) {
+	tfs_mutex_lock(&self->lock);
+	self->closed = true;
+	tfs_cond_var_broadcast(&self->not_empty);
+	tfs_mutex_unlock(&self->lock);
+}
+
+void tfs_server_admission_stats_print(const TfsServerAdmission* self, FILE* out) {
+	fprintf(out,
+		"Admission: %" PRIu64 " messages rejected without a queue\n",
+		__atomic_load_n(&self->untracked_rejected, __ATOMIC_RELAXED));
+	for (size_t n = 0; n < self->clients_capacity; n++) {
+		const TfsServerAdmissionClient* client = &self->clients[n];
+		socklen_t address_len = __atomic_load_n(&client->address_len, __ATOMIC_RELAXED);
+		if (address_len == 0) { continue; }
+
+		fprintf(out,
+			"Client '%.*s': %" PRIu64 " admitted, %" PRIu64 " rejected, %" PRIu64 " dispatched, %" PRIu64
+			" queued (at most %" PRIu64 ")\n",
+			(int)sizeof(client->address.sun_path),
+			client->address.sun_path,
+			__atomic_load_n(&client->stats.admitted, __ATOMIC_RELAXED),
+			__atomic_load_n(&client->stats.rejected, __ATOMIC_RELAXED),
+			__atomic_load_n(&client->stats.dispatched, __ATOMIC_RELAXED),
+			__atomic_load_n(&client->stats.queued, __ATOMIC_RELAXED),
+			__atomic_load_n(&client->stats.max_queued, __ATOMIC_RELAXED));
+	}
+}
@@ -0,0 +1,173 @@
+/// @file
+/// @brief Per-client admission control
+/// @details
+/// This file defines the #TfsServerAdmission type, which queues the messages
+/// received by the server in a bounded queue per client address, and hands
+/// them out to the executing threads in deficit round-robin order, so a single
+/// client flooding the server only ever fills it's own queue.
+///
+/// Each round, every client with queued messages gets a quantum of commands
+/// added to it's deficit, and it's messages are handed out while their cost,
+/// their number of commands, fits in it.
+///
+/// Once a client's queue is full, it's messages are rejected, and should be
+/// replied to with a busy reply, see #TfsProtocolKindBusy, asking the client
+/// to retry after about as long as it's queue takes to be drained.
+
+#ifndef TFS_SERVER_ADMISSION_H
+#define TFS_SERVER_ADMISSION_H
+
+// Imports
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint32_t, uint64_t
+#include <stdio.h>		  // FILE
+#include <sys/socket.h>	  // socklen_t
+#include <sys/un.h>		  // sockaddr_un
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/mutex.h>	  // TfsMutex
+
+/// @brief A queued message
+typedef struct TfsServerAdmissionEntry {
+	/// @brief The message
+	void* item;
+
+	/// @brief It's cost, in commands
+	size_t cost;
+} TfsServerAdmissionEntry;
+
+/// @brief Statistics of a client
+/// @details
+/// These are updated atomically, so they may be read without the lock.
+typedef struct TfsServerAdmissionStats {
+	/// @brief Number of messages admitted
+	uint64_t admitted;
+
+	/// @brief Number of messages rejected
+	uint64_t rejected;
+
+	/// @brief Number of messages handed out
+	uint64_t dispatched;
+
+	/// @brief Current number of messages queued
+	uint64_t queued;
+
+	/// @brief Maximum number of messages queued at once
+	uint64_t max_queued;
+} TfsServerAdmissionStats;
+
+/// @brief A client, along with it's queue
+typedef struct TfsServerAdmissionClient {
+	/// @brief Address of the client
+	struct sockaddr_un address;
+
+	/// @brief Length of @ref address, or `0` if this client is unused
+	socklen_t address_len;
+
+	/// @brief All queued messages, as a circular buffer
+	TfsServerAdmissionEntry* entries;
+
+	/// @brief Index of the first queued message
+	size_t head;
+
+	/// @brief Number of queued messages
+	size_t len;
+
+	/// @brief Deficit, in commands
+	size_t deficit;
+
+	/// @brief Statistics
+	TfsServerAdmissionStats stats;
+} TfsServerAdmissionClient;
+
+/// @brief Per-client admission control
+typedef struct TfsServerAdmission {
+	/// @brief All clients
+	TfsServerAdmissionClient* clients;
+
+	/// @brief Maximum number of clients
+	size_t clients_capacity;
+
+	/// @brief Indices of all clients with queued messages, in round-robin order, as a circular buffer
+	size_t* active;
+
+	/// @brief Index of the first active client
+	size_t active_head;
+
+	/// @brief Number of active clients
+	size_t active_len;
+
+	/// @brief Capacity of each client's queue
+	size_t queue_capacity;
+
+	/// @brief Commands added to each active client's deficit every round
+	size_t quantum;
+
+	/// @brief Exponential moving average of the time to execute a message, in nanoseconds
+	uint64_t average_ns;
+
+	/// @brief Number of messages rejected because no client could be tracked
+	uint64_t untracked_rejected;
+
+	/// @brief Lock over everything
+	TfsMutex lock;
+
+	/// @brief Signaled whenever a message is admitted or the admission is closed
+	TfsCondVar not_empty;
+
+	/// @brief If closed
+	bool closed;
+} TfsServerAdmission;
+
+/// @brief Creates a new admission control
+/// @param clients_capacity Maximum number of clients tracked at once
+/// @param queue_capacity Capacity of each client's queue
+/// @param quantum Commands added to each active client's deficit every round
+TfsServerAdmission tfs_server_admission_new(size_t clients_capacity, size_t queue_capacity, size_t quantum);
+
+/// @brief Destroys an admission control
+/// @details
+/// All messages still queued are simply dropped.
+void tfs_server_admission_destroy(TfsServerAdmission* self);
+
+/// @brief Admits a message from a client into it's queue
+/// @param self
+/// @param address Address of the client
+/// @param address_len Length of @p address
+/// @param item The message
+/// @param cost Cost of the message, in commands
+/// @param[out] retry_after_ms If rejected, how long the client should wait for before retrying
+/// @return If admitted
+/// @details
+/// Messages are rejected if their client's queue is full, if every client is tracked
+/// and none is idle, for it's tracking to be reused, or once the admission is closed.
+bool tfs_server_admission_push(TfsServerAdmission* self,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	void* item,
+	size_t cost,
+	uint32_t* retry_after_ms);
+
+/// @brief Hands out the next message, in deficit round-robin order
+/// @return The message, or `NULL` once closed
+/// @details
+/// Blocks while no messages are queued.
+void* tfs_server_admission_pop(TfsServerAdmission* self);
+
+/// @brief Records the time a message took to execute
+/// @param self
+/// @param elapsed_ns Time taken, in nanoseconds
+void tfs_server_admission_record(TfsServerAdmission* self, uint64_t elapsed_ns);
+
+/// @brief Closes the admission, waking up all waiting threads
+void tfs_server_admission_close(TfsServerAdmission* self);
+
+/// @brief Prints the statistics of every client to @p out
+/// @param self
+/// @param out File to output to.
+/// @details
+/// Doesn't take the lock, so clients may be inconsistent with each other,
+/// and a client whose tracking is being reused may be skipped.
+void tfs_server_admission_stats_print(const TfsServerAdmission* self, FILE* out);
+
+#endif
@@ -0,0 +1,86 @@
+#include "deque.h"
+
+// Imports
+#include <assert.h>	// assert
+#include <stdio.h>	// fprintf, stderr
+#include <stdlib.h>	// malloc, free, exit, EXIT_FAILURE
+
+TfsServerDeque tfs_server_deque_new(size_t capacity) {
+	assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+
+	TfsServerDeque deque = {
+		.items = malloc(capacity * sizeof(void*)),
+		.mask = capacity - 1,
+		.top = 0,
+		.bottom = 0,
+	};
+	if (deque.items == NULL) {
+		fprintf(stderr, "Unable to allocate deque with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	return deque;
+}
+
+void tfs_server_deque_destroy(TfsServerDeque* self) {
+	free(self->items);
+}
+
+bool tfs_server_deque_push(TfsServerDeque* self, void* item) {
+	int64_t bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED);
+	int64_t top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+	if ((size_t)(bottom - top) > self->mask) { return false; }
+
+	// Note: The item must be visible before the new bottom is, so thieves never read a stale item.
+	__atomic_store_n(&self->items[(size_t)bottom & self->mask], item, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+void* tfs_server_deque_pop(TfsServerDeque* self) {
+	// Reserve the bottom item before reading the top
+	// Note: The fence orders the store before the load, so either we or a thief sees the other.
+	int64_t bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&self->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t top = __atomic_load_n(&self->top, __ATOMIC_RELAXED);
+
+	// If it was empty, restore the bottom
+	if (top > bottom) {
+		__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	// If it wasn't the last item, no thief may take it
+	void* item = __atomic_load_n(&self->items[(size_t)bottom & self->mask], __ATOMIC_RELAXED);
+	if (top < bottom) { return item; }
+
+	// Else race the thieves for it, by taking it from the top instead
+	if (!__atomic_compare_exchange_n(&self->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		item = NULL;
+	}
+	__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+	return item;
+}
+
+void* tfs_server_deque_steal(TfsServerDeque* self) {
+	int64_t top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t bottom = __atomic_load_n(&self->bottom, __ATOMIC_ACQUIRE);
+	if (top >= bottom) { return NULL; }
+
+	// Note: The owner only overwrites this slot once the top moved past it, in which case we lose the race below.
+	void* item = __atomic_load_n(&self->items[(size_t)top & self->mask], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&self->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		return NULL;
+	}
+
+	return item;
+}
+
+size_t tfs_server_deque_len(const TfsServerDeque* self) {
+	int64_t top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+	int64_t bottom = __atomic_load_n(&self->bottom, __ATOMIC_ACQUIRE);
+	return bottom > top ? (size_t)(bottom - top) : 0;
+}
@@ -0,0 +1,71 @@
+/// @file
+/// @brief Work-stealing deque
+/// @details
+/// This file defines the #TfsServerDeque type, a Chase-Lev deque of items,
+/// owned by a single thread, which pushes and pops items at it's bottom,
+/// while any other thread may steal items from it's top.
+///
+/// The owner only synchronizes with thieves when taking the last item, so
+/// pushing and popping are just a few loads and stores. The deque has a
+/// fixed capacity, rather than growing, so a full deque rejects pushes,
+/// leaving the owner to execute those items itself.
+///
+/// The memory orderings follow Lê et al., "Correct and Efficient
+/// Work-Stealing for Weak Memory Models".
+
+#ifndef TFS_SERVER_DEQUE_H
+#define TFS_SERVER_DEQUE_H
+
+// Imports
+#include <stdbool.h> // bool
+#include <stddef.h>	 // size_t
+#include <stdint.h>	 // int64_t
+
+/// @brief A work-stealing deque
+typedef struct TfsServerDeque {
+	/// @brief All items, as a circular buffer
+	void** items;
+
+	/// @brief Mask of the index of an item in @ref items, one less than it's capacity
+	size_t mask;
+
+	/// @brief Index of the top item, only ever incremented
+	int64_t top;
+
+	/// @brief Index past the bottom item
+	int64_t bottom;
+} TfsServerDeque;
+
+/// @brief Creates a new deque
+/// @param capacity Capacity of the deque, a power of two.
+TfsServerDeque tfs_server_deque_new(size_t capacity);
+
+/// @brief Destroys a deque
+/// @details
+/// All items still in the deque are simply dropped.
+void tfs_server_deque_destroy(TfsServerDeque* self);
+
+/// @brief Pushes an item to the bottom of the deque
+/// @return If pushed. Fails only if the deque is full.
+/// @details
+/// Must only be called by the owner.
+bool tfs_server_deque_push(TfsServerDeque* self, void* item);
+
+/// @brief Pops the bottom item of the deque
+/// @return The item, or `NULL` if empty.
+/// @details
+/// Must only be called by the owner.
+void* tfs_server_deque_pop(TfsServerDeque* self);
+
+/// @brief Steals the top item of the deque
+/// @return The item, or `NULL` if empty or if another thread took it first.
+/// @details
+/// May be called by any thread.
+void* tfs_server_deque_steal(TfsServerDeque* self);
+
+/// @brief Returns the number of items in the deque
+/// @details
+/// May be called by any thread, although it may be outdated by the time it returns.
+size_t tfs_server_deque_len(const TfsServerDeque* self);
+
+#endif
@@ -0,0 +1,117 @@
+#include "leases.h"
+
+// Imports
+#include <stdio.h>		  // fprintf, stderr
+#include <stdlib.h>		  // malloc, free, exit, EXIT_FAILURE
+#include <string.h>		  // memcmp, memcpy
+#include <tfs/protocol.h> // tfs_protocol_*
+#include <tfs/util.h>	  // tfs_now_ns
+#include <time.h>		  // CLOCK_MONOTONIC
+
+/// @brief Removes the lease at @p idx
+/// @details
+/// The last lease takes it's place.
+static void remove_lease(TfsServerLeases* self, size_t idx) {
+	tfs_path_owned_destroy(&self->leases[idx].path);
+	self->leases[idx] = self->leases[--self->len];
+}
+
+TfsServerLeases tfs_server_leases_new(size_t capacity, uint32_t duration_ms) {
+	TfsServerLeases leases = {
+		.leases = malloc(capacity * sizeof(TfsServerLease)),
+		.len = 0,
+		.capacity = capacity,
+		.duration_ms = duration_ms,
+		.lock = tfs_mutex_new(),
+	};
+	if (leases.leases == NULL) {
+		fprintf(stderr, "Unable to allocate lease table with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	return leases;
+}
+
+void tfs_server_leases_destroy(TfsServerLeases* self) {
+	while (self->len > 0) { remove_lease(self, self->len - 1); }
+	free(self->leases);
+	tfs_mutex_destroy(&self->lock);
+}
+
+uint32_t tfs_server_leases_grant(
+	TfsServerLeases* self, TfsPath path, const struct sockaddr_un* address, socklen_t address_len) {
+	if (self->duration_ms == 0) { return 0; }
+
+	tfs_mutex_lock(&self->lock);
+	uint64_t now = tfs_now_ns(CLOCK_MONOTONIC);
+	uint64_t expires_ns = now + (uint64_t)self->duration_ms * 1000000u;
+
+	// Renew the client's lease, if it already has one, dropping any expired ones as we go
+	size_t idx = 0;
+	while (idx < self->len) {
+		TfsServerLease* lease = &self->leases[idx];
+		if (lease->expires_ns <= now) {
+			remove_lease(self, idx);
+			continue;
+		}
+
+		if (lease->address_len == address_len && memcmp(&lease->address, address, address_len) == 0 &&
+			tfs_path_eq(tfs_path_owned_borrow(lease->path), path)) {
+			lease->expires_ns = expires_ns;
+			tfs_mutex_unlock(&self->lock);
+			return self->duration_ms;
+		}
+		idx++;
+	}
+
+	// Else grant a new one, if there's space
+	if (self->len == self->capacity) {
+		tfs_mutex_unlock(&self->lock);
+		return 0;
+	}
+	TfsServerLease* lease = &self->leases[self->len++];
+	lease->path = tfs_path_to_owned(path);
+	memcpy(&lease->address, address, address_len);
+	lease->address_len = address_len;
+	lease->expires_ns = expires_ns;
+	tfs_mutex_unlock(&self->lock);
+
+	return self->duration_ms;
+}
+
+void tfs_server_leases_invalidate(TfsServerLeases* self, TfsPath path, int socket) {
+	if (self->duration_ms == 0) { return; }
+
+	// Build the invalidation message
+	// Note: Paths too long for a message invalidate all paths instead.
+	path = tfs_path_trim(path);
+	if (path.len > TFS_PROTOCOL_MAX_MESSAGE_LEN - TFS_PROTOCOL_HEADER_LEN) { path.len = 0; }
+	char message[TFS_PROTOCOL_MAX_MESSAGE_LEN];
+	tfs_protocol_header_write((TfsProtocolHeader){.kind = TfsProtocolKindInvalidate, .count = 0, .id = 0}, message);
+	memcpy(message + TFS_PROTOCOL_HEADER_LEN, path.chars, path.len);
+
+	tfs_mutex_lock(&self->lock);
+	uint64_t now = tfs_now_ns(CLOCK_MONOTONIC);
+	size_t idx = 0;
+	while (idx < self->len) {
+		TfsServerLease* lease = &self->leases[idx];
+		if (lease->expires_ns <= now) {
+			remove_lease(self, idx);
+			continue;
+		}
+		if (!tfs_path_starts_with(tfs_path_owned_borrow(lease->path), path)) {
+			idx++;
+			continue;
+		}
+
+		// Note: We don't wait on clients with a full socket, their lease will expire instead.
+		sendto(socket,
+			message,
+			TFS_PROTOCOL_HEADER_LEN + path.len,
+			MSG_DONTWAIT,
+			(const struct sockaddr*)&lease->address,
+			lease->address_len);
+		remove_lease(self, idx);
+	}
+	tfs_mutex_unlock(&self->lock);
+}
@@ -0,0 +1,88 @@
+/// @file
+/// @brief Lookup leases
+/// @details
+/// This file defines the #TfsServerLeases type, which keeps track of
+/// the leases the server granted to clients on lookup results.
+///
+/// Whenever a command changes a path, every client holding a lease on
+/// that path, or any path within it, is sent an invalidation message.
+/// Leases are granted before the lookup is executed, and invalidations
+/// sent after the change is made, so no client can cache a result that
+/// was changed without being told.
+///
+/// Invalidations are sent without blocking, so a client whose socket is
+/// full might miss one, in which case it's cached result stays stale
+/// until the lease expires.
+
+#ifndef TFS_SERVER_LEASES_H
+#define TFS_SERVER_LEASES_H
+
+// Imports
+#include <stddef.h>		// size_t
+#include <stdint.h>		// uint32_t, uint64_t
+#include <sys/socket.h> // socklen_t
+#include <sys/un.h>		// sockaddr_un
+#include <tfs/mutex.h>	// TfsMutex
+#include <tfs/path.h>	// TfsPath, TfsPathOwned
+
+/// @brief A lease held by a client
+typedef struct TfsServerLease {
+	/// @brief Path leased
+	TfsPathOwned path;
+
+	/// @brief Address of the client
+	struct sockaddr_un address;
+
+	/// @brief Length of the client's address
+	socklen_t address_len;
+
+	/// @brief Time the lease expires at, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t expires_ns;
+} TfsServerLease;
+
+/// @brief All leases granted
+typedef struct TfsServerLeases {
+	/// @brief All leases
+	TfsServerLease* leases;
+
+	/// @brief Number of leases
+	size_t len;
+
+	/// @brief Maximum number of leases
+	size_t capacity;
+
+	/// @brief Duration of each lease, in milliseconds
+	uint32_t duration_ms;
+
+	/// @brief Lock over all leases
+	TfsMutex lock;
+} TfsServerLeases;
+
+/// @brief Creates a new lease table
+/// @param capacity Maximum number of leases held at once
+/// @param duration_ms Duration of each lease, in milliseconds
+TfsServerLeases tfs_server_leases_new(size_t capacity, uint32_t duration_ms);
+
+/// @brief Destroys a lease table
+void tfs_server_leases_destroy(TfsServerLeases* self);
+
+/// @brief Grants a lease on @p path to a client
+/// @param self
+/// @param path The path to lease
+/// @param address Address of the client
+/// @param address_len Length of @p address
+/// @return Duration of the lease, in milliseconds, or `0` if none was granted
+/// @details
+/// Must be called _before_ the lookup is executed.
+uint32_t tfs_server_leases_grant(
+	TfsServerLeases* self, TfsPath path, const struct sockaddr_un* address, socklen_t address_len);
+
+/// @brief Invalidates all leases on @p path, or any path within it
+/// @param self
+/// @param path The path that was changed
+/// @param socket Socket to send invalidations from
+/// @details
+/// Must be called _after_ the change is made.
+void tfs_server_leases_invalidate(TfsServerLeases* self, TfsPath path, int socket);
+
+#endif
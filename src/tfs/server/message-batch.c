@@ -0,0 +1,259 @@
+#include "message-batch.h"
+
+// Imports
+#include <assert.h>	 // assert
+#include <errno.h>	 // errno, EAGAIN
+#include <stdlib.h>	 // malloc, free, exit, EXIT_FAILURE
+#include <string.h>	 // memset, memcpy
+#include <sys/uio.h> // iovec
+#include <time.h>	 // clock_gettime, CLOCK_MONOTONIC
+#include <unistd.h>	 // close
+
+void tfs_server_message_batch_recv_error_print(const TfsServerMessageBatchRecvError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsServerMessageBatchRecvErrorReceive: {
+			fprintf(out, "Unable to receive messages\n");
+			break;
+		}
+		case TfsServerMessageBatchRecvErrorShutdown: {
+			fprintf(out, "Socket was shut down\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+TfsServerMessageBatch tfs_server_message_batch_new(size_t capacity) {
+	assert(capacity >= 1);
+
+	TfsServerMessageBatch batch = {
+		.messages = malloc(capacity * TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY),
+		.replies = malloc(capacity * TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY),
+		.addresses = malloc(capacity * sizeof(struct sockaddr_un)),
+		.controls = malloc(capacity * TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY),
+		.fds = malloc(capacity * sizeof(int)),
+		.fds_len = 0,
+		.message_iovecs = malloc(capacity * sizeof(struct iovec)),
+		.reply_iovecs = malloc(capacity * sizeof(struct iovec)),
+		.message_headers = malloc(capacity * sizeof(struct mmsghdr)),
+		.reply_headers = malloc(capacity * sizeof(struct mmsghdr)),
+		.capacity = capacity,
+		.target = 1,
+		.len = 0,
+		.stats = {.recv_calls = 0, .send_calls = 0, .messages = 0},
+	};
+	if (batch.messages == NULL || batch.replies == NULL || batch.addresses == NULL || batch.controls == NULL ||
+		batch.fds == NULL || batch.message_iovecs == NULL || batch.reply_iovecs == NULL ||
+		batch.message_headers == NULL || batch.reply_headers == NULL) {
+		fprintf(stderr, "Unable to allocate message batch with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	// Point each message header at it's buffer and address
+	// Note: Messages leave a byte at the end for a nul terminator.
+	for (size_t n = 0; n < capacity; n++) {
+		batch.message_iovecs[n] = (struct iovec){
+			.iov_base = batch.messages + n * TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY,
+			.iov_len = TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY - 1,
+		};
+		batch.reply_iovecs[n] = (struct iovec){
+			.iov_base = batch.replies + n * TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY,
+			.iov_len = 0,
+		};
+
+		memset(&batch.message_headers[n], 0, sizeof(struct mmsghdr));
+		batch.message_headers[n].msg_hdr.msg_iov = &batch.message_iovecs[n];
+		batch.message_headers[n].msg_hdr.msg_iovlen = 1;
+		batch.fds[n] = -1;
+	}
+
+	return batch;
+}
+
+/// @brief Closes all file descriptors from the last receive
+static void close_fds(TfsServerMessageBatch* self) {
+	for (size_t n = 0; n < self->fds_len; n++) {
+		if (self->fds[n] >= 0) {
+			close(self->fds[n]);
+			self->fds[n] = -1;
+		}
+	}
+	self->fds_len = 0;
+}
+
+void tfs_server_message_batch_destroy(TfsServerMessageBatch* self) {
+	close_fds(self);
+	free(self->messages);
+	free(self->replies);
+	free(self->addresses);
+	free(self->controls);
+	free(self->fds);
+	free(self->message_iovecs);
+	free(self->reply_iovecs);
+	free(self->message_headers);
+	free(self->reply_headers);
+}
+
+/// @brief Receives messages from a socket
+/// @param self
+/// @param socket The socket to receive from
+/// @param flags Flags to receive with, besides `MSG_WAITFORONE` and `MSG_CMSG_CLOEXEC`
+static TfsServerMessageBatchRecvResult recv_flags(TfsServerMessageBatch* self, int socket, int flags) {
+	// Reset the addresses, ancillary data and their lengths, as the last receive overwrote them
+	close_fds(self);
+	for (size_t n = 0; n < self->target; n++) {
+		self->message_headers[n].msg_hdr.msg_name = &self->addresses[n];
+		self->message_headers[n].msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+		self->message_headers[n].msg_hdr.msg_control = self->controls + n * TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY;
+		self->message_headers[n].msg_hdr.msg_controllen = TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY;
+		self->reply_iovecs[n].iov_len = 0;
+	}
+
+	// Note: `MSG_WAITFORONE` blocks only until the first message arrives.
+	int received = recvmmsg(
+		socket, self->message_headers, (unsigned int)self->target, MSG_WAITFORONE | MSG_CMSG_CLOEXEC | flags, NULL);
+	self->stats.recv_calls++;
+	if (received < 0 && (flags & MSG_DONTWAIT) != 0 && errno == EAGAIN) {
+		self->len = 0;
+		return (TfsServerMessageBatchRecvResult){
+			.success = true,
+		};
+	}
+	if (received < 0) {
+		self->len = 0;
+		return (TfsServerMessageBatchRecvResult){
+			.success = false,
+			.data.err.kind = TfsServerMessageBatchRecvErrorReceive,
+		};
+	}
+
+	// Note: A shut down socket receives empty messages
+	if (received == 0 || self->message_headers[0].msg_len == 0) {
+		self->len = 0;
+		return (TfsServerMessageBatchRecvResult){
+			.success = false,
+			.data.err.kind = TfsServerMessageBatchRecvErrorShutdown,
+		};
+	}
+	self->len = (size_t)received;
+	self->stats.messages += self->len;
+
+	// Collect the file descriptors carried by any messages
+	// Note: Only a single descriptor fits, any others sent are discarded by the kernel.
+	for (size_t n = 0; n < self->len; n++) {
+		self->fds[n] = tfs_server_message_fd(&self->message_headers[n].msg_hdr);
+	}
+	self->fds_len = self->len;
+
+	// Adapt the target to the backlog
+	if (self->len == self->target) {
+		self->target = self->target * 2 > self->capacity ? self->capacity : self->target * 2;
+	}
+	else if (self->len < self->target / 2) {
+		self->target /= 2;
+	}
+
+	return (TfsServerMessageBatchRecvResult){
+		.success = true,
+	};
+}
+
+TfsServerMessageBatchRecvResult tfs_server_message_batch_recv(TfsServerMessageBatch* self, int socket) {
+	return recv_flags(self, socket, 0);
+}
+
+TfsServerMessageBatchRecvResult tfs_server_message_batch_try_recv(TfsServerMessageBatch* self, int socket) {
+	return recv_flags(self, socket, MSG_DONTWAIT);
+}
+
+TfsServerMessageBatchRecvResult tfs_server_message_batch_poll_recv(
+	TfsServerMessageBatch* self, int socket, uint64_t spin_ns) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (1) {
+		TfsServerMessageBatchRecvResult result = recv_flags(self, socket, MSG_DONTWAIT);
+		if (!result.success || self->len != 0) { return result; }
+
+		// Note: The clock is read through the vdso, so it's far cheaper than the receive itself.
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t elapsed_ns = (uint64_t)((now.tv_sec - start.tv_sec) * 1000000000 + (now.tv_nsec - start.tv_nsec));
+		if (elapsed_ns >= spin_ns) { break; }
+	}
+
+	return recv_flags(self, socket, 0);
+}
+
+char* tfs_server_message_batch_message(TfsServerMessageBatch* self, size_t idx, size_t* len) {
+	assert(idx < self->len);
+	*len = self->message_headers[idx].msg_len;
+	return self->message_iovecs[idx].iov_base;
+}
+
+const struct sockaddr_un* tfs_server_message_batch_address(
+	const TfsServerMessageBatch* self, size_t idx, socklen_t* len) {
+	assert(idx < self->len);
+	*len = self->message_headers[idx].msg_hdr.msg_namelen;
+	return &self->addresses[idx];
+}
+
+int tfs_server_message_fd(struct msghdr* header) {
+	struct cmsghdr* control = CMSG_FIRSTHDR(header);
+	if (control == NULL || control->cmsg_level != SOL_SOCKET || control->cmsg_type != SCM_RIGHTS ||
+		control->cmsg_len < CMSG_LEN(sizeof(int))) {
+		return -1;
+	}
+
+	int fd;
+	memcpy(&fd, CMSG_DATA(control), sizeof(int));
+	return fd;
+}
+
+int tfs_server_message_batch_fd(const TfsServerMessageBatch* self, size_t idx) {
+	assert(idx < self->len);
+	return self->fds[idx];
+}
+
+char* tfs_server_message_batch_reply(TfsServerMessageBatch* self, size_t idx) {
+	assert(idx < self->len);
+	return self->reply_iovecs[idx].iov_base;
+}
+
+void tfs_server_message_batch_set_reply_len(TfsServerMessageBatch* self, size_t idx, size_t len) {
+	assert(idx < self->len);
+	assert(len <= TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY);
+	self->reply_iovecs[idx].iov_len = len;
+}
+
+void tfs_server_message_batch_send(TfsServerMessageBatch* self, int socket) {
+	// Gather all non-empty replies
+	size_t replies_len = 0;
+	for (size_t n = 0; n < self->len; n++) {
+		if (self->reply_iovecs[n].iov_len == 0) { continue; }
+
+		struct mmsghdr* header = &self->reply_headers[replies_len];
+		memset(header, 0, sizeof(struct mmsghdr));
+		header->msg_hdr.msg_name = &self->addresses[n];
+		header->msg_hdr.msg_namelen = self->message_headers[n].msg_hdr.msg_namelen;
+		header->msg_hdr.msg_iov = &self->reply_iovecs[n];
+		header->msg_hdr.msg_iovlen = 1;
+		replies_len++;
+	}
+
+	// Then send them, skipping any we can't send
+	// Note: `sendmmsg` stops at the first reply it can't send, returning an
+	//       error only if it's the first one, so we skip it and send the rest.
+	size_t sent = 0;
+	while (sent < replies_len) {
+		int res = sendmmsg(socket, self->reply_headers + sent, (unsigned int)(replies_len - sent), 0);
+		self->stats.send_calls++;
+		if (res <= 0) { sent++; }
+		else {
+			sent += (size_t)res;
+		}
+	}
+
+	self->len = 0;
+}
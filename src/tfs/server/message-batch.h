@@ -0,0 +1,212 @@
+/// @file
+/// @brief Batched message receiving and sending
+/// @details
+/// This file defines the #TfsServerMessageBatch type, used by the
+/// server workers to receive several messages with a single `recvmmsg`
+/// call, and to send all of their replies with a single `sendmmsg` call.
+///
+/// The number of messages received at once adapts to the depth of the
+/// socket's backlog. It doubles whenever a receive fills the whole batch,
+/// and halves whenever a receive fills less than half of it, so an idle
+/// server doesn't have a worker hoard messages other workers could be executing.
+///
+/// Latency-critical workers may instead busy-poll the socket, receiving without
+/// blocking until a message arrives, see #tfs_server_message_batch_poll_recv,
+/// so they never pay for the wakeup of a blocking receive, as long as they
+/// keep receiving messages. After a while idle, they block once again.
+///
+/// Messages may also carry a file descriptor, such as a client's shared-memory
+/// ring, retrieved with #tfs_server_message_batch_fd. These are owned by the
+/// batch and closed on the next receive, so they must be duplicated to outlive it.
+
+#ifndef TFS_SERVER_MESSAGE_BATCH_H
+#define TFS_SERVER_MESSAGE_BATCH_H
+
+// Imports
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint64_t
+#include <stdio.h>		  // FILE
+#include <sys/socket.h>	  // mmsghdr
+#include <sys/un.h>		  // sockaddr_un
+#include <tfs/protocol.h> // TFS_PROTOCOL_MAX_MESSAGE_LEN
+
+/// @brief Capacity of each message
+/// @details
+/// Messages have space for a nul terminator after their contents.
+#define TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY (TFS_PROTOCOL_MAX_MESSAGE_LEN + 1)
+
+/// @brief Capacity of the ancillary data of each message, enough for a single file descriptor
+#define TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY CMSG_SPACE(sizeof(int))
+
+/// @brief Capacity of each reply
+#define TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY (TFS_PROTOCOL_HEADER_LEN + TFS_PROTOCOL_MAX_BATCH_LEN)
+
+/// @brief Syscall statistics of a batch
+typedef struct TfsServerMessageBatchStats {
+	/// @brief Number of `recvmmsg` calls
+	uint64_t recv_calls;
+
+	/// @brief Number of `sendmmsg` calls
+	uint64_t send_calls;
+
+	/// @brief Number of messages received
+	uint64_t messages;
+} TfsServerMessageBatchStats;
+
+/// @brief A batch of messages
+typedef struct TfsServerMessageBatch {
+	/// @brief All messages, each with #TFS_SERVER_MESSAGE_BATCH_MESSAGE_CAPACITY bytes
+	char* messages;
+
+	/// @brief All replies, each with #TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY bytes
+	char* replies;
+
+	/// @brief Address of the sender of each message
+	struct sockaddr_un* addresses;
+
+	/// @brief Ancillary data of each message, each with #TFS_SERVER_MESSAGE_BATCH_CONTROL_CAPACITY bytes
+	char* controls;
+
+	/// @brief File descriptor carried by each message, or `-1` if none
+	int* fds;
+
+	/// @brief Number of messages whose file descriptors haven't been closed
+	size_t fds_len;
+
+	/// @brief Buffer of each message
+	struct iovec* message_iovecs;
+
+	/// @brief Buffer of each reply
+	struct iovec* reply_iovecs;
+
+	/// @brief Headers of each message
+	struct mmsghdr* message_headers;
+
+	/// @brief Headers of each reply
+	struct mmsghdr* reply_headers;
+
+	/// @brief Maximum number of messages
+	size_t capacity;
+
+	/// @brief Number of messages to receive in the next receive
+	size_t target;
+
+	/// @brief Number of messages received
+	size_t len;
+
+	/// @brief Syscall statistics
+	TfsServerMessageBatchStats stats;
+} TfsServerMessageBatch;
+
+/// @brief Error type for #tfs_server_message_batch_recv
+typedef struct TfsServerMessageBatchRecvError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to receive messages
+		TfsServerMessageBatchRecvErrorReceive,
+
+		/// @brief Socket was shut down
+		TfsServerMessageBatchRecvErrorShutdown,
+	} kind;
+} TfsServerMessageBatchRecvError;
+
+/// @brief Result type for #tfs_server_message_batch_recv
+typedef struct TfsServerMessageBatchRecvResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Underlying error
+		TfsServerMessageBatchRecvError err;
+	} data;
+} TfsServerMessageBatchRecvResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_server_message_batch_recv_error_print(const TfsServerMessageBatchRecvError* self, FILE* out);
+
+/// @brief Creates a new message batch
+/// @param capacity Maximum number of messages received at once. Must be at least `1`.
+TfsServerMessageBatch tfs_server_message_batch_new(size_t capacity);
+
+/// @brief Destroys a message batch
+void tfs_server_message_batch_destroy(TfsServerMessageBatch* self);
+
+/// @brief Receives messages from a socket
+/// @param self
+/// @param socket The socket to receive from
+/// @details
+/// Blocks until at least one message is received, then receives
+/// any more messages already queued, up to the current target.
+TfsServerMessageBatchRecvResult tfs_server_message_batch_recv(TfsServerMessageBatch* self, int socket);
+
+/// @brief Receives messages from a socket, without blocking
+/// @param self
+/// @param socket The socket to receive from
+/// @details
+/// Receives any messages already queued, up to the current target.
+/// If none are, succeeds with no messages received.
+TfsServerMessageBatchRecvResult tfs_server_message_batch_try_recv(TfsServerMessageBatch* self, int socket);
+
+/// @brief Receives messages from a socket, busy-polling it for a while before blocking
+/// @param self
+/// @param socket The socket to receive from
+/// @param spin_ns Time to busy-poll for before blocking, in nanoseconds
+/// @details
+/// Receives without blocking until at least one message is received, then
+/// receives any more messages already queued, up to the current target.
+/// If none arrive within @p spin_ns, blocks until one does.
+TfsServerMessageBatchRecvResult tfs_server_message_batch_poll_recv(
+	TfsServerMessageBatch* self, int socket, uint64_t spin_ns);
+
+/// @brief Returns the message with index @p idx
+/// @param self
+/// @param idx Index of the message, less than `self->len`.
+/// @param[out] len Length of the message
+/// @details
+/// The message has space for a nul terminator after it's `len` bytes.
+char* tfs_server_message_batch_message(TfsServerMessageBatch* self, size_t idx, size_t* len);
+
+/// @brief Returns the address of the sender of message @p idx
+/// @param self
+/// @param idx Index of the message, less than `self->len`.
+/// @param[out] len Length of the address
+const struct sockaddr_un* tfs_server_message_batch_address(
+	const TfsServerMessageBatch* self, size_t idx, socklen_t* len);
+
+/// @brief Returns the file descriptor carried by message @p idx
+/// @param self
+/// @param idx Index of the message, less than `self->len`.
+/// @return The file descriptor, owned by the batch, or `-1` if the message carried none.
+int tfs_server_message_batch_fd(const TfsServerMessageBatch* self, size_t idx);
+
+/// @brief Returns the file descriptor carried by a received message
+/// @param header Header of the message
+/// @return The file descriptor, or `-1` if the message carried none.
+int tfs_server_message_fd(struct msghdr* header);
+
+/// @brief Returns the reply buffer of message @p idx
+/// @param self
+/// @param idx Index of the message, less than `self->len`.
+/// @details
+/// The buffer has #TFS_SERVER_MESSAGE_BATCH_REPLY_CAPACITY bytes.
+char* tfs_server_message_batch_reply(TfsServerMessageBatch* self, size_t idx);
+
+/// @brief Sets the length of the reply of message @p idx
+/// @param self
+/// @param idx Index of the message, less than `self->len`.
+/// @param len Length of the reply. A length of `0` sends no reply.
+void tfs_server_message_batch_set_reply_len(TfsServerMessageBatch* self, size_t idx, size_t len);
+
+/// @brief Sends the replies of all messages received to their senders
+/// @param self
+/// @param socket The socket to send from
+/// @details
+/// Replies that can't be sent, such as to a client that has
+/// since disconnected, are skipped.
+void tfs_server_message_batch_send(TfsServerMessageBatch* self, int socket);
+
+#endif
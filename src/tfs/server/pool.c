@@ -0,0 +1,301 @@
+#include "pool.h"
+
+// Imports
+#include <inttypes.h>	 // PRIu64
+#include <sched.h>		 // sched_getaffinity, CPU_COUNT
+#include <stdlib.h>		 // malloc, free, exit, EXIT_FAILURE
+#include <tfs/rw_lock.h> // tfs_rw_lock_blocked_ns
+#include <tfs/util.h>	 // tfs_now_ns
+#include <time.h>		 // clock_gettime, CLOCK_MONOTONIC, CLOCK_REALTIME, CLOCK_THREAD_CPUTIME_ID
+
+/// @brief Returns the number of CPUs we may run on
+static size_t available_cpus(void) {
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) < 0) { return 1; }
+
+	int cpus = CPU_COUNT(&set);
+	return cpus < 1 ? 1 : (size_t)cpus;
+}
+
+TfsServerPool tfs_server_pool_new(
+	size_t min, size_t max, size_t capacity, TfsServerPoolExecuteFn execute, void* execute_data) {
+	TfsServerPool pool = {
+		.items = malloc(capacity * sizeof(void*)),
+		.pushed_ns = malloc(capacity * sizeof(uint64_t)),
+		.head = 0,
+		.len = 0,
+		.capacity = capacity,
+		.size = 0,
+		.live = 0,
+		.min = min,
+		.max = max,
+		.cpus = available_cpus(),
+		.pinned = false,
+		.execute = execute,
+		.execute_data = execute_data,
+		.totals = {.executed = 0, .delay_ns = 0, .busy_ns = 0, .blocked_ns = 0, .cpu_ns = 0},
+		.lock = tfs_mutex_new(),
+		.not_empty = tfs_cond_var_new(),
+		.not_full = tfs_cond_var_new(),
+		.retired = tfs_cond_var_new(),
+		.closed = false,
+	};
+	if (pool.items == NULL || pool.pushed_ns == NULL) {
+		fprintf(stderr, "Unable to allocate pool queue with capacity %zu\n", capacity);
+		exit(EXIT_FAILURE);
+	}
+
+	return pool;
+}
+
+void tfs_server_pool_destroy(TfsServerPool* self) {
+	free(self->items);
+	free(self->pushed_ns);
+	tfs_cond_var_destroy(&self->retired);
+	tfs_cond_var_destroy(&self->not_full);
+	tfs_cond_var_destroy(&self->not_empty);
+	tfs_mutex_destroy(&self->lock);
+}
+
+/// @brief Executor thread function
+/// @param arg The pool
+static void* executor_thread_fn(void* arg) {
+	TfsServerPool* self = arg;
+
+	tfs_mutex_lock(&self->lock);
+	while (1) {
+		while (self->len == 0 && !self->closed && self->live <= self->size) {
+			tfs_cond_var_wait(&self->not_empty, &self->lock);
+		}
+
+		// Retire if the pool shrunk, or once closed and drained
+		// Note: If we were woken up for an item, another executor must take it instead.
+		if (self->len == 0 || (self->live > self->size && !self->closed)) {
+			if (self->len != 0) { tfs_cond_var_signal(&self->not_empty); }
+			__atomic_store_n(&self->live, self->live - 1, __ATOMIC_RELAXED);
+			tfs_cond_var_broadcast(&self->retired);
+			tfs_mutex_unlock(&self->lock);
+			return NULL;
+		}
+
+		void* item = self->items[self->head];
+		uint64_t pushed_ns = self->pushed_ns[self->head];
+		self->head = (self->head + 1) % self->capacity;
+		self->len--;
+		if (self->len == self->capacity - 1) { tfs_cond_var_broadcast(&self->not_full); }
+		tfs_mutex_unlock(&self->lock);
+
+		// Execute it, measuring how long it waited, ran and blocked for
+		uint64_t start_ns = tfs_now_ns(CLOCK_MONOTONIC);
+		uint64_t start_cpu_ns = tfs_now_ns(CLOCK_THREAD_CPUTIME_ID);
+		uint64_t start_blocked_ns = tfs_rw_lock_blocked_ns();
+		self->execute(item, self->execute_data);
+		uint64_t end_ns = tfs_now_ns(CLOCK_MONOTONIC);
+
+		__atomic_fetch_add(&self->totals.executed, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&self->totals.delay_ns, start_ns - pushed_ns, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&self->totals.busy_ns, end_ns - start_ns, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&self->totals.blocked_ns, tfs_rw_lock_blocked_ns() - start_blocked_ns, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&self->totals.cpu_ns, tfs_now_ns(CLOCK_THREAD_CPUTIME_ID) - start_cpu_ns, __ATOMIC_RELAXED);
+
+		tfs_mutex_lock(&self->lock);
+	}
+}
+
+/// @brief Sets the size of the pool, starting executors if it grew
+/// @details
+/// Must be called with the lock held. Executors retire on their own if it shrunk.
+static void resize(TfsServerPool* self, size_t size) {
+	__atomic_store_n(&self->size, size, __ATOMIC_RELAXED);
+
+	// Note: Executors are detached, as they retire on their own, and we wait for them on close.
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	while (self->live < self->size) {
+		pthread_t thread;
+		int res = pthread_create(&thread, &attr, executor_thread_fn, self);
+		if (res != 0) {
+			fprintf(stderr, "Unable to create executor thread #%zu: %d\n", self->live, res);
+			__atomic_store_n(&self->size, self->live, __ATOMIC_RELAXED);
+			break;
+		}
+		__atomic_store_n(&self->live, self->live + 1, __ATOMIC_RELAXED);
+	}
+	pthread_attr_destroy(&attr);
+
+	tfs_cond_var_broadcast(&self->not_empty);
+}
+
+/// @brief Returns the totals of all executors
+static TfsServerPoolSample load_totals(const TfsServerPool* self) {
+	return (TfsServerPoolSample){
+		.executed = __atomic_load_n(&self->totals.executed, __ATOMIC_RELAXED),
+		.delay_ns = __atomic_load_n(&self->totals.delay_ns, __ATOMIC_RELAXED),
+		.busy_ns = __atomic_load_n(&self->totals.busy_ns, __ATOMIC_RELAXED),
+		.blocked_ns = __atomic_load_n(&self->totals.blocked_ns, __ATOMIC_RELAXED),
+		.cpu_ns = __atomic_load_n(&self->totals.cpu_ns, __ATOMIC_RELAXED),
+	};
+}
+
+/// @brief Controller thread function
+/// @param arg The pool
+static void* controller_thread_fn(void* arg) {
+	TfsServerPool* self = arg;
+	TfsServerPoolSample last = load_totals(self);
+	uint64_t last_ns = tfs_now_ns(CLOCK_MONOTONIC);
+
+	tfs_mutex_lock(&self->lock);
+	while (1) {
+		// Wait for the next interval, unless closed meanwhile
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += TFS_SERVER_POOL_INTERVAL_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		while (!self->closed && tfs_cond_var_timed_wait(&self->retired, &self->lock, &deadline)) {}
+		if (self->closed) { break; }
+
+		// Sample the interval
+		TfsServerPoolSample totals = load_totals(self);
+		uint64_t cur_ns = tfs_now_ns(CLOCK_MONOTONIC);
+		TfsServerPoolSample sample = {
+			.executed = totals.executed - last.executed,
+			.delay_ns = totals.delay_ns - last.delay_ns,
+			.busy_ns = totals.busy_ns - last.busy_ns,
+			.blocked_ns = totals.blocked_ns - last.blocked_ns,
+			.cpu_ns = totals.cpu_ns - last.cpu_ns,
+		};
+		uint64_t interval_ns = cur_ns - last_ns;
+		last = totals;
+		last_ns = cur_ns;
+		if (self->pinned) { continue; }
+
+		// Then resize the pool, if needed
+		size_t size = tfs_server_pool_decide(&sample, interval_ns, self->size, self->cpus);
+		if (size < self->min) { size = self->min; }
+		if (size > self->max) { size = self->max; }
+		if (size == self->size) { continue; }
+
+		fprintf(stderr,
+			"Resizing pool from %zu to %zu threads (%" PRIu64 " executed, %" PRIu64 "us average delay, %" PRIu64
+			"us blocked, %" PRIu64 "us on cpu)\n",
+			self->size,
+			size,
+			sample.executed,
+			sample.executed == 0 ? 0 : sample.delay_ns / sample.executed / 1000,
+			sample.blocked_ns / 1000,
+			sample.cpu_ns / 1000);
+		resize(self, size);
+	}
+	tfs_mutex_unlock(&self->lock);
+
+	return NULL;
+}
+
+void tfs_server_pool_start(TfsServerPool* self) {
+	tfs_mutex_lock(&self->lock);
+	resize(self, self->min);
+	tfs_mutex_unlock(&self->lock);
+
+	int res = pthread_create(&self->controller_thread, NULL, controller_thread_fn, self);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create pool controller thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool tfs_server_pool_push(TfsServerPool* self, void* item) {
+	tfs_mutex_lock(&self->lock);
+	while (!self->closed && self->len == self->capacity) { tfs_cond_var_wait(&self->not_full, &self->lock); }
+	if (self->closed) {
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+
+	size_t idx = (self->head + self->len) % self->capacity;
+	self->items[idx] = item;
+	self->pushed_ns[idx] = tfs_now_ns(CLOCK_MONOTONIC);
+	self->len++;
+	tfs_cond_var_signal(&self->not_empty);
+	tfs_mutex_unlock(&self->lock);
+
+	return true;
+}
+
+void tfs_server_pool_pin(TfsServerPool* self, size_t size) {
+	tfs_mutex_lock(&self->lock);
+	if (size == 0) { __atomic_store_n(&self->pinned, false, __ATOMIC_RELAXED); }
+	else {
+		if (size < self->min) { size = self->min; }
+		if (size > self->max) { size = self->max; }
+		__atomic_store_n(&self->pinned, true, __ATOMIC_RELAXED);
+		resize(self, size);
+	}
+	tfs_mutex_unlock(&self->lock);
+}
+
+TfsServerPoolInfo tfs_server_pool_info(TfsServerPool* self) {
+	tfs_mutex_lock(&self->lock);
+	TfsServerPoolInfo info = {
+		.size = self->size,
+		.live = self->live,
+		.min = self->min,
+		.max = self->max,
+		.pinned = self->pinned,
+	};
+	tfs_mutex_unlock(&self->lock);
+
+	return info;
+}
+
+size_t tfs_server_pool_decide(const TfsServerPoolSample* sample, uint64_t interval_ns, size_t size, size_t cpus) {
+	// If items barely waited, and the executors were mostly idle, shrink
+	uint64_t delay_ns = sample->executed == 0 ? 0 : sample->delay_ns / sample->executed;
+	if (delay_ns < TFS_SERVER_POOL_LOW_DELAY_NS && sample->busy_ns < size * interval_ns / 2) {
+		return size == 0 ? 0 : size - 1;
+	}
+
+	// Else if they didn't wait for too long, we're fine
+	if (delay_ns <= TFS_SERVER_POOL_HIGH_DELAY_NS) { return size; }
+
+	// If all CPUs are busy, more threads would only context switch, so
+	// shrink if executors spent more than a thread's worth of time runnable,
+	// but neither running nor blocked on a lock.
+	if (sample->cpu_ns >= cpus * interval_ns * 9 / 10) {
+		uint64_t running_ns = sample->cpu_ns + sample->blocked_ns;
+		uint64_t runnable_ns = sample->busy_ns > running_ns ? sample->busy_ns - running_ns : 0;
+		return runnable_ns > interval_ns && size > 0 ? size - 1 : size;
+	}
+
+	// Else grow by a thread, along with one for each thread's worth of time blocked on locks
+	return size + 1 + (size_t)(sample->blocked_ns / interval_ns);
+}
+
+void tfs_server_pool_close(TfsServerPool* self) {
+	tfs_mutex_lock(&self->lock);
+	self->closed = true;
+	tfs_cond_var_broadcast(&self->not_empty);
+	tfs_cond_var_broadcast(&self->not_full);
+	tfs_cond_var_broadcast(&self->retired);
+	while (self->live != 0) { tfs_cond_var_wait(&self->retired, &self->lock); }
+	tfs_mutex_unlock(&self->lock);
+
+	pthread_join(self->controller_thread, NULL);
+}
+
+void tfs_server_pool_stats_print(const TfsServerPool* self, FILE* out) {
+	TfsServerPoolSample totals = load_totals(self);
+	fprintf(out,
+		"Pool: %zu threads (%zu running, between %zu and %zu, %s), %" PRIu64 " executed, %" PRIu64
+		"us average delay, %" PRIu64 "us blocked, %" PRIu64 "us on cpu\n",
+		__atomic_load_n(&self->size, __ATOMIC_RELAXED),
+		__atomic_load_n(&self->live, __ATOMIC_RELAXED),
+		self->min,
+		self->max,
+		__atomic_load_n(&self->pinned, __ATOMIC_RELAXED) ? "pinned" : "adaptive",
+		totals.executed,
+		totals.executed == 0 ? 0 : totals.delay_ns / totals.executed / 1000,
+		totals.blocked_ns / 1000,
+		totals.cpu_ns / 1000);
+}
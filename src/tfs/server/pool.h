@@ -0,0 +1,199 @@
+/// @file
+/// @brief Adaptive pool of executor threads
+/// @details
+/// This file defines the #TfsServerPool type, a queue of items along with a
+/// pool of threads executing them, whose size is adapted, between a minimum
+/// and a maximum, to the load it observes.
+///
+/// Every #TFS_SERVER_POOL_INTERVAL_MS, a controller thread samples how long
+/// items waited in the queue, how long executors were blocked on inode locks
+/// and how much CPU time they used, and decides the pool's new size, see
+/// #tfs_server_pool_decide. Items waiting for too long grow the pool, by one
+/// thread for each thread's worth of time spent blocked on locks, as long as
+/// a CPU is available to run them. Once the CPUs are saturated, and threads
+/// wait to be scheduled, rather than on locks, the pool shrinks instead, as
+/// more threads would only context switch. An idle pool shrinks as well.
+///
+/// The size may also be pinned, after which it's only changed by another pin.
+
+#ifndef TFS_SERVER_POOL_H
+#define TFS_SERVER_POOL_H
+
+// Imports
+#include <pthread.h>	  // pthread_t
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint64_t
+#include <stdio.h>		  // FILE
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/mutex.h>	  // TfsMutex
+
+/// @brief Interval between each adaptation of the pool's size, in milliseconds
+#define TFS_SERVER_POOL_INTERVAL_MS 100
+
+/// @brief Average queue delay above which the pool grows, in nanoseconds
+#define TFS_SERVER_POOL_HIGH_DELAY_NS 1000000u
+
+/// @brief Average queue delay below which a mostly idle pool shrinks, in nanoseconds
+#define TFS_SERVER_POOL_LOW_DELAY_NS 100000u
+
+/// @brief Function executing an item
+/// @details
+/// The function takes ownership of the item.
+typedef void (*TfsServerPoolExecuteFn)(void* item, void* data);
+
+/// @brief Totals accumulated by all executors
+/// @details
+/// These are updated atomically, so they may be read without the lock.
+typedef struct TfsServerPoolSample {
+	/// @brief Number of items executed
+	uint64_t executed;
+
+	/// @brief Time items waited in the queue, in nanoseconds
+	uint64_t delay_ns;
+
+	/// @brief Time spent executing items, in nanoseconds
+	uint64_t busy_ns;
+
+	/// @brief Time spent blocked on inode locks while executing, in nanoseconds
+	uint64_t blocked_ns;
+
+	/// @brief CPU time spent executing, in nanoseconds
+	uint64_t cpu_ns;
+} TfsServerPoolSample;
+
+/// @brief State of the pool, as reported to administrators
+typedef struct TfsServerPoolInfo {
+	/// @brief Size the pool is adapting to
+	size_t size;
+
+	/// @brief Number of executors currently running
+	size_t live;
+
+	/// @brief Minimum size
+	size_t min;
+
+	/// @brief Maximum size
+	size_t max;
+
+	/// @brief If the size was pinned
+	bool pinned;
+} TfsServerPoolInfo;
+
+/// @brief Adaptive pool of executor threads
+typedef struct TfsServerPool {
+	/// @brief All queued items, as a circular buffer
+	void** items;
+
+	/// @brief Time each queued item was pushed at, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t* pushed_ns;
+
+	/// @brief Index of the first item
+	size_t head;
+
+	/// @brief Number of items
+	size_t len;
+
+	/// @brief Capacity of the queue
+	size_t capacity;
+
+	/// @brief Size the pool is adapting to
+	size_t size;
+
+	/// @brief Number of executors running
+	size_t live;
+
+	/// @brief Minimum size
+	size_t min;
+
+	/// @brief Maximum size
+	size_t max;
+
+	/// @brief Number of CPUs we may run on
+	size_t cpus;
+
+	/// @brief If the size was pinned
+	bool pinned;
+
+	/// @brief Function executing each item
+	TfsServerPoolExecuteFn execute;
+
+	/// @brief Data passed to @ref execute
+	void* execute_data;
+
+	/// @brief Totals of all executors
+	TfsServerPoolSample totals;
+
+	/// @brief Controller thread
+	pthread_t controller_thread;
+
+	/// @brief Lock over everything but @ref totals
+	TfsMutex lock;
+
+	/// @brief Signaled whenever an item is pushed, the size shrinks or the pool is closed
+	TfsCondVar not_empty;
+
+	/// @brief Signaled whenever an item is popped or the pool is closed
+	TfsCondVar not_full;
+
+	/// @brief Signaled whenever an executor retires or the pool is closed
+	TfsCondVar retired;
+
+	/// @brief If closed
+	bool closed;
+} TfsServerPool;
+
+/// @brief Creates a new pool
+/// @param min Minimum size, at least 1
+/// @param max Maximum size, at least @p min
+/// @param capacity Capacity of the queue
+/// @param execute Function executing each item
+/// @param execute_data Data passed to @p execute
+/// @details
+/// No threads are started until #tfs_server_pool_start.
+TfsServerPool tfs_server_pool_new(
+	size_t min, size_t max, size_t capacity, TfsServerPoolExecuteFn execute, void* execute_data);
+
+/// @brief Destroys a pool
+/// @details
+/// The pool must have been closed, and all items still queued are simply dropped.
+void tfs_server_pool_destroy(TfsServerPool* self);
+
+/// @brief Starts the minimum number of executors and the controller
+/// @details
+/// The pool must not be moved from then on.
+void tfs_server_pool_start(TfsServerPool* self);
+
+/// @brief Pushes an item to the queue
+/// @return If pushed. Fails only once the pool is closed.
+/// @details
+/// Blocks while the queue is full.
+bool tfs_server_pool_push(TfsServerPool* self, void* item);
+
+/// @brief Pins the pool's size
+/// @param self
+/// @param size The size, clamped between the minimum and maximum, or `0` to adapt it again
+void tfs_server_pool_pin(TfsServerPool* self, size_t size);
+
+/// @brief Returns the pool's state
+TfsServerPoolInfo tfs_server_pool_info(TfsServerPool* self);
+
+/// @brief Decides the size of a pool after an interval
+/// @param sample Totals accumulated during the interval
+/// @param interval_ns Length of the interval, in nanoseconds
+/// @param size Size during the interval
+/// @param cpus Number of CPUs available
+/// @return The new size, which may be outside the pool's bounds
+size_t tfs_server_pool_decide(const TfsServerPoolSample* sample, uint64_t interval_ns, size_t size, size_t cpus);
+
+/// @brief Closes the pool, waiting for all queued items to be executed and all executors to retire
+void tfs_server_pool_close(TfsServerPool* self);
+
+/// @brief Prints the state and totals of the pool to @p out
+/// @param self
+/// @param out File to output to.
+/// @details
+/// Doesn't take the lock, so the state may be inconsistent with the totals.
+void tfs_server_pool_stats_print(const TfsServerPool* self, FILE* out);
+
+#endif
@@ -0,0 +1,345 @@
+#include "recorder.h"
+
+// Imports
+#include <stdlib.h>				   // malloc, realloc, free, exit, EXIT_FAILURE
+#include <string.h>				   // memcpy, memcmp
+#include <tfs/command/recording.h> // TfsCommandRecordingHeader, TfsCommandRecordingEntryHeader
+#include <tfs/util.h>			   // tfs_hash_bytes, tfs_buckets_*, tfs_max_size_t, tfs_now_ns
+#include <time.h>				   // clock_gettime, CLOCK_MONOTONIC, CLOCK_REALTIME
+
+/// @brief Interval, in milliseconds, at which the writer collects partially filled buffers
+#define RECORDER_FLUSH_INTERVAL_MS 200
+
+/// @brief Initial number of buckets of the clients
+#define RECORDER_INITIAL_BUCKETS 64
+
+/// @brief Header of each command in a thread's buffer
+/// @details
+/// It's followed by the client's address, and then the command, without it's newline.
+/// Entries aren't aligned, so this must be copied out, rather than accessed in place.
+typedef struct BufferEntryHeader {
+	/// @brief Time the command was received, in nanoseconds since the recording started
+	uint64_t time_ns;
+
+	/// @brief Length of the client's address, or `0` if it's unnamed
+	uint32_t address_len;
+
+	/// @brief Length of the command
+	uint32_t len;
+} BufferEntryHeader;
+
+/// @brief Id of the next recorder created
+static uint64_t next_recorder_id = 1;
+
+/// @brief This thread's buffer, if it ever recorded a command
+static __thread TfsServerRecorderBuffer* thread_buffer = NULL;
+
+/// @brief Id of the recorder #thread_buffer belongs to
+/// @details
+/// A new recorder may end up at the same address as a destroyed one,
+/// so the buffer is only used while the ids match.
+static __thread uint64_t thread_buffer_recorder = 0;
+
+/// @brief Returns this thread's buffer, adding one the first time the thread records
+static TfsServerRecorderBuffer* thread_buffer_get(TfsServerRecorder* self) {
+	if (thread_buffer != NULL && thread_buffer_recorder == self->id) { return thread_buffer; }
+
+	TfsServerRecorderBuffer* buffer = malloc(sizeof(TfsServerRecorderBuffer));
+	char* entries = malloc(TFS_SERVER_RECORDER_BUFFER_CAPACITY);
+	char* spare = malloc(TFS_SERVER_RECORDER_BUFFER_CAPACITY);
+	if (buffer == NULL || entries == NULL || spare == NULL) {
+		fprintf(stderr, "Unable to allocate recorder buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	*buffer = (TfsServerRecorderBuffer){
+		.entries = entries,
+		.len = 0,
+		.spare = spare,
+		.lock = tfs_mutex_new(),
+		.next = NULL,
+	};
+
+	tfs_mutex_lock(&self->buffers_lock);
+	buffer->next = self->buffers;
+	self->buffers = buffer;
+	tfs_mutex_unlock(&self->buffers_lock);
+
+	thread_buffer = buffer;
+	thread_buffer_recorder = self->id;
+	return buffer;
+}
+
+/// @brief Resizes the buckets, re-adding all clients
+static void rehash(TfsServerRecorder* self, size_t buckets_len) {
+	free(self->buckets);
+	self->buckets = malloc(buckets_len * sizeof(uint32_t));
+	self->clients = realloc(self->clients, buckets_len / 2 * sizeof(TfsServerRecorderClient));
+	if (self->buckets == NULL || self->clients == NULL) {
+		fprintf(stderr, "Unable to allocate recorder clients\n");
+		exit(EXIT_FAILURE);
+	}
+	self->buckets_len = buckets_len;
+
+	tfs_buckets_clear(self->buckets, buckets_len);
+	for (size_t n = 0; n < self->clients_len; n++) {
+		const TfsServerRecorderClient* client = &self->clients[n];
+		uint64_t hash = tfs_hash_bytes(TFS_HASH_SEED, &client->address, client->address_len);
+		self->buckets[tfs_buckets_find_empty(self->buckets, buckets_len, hash)] = (uint32_t)n;
+	}
+}
+
+/// @brief Returns the number of a client, adding it if it wasn't yet seen
+/// @details
+/// Only the writer may call this.
+static uint32_t client_number(TfsServerRecorder* self, const struct sockaddr_un* address, socklen_t address_len) {
+	size_t bucket = (size_t)(tfs_hash_bytes(TFS_HASH_SEED, address, address_len) % self->buckets_len);
+	while (self->buckets[bucket] != TFS_BUCKET_EMPTY) {
+		const TfsServerRecorderClient* client = &self->clients[self->buckets[bucket]];
+		if (client->address_len == address_len && memcmp(&client->address, address, address_len) == 0) {
+			return self->buckets[bucket];
+		}
+		bucket = (bucket + 1) % self->buckets_len;
+	}
+
+	uint32_t number = (uint32_t)self->clients_len;
+	self->buckets[bucket] = number;
+	TfsServerRecorderClient* client = &self->clients[self->clients_len++];
+	memcpy(&client->address, address, address_len);
+	client->address_len = address_len;
+	if (2 * self->clients_len >= self->buckets_len) { rehash(self, 2 * self->buckets_len); }
+
+	return number;
+}
+
+/// @brief Converts a buffer's entries to the recording's format, appending them to the output buffer
+/// @details
+/// Only the writer may call this.
+static void convert_entries(TfsServerRecorder* self, const char* entries, size_t entries_len) {
+	// Note: Each converted entry is at most a header and a newline longer than the buffered one.
+	size_t max_entries = entries_len / sizeof(BufferEntryHeader);
+	size_t max_len = self->out_buffer_len + entries_len + max_entries * (sizeof(TfsCommandRecordingEntryHeader) + 1);
+	if (max_len > self->out_buffer_capacity) {
+		self->out_buffer_capacity = tfs_max_size_t(max_len, 2 * self->out_buffer_capacity);
+		self->out_buffer = realloc(self->out_buffer, self->out_buffer_capacity);
+		if (self->out_buffer == NULL) {
+			fprintf(stderr, "Unable to allocate recorder output buffer\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	size_t pos = 0;
+	while (pos < entries_len) {
+		BufferEntryHeader buffer_header;
+		memcpy(&buffer_header, entries + pos, sizeof(buffer_header));
+		const char* address = entries + pos + sizeof(buffer_header);
+		const char* command_str = address + buffer_header.address_len;
+		pos += sizeof(buffer_header) + buffer_header.address_len + buffer_header.len;
+
+		// Note: Unnamed clients are all given the same address, with just the family, so they share a number.
+		struct sockaddr_un client_address = {.sun_family = AF_UNIX};
+		socklen_t client_address_len = sizeof(sa_family_t);
+		if (buffer_header.address_len != 0) {
+			memcpy(&client_address, address, buffer_header.address_len);
+			client_address_len = buffer_header.address_len;
+		}
+
+		TfsCommandRecordingEntryHeader header = {
+			.time_ns = buffer_header.time_ns,
+			.client = client_number(self, &client_address, client_address_len),
+			.len = buffer_header.len,
+		};
+		char* entry = self->out_buffer + self->out_buffer_len;
+		memcpy(entry, &header, sizeof(header));
+		memcpy(entry + sizeof(header), command_str, buffer_header.len);
+		entry[sizeof(header) + buffer_header.len] = '\n';
+		self->out_buffer_len += sizeof(header) + buffer_header.len + 1;
+	}
+}
+
+/// @brief Collects all buffers, and writes them to the output file
+/// @details
+/// Only the writer, or the closer, once the writer stopped, may call this.
+static void collect(TfsServerRecorder* self) {
+	if (__atomic_load_n(&self->failed, __ATOMIC_ACQUIRE)) { return; }
+
+	// Note: Buffers are only ever added to the front, so the rest of the list may be walked without the lock.
+	tfs_mutex_lock(&self->buffers_lock);
+	TfsServerRecorderBuffer* buffers = self->buffers;
+	tfs_mutex_unlock(&self->buffers_lock);
+
+	// Swap out each buffer's entries, and convert them without holding it's lock
+	for (TfsServerRecorderBuffer* buffer = buffers; buffer != NULL; buffer = buffer->next) {
+		tfs_mutex_lock(&buffer->lock);
+		char* entries = buffer->entries;
+		size_t entries_len = buffer->len;
+		buffer->entries = buffer->spare;
+		buffer->len = 0;
+		buffer->spare = entries;
+		tfs_mutex_unlock(&buffer->lock);
+
+		convert_entries(self, entries, entries_len);
+	}
+	if (self->out_buffer_len == 0) { return; }
+
+	size_t out_buffer_len = self->out_buffer_len;
+	self->out_buffer_len = 0;
+	if (fwrite(self->out_buffer, 1, out_buffer_len, self->out) != out_buffer_len || fflush(self->out) != 0) {
+		fprintf(stderr, "Unable to write recording, no further commands will be recorded\n");
+		__atomic_store_n(&self->failed, true, __ATOMIC_RELEASE);
+	}
+}
+
+/// @brief Writer thread, collecting the buffers whenever one fills up halfway or the interval passes
+static void* writer_thread_fn(void* arg) {
+	TfsServerRecorder* self = arg;
+
+	tfs_mutex_lock(&self->lock);
+	while (!self->stop) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += RECORDER_FLUSH_INTERVAL_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		bool timed_out = false;
+		while (!self->wake && !self->stop && !timed_out) {
+			timed_out = !tfs_cond_var_timed_wait(&self->cond, &self->lock, &deadline);
+		}
+		self->wake = false;
+
+		tfs_mutex_unlock(&self->lock);
+		collect(self);
+		tfs_mutex_lock(&self->lock);
+	}
+	tfs_mutex_unlock(&self->lock);
+
+	return NULL;
+}
+
+TfsServerRecorder tfs_server_recorder_new(FILE* out) {
+	TfsServerRecorder self = {
+		.out = out,
+		.id = __atomic_fetch_add(&next_recorder_id, 1, __ATOMIC_RELAXED),
+		.start_ns = tfs_now_ns(CLOCK_MONOTONIC),
+		.buffers = NULL,
+		.buffers_lock = tfs_mutex_new(),
+		.out_buffer = malloc(TFS_SERVER_RECORDER_BUFFER_CAPACITY),
+		.out_buffer_len = 0,
+		.out_buffer_capacity = TFS_SERVER_RECORDER_BUFFER_CAPACITY,
+		.clients = NULL,
+		.clients_len = 0,
+		.buckets = NULL,
+		.buckets_len = 0,
+		.dropped = 0,
+		.failed = false,
+		.wake = false,
+		.stop = false,
+		.lock = tfs_mutex_new(),
+		.cond = tfs_cond_var_new(),
+	};
+	if (self.out_buffer == NULL) {
+		fprintf(stderr, "Unable to allocate recorder output buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	rehash(&self, RECORDER_INITIAL_BUCKETS);
+
+	// Note: The header is buffered like any entry, so it's written along with them.
+	TfsCommandRecordingHeader header = {
+		.magic = TFS_COMMAND_RECORDING_MAGIC,
+		.version = TFS_COMMAND_RECORDING_VERSION,
+		.reserved = 0,
+	};
+	memcpy(self.out_buffer, &header, sizeof(header));
+	self.out_buffer_len = sizeof(header);
+
+	return self;
+}
+
+void tfs_server_recorder_destroy(TfsServerRecorder* self) {
+	TfsServerRecorderBuffer* buffer = self->buffers;
+	while (buffer != NULL) {
+		TfsServerRecorderBuffer* next = buffer->next;
+		tfs_mutex_destroy(&buffer->lock);
+		free(buffer->spare);
+		free(buffer->entries);
+		free(buffer);
+		buffer = next;
+	}
+
+	tfs_cond_var_destroy(&self->cond);
+	tfs_mutex_destroy(&self->lock);
+	tfs_mutex_destroy(&self->buffers_lock);
+	free(self->buckets);
+	free(self->clients);
+	free(self->out_buffer);
+}
+
+void tfs_server_recorder_start(TfsServerRecorder* self) {
+	int res = pthread_create(&self->writer, NULL, writer_thread_fn, self);
+	if (res != 0) {
+		fprintf(stderr, "Unable to create recorder writer thread: %d\n", res);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void tfs_server_recorder_record(TfsServerRecorder* self,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	const char* command_str,
+	size_t command_str_len) {
+	if (__atomic_load_n(&self->failed, __ATOMIC_ACQUIRE)) { return; }
+
+	// Note: Unnamed addresses may hold anything past their family, so none of it is recorded.
+	if (address_len <= sizeof(sa_family_t)) { address_len = 0; }
+
+	// If the buffer is full, drop the command, rather than wait for the writer
+	TfsServerRecorderBuffer* buffer = thread_buffer_get(self);
+	size_t entry_len = sizeof(BufferEntryHeader) + address_len + command_str_len;
+	tfs_mutex_lock(&buffer->lock);
+	if (buffer->len + entry_len > TFS_SERVER_RECORDER_BUFFER_CAPACITY) {
+		tfs_mutex_unlock(&buffer->lock);
+		__atomic_fetch_add(&self->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	// Note: The time is taken with the lock held, so each buffer's entries are always in order.
+	BufferEntryHeader header = {
+		.time_ns = tfs_now_ns(CLOCK_MONOTONIC) - self->start_ns,
+		.address_len = (uint32_t)address_len,
+		.len = (uint32_t)command_str_len,
+	};
+	char* entry = buffer->entries + buffer->len;
+	memcpy(entry, &header, sizeof(header));
+	memcpy(entry + sizeof(header), address, address_len);
+	memcpy(entry + sizeof(header) + address_len, command_str, command_str_len);
+	size_t half_capacity = TFS_SERVER_RECORDER_BUFFER_CAPACITY / 2;
+	bool half_full = buffer->len < half_capacity && buffer->len + entry_len >= half_capacity;
+	buffer->len += entry_len;
+	tfs_mutex_unlock(&buffer->lock);
+
+	// Note: The writer is only woken as the buffer crosses half full, so it's lock is rarely taken here.
+	if (half_full) {
+		tfs_mutex_lock(&self->lock);
+		self->wake = true;
+		tfs_cond_var_signal(&self->cond);
+		tfs_mutex_unlock(&self->lock);
+	}
+}
+
+uint64_t tfs_server_recorder_dropped(const TfsServerRecorder* self) {
+	return __atomic_load_n(&self->dropped, __ATOMIC_RELAXED);
+}
+
+bool tfs_server_recorder_close(TfsServerRecorder* self) {
+	// Stop the writer
+	tfs_mutex_lock(&self->lock);
+	self->stop = true;
+	tfs_cond_var_signal(&self->cond);
+	tfs_mutex_unlock(&self->lock);
+	pthread_join(self->writer, NULL);
+
+	// Then collect and write everything that's left ourselves
+	collect(self);
+
+	return !__atomic_load_n(&self->failed, __ATOMIC_ACQUIRE);
+}
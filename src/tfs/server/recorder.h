@@ -0,0 +1,182 @@
+/// @file
+/// @brief Command traffic recorder
+/// @details
+/// This file defines the #TfsServerRecorder type, which records every
+/// command the server executes, along with when and from which client,
+/// into a #TfsCommandRecording.
+///
+/// Recording a command only appends it to the recording thread's own
+/// buffer, see #TfsServerRecorderBuffer, under a lock only ever contended
+/// by the writer. A background writer collects all buffers, and writes
+/// them to the output file, whenever one of them fills up halfway, or at
+/// a fixed interval, so at most that interval's commands are lost if the
+/// server is killed.
+///
+/// Buffers never grow: if the writer falls behind, and a thread's buffer
+/// fills up, further commands of that thread are dropped, and counted,
+/// see #tfs_server_recorder_dropped, rather than recorded.
+///
+/// Clients are identified by their address, and numbered by the writer in
+/// the order it first wrote them. Clients without an address, such as those
+/// of the session socket, all share a single number.
+
+#ifndef TFS_SERVER_RECORDER_H
+#define TFS_SERVER_RECORDER_H
+
+// Imports
+#include <pthread.h>	  // pthread_t
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint32_t, uint64_t
+#include <stdio.h>		  // FILE
+#include <sys/socket.h>	  // socklen_t
+#include <sys/un.h>		  // sockaddr_un
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/mutex.h>	  // TfsMutex
+
+/// @brief Capacity of each thread's buffer
+#define TFS_SERVER_RECORDER_BUFFER_CAPACITY (256 * 1024)
+
+/// @brief A client seen by the recorder
+typedef struct TfsServerRecorderClient {
+	/// @brief Address of the client
+	struct sockaddr_un address;
+
+	/// @brief Length of @ref address
+	socklen_t address_len;
+} TfsServerRecorderClient;
+
+/// @brief A thread's buffer of recorded commands
+/// @details
+/// Commands are buffered with their client's address, rather than it's
+/// number, which only the writer assigns, once it collects them.
+typedef struct TfsServerRecorderBuffer {
+	/// @brief Commands not yet collected by the writer
+	char* entries;
+
+	/// @brief Length of @ref entries
+	size_t len;
+
+	/// @brief Buffer the writer swaps with @ref entries when collecting them
+	char* spare;
+
+	/// @brief Lock over @ref entries and @ref len
+	TfsMutex lock;
+
+	/// @brief Next buffer
+	struct TfsServerRecorderBuffer* next;
+} TfsServerRecorderBuffer;
+
+/// @brief Command traffic recorder
+typedef struct TfsServerRecorder {
+	/// @brief File recorded to
+	FILE* out;
+
+	/// @brief Unique id of the recorder, which each thread's buffer is tied to
+	uint64_t id;
+
+	/// @brief Time the recording started, in `CLOCK_MONOTONIC` nanoseconds
+	uint64_t start_ns;
+
+	/// @brief All threads' buffers, as a linked list
+	/// @details
+	/// Buffers are only ever added, to the front, until the recorder is destroyed.
+	TfsServerRecorderBuffer* buffers;
+
+	/// @brief Lock over @ref buffers
+	/// @details
+	/// This is only taken by the writer and by threads recording their first command.
+	TfsMutex buffers_lock;
+
+	/// @brief Collected commands, in the recording's format, not yet written
+	/// @details
+	/// This, and all fields up until @ref buckets_len, are only accessed by the writer.
+	char* out_buffer;
+
+	/// @brief Length of @ref out_buffer
+	size_t out_buffer_len;
+
+	/// @brief Capacity of @ref out_buffer
+	size_t out_buffer_capacity;
+
+	/// @brief All clients written, indexed by their number
+	TfsServerRecorderClient* clients;
+
+	/// @brief Number of clients
+	size_t clients_len;
+
+	/// @brief Client of each bucket, or #TFS_BUCKET_EMPTY
+	/// @details
+	/// Buckets are probed linearly, and kept at most half full.
+	uint32_t* buckets;
+
+	/// @brief Number of buckets
+	size_t buckets_len;
+
+	/// @brief Number of commands dropped, as their thread's buffer was full
+	/// @details
+	/// This is updated atomically.
+	uint64_t dropped;
+
+	/// @brief If a write failed, after which nothing else is recorded nor written
+	/// @details
+	/// This is updated atomically.
+	bool failed;
+
+	/// @brief If a buffer filled up halfway since the writer last collected them
+	bool wake;
+
+	/// @brief If the writer should stop
+	bool stop;
+
+	/// @brief The writer thread
+	pthread_t writer;
+
+	/// @brief Lock over @ref wake and @ref stop
+	TfsMutex lock;
+
+	/// @brief Signaled when a buffer fills up halfway, or the writer should stop
+	TfsCondVar cond;
+} TfsServerRecorder;
+
+/// @brief Creates a new recorder
+/// @param out File to record to. Only borrowed, and must outlive the recorder.
+/// @details
+/// The recording's header is buffered, and written along with the first
+/// commands. Nothing is written until #tfs_server_recorder_start.
+TfsServerRecorder tfs_server_recorder_new(FILE* out);
+
+/// @brief Destroys a recorder
+/// @details
+/// The recorder must have been closed.
+void tfs_server_recorder_destroy(TfsServerRecorder* self);
+
+/// @brief Starts the writer
+/// @details
+/// The recorder must not be moved from then on.
+void tfs_server_recorder_start(TfsServerRecorder* self);
+
+/// @brief Records a command
+/// @param self
+/// @param address Address of the client that sent it
+/// @param address_len Length of @p address
+/// @param command_str The command, as text, without it's newline
+/// @param command_str_len Length of @p command_str
+/// @details
+/// If the calling thread's buffer is full, the command is dropped instead.
+void tfs_server_recorder_record(TfsServerRecorder* self,
+	const struct sockaddr_un* address,
+	socklen_t address_len,
+	const char* command_str,
+	size_t command_str_len);
+
+/// @brief Returns the number of commands dropped so far, as their thread's buffer was full
+uint64_t tfs_server_recorder_dropped(const TfsServerRecorder* self);
+
+/// @brief Closes the recorder, stopping the writer and writing everything recorded
+/// @return If everything was written
+/// @details
+/// No commands may be recorded once closed.
+bool tfs_server_recorder_close(TfsServerRecorder* self);
+
+#endif
@@ -0,0 +1,136 @@
+#include "scheduler.h"
+
+// Imports
+#include <ctype.h>	// isspace
+#include <stdio.h>	// fprintf, stderr
+#include <stdlib.h>	// malloc, free, exit, EXIT_FAILURE
+
+const char* tfs_server_scheduler_class_str(TfsServerSchedulerClass class) {
+	switch (class) {
+		case TfsServerSchedulerClassRead: return "read";
+		case TfsServerSchedulerClassWrite: return "write";
+		case TfsServerSchedulerClassBackground: return "background";
+		default: return "unknown";
+	}
+}
+
+TfsServerSchedulerClass tfs_server_scheduler_classify(const char* command_str, size_t command_str_len) {
+	// Note: Just like when parsed, the command may be preceded by whitespace.
+	size_t pos = 0;
+	while (pos < command_str_len && isspace((unsigned char)command_str[pos])) { pos++; }
+	if (pos == command_str_len) { return TfsServerSchedulerClassWrite; }
+
+	switch (command_str[pos]) {
+		case 'l': return TfsServerSchedulerClassRead;
+		case 'p': return TfsServerSchedulerClassBackground;
+		default: return TfsServerSchedulerClassWrite;
+	}
+}
+
+TfsServerScheduler tfs_server_scheduler_new(size_t capacity) {
+	TfsServerScheduler scheduler = {
+		.capacity = capacity,
+		.lock = tfs_mutex_new(),
+		.not_full = tfs_cond_var_new(),
+		.closed = false,
+	};
+
+	for (size_t n = 0; n < TFS_SERVER_SCHEDULER_CLASSES; n++) {
+		void** items = malloc(capacity * sizeof(void*));
+		if (items == NULL) {
+			fprintf(stderr, "Unable to allocate scheduler queue\n");
+			exit(EXIT_FAILURE);
+		}
+		scheduler.queues[n] = (TfsServerSchedulerQueue){
+			.items = items,
+			.head = 0,
+			.len = 0,
+			.waiting = 0,
+			.not_empty = tfs_cond_var_new(),
+			.pushed = 0,
+		};
+	}
+
+	return scheduler;
+}
+
+void tfs_server_scheduler_destroy(TfsServerScheduler* self) {
+	for (size_t n = 0; n < TFS_SERVER_SCHEDULER_CLASSES; n++) {
+		tfs_cond_var_destroy(&self->queues[n].not_empty);
+		free(self->queues[n].items);
+	}
+	tfs_cond_var_destroy(&self->not_full);
+	tfs_mutex_destroy(&self->lock);
+}
+
+bool tfs_server_scheduler_push(TfsServerScheduler* self, TfsServerSchedulerClass class, void* item) {
+	TfsServerSchedulerQueue* queue = &self->queues[class];
+
+	tfs_mutex_lock(&self->lock);
+	while (!self->closed && queue->len == self->capacity) { tfs_cond_var_wait(&self->not_full, &self->lock); }
+	if (self->closed) {
+		tfs_mutex_unlock(&self->lock);
+		return false;
+	}
+
+	queue->items[(queue->head + queue->len) % self->capacity] = item;
+	queue->len++;
+	queue->pushed++;
+
+	// Note: If no reader is waiting, an idle writer may take the read instead.
+	TfsServerSchedulerQueue* write_queue = &self->queues[TfsServerSchedulerClassWrite];
+	if (class == TfsServerSchedulerClassRead && queue->waiting == 0 && write_queue->waiting != 0) {
+		tfs_cond_var_signal(&write_queue->not_empty);
+	}
+	else {
+		tfs_cond_var_signal(&queue->not_empty);
+	}
+	tfs_mutex_unlock(&self->lock);
+
+	return true;
+}
+
+/// @brief Returns the queue a lane of @p class should pop from, if any has items
+/// @details
+/// Must be called with the lock held.
+static TfsServerSchedulerQueue* lane_queue(TfsServerScheduler* self, TfsServerSchedulerClass class) {
+	if (self->queues[class].len != 0) { return &self->queues[class]; }
+
+	// Note: Writers help with reads, but nobody helps with writes or the background.
+	TfsServerSchedulerQueue* read_queue = &self->queues[TfsServerSchedulerClassRead];
+	if (class == TfsServerSchedulerClassWrite && read_queue->len != 0) { return read_queue; }
+
+	return NULL;
+}
+
+void* tfs_server_scheduler_pop(TfsServerScheduler* self, TfsServerSchedulerClass class) {
+	TfsServerSchedulerQueue* own_queue = &self->queues[class];
+
+	tfs_mutex_lock(&self->lock);
+	TfsServerSchedulerQueue* queue;
+	while ((queue = lane_queue(self, class)) == NULL && !self->closed) {
+		own_queue->waiting++;
+		tfs_cond_var_wait(&own_queue->not_empty, &self->lock);
+		own_queue->waiting--;
+	}
+	if (queue == NULL) {
+		tfs_mutex_unlock(&self->lock);
+		return NULL;
+	}
+
+	void* item = queue->items[queue->head];
+	queue->head = (queue->head + 1) % self->capacity;
+	queue->len--;
+	if (queue->len == self->capacity - 1) { tfs_cond_var_broadcast(&self->not_full); }
+	tfs_mutex_unlock(&self->lock);
+
+	return item;
+}
+
+void tfs_server_scheduler_close(TfsServerScheduler* self) {
+	tfs_mutex_lock(&self->lock);
+	self->closed = true;
+	for (size_t n = 0; n < TFS_SERVER_SCHEDULER_CLASSES; n++) { tfs_cond_var_broadcast(&self->queues[n].not_empty); }
+	tfs_cond_var_broadcast(&self->not_full);
+	tfs_mutex_unlock(&self->lock);
+}
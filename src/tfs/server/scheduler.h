@@ -0,0 +1,121 @@
+/// @file
+/// @brief Scheduling classes of the server's messages
+/// @details
+/// This file defines the #TfsServerScheduler type, a set of queues, one for
+/// each #TfsServerSchedulerClass, from which the server's worker lanes take
+/// the messages to execute.
+///
+/// Each lane serves a single class, but lanes of the write class also help
+/// with reads while they have no writes to execute, as reads are the most
+/// latency-critical. Reads are never executed by lanes of other classes, so
+/// a reader never queues up behind a writer blocked on a lock, and the
+/// background class, for prints, neither helps nor is helped by other lanes.
+
+#ifndef TFS_SERVER_SCHEDULER_H
+#define TFS_SERVER_SCHEDULER_H
+
+// Imports
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint64_t
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/mutex.h>	  // TfsMutex
+
+/// @brief Scheduling class of a message
+/// @details
+/// Classes are ordered by priority, so a message with commands of several
+/// classes is scheduled in the lowest priority one.
+typedef enum TfsServerSchedulerClass {
+	/// @brief Lookups, which are cheap and mostly parallel
+	TfsServerSchedulerClassRead = 0,
+
+	/// @brief Creates, removes and moves, which take unique locks
+	TfsServerSchedulerClassWrite = 1,
+
+	/// @brief Prints, which lock the whole file system
+	TfsServerSchedulerClassBackground = 2,
+} TfsServerSchedulerClass;
+
+/// @brief Number of scheduling classes
+#define TFS_SERVER_SCHEDULER_CLASSES 3
+
+/// @brief Queue of a scheduling class
+typedef struct TfsServerSchedulerQueue {
+	/// @brief All items, as a circular buffer
+	void** items;
+
+	/// @brief Index of the first item
+	size_t head;
+
+	/// @brief Number of items
+	size_t len;
+
+	/// @brief Number of lanes of this class waiting for an item
+	size_t waiting;
+
+	/// @brief Signaled whenever an item is pushed
+	TfsCondVar not_empty;
+
+	/// @brief Number of items ever pushed
+	uint64_t pushed;
+} TfsServerSchedulerQueue;
+
+/// @brief Queues of all scheduling classes
+typedef struct TfsServerScheduler {
+	/// @brief Queue of each class
+	TfsServerSchedulerQueue queues[TFS_SERVER_SCHEDULER_CLASSES];
+
+	/// @brief Capacity of each queue
+	size_t capacity;
+
+	/// @brief Lock over all queues
+	TfsMutex lock;
+
+	/// @brief Signaled whenever an item is popped or the scheduler is closed
+	TfsCondVar not_full;
+
+	/// @brief If the scheduler was closed
+	bool closed;
+} TfsServerScheduler;
+
+/// @brief Returns the name of a scheduling class
+const char* tfs_server_scheduler_class_str(TfsServerSchedulerClass class);
+
+/// @brief Classifies a command by it's kind
+/// @param command_str The command, of which only the first non-whitespace character, it's kind, is read
+/// @param command_str_len Length of @p command_str
+/// @details
+/// Unknown, or empty, commands are classified as writes, as they're
+/// rejected once parsed anyway.
+TfsServerSchedulerClass tfs_server_scheduler_classify(const char* command_str, size_t command_str_len);
+
+/// @brief Creates a new scheduler
+/// @param capacity Capacity of each class' queue
+TfsServerScheduler tfs_server_scheduler_new(size_t capacity);
+
+/// @brief Destroys a scheduler
+/// @details
+/// All items still queued are simply dropped.
+void tfs_server_scheduler_destroy(TfsServerScheduler* self);
+
+/// @brief Pushes an item to the queue of @p class
+/// @param self
+/// @param class The class of the item
+/// @param item The item
+/// @return If pushed. Fails only once the scheduler is closed.
+/// @details
+/// Blocks while the queue is full.
+bool tfs_server_scheduler_push(TfsServerScheduler* self, TfsServerSchedulerClass class, void* item);
+
+/// @brief Pops the next item for a lane of @p class
+/// @param self
+/// @param class The class of the lane
+/// @return The item, or `NULL` once the scheduler is closed and no items are left for the lane
+/// @details
+/// Blocks while no item is available for the lane.
+void* tfs_server_scheduler_pop(TfsServerScheduler* self, TfsServerSchedulerClass class);
+
+/// @brief Closes the scheduler, waking up all lanes
+void tfs_server_scheduler_close(TfsServerScheduler* self);
+
+#endif
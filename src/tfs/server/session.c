@@ -0,0 +1,65 @@
+#include "session.h"
+
+// Imports
+#include <inttypes.h>	  // PRIu64
+#include <stdlib.h>		  // malloc, free, exit, EXIT_FAILURE
+#include <sys/socket.h>	  // getsockopt, ucred, SO_PEERCRED
+#include <tfs/protocol.h> // tfs_protocol_*
+#include <unistd.h>		  // close
+
+TfsServerSession* tfs_server_session_new(int socket, size_t id) {
+	TfsServerSession* session = malloc(sizeof(TfsServerSession));
+	if (session == NULL) {
+		fprintf(stderr, "Unable to allocate session\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// Note: If we can't get the client's credentials, we just leave them unknown.
+	struct ucred credentials = {.pid = 0, .uid = 0, .gid = 0};
+	socklen_t credentials_len = sizeof(credentials);
+	getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_len);
+
+	*session = (TfsServerSession){
+		.socket = socket,
+		.id = id,
+		.pid = credentials.pid,
+		.uid = credentials.uid,
+		.stats = {.messages = 0, .commands = 0, .commands_failed = 0},
+	};
+
+	return session;
+}
+
+void tfs_server_session_destroy(TfsServerSession* self) {
+	close(self->socket);
+	free(self);
+}
+
+void tfs_server_session_record(TfsServerSession* self, const char* reply, size_t reply_len) {
+	self->stats.messages++;
+
+	// Legacy replies hold a single result, while framed ones hold `count` results after their header
+	if (!tfs_protocol_is_framed(reply, reply_len)) {
+		self->stats.commands++;
+		if (reply_len == 0 || reply[0] == '\0') { self->stats.commands_failed++; }
+		return;
+	}
+
+	TfsProtocolHeaderReadResult header_result = tfs_protocol_header_read(reply, reply_len);
+	if (!header_result.success) { return; }
+	for (size_t n = 0; n < header_result.data.header.count && TFS_PROTOCOL_HEADER_LEN + n < reply_len; n++) {
+		self->stats.commands++;
+		if (reply[TFS_PROTOCOL_HEADER_LEN + n] == '\0') { self->stats.commands_failed++; }
+	}
+}
+
+void tfs_server_session_print(const TfsServerSession* self, FILE* out) {
+	fprintf(out,
+		"Session #%zu (pid %d, uid %u): %" PRIu64 " messages, %" PRIu64 " commands (%" PRIu64 " failed)\n",
+		self->id,
+		(int)self->pid,
+		(unsigned)self->uid,
+		self->stats.messages,
+		self->stats.commands,
+		self->stats.commands_failed);
+}
@@ -0,0 +1,71 @@
+/// @file
+/// @brief Connection-oriented client sessions
+/// @details
+/// This file defines the #TfsServerSession type, the state the server keeps
+/// for each client connected to it's `SOCK_SEQPACKET` session socket.
+///
+/// Unlike datagram clients, whose address is re-learned on every message,
+/// a session lives for as long as it's connection, so the server can keep
+/// per-client state, such as the client's credentials and statistics, which
+/// is reclaimed once the client disconnects.
+
+#ifndef TFS_SERVER_SESSION_H
+#define TFS_SERVER_SESSION_H
+
+// Imports
+#include <stddef.h>	   // size_t
+#include <stdint.h>	   // uint64_t
+#include <stdio.h>	   // FILE
+#include <sys/types.h> // pid_t, uid_t
+
+/// @brief Statistics of a session
+typedef struct TfsServerSessionStats {
+	/// @brief Number of messages received
+	uint64_t messages;
+
+	/// @brief Number of commands executed
+	uint64_t commands;
+
+	/// @brief Number of commands that failed
+	uint64_t commands_failed;
+} TfsServerSessionStats;
+
+/// @brief A client session
+typedef struct TfsServerSession {
+	/// @brief Connected socket of the session
+	int socket;
+
+	/// @brief Id of the session
+	size_t id;
+
+	/// @brief Process id of the client, or `0` if unknown
+	pid_t pid;
+
+	/// @brief User id of the client
+	uid_t uid;
+
+	/// @brief Statistics
+	TfsServerSessionStats stats;
+} TfsServerSession;
+
+/// @brief Creates a new session
+/// @param socket The connected socket. It is owned by the session afterwards.
+/// @param id Id of the session
+/// @return The session, which must be destroyed with #tfs_server_session_destroy.
+TfsServerSession* tfs_server_session_new(int socket, size_t id);
+
+/// @brief Destroys a session, closing it's socket
+void tfs_server_session_destroy(TfsServerSession* self);
+
+/// @brief Records a message and it's reply on the session's statistics
+/// @param self
+/// @param reply The reply sent to the message
+/// @param reply_len Length of @p reply
+void tfs_server_session_record(TfsServerSession* self, const char* reply, size_t reply_len);
+
+/// @brief Prints a summary of a session to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_server_session_print(const TfsServerSession* self, FILE* out);
+
+#endif
@@ -0,0 +1,111 @@
+#include "singleflight.h"
+
+// Imports
+#include <inttypes.h> // PRIu64
+#include <stdlib.h>	  // malloc, free, exit, EXIT_FAILURE
+
+TfsServerSingleflight tfs_server_singleflight_new(void) {
+	return (TfsServerSingleflight){
+		.calls = NULL,
+		.lock = tfs_mutex_new(),
+		.generation = 0,
+		.stats = {.executed = 0, .coalesced = 0, .max_shared = 0},
+	};
+}
+
+void tfs_server_singleflight_destroy(TfsServerSingleflight* self) {
+	tfs_mutex_destroy(&self->lock);
+}
+
+/// @brief Releases a reference to @p call, destroying it if it was the last
+/// @details
+/// Must be called with the lock held.
+static void release_call(TfsServerSingleflightCall* call) {
+	if (--call->refs != 0) { return; }
+
+	tfs_cond_var_destroy(&call->done_cond);
+	free(call);
+}
+
+TfsFsFindResult tfs_server_singleflight_find(TfsServerSingleflight* self, TfsFs* fs, TfsPath path) {
+	tfs_mutex_lock(&self->lock);
+
+	// If the path is already being looked up since the last write, wait for it's result
+	// Note: Lookups that started before it may still be in flight, alongside ours, but can't be joined.
+	uint64_t generation = __atomic_load_n(&self->generation, __ATOMIC_ACQUIRE);
+	for (TfsServerSingleflightCall* call = self->calls; call != NULL; call = call->next) {
+		if (call->generation != generation || !tfs_path_eq(call->path, path)) { continue; }
+
+		call->refs++;
+		__atomic_fetch_add(&self->stats.coalesced, 1, __ATOMIC_RELAXED);
+		while (!call->done) { tfs_cond_var_wait(&call->done_cond, &self->lock); }
+
+		TfsFsFindResult result = call->result;
+		release_call(call);
+		tfs_mutex_unlock(&self->lock);
+		return result;
+	}
+
+	// Else lead the lookup ourselves
+	TfsServerSingleflightCall* call = malloc(sizeof(TfsServerSingleflightCall));
+	if (call == NULL) {
+		fprintf(stderr, "Unable to allocate lookup\n");
+		exit(EXIT_FAILURE);
+	}
+	*call = (TfsServerSingleflightCall){
+		.path = path,
+		.generation = generation,
+		.done = false,
+		.refs = 1,
+		.done_cond = tfs_cond_var_new(),
+		.next = self->calls,
+	};
+	self->calls = call;
+	tfs_mutex_unlock(&self->lock);
+
+	// Note: We unlock the inode right away, as the followers can't share it's lock.
+	TfsFsFindResult result = tfs_fs_find(fs, path, TfsRwLockAccessShared);
+	if (result.success) { tfs_fs_unlock_inode(fs, result.data.inode.idx); }
+	__atomic_fetch_add(&self->stats.executed, 1, __ATOMIC_RELAXED);
+
+	// Then remove the lookup, so no more followers join it, and share it's result
+	tfs_mutex_lock(&self->lock);
+	TfsServerSingleflightCall** link = &self->calls;
+	while (*link != call) { link = &(*link)->next; }
+	*link = call->next;
+
+	uint64_t shared = call->refs;
+	if (shared > __atomic_load_n(&self->stats.max_shared, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&self->stats.max_shared, shared, __ATOMIC_RELAXED);
+	}
+
+	call->result = result;
+	call->done = true;
+	tfs_cond_var_broadcast(&call->done_cond);
+	release_call(call);
+	tfs_mutex_unlock(&self->lock);
+
+	return result;
+}
+
+void tfs_server_singleflight_written(TfsServerSingleflight* self) {
+	__atomic_fetch_add(&self->generation, 1, __ATOMIC_RELEASE);
+}
+
+TfsServerSingleflightStats tfs_server_singleflight_stats(const TfsServerSingleflight* self) {
+	return (TfsServerSingleflightStats){
+		.executed = __atomic_load_n(&self->stats.executed, __ATOMIC_RELAXED),
+		.coalesced = __atomic_load_n(&self->stats.coalesced, __ATOMIC_RELAXED),
+		.max_shared = __atomic_load_n(&self->stats.max_shared, __ATOMIC_RELAXED),
+	};
+}
+
+void tfs_server_singleflight_stats_print(const TfsServerSingleflightStats* self, FILE* out) {
+	uint64_t total = self->executed + self->coalesced;
+	fprintf(out,
+		"Lookups: %" PRIu64 " executed, %" PRIu64 " coalesced (%.1f%%), at most %" PRIu64 " per execution\n",
+		self->executed,
+		self->coalesced,
+		total == 0 ? 0.0 : 100.0 * (double)self->coalesced / (double)total,
+		self->max_shared);
+}
@@ -0,0 +1,116 @@
+/// @file
+/// @brief Coalescing of concurrent identical lookups
+/// @details
+/// This file defines the #TfsServerSingleflight type, which lets concurrent
+/// lookups of the same path share a single #tfs_fs_find execution.
+///
+/// The first lookup of a path, the leader, executes it, while any lookup of
+/// the same path arriving before it finishes, a follower, waits for it and
+/// shares it's result. As a follower only ever joins a lookup in flight, it's
+/// result is still one the file system had while the follower was waiting.
+///
+/// However, a lookup in flight may have started before a write that has since
+/// finished, and so may miss it. Writes are thus reported with
+/// #tfs_server_singleflight_written, and followers only join lookups that
+/// started after the last one.
+
+#ifndef TFS_SERVER_SINGLEFLIGHT_H
+#define TFS_SERVER_SINGLEFLIGHT_H
+
+// Imports
+#include <stdint.h>		  // uint64_t
+#include <stdio.h>		  // FILE
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/fs.h>		  // TfsFs, TfsFsFindResult
+#include <tfs/mutex.h>	  // TfsMutex
+#include <tfs/path.h>	  // TfsPath
+
+/// @brief A lookup in flight
+typedef struct TfsServerSingleflightCall {
+	/// @brief Path looked up
+	/// @details
+	/// Borrowed from the leader, so only valid while the lookup is in flight.
+	TfsPath path;
+
+	/// @brief Result of the lookup, once done
+	/// @details
+	/// The inode found, if any, is already unlocked.
+	TfsFsFindResult result;
+
+	/// @brief Write generation the lookup started in
+	uint64_t generation;
+
+	/// @brief If the lookup is done
+	bool done;
+
+	/// @brief Number of lookups still referencing this call
+	size_t refs;
+
+	/// @brief Signaled once the lookup is done
+	TfsCondVar done_cond;
+
+	/// @brief Next lookup in flight
+	struct TfsServerSingleflightCall* next;
+} TfsServerSingleflightCall;
+
+/// @brief Statistics of coalesced lookups
+typedef struct TfsServerSingleflightStats {
+	/// @brief Number of lookups executed
+	uint64_t executed;
+
+	/// @brief Number of lookups that shared another's execution
+	uint64_t coalesced;
+
+	/// @brief Maximum number of lookups sharing a single execution
+	uint64_t max_shared;
+} TfsServerSingleflightStats;
+
+/// @brief All lookups in flight
+typedef struct TfsServerSingleflight {
+	/// @brief All lookups in flight, as a linked list
+	TfsServerSingleflightCall* calls;
+
+	/// @brief Lock over @ref calls
+	TfsMutex lock;
+
+	/// @brief Number of writes finished
+	/// @details
+	/// This is updated atomically, so it may be bumped without the lock.
+	uint64_t generation;
+
+	/// @brief Statistics
+	/// @details
+	/// These are updated atomically, so they may be read without the lock.
+	TfsServerSingleflightStats stats;
+} TfsServerSingleflight;
+
+/// @brief Creates a new, empty, set of lookups in flight
+TfsServerSingleflight tfs_server_singleflight_new(void);
+
+/// @brief Destroys a set of lookups in flight
+/// @details
+/// No lookups may be in flight.
+void tfs_server_singleflight_destroy(TfsServerSingleflight* self);
+
+/// @brief Looks up @p path, sharing the execution of any lookup of @p path in flight
+/// @param self
+/// @param fs The file system
+/// @param path The path to look up
+/// @return The result of #tfs_fs_find, with shared access, except that the inode found, if any, is already unlocked.
+TfsFsFindResult tfs_server_singleflight_find(TfsServerSingleflight* self, TfsFs* fs, TfsPath path);
+
+/// @brief Reports that a write to the file system finished
+/// @details
+/// Must be called after any successful create, remove or move, before it's acknowledged,
+/// so that no lookup arriving after it may share a lookup that started before it.
+void tfs_server_singleflight_written(TfsServerSingleflight* self);
+
+/// @brief Returns a snapshot of the statistics
+TfsServerSingleflightStats tfs_server_singleflight_stats(const TfsServerSingleflight* self);
+
+/// @brief Prints statistics to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_server_singleflight_stats_print(const TfsServerSingleflightStats* self, FILE* out);
+
+#endif
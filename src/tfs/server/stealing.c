@@ -0,0 +1,132 @@
+#include "stealing.h"
+
+// Imports
+#include <assert.h>		 // assert
+#include <errno.h>		 // errno, EINTR
+#include <inttypes.h>	 // PRIu64
+#include <poll.h>		 // poll, pollfd, POLLIN
+#include <stdlib.h>		 // malloc, free, exit, EXIT_FAILURE
+#include <string.h>		 // strerror
+#include <sys/eventfd.h> // eventfd, EFD_*
+#include <unistd.h>		 // read, write, close
+
+TfsServerStealing tfs_server_stealing_new(size_t workers, size_t capacity) {
+	assert(workers >= 1);
+
+	TfsServerStealing stealing = {
+		.deques = malloc(workers * sizeof(TfsServerDeque)),
+		.stats = malloc(workers * sizeof(TfsServerStealingStats)),
+		.len = workers,
+		.joined = 0,
+		.idle = 0,
+		.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC),
+	};
+	if (stealing.deques == NULL || stealing.stats == NULL) {
+		fprintf(stderr, "Unable to allocate deques for %zu workers\n", workers);
+		exit(EXIT_FAILURE);
+	}
+	if (stealing.wake_fd < 0) {
+		fprintf(stderr, "Unable to create wake eventfd\n");
+		fprintf(stderr, "(%d) %s\n", errno, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t n = 0; n < workers; n++) {
+		stealing.deques[n] = tfs_server_deque_new(capacity);
+		stealing.stats[n] = (TfsServerStealingStats){.popped = 0, .stolen = 0, .overflowed = 0};
+	}
+
+	return stealing;
+}
+
+void tfs_server_stealing_destroy(TfsServerStealing* self) {
+	for (size_t n = 0; n < self->len; n++) { tfs_server_deque_destroy(&self->deques[n]); }
+	close(self->wake_fd);
+	free(self->stats);
+	free(self->deques);
+}
+
+size_t tfs_server_stealing_join(TfsServerStealing* self) {
+	size_t worker = __atomic_fetch_add(&self->joined, 1, __ATOMIC_RELAXED);
+	assert(worker < self->len);
+	return worker;
+}
+
+bool tfs_server_stealing_push(TfsServerStealing* self, size_t worker, void* item) {
+	if (tfs_server_deque_push(&self->deques[worker], item)) { return true; }
+
+	__atomic_fetch_add(&self->stats[worker].overflowed, 1, __ATOMIC_RELAXED);
+	return false;
+}
+
+void tfs_server_stealing_notify(TfsServerStealing* self) {
+	// Note: The fence orders our pushes before the load, pairing with the one in #tfs_server_stealing_wait,
+	//       so either we see the worker idle, or it sees our messages.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&self->idle, __ATOMIC_RELAXED) == 0) { return; }
+
+	// Note: If the eventfd is already signaled, there's no need to signal it again.
+	uint64_t wake = 1;
+	if (write(self->wake_fd, &wake, sizeof(wake)) < 0) {}
+}
+
+void* tfs_server_stealing_take(TfsServerStealing* self, size_t worker, uint64_t* seed) {
+	// Take our own newest message, if any
+	void* item = tfs_server_deque_pop(&self->deques[worker]);
+	if (item != NULL) {
+		__atomic_fetch_add(&self->stats[worker].popped, 1, __ATOMIC_RELAXED);
+		return item;
+	}
+
+	// Else steal the oldest message of another worker, starting at a random one
+	// Note: The seed is advanced with a xorshift.
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	size_t start = (size_t)(*seed % self->len);
+	for (size_t n = 0; n < self->len; n++) {
+		size_t victim = (start + n) % self->len;
+		if (victim == worker) { continue; }
+
+		item = tfs_server_deque_steal(&self->deques[victim]);
+		if (item != NULL) {
+			__atomic_fetch_add(&self->stats[worker].stolen, 1, __ATOMIC_RELAXED);
+			return item;
+		}
+	}
+
+	return NULL;
+}
+
+void tfs_server_stealing_wait(TfsServerStealing* self, int socket) {
+	// Announce we're idle, then check no messages were pushed before that
+	__atomic_fetch_add(&self->idle, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bool pending = false;
+	for (size_t n = 0; n < self->len && !pending; n++) { pending = tfs_server_deque_len(&self->deques[n]) != 0; }
+
+	if (!pending) {
+		struct pollfd fds[2] = {
+			{.fd = socket, .events = POLLIN, .revents = 0},
+			{.fd = self->wake_fd, .events = POLLIN, .revents = 0},
+		};
+		while (poll(fds, 2, -1) < 0 && errno == EINTR) {}
+	}
+	__atomic_fetch_sub(&self->idle, 1, __ATOMIC_SEQ_CST);
+
+	// Note: All idle workers were woken up, so whoever reads the eventfd resets it for all of them.
+	uint64_t wake;
+	if (read(self->wake_fd, &wake, sizeof(wake)) < 0) {}
+}
+
+void tfs_server_stealing_stats_print(const TfsServerStealing* self, FILE* out) {
+	for (size_t n = 0; n < self->len; n++) {
+		fprintf(out,
+			"Worker #%zu: %" PRIu64 " popped, %" PRIu64 " stolen, %" PRIu64 " overflowed, %zu queued\n",
+			n,
+			__atomic_load_n(&self->stats[n].popped, __ATOMIC_RELAXED),
+			__atomic_load_n(&self->stats[n].stolen, __ATOMIC_RELAXED),
+			__atomic_load_n(&self->stats[n].overflowed, __ATOMIC_RELAXED),
+			tfs_server_deque_len(&self->deques[n]));
+	}
+}
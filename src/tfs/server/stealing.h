@@ -0,0 +1,107 @@
+/// @file
+/// @brief Work-stealing between workers
+/// @details
+/// This file defines the #TfsServerStealing type, which gives each worker a
+/// #TfsServerDeque for the messages it receives, so a worker whose messages
+/// take long, such as a slow move or print, has the rest of them stolen by
+/// any idle workers, rather than leaving them waiting behind it.
+///
+/// A worker takes it's own messages newest first, which are the most likely
+/// to still be in it's cache, while thieves steal the oldest, which have been
+/// waiting for the longest. Thieves pick a random victim to start from, so
+/// they don't all contend on the same deque.
+///
+/// Idle workers wait on both the server socket and an eventfd, signaled
+/// whenever a worker pushes messages while any are idle, so they wake up
+/// either to receive messages of their own or to steal another's.
+
+#ifndef TFS_SERVER_STEALING_H
+#define TFS_SERVER_STEALING_H
+
+// Imports
+#include <stdbool.h>		  // bool
+#include <stddef.h>			  // size_t
+#include <stdint.h>			  // uint64_t
+#include <stdio.h>			  // FILE
+#include <tfs/server/deque.h> // TfsServerDeque
+
+/// @brief Statistics of a worker
+/// @details
+/// These are updated atomically, so they may be read by any thread.
+typedef struct TfsServerStealingStats {
+	/// @brief Number of messages taken from it's own deque
+	uint64_t popped;
+
+	/// @brief Number of messages stolen from other workers' deques
+	uint64_t stolen;
+
+	/// @brief Number of messages it couldn't push, as it's deque was full
+	uint64_t overflowed;
+} TfsServerStealingStats;
+
+/// @brief Work-stealing between workers
+typedef struct TfsServerStealing {
+	/// @brief Deque of each worker
+	TfsServerDeque* deques;
+
+	/// @brief Statistics of each worker
+	TfsServerStealingStats* stats;
+
+	/// @brief Number of workers
+	size_t len;
+
+	/// @brief Number of workers that joined
+	size_t joined;
+
+	/// @brief Number of workers currently idle
+	size_t idle;
+
+	/// @brief Eventfd signaled to wake up idle workers
+	int wake_fd;
+} TfsServerStealing;
+
+/// @brief Creates a new work-stealing set
+/// @param workers Number of workers
+/// @param capacity Capacity of each worker's deque, a power of two.
+TfsServerStealing tfs_server_stealing_new(size_t workers, size_t capacity);
+
+/// @brief Destroys a work-stealing set
+/// @details
+/// All messages still queued are simply dropped.
+void tfs_server_stealing_destroy(TfsServerStealing* self);
+
+/// @brief Joins a worker, returning it's index
+/// @details
+/// Must be called once by each worker, before any other function.
+size_t tfs_server_stealing_join(TfsServerStealing* self);
+
+/// @brief Pushes a message to a worker's deque
+/// @param self
+/// @param worker Index of the calling worker
+/// @param item The message
+/// @return If pushed. Fails only if the deque is full, in which case the worker should execute it itself.
+/// @details
+/// Idle workers aren't woken up until #tfs_server_stealing_notify.
+bool tfs_server_stealing_push(TfsServerStealing* self, size_t worker, void* item);
+
+/// @brief Wakes up the idle workers, if any, to steal the messages pushed
+void tfs_server_stealing_notify(TfsServerStealing* self);
+
+/// @brief Takes a message from a worker's deque, or steals one from another's
+/// @param self
+/// @param worker Index of the calling worker
+/// @param[in,out] seed State of the worker's random victim choice, never `0`.
+/// @return The message, or `NULL` if none were found.
+void* tfs_server_stealing_take(TfsServerStealing* self, size_t worker, uint64_t* seed);
+
+/// @brief Waits until @p socket is readable, or until woken up to steal
+/// @details
+/// Returns right away if any deque has messages.
+void tfs_server_stealing_wait(TfsServerStealing* self, int socket);
+
+/// @brief Prints the statistics of all workers to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_server_stealing_stats_print(const TfsServerStealing* self, FILE* out);
+
+#endif
@@ -0,0 +1,165 @@
+#include "uring.h"
+
+// Imports
+#include <string.h>		 // memset
+#include <sys/mman.h>	 // mmap, munmap
+#include <sys/syscall.h> // SYS_io_uring_setup, SYS_io_uring_enter
+#include <unistd.h>		 // syscall, close
+
+void tfs_server_uring_new_error_print(const TfsServerUringNewError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsServerUringNewErrorSetup: {
+			fprintf(out, "Unable to set up io_uring\n");
+			break;
+		}
+		case TfsServerUringNewErrorMap: {
+			fprintf(out, "Unable to map io_uring queues\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+/// @brief Returns a pointer @p offset bytes into a mapping
+static void* ring_field(void* ring, unsigned offset) {
+	return (char*)ring + offset;
+}
+
+TfsServerUringNewResult tfs_server_uring_new(unsigned entries) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	long fd = syscall(SYS_io_uring_setup, entries, &params);
+	if (fd < 0) {
+		return (TfsServerUringNewResult){
+			.success = false,
+			.data.err.kind = TfsServerUringNewErrorSetup,
+		};
+	}
+
+	// Map both queues and the submission entries
+	// Note: Newer kernels share a single mapping for both queues, but mapping them separately still works.
+	TfsServerUring uring = {
+		.fd = (int)fd,
+		.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned),
+		.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe),
+		.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe),
+	};
+	uring.sq_ring = mmap(NULL,
+		uring.sq_ring_size,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		uring.fd,
+		IORING_OFF_SQ_RING);
+	uring.cq_ring = mmap(NULL,
+		uring.cq_ring_size,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		uring.fd,
+		IORING_OFF_CQ_RING);
+	uring.sqes = mmap(
+		NULL, uring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQES);
+	if (uring.sq_ring == MAP_FAILED || uring.cq_ring == MAP_FAILED || uring.sqes == MAP_FAILED) {
+		if (uring.sq_ring != MAP_FAILED) { munmap(uring.sq_ring, uring.sq_ring_size); }
+		if (uring.cq_ring != MAP_FAILED) { munmap(uring.cq_ring, uring.cq_ring_size); }
+		if (uring.sqes != MAP_FAILED) { munmap(uring.sqes, uring.sqes_size); }
+		close(uring.fd);
+		return (TfsServerUringNewResult){
+			.success = false,
+			.data.err.kind = TfsServerUringNewErrorMap,
+		};
+	}
+
+	uring.sq_head = ring_field(uring.sq_ring, params.sq_off.head);
+	uring.sq_tail = ring_field(uring.sq_ring, params.sq_off.tail);
+	uring.sq_array = ring_field(uring.sq_ring, params.sq_off.array);
+	uring.sq_mask = *(unsigned*)ring_field(uring.sq_ring, params.sq_off.ring_mask);
+	uring.sq_entries = params.sq_entries;
+	uring.sq_local_tail = *uring.sq_tail;
+	uring.cq_head = ring_field(uring.cq_ring, params.cq_off.head);
+	uring.cq_tail = ring_field(uring.cq_ring, params.cq_off.tail);
+	uring.cq_mask = *(unsigned*)ring_field(uring.cq_ring, params.cq_off.ring_mask);
+	uring.cqes = ring_field(uring.cq_ring, params.cq_off.cqes);
+
+	return (TfsServerUringNewResult){
+		.success = true,
+		.data.uring = uring,
+	};
+}
+
+void tfs_server_uring_destroy(TfsServerUring* self) {
+	munmap(self->sq_ring, self->sq_ring_size);
+	munmap(self->cq_ring, self->cq_ring_size);
+	munmap(self->sqes, self->sqes_size);
+	close(self->fd);
+}
+
+/// @brief Returns a cleared submission entry, handing all queued ones to the kernel if full
+static struct io_uring_sqe* get_sqe(TfsServerUring* self) {
+	// Note: Without `SQPOLL`, the kernel consumes every entry submitted, so it's never full after submitting.
+	if (self->sq_local_tail - __atomic_load_n(self->sq_head, __ATOMIC_ACQUIRE) == self->sq_entries) {
+		tfs_server_uring_submit(self, 0);
+	}
+
+	unsigned idx = self->sq_local_tail & self->sq_mask;
+	self->sq_array[idx] = idx;
+	self->sq_local_tail++;
+
+	struct io_uring_sqe* sqe = &self->sqes[idx];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	return sqe;
+}
+
+void tfs_server_uring_recvmsg(
+	TfsServerUring* self, int socket, struct msghdr* message, unsigned flags, uint64_t user_data) {
+	struct io_uring_sqe* sqe = get_sqe(self);
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = socket;
+	sqe->addr = (uint64_t)(uintptr_t)message;
+	sqe->len = 1;
+	sqe->msg_flags = flags;
+	sqe->user_data = user_data;
+}
+
+void tfs_server_uring_sendmsg(
+	TfsServerUring* self, int socket, const struct msghdr* message, unsigned flags, uint64_t user_data) {
+	struct io_uring_sqe* sqe = get_sqe(self);
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = socket;
+	sqe->addr = (uint64_t)(uintptr_t)message;
+	sqe->len = 1;
+	sqe->msg_flags = flags;
+	sqe->user_data = user_data;
+}
+
+void tfs_server_uring_write(
+	TfsServerUring* self, int fd, const void* buffer, unsigned len, uint64_t offset, uint64_t user_data) {
+	struct io_uring_sqe* sqe = get_sqe(self);
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buffer;
+	sqe->len = len;
+	sqe->off = offset;
+	sqe->user_data = user_data;
+}
+
+int tfs_server_uring_submit(TfsServerUring* self, unsigned wait_for) {
+	unsigned to_submit = self->sq_local_tail - *self->sq_tail;
+	__atomic_store_n(self->sq_tail, self->sq_local_tail, __ATOMIC_RELEASE);
+
+	long res = syscall(
+		SYS_io_uring_enter, self->fd, to_submit, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	return res < 0 ? -1 : 0;
+}
+
+struct io_uring_cqe* tfs_server_uring_peek_cqe(TfsServerUring* self) {
+	unsigned head = *self->cq_head;
+	if (head == __atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE)) { return NULL; }
+
+	return &self->cqes[head & self->cq_mask];
+}
+
+void tfs_server_uring_cqe_seen(TfsServerUring* self) {
+	__atomic_store_n(self->cq_head, *self->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,159 @@
+/// @file
+/// @brief Minimal io_uring wrapper
+/// @details
+/// This file defines the #TfsServerUring type, a thin wrapper over an
+/// io_uring instance, set up directly with it's syscalls, used by the
+/// server workers to keep several receives posted and to batch all of
+/// their sends and writes into a single `io_uring_enter` call.
+///
+/// Submissions are only queued by #tfs_server_uring_recvmsg and friends, and
+/// handed to the kernel, all at once, by #tfs_server_uring_submit. A ring must
+/// only be used by a single thread.
+
+#ifndef TFS_SERVER_URING_H
+#define TFS_SERVER_URING_H
+
+// Imports
+#include <linux/io_uring.h> // io_uring_sqe, io_uring_cqe
+#include <stdbool.h>		// bool
+#include <stddef.h>			// size_t
+#include <stdint.h>			// uint64_t
+#include <stdio.h>			// FILE
+#include <sys/socket.h>		// msghdr
+
+/// @brief An io_uring instance
+typedef struct TfsServerUring {
+	/// @brief File descriptor of the ring
+	int fd;
+
+	/// @brief Submission queue mapping
+	void* sq_ring;
+
+	/// @brief Size of @ref sq_ring
+	size_t sq_ring_size;
+
+	/// @brief Completion queue mapping
+	void* cq_ring;
+
+	/// @brief Size of @ref cq_ring
+	size_t cq_ring_size;
+
+	/// @brief Submission queue entries
+	struct io_uring_sqe* sqes;
+
+	/// @brief Size of @ref sqes
+	size_t sqes_size;
+
+	/// @brief Submission queue head, advanced by the kernel
+	unsigned* sq_head;
+
+	/// @brief Submission queue tail, advanced by us
+	unsigned* sq_tail;
+
+	/// @brief Submission queue index array
+	unsigned* sq_array;
+
+	/// @brief Mask of submission queue indices
+	unsigned sq_mask;
+
+	/// @brief Number of submission queue entries
+	unsigned sq_entries;
+
+	/// @brief Tail of the entries queued, but not yet handed to the kernel
+	unsigned sq_local_tail;
+
+	/// @brief Completion queue head, advanced by us
+	unsigned* cq_head;
+
+	/// @brief Completion queue tail, advanced by the kernel
+	unsigned* cq_tail;
+
+	/// @brief Mask of completion queue indices
+	unsigned cq_mask;
+
+	/// @brief Completion queue entries
+	struct io_uring_cqe* cqes;
+} TfsServerUring;
+
+/// @brief Error type for #tfs_server_uring_new
+typedef struct TfsServerUringNewError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to set up the ring, such as if io_uring isn't supported
+		TfsServerUringNewErrorSetup,
+
+		/// @brief Unable to map the ring's queues
+		TfsServerUringNewErrorMap,
+	} kind;
+} TfsServerUringNewError;
+
+/// @brief Result type for #tfs_server_uring_new
+typedef struct TfsServerUringNewResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief The ring
+		TfsServerUring uring;
+
+		/// @brief Underlying error
+		TfsServerUringNewError err;
+	} data;
+} TfsServerUringNewResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_server_uring_new_error_print(const TfsServerUringNewError* self, FILE* out);
+
+/// @brief Creates a new ring
+/// @param entries Minimum number of submission queue entries
+TfsServerUringNewResult tfs_server_uring_new(unsigned entries);
+
+/// @brief Destroys a ring
+void tfs_server_uring_destroy(TfsServerUring* self);
+
+/// @brief Queues a `recvmsg` on a socket
+/// @param self
+/// @param socket The socket
+/// @param message The message header. Must outlive the receive.
+/// @param flags Flags to receive with
+/// @param user_data Data returned in the completion
+void tfs_server_uring_recvmsg(
+	TfsServerUring* self, int socket, struct msghdr* message, unsigned flags, uint64_t user_data);
+
+/// @brief Queues a `sendmsg` on a socket
+/// @param self
+/// @param socket The socket
+/// @param message The message header. Must outlive the send.
+/// @param flags Flags to send with
+/// @param user_data Data returned in the completion
+void tfs_server_uring_sendmsg(
+	TfsServerUring* self, int socket, const struct msghdr* message, unsigned flags, uint64_t user_data);
+
+/// @brief Queues a `pwrite` on a file
+/// @param self
+/// @param fd The file
+/// @param buffer Data to write. Must outlive the write.
+/// @param len Length of @p buffer
+/// @param offset Offset to write at
+/// @param user_data Data returned in the completion
+void tfs_server_uring_write(
+	TfsServerUring* self, int fd, const void* buffer, unsigned len, uint64_t offset, uint64_t user_data);
+
+/// @brief Hands all queued entries to the kernel
+/// @param self
+/// @param wait_for Number of completions to wait for
+/// @return `0` on success, or `-1` on error, with `errno` set.
+int tfs_server_uring_submit(TfsServerUring* self, unsigned wait_for);
+
+/// @brief Returns the next completion, if any
+/// @details
+/// The completion must be marked as seen with #tfs_server_uring_cqe_seen.
+struct io_uring_cqe* tfs_server_uring_peek_cqe(TfsServerUring* self);
+
+/// @brief Marks the completion returned by #tfs_server_uring_peek_cqe as seen
+void tfs_server_uring_cqe_seen(TfsServerUring* self);
+
+#endif
@@ -0,0 +1,224 @@
+#include "shm-ring.h"
+
+// Imports
+#include <fcntl.h>		 // fcntl, F_ADD_SEALS, F_GET_SEALS, F_SEAL_*
+#include <linux/futex.h> // FUTEX_WAIT, FUTEX_WAKE
+#include <string.h>		 // memcpy
+#include <sys/mman.h>	 // memfd_create, mmap, munmap
+#include <sys/stat.h>	 // fstat
+#include <sys/syscall.h> // SYS_futex
+#include <time.h>		 // timespec
+#include <unistd.h>		 // syscall, ftruncate, close
+
+/// @brief Magic of all regions
+#define MAGIC 0x74667372u
+
+/// @brief Longest time a side sleeps before checking if the ring was closed, in nanoseconds
+#define MAX_SLEEP_NS 100000000
+
+/// @brief Sleeps while @p word is @p value
+/// @details
+/// Sleeps at most #MAX_SLEEP_NS, and may wake up spuriously.
+static void futex_wait(uint32_t* word, uint32_t value) {
+	struct timespec timeout = {.tv_sec = 0, .tv_nsec = MAX_SLEEP_NS};
+	syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+/// @brief Wakes anyone sleeping on @p word
+static void futex_wake(uint32_t* word) {
+	syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/// @brief Creates both queues of a mapped region
+static TfsShmRing ring_from_region(TfsShmRingRegion* region, int fd) {
+	return (TfsShmRing){
+		.region = region,
+		.fd = fd,
+		.submissions =
+			{
+				.header = &region->submissions,
+				.slots = &region->submission_slots[0][0],
+				.slot_size = sizeof(region->submission_slots[0]),
+				.closed = &region->closed,
+			},
+		.completions =
+			{
+				.header = &region->completions,
+				.slots = &region->completion_slots[0][0],
+				.slot_size = sizeof(region->completion_slots[0]),
+				.closed = &region->closed,
+			},
+	};
+}
+
+/// @brief Returns the slot with index @p idx
+static char* queue_slot(TfsShmRingQueue* self, uint32_t idx) {
+	return self->slots + (idx & (TFS_SHM_RING_SLOTS - 1)) * self->slot_size;
+}
+
+void tfs_shm_ring_map_error_print(const TfsShmRingMapError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsShmRingMapErrorCreate: {
+			fprintf(out, "Unable to create shared region\n");
+			break;
+		}
+		case TfsShmRingMapErrorInvalid: {
+			fprintf(out, "Shared region is invalid\n");
+			break;
+		}
+		case TfsShmRingMapErrorMap: {
+			fprintf(out, "Unable to map shared region\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+TfsShmRingMapResult tfs_shm_ring_create(void) {
+	// Note: `ftruncate` zeroes the region, so both queues start empty.
+	// Note: The size is then sealed, as the other side would be killed by `SIGBUS`
+	//       when touching the region if it were ever shrunk under it.
+	int fd = memfd_create("tfs-shm-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorCreate,
+		};
+	}
+	if (ftruncate(fd, sizeof(TfsShmRingRegion)) < 0 ||
+		fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+		close(fd);
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorCreate,
+		};
+	}
+
+	TfsShmRingRegion* region = mmap(NULL, sizeof(TfsShmRingRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (region == MAP_FAILED) {
+		close(fd);
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorMap,
+		};
+	}
+	region->magic = MAGIC;
+
+	return (TfsShmRingMapResult){
+		.success = true,
+		.data.ring = ring_from_region(region, fd),
+	};
+}
+
+TfsShmRingMapResult tfs_shm_ring_map(int fd) {
+	// Note: Regions that may still be shrunk aren't safe to map, see `tfs_shm_ring_create`.
+	struct stat fd_stat;
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || (seals & F_SEAL_SHRINK) == 0 || fstat(fd, &fd_stat) < 0 ||
+		(size_t)fd_stat.st_size != sizeof(TfsShmRingRegion)) {
+		close(fd);
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorInvalid,
+		};
+	}
+
+	TfsShmRingRegion* region = mmap(NULL, sizeof(TfsShmRingRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (region == MAP_FAILED) {
+		close(fd);
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorMap,
+		};
+	}
+	if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != MAGIC) {
+		munmap(region, sizeof(TfsShmRingRegion));
+		close(fd);
+		return (TfsShmRingMapResult){
+			.success = false,
+			.data.err.kind = TfsShmRingMapErrorInvalid,
+		};
+	}
+
+	return (TfsShmRingMapResult){
+		.success = true,
+		.data.ring = ring_from_region(region, fd),
+	};
+}
+
+void tfs_shm_ring_unmap(TfsShmRing* self) {
+	munmap(self->region, sizeof(TfsShmRingRegion));
+	close(self->fd);
+}
+
+void tfs_shm_ring_close(TfsShmRing* self) {
+	__atomic_store_n(&self->region->closed, 1, __ATOMIC_SEQ_CST);
+	futex_wake(&self->region->submissions.head);
+	futex_wake(&self->region->submissions.tail);
+	futex_wake(&self->region->completions.head);
+	futex_wake(&self->region->completions.tail);
+}
+
+bool tfs_shm_ring_is_closed(const TfsShmRing* self) {
+	return __atomic_load_n(&self->region->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+char* tfs_shm_ring_queue_reserve(TfsShmRingQueue* self, bool wait) {
+	TfsShmRingQueueHeader* header = self->header;
+	uint32_t tail = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+	while (1) {
+		if (__atomic_load_n(self->closed, __ATOMIC_ACQUIRE) != 0) { return NULL; }
+
+		uint32_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+		if (tail - head < TFS_SHM_RING_SLOTS) { return queue_slot(self, tail) + sizeof(uint32_t); }
+		if (!wait) { return NULL; }
+
+		// Announce we're sleeping, then make sure the consumer didn't release a slot meanwhile
+		// Note: The consumer advances `head` before checking if we're waiting, so one of us always sees the other.
+		__atomic_store_n(&header->producer_waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) != head) { continue; }
+		futex_wait(&header->head, head);
+	}
+}
+
+void tfs_shm_ring_queue_commit(TfsShmRingQueue* self, size_t len) {
+	TfsShmRingQueueHeader* header = self->header;
+	uint32_t tail = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+	uint32_t slot_len = (uint32_t)len;
+	memcpy(queue_slot(self, tail), &slot_len, sizeof(uint32_t));
+
+	__atomic_store_n(&header->tail, tail + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&header->consumer_waiting, 0, __ATOMIC_SEQ_CST) != 0) { futex_wake(&header->tail); }
+}
+
+char* tfs_shm_ring_queue_peek(TfsShmRingQueue* self, bool wait, size_t* len) {
+	TfsShmRingQueueHeader* header = self->header;
+	uint32_t head = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+	while (1) {
+		uint32_t tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+		if (tail != head) {
+			char* slot = queue_slot(self, head);
+			uint32_t slot_len;
+			memcpy(&slot_len, slot, sizeof(uint32_t));
+			*len = slot_len;
+			return slot + sizeof(uint32_t);
+		}
+		if (!wait || __atomic_load_n(self->closed, __ATOMIC_ACQUIRE) != 0) { return NULL; }
+
+		// Announce we're sleeping, then make sure the producer didn't commit a slot meanwhile
+		// Note: The producer advances `tail` before checking if we're waiting, so one of us always sees the other.
+		__atomic_store_n(&header->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->tail, __ATOMIC_SEQ_CST) != head) { continue; }
+		futex_wait(&header->tail, head);
+	}
+}
+
+void tfs_shm_ring_queue_release(TfsShmRingQueue* self) {
+	TfsShmRingQueueHeader* header = self->header;
+	uint32_t head = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&header->head, head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&header->producer_waiting, 0, __ATOMIC_SEQ_CST) != 0) { futex_wake(&header->head); }
+}
@@ -0,0 +1,204 @@
+/// @file
+/// @brief Shared-memory ring transport
+/// @details
+/// This file defines the #TfsShmRing type, a transport between a client and
+/// the server on the same host, that exchanges messages through a memfd-backed
+/// shared-memory region instead of the server socket.
+///
+/// The region holds two single-producer single-consumer queues, one of
+/// submissions, from the client to the server, and one of completions, from
+/// the server to the client. Each queue is a ring of fixed-size slots, whose
+/// head and tail are only ever advanced by the consumer and producer,
+/// respectively, so neither side needs a lock.
+///
+/// Each side only sleeps, on a futex over the index it's waiting on, once it
+/// runs out of work, after announcing so, and the other side only makes a
+/// syscall to wake it if it announced it's sleeping. Sleeps are bounded, so
+/// a side waiting on a peer that closed the ring always notices it.
+///
+/// The client creates the region, and passes it's file descriptor to the
+/// server over the server socket, in an attach request.
+
+#ifndef TFS_SHM_RING_H
+#define TFS_SHM_RING_H
+
+// Imports
+#include <stdbool.h>	  // bool
+#include <stddef.h>		  // size_t
+#include <stdint.h>		  // uint32_t
+#include <stdio.h>		  // FILE
+#include <tfs/protocol.h> // TFS_PROTOCOL_*
+
+/// @brief Number of slots in each queue
+/// @details
+/// Must be a power of two.
+#define TFS_SHM_RING_SLOTS 64
+
+/// @brief Capacity of each submission slot
+/// @details
+/// Submissions have space for a nul terminator after the longest message.
+#define TFS_SHM_RING_SUBMISSION_CAPACITY (TFS_PROTOCOL_MAX_MESSAGE_LEN + 1)
+
+/// @brief Capacity of each completion slot
+#define TFS_SHM_RING_COMPLETION_CAPACITY (TFS_PROTOCOL_HEADER_LEN + TFS_PROTOCOL_MAX_BATCH_LEN)
+
+/// @brief Size of a cache line, to keep each side's indices apart
+#define TFS_SHM_RING_CACHE_LINE 64
+
+/// @brief Shared header of a queue
+typedef struct TfsShmRingQueueHeader {
+	/// @brief Index of the next slot to consume, only advanced by the consumer
+	uint32_t head;
+
+	/// @brief If the producer is sleeping on @ref head
+	uint32_t producer_waiting;
+
+	/// @brief Padding between both sides
+	char head_padding[TFS_SHM_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+	/// @brief Index of the next slot to produce, only advanced by the producer
+	uint32_t tail;
+
+	/// @brief If the consumer is sleeping on @ref tail
+	uint32_t consumer_waiting;
+
+	/// @brief Padding after the tail
+	char tail_padding[TFS_SHM_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+} TfsShmRingQueueHeader;
+
+/// @brief The shared region
+typedef struct TfsShmRingRegion {
+	/// @brief Magic, to check the region was set up by a client
+	uint32_t magic;
+
+	/// @brief If either side closed the ring
+	uint32_t closed;
+
+	/// @brief Padding after the shared state
+	char padding[TFS_SHM_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+	/// @brief Submissions queue
+	TfsShmRingQueueHeader submissions;
+
+	/// @brief Completions queue
+	TfsShmRingQueueHeader completions;
+
+	/// @brief Length, followed by the contents, of each submission
+	char submission_slots[TFS_SHM_RING_SLOTS][sizeof(uint32_t) + TFS_SHM_RING_SUBMISSION_CAPACITY];
+
+	/// @brief Length, followed by the contents, of each completion
+	char completion_slots[TFS_SHM_RING_SLOTS][sizeof(uint32_t) + TFS_SHM_RING_COMPLETION_CAPACITY];
+} TfsShmRingRegion;
+
+/// @brief One side of a queue
+typedef struct TfsShmRingQueue {
+	/// @brief Shared header
+	TfsShmRingQueueHeader* header;
+
+	/// @brief All slots
+	char* slots;
+
+	/// @brief Size of each slot, including it's length
+	size_t slot_size;
+
+	/// @brief The ring's closed flag
+	uint32_t* closed;
+} TfsShmRingQueue;
+
+/// @brief A mapped ring
+typedef struct TfsShmRing {
+	/// @brief The shared region
+	TfsShmRingRegion* region;
+
+	/// @brief File descriptor of the region
+	int fd;
+
+	/// @brief Submissions queue
+	TfsShmRingQueue submissions;
+
+	/// @brief Completions queue
+	TfsShmRingQueue completions;
+} TfsShmRing;
+
+/// @brief Error type for #tfs_shm_ring_create and #tfs_shm_ring_map
+typedef struct TfsShmRingMapError {
+	/// @brief Error kind
+	enum {
+		/// @brief Unable to create the region
+		TfsShmRingMapErrorCreate,
+
+		/// @brief Region has the wrong size or magic, or may be shrunk
+		TfsShmRingMapErrorInvalid,
+
+		/// @brief Unable to map the region
+		TfsShmRingMapErrorMap,
+	} kind;
+} TfsShmRingMapError;
+
+/// @brief Result type for #tfs_shm_ring_create and #tfs_shm_ring_map
+typedef struct TfsShmRingMapResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief The ring
+		TfsShmRing ring;
+
+		/// @brief Underlying error
+		TfsShmRingMapError err;
+	} data;
+} TfsShmRingMapResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_shm_ring_map_error_print(const TfsShmRingMapError* self, FILE* out);
+
+/// @brief Creates a new ring, backed by a new memfd
+/// @details
+/// The memfd is sealed, so that it's size may never change.
+TfsShmRingMapResult tfs_shm_ring_create(void);
+
+/// @brief Maps a ring created by #tfs_shm_ring_create
+/// @param fd File descriptor of the region. It is owned by the ring afterwards.
+/// @details
+/// Regions not sealed against shrinking are rejected, as whoever
+/// sent them could otherwise shrink them while they're mapped.
+TfsShmRingMapResult tfs_shm_ring_map(int fd);
+
+/// @brief Unmaps a ring
+/// @details
+/// The ring should be closed first, with #tfs_shm_ring_close.
+void tfs_shm_ring_unmap(TfsShmRing* self);
+
+/// @brief Closes a ring, waking the other side
+void tfs_shm_ring_close(TfsShmRing* self);
+
+/// @brief Checks if either side closed the ring
+bool tfs_shm_ring_is_closed(const TfsShmRing* self);
+
+/// @brief Reserves the next slot to produce
+/// @param self
+/// @param wait If the queue is full, whether to wait for a free slot
+/// @return The slot's contents, or `NULL` if the queue is full, when not waiting, or closed.
+/// @details
+/// The slot is only made visible to the consumer by #tfs_shm_ring_queue_commit.
+char* tfs_shm_ring_queue_reserve(TfsShmRingQueue* self, bool wait);
+
+/// @brief Commits the reserved slot, waking the consumer, if sleeping
+/// @param self
+/// @param len Length of the contents written to the slot
+void tfs_shm_ring_queue_commit(TfsShmRingQueue* self, size_t len);
+
+/// @brief Returns the next slot to consume
+/// @param self
+/// @param wait If the queue is empty, whether to wait for a slot
+/// @param[out] len Length of the slot's contents
+/// @return The slot's contents, or `NULL` if the queue is empty, when not waiting, or closed.
+char* tfs_shm_ring_queue_peek(TfsShmRingQueue* self, bool wait, size_t* len);
+
+/// @brief Releases the slot returned by #tfs_shm_ring_queue_peek, waking the producer, if sleeping
+void tfs_shm_ring_queue_release(TfsShmRingQueue* self);
+
+#endif
@@ -0,0 +1,25 @@
+#include "file.h"
+
+// Imports
+#include <stdlib.h>	// mkstemp
+#include <unistd.h>	// write, close, unlink
+
+int tfs_test_temp_file(const char* contents, size_t contents_len) {
+	char path[] = "/tmp/tfs-test-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd == -1) { return -1; }
+	unlink(path);
+
+	// Note: Writes may be short, so we keep writing until everything is.
+	size_t written = 0;
+	while (written < contents_len) {
+		ssize_t write_len = write(fd, contents + written, contents_len - written);
+		if (write_len <= 0) {
+			close(fd);
+			return -1;
+		}
+		written += (size_t)write_len;
+	}
+
+	return fd;
+}
@@ -0,0 +1,21 @@
+/// @file
+/// @brief Testing files
+/// @details
+/// This file provides temporary files for the tests
+/// that read their input from a file descriptor.
+
+#ifndef TFS_TEST_FILE_H
+#define TFS_TEST_FILE_H
+
+// Imports
+#include <stddef.h>	// size_t
+
+/// @brief Writes @p contents to a new temporary file
+/// @param contents Contents to write
+/// @param contents_len Length of @p contents
+/// @return The file descriptor of the file, positioned at it's end, or `-1` if unable to.
+/// @details
+/// The file is unlinked right away, so it's removed once the descriptor is closed.
+int tfs_test_temp_file(const char* contents, size_t contents_len);
+
+#endif
@@ -0,0 +1,406 @@
+#include "trace.h"
+
+// Imports
+#include <inttypes.h>	  // PRIu64
+#include <pthread.h>	  // pthread_create, pthread_join
+#include <stdlib.h>		  // malloc, free, exit, EXIT_FAILURE
+#include <sys/syscall.h>  // SYS_gettid
+#include <sys/types.h>	  // pid_t
+#include <tfs/cond_var.h> // TfsCondVar
+#include <tfs/mutex.h>	  // TfsMutex
+#include <unistd.h>		  // getpid, syscall
+
+/// @brief Number of events stored in each thread's buffer before it's handed off to the writer.
+#define TFS_TRACE_BUFFER_CAPACITY 4096
+
+/// @brief Interval, in milliseconds, at which the writer collects partially filled buffers.
+#define TFS_TRACE_FLUSH_INTERVAL_MS 500
+
+bool tfs_trace_global_enabled = false;
+
+/// @brief A recorded event
+typedef struct TfsTraceEvent {
+	/// @brief Name of the event
+	const char* name;
+
+	/// @brief Name of the argument, if any
+	const char* arg_name;
+
+	/// @brief Value of the argument
+	size_t arg;
+
+	/// @brief Start time, in nanoseconds
+	uint64_t start_ns;
+
+	/// @brief End time, in nanoseconds
+	uint64_t end_ns;
+} TfsTraceEvent;
+
+/// @brief A chunk of events waiting to be written
+typedef struct TfsTraceChunk {
+	/// @brief All events
+	TfsTraceEvent* events;
+
+	/// @brief Number of events
+	size_t len;
+
+	/// @brief Thread that recorded these events
+	pid_t tid;
+
+	/// @brief Next chunk in the queue
+	struct TfsTraceChunk* next;
+} TfsTraceChunk;
+
+/// @brief A thread's event buffer
+typedef struct TfsTraceThreadBuffer {
+	/// @brief Lock for this buffer
+	/// @details
+	/// Only contended by the writer when it collects
+	/// partially filled buffers.
+	TfsMutex lock;
+
+	/// @brief Thread id of the owner
+	pid_t tid;
+
+	/// @brief All events
+	TfsTraceEvent* events;
+
+	/// @brief Number of events
+	size_t len;
+
+	/// @brief Next buffer in the registry
+	struct TfsTraceThreadBuffer* next;
+} TfsTraceThreadBuffer;
+
+/// @brief Global tracer state
+static struct {
+	/// @brief If the tracer is open
+	bool open;
+
+	/// @brief Number of times the tracer has been opened
+	/// @details
+	/// Thread buffers are freed when the tracer is closed, so a
+	/// thread's buffer is only used if created since the last open.
+	size_t generation;
+
+	/// @brief Output file
+	FILE* out;
+
+	/// @brief Our process id
+	pid_t pid;
+
+	/// @brief Writer thread
+	pthread_t writer;
+
+	/// @brief If the writer should stop
+	bool stop;
+
+	/// @brief Lock for all fields below
+	TfsMutex lock;
+
+	/// @brief Cond var signaled when a chunk is queued or the writer should stop
+	TfsCondVar cond;
+
+	/// @brief First chunk queued for writing
+	TfsTraceChunk* chunks_head;
+
+	/// @brief Last chunk queued for writing
+	TfsTraceChunk* chunks_tail;
+
+	/// @brief All thread buffers
+	TfsTraceThreadBuffer* buffers;
+} tracer = {
+	.open = false,
+	.generation = 0,
+	.lock = {.mutex = PTHREAD_MUTEX_INITIALIZER},
+	.cond = {.cond = PTHREAD_COND_INITIALIZER},
+};
+
+/// @brief This thread's buffer
+static __thread TfsTraceThreadBuffer* thread_buffer = NULL;
+
+/// @brief Generation of the tracer #thread_buffer was created in
+static __thread size_t thread_buffer_generation = 0;
+
+/// @brief Allocates storage for a buffer's events
+static TfsTraceEvent* tfs_trace_alloc_events(void) {
+	TfsTraceEvent* events = malloc(TFS_TRACE_BUFFER_CAPACITY * sizeof(TfsTraceEvent));
+	if (events == NULL) {
+		fprintf(stderr, "Unable to allocate trace buffer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return events;
+}
+
+/// @brief Returns this thread's buffer, creating and registering it if it doesn't exist
+static TfsTraceThreadBuffer* tfs_trace_thread_buffer(void) {
+	// Note: A buffer from a previous open was freed when the tracer was closed, so we create a new one.
+	size_t generation = __atomic_load_n(&tracer.generation, __ATOMIC_ACQUIRE);
+	if (thread_buffer != NULL && thread_buffer_generation == generation) { return thread_buffer; }
+
+	TfsTraceThreadBuffer* buffer = malloc(sizeof(TfsTraceThreadBuffer));
+	if (buffer == NULL) {
+		fprintf(stderr, "Unable to allocate trace buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	*buffer = (TfsTraceThreadBuffer){
+		.lock = tfs_mutex_new(),
+		.tid = (pid_t)syscall(SYS_gettid),
+		.events = tfs_trace_alloc_events(),
+		.len = 0,
+	};
+
+	// Add it to the registry
+	tfs_mutex_lock(&tracer.lock);
+	buffer->next = tracer.buffers;
+	tracer.buffers = buffer;
+	tfs_mutex_unlock(&tracer.lock);
+
+	thread_buffer = buffer;
+	thread_buffer_generation = generation;
+	return buffer;
+}
+
+/// @brief Takes all events out of a buffer into a chunk.
+/// @param buffer The buffer to take from. _Must_ be locked and non-empty.
+static TfsTraceChunk* tfs_trace_take_chunk(TfsTraceThreadBuffer* buffer) {
+	TfsTraceChunk* chunk = malloc(sizeof(TfsTraceChunk));
+	if (chunk == NULL) {
+		fprintf(stderr, "Unable to allocate trace chunk\n");
+		exit(EXIT_FAILURE);
+	}
+	*chunk = (TfsTraceChunk){
+		.events = buffer->events,
+		.len = buffer->len,
+		.tid = buffer->tid,
+		.next = NULL,
+	};
+
+	buffer->events = tfs_trace_alloc_events();
+	buffer->len = 0;
+
+	return chunk;
+}
+
+/// @brief Queues a chunk for writing.
+/// @param chunk The chunk to queue.
+/// @details
+/// The tracer lock must _not_ be held.
+static void tfs_trace_push_chunk(TfsTraceChunk* chunk) {
+	tfs_mutex_lock(&tracer.lock);
+	if (tracer.chunks_tail == NULL) { tracer.chunks_head = chunk; }
+	else {
+		tracer.chunks_tail->next = chunk;
+	}
+	tracer.chunks_tail = chunk;
+	tfs_cond_var_signal(&tracer.cond);
+	tfs_mutex_unlock(&tracer.lock);
+}
+
+/// @brief Moves all partially filled buffers into the chunk queue
+/// @details
+/// The tracer lock _must_ be held.
+static void tfs_trace_collect_buffers(void) {
+	for (TfsTraceThreadBuffer* buffer = tracer.buffers; buffer != NULL; buffer = buffer->next) {
+		tfs_mutex_lock(&buffer->lock);
+		TfsTraceChunk* chunk = buffer->len != 0 ? tfs_trace_take_chunk(buffer) : NULL;
+		tfs_mutex_unlock(&buffer->lock);
+		if (chunk == NULL) { continue; }
+
+		if (tracer.chunks_tail == NULL) { tracer.chunks_head = chunk; }
+		else {
+			tracer.chunks_tail->next = chunk;
+		}
+		tracer.chunks_tail = chunk;
+	}
+}
+
+/// @brief Writes all chunks in a list and frees them
+/// @param chunk The first chunk of the list.
+static void tfs_trace_write_chunks(TfsTraceChunk* chunk) {
+	while (chunk != NULL) {
+		for (size_t n = 0; n < chunk->len; n++) {
+			const TfsTraceEvent* event = &chunk->events[n];
+			uint64_t dur_ns = event->end_ns - event->start_ns;
+
+			// Note: Timestamps are in microseconds, so we print the nanoseconds as the fractional part.
+			fprintf(tracer.out,
+				"{\"name\":\"%s\",\"cat\":\"tfs\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+				"\"ts\":%" PRIu64 ".%03" PRIu64 ",\"dur\":%" PRIu64 ".%03" PRIu64,
+				event->name,
+				tracer.pid,
+				chunk->tid,
+				event->start_ns / 1000,
+				event->start_ns % 1000,
+				dur_ns / 1000,
+				dur_ns % 1000);
+			if (event->arg_name != NULL) { fprintf(tracer.out, ",\"args\":{\"%s\":%zu}", event->arg_name, event->arg); }
+			fprintf(tracer.out, "},\n");
+		}
+
+		TfsTraceChunk* next = chunk->next;
+		free(chunk->events);
+		free(chunk);
+		chunk = next;
+	}
+
+	fflush(tracer.out);
+}
+
+/// @brief Writer thread, writing queued chunks to the output file.
+static void* tfs_trace_writer_fn(void* arg) {
+	(void)arg;
+
+	tfs_mutex_lock(&tracer.lock);
+	while (!tracer.stop) {
+		// Wait until we get a chunk, or until it's time to collect partial buffers.
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += TFS_TRACE_FLUSH_INTERVAL_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		bool timed_out = false;
+		while (tracer.chunks_head == NULL && !tracer.stop && !timed_out) {
+			timed_out = !tfs_cond_var_timed_wait(&tracer.cond, &tracer.lock, &deadline);
+		}
+		if (timed_out) { tfs_trace_collect_buffers(); }
+
+		// Take all chunks and write them without holding the lock
+		TfsTraceChunk* chunks = tracer.chunks_head;
+		tracer.chunks_head = NULL;
+		tracer.chunks_tail = NULL;
+		tfs_mutex_unlock(&tracer.lock);
+		tfs_trace_write_chunks(chunks);
+		tfs_mutex_lock(&tracer.lock);
+	}
+	tfs_mutex_unlock(&tracer.lock);
+
+	return NULL;
+}
+
+void tfs_trace_open_error_print(const TfsTraceOpenError* self, FILE* out) {
+	switch (self->kind) {
+		case TfsTraceOpenErrorAlreadyOpen: {
+			fprintf(out, "Tracer is already open\n");
+			break;
+		}
+		case TfsTraceOpenErrorOpenFile: {
+			fprintf(out, "Unable to open trace file\n");
+			break;
+		}
+		case TfsTraceOpenErrorSpawnWriter: {
+			fprintf(out, "Unable to spawn trace writer thread\n");
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+TfsTraceOpenResult tfs_trace_open(const char* file_name, bool enabled) {
+	if (__atomic_load_n(&tracer.open, __ATOMIC_ACQUIRE)) {
+		return (TfsTraceOpenResult){
+			.success = false,
+			.data.err.kind = TfsTraceOpenErrorAlreadyOpen,
+		};
+	}
+
+	FILE* out = fopen(file_name, "w");
+	if (out == NULL) {
+		return (TfsTraceOpenResult){
+			.success = false,
+			.data.err.kind = TfsTraceOpenErrorOpenFile,
+		};
+	}
+
+	// Note: We use the JSON array format, which allows
+	//       readers to load a trace that was never closed.
+	fprintf(out, "[\n");
+	tracer.out = out;
+	tracer.pid = getpid();
+	tracer.stop = false;
+
+	if (pthread_create(&tracer.writer, NULL, tfs_trace_writer_fn, NULL) != 0) {
+		fclose(out);
+		return (TfsTraceOpenResult){
+			.success = false,
+			.data.err.kind = TfsTraceOpenErrorSpawnWriter,
+		};
+	}
+
+	__atomic_add_fetch(&tracer.generation, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&tracer.open, true, __ATOMIC_RELEASE);
+	__atomic_store_n(&tfs_trace_global_enabled, enabled, __ATOMIC_RELAXED);
+
+	return (TfsTraceOpenResult){.success = true};
+}
+
+void tfs_trace_close(void) {
+	if (!__atomic_load_n(&tracer.open, __ATOMIC_ACQUIRE)) { return; }
+	__atomic_store_n(&tfs_trace_global_enabled, false, __ATOMIC_RELAXED);
+
+	// Stop the writer
+	tfs_mutex_lock(&tracer.lock);
+	tracer.stop = true;
+	tfs_cond_var_signal(&tracer.cond);
+	tfs_mutex_unlock(&tracer.lock);
+	pthread_join(tracer.writer, NULL);
+
+	// Then write everything that's left ourselves
+	tfs_mutex_lock(&tracer.lock);
+	tfs_trace_collect_buffers();
+	TfsTraceChunk* chunks = tracer.chunks_head;
+	tracer.chunks_head = NULL;
+	tracer.chunks_tail = NULL;
+	tfs_trace_write_chunks(chunks);
+
+	// Note: The metadata event is last so the output is valid json without any trailing commas.
+	fprintf(tracer.out,
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"tecnicofs\"}}\n]\n",
+		tracer.pid);
+	fclose(tracer.out);
+	tracer.out = NULL;
+
+	// Free all buffers
+	while (tracer.buffers != NULL) {
+		TfsTraceThreadBuffer* next = tracer.buffers->next;
+		tfs_mutex_destroy(&tracer.buffers->lock);
+		free(tracer.buffers->events);
+		free(tracer.buffers);
+		tracer.buffers = next;
+	}
+	thread_buffer = NULL;
+
+	__atomic_store_n(&tracer.open, false, __ATOMIC_RELEASE);
+	tfs_mutex_unlock(&tracer.lock);
+}
+
+void tfs_trace_set_enabled(bool enabled) {
+	if (!__atomic_load_n(&tracer.open, __ATOMIC_ACQUIRE)) { return; }
+
+	__atomic_store_n(&tfs_trace_global_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+void tfs_trace_record(const char* name, uint64_t start_ns, const char* arg_name, size_t arg) {
+	uint64_t end_ns = tfs_trace_now();
+	if (!__atomic_load_n(&tracer.open, __ATOMIC_ACQUIRE)) { return; }
+
+	TfsTraceThreadBuffer* buffer = tfs_trace_thread_buffer();
+	tfs_mutex_lock(&buffer->lock);
+	buffer->events[buffer->len] = (TfsTraceEvent){
+		.name = name,
+		.arg_name = arg_name,
+		.arg = arg,
+		.start_ns = start_ns,
+		.end_ns = end_ns,
+	};
+	buffer->len++;
+
+	// If we're full, hand the events off to the writer
+	TfsTraceChunk* chunk = buffer->len == TFS_TRACE_BUFFER_CAPACITY ? tfs_trace_take_chunk(buffer) : NULL;
+	tfs_mutex_unlock(&buffer->lock);
+	if (chunk != NULL) { tfs_trace_push_chunk(chunk); }
+}
@@ -0,0 +1,141 @@
+/// @file
+/// @brief Request tracing
+/// @details
+/// This file defines a process-wide tracer that records spans
+/// in the Chrome trace-event format, which can be opened by
+/// `chrome://tracing` or Perfetto.
+///
+/// Each thread buffers it's own events and hands them off to a
+/// background writer thread, so recording a span never touches
+/// the output file. While tracing is disabled, recording a span
+/// costs a single branch.
+
+#ifndef TFS_TRACE_H
+#define TFS_TRACE_H
+
+// Imports
+#include <stdbool.h> // bool
+#include <stddef.h>	 // size_t
+#include <stdint.h>	 // uint64_t
+#include <stdio.h>	 // FILE
+#include <time.h>	 // clock_gettime
+
+/// @brief If the tracer is currently recording.
+/// @warning Use #tfs_trace_is_enabled and #tfs_trace_set_enabled instead of accessing this directly.
+extern bool tfs_trace_global_enabled;
+
+/// @brief A span being recorded
+/// @details
+/// Returned by #tfs_trace_begin and consumed by
+/// #tfs_trace_end or #tfs_trace_end_arg.
+typedef struct TfsTraceSpan {
+	/// @brief Start time of the span, in nanoseconds.
+	/// @details
+	/// If `0`, the tracer was disabled when the span started
+	/// and it will not be recorded.
+	uint64_t start_ns;
+} TfsTraceSpan;
+
+/// @brief Error type for #tfs_trace_open
+typedef struct TfsTraceOpenError {
+	/// @brief Error kind
+	enum {
+		/// @brief The tracer was already open
+		TfsTraceOpenErrorAlreadyOpen,
+
+		/// @brief Unable to open the output file
+		TfsTraceOpenErrorOpenFile,
+
+		/// @brief Unable to spawn the writer thread
+		TfsTraceOpenErrorSpawnWriter,
+	} kind;
+} TfsTraceOpenError;
+
+/// @brief Result type for #tfs_trace_open
+typedef struct TfsTraceOpenResult {
+	/// @brief If successful
+	bool success;
+
+	/// @brief Result data
+	union {
+		/// @brief Underlying error
+		TfsTraceOpenError err;
+	} data;
+} TfsTraceOpenResult;
+
+/// @brief Prints a textual representation of @p self to @p out
+/// @param self
+/// @param out File to output to.
+void tfs_trace_open_error_print(const TfsTraceOpenError* self, FILE* out);
+
+/// @brief Opens the tracer, writing all events to @p file_name
+/// @param file_name The file to write the trace to.
+/// @param enabled If the tracer should start out enabled.
+/// @details
+/// The tracer may only be open once at a time, but may be
+/// opened again after being closed.
+TfsTraceOpenResult tfs_trace_open(const char* file_name, bool enabled);
+
+/// @brief Closes the tracer
+/// @details
+/// Disables the tracer, writes all buffered events and closes
+/// the output file. Must only be called once no other thread
+/// is recording spans.
+void tfs_trace_close(void);
+
+/// @brief Enables or disables the tracer
+/// @details
+/// Has no effect if the tracer isn't open.
+/// This function is async-signal-safe.
+void tfs_trace_set_enabled(bool enabled);
+
+/// @brief Returns the current monotonic time in nanoseconds
+inline static uint64_t tfs_trace_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/// @brief Returns if the tracer is currently recording
+inline static bool tfs_trace_is_enabled(void) {
+	return __atomic_load_n(&tfs_trace_global_enabled, __ATOMIC_RELAXED);
+}
+
+/// @brief Records a finished span into the current thread's buffer
+/// @param name Name of the span. Must be a string with static lifetime.
+/// @param start_ns Start time of the span, from #tfs_trace_now
+/// @param arg_name Name of the span's argument, or `NULL` if it has none. Must have static lifetime.
+/// @param arg Value of the span's argument.
+/// @details
+/// Prefer #tfs_trace_end and #tfs_trace_end_arg, which skip
+/// this call if the span wasn't started while enabled.
+void tfs_trace_record(const char* name, uint64_t start_ns, const char* arg_name, size_t arg);
+
+/// @brief Starts a span
+inline static TfsTraceSpan tfs_trace_begin(void) {
+	if (!tfs_trace_is_enabled()) { return (TfsTraceSpan){.start_ns = 0}; }
+
+	return (TfsTraceSpan){.start_ns = tfs_trace_now()};
+}
+
+/// @brief Ends a span, recording it as @p name
+/// @param span The span to end
+/// @param name Name of the span. Must be a string with static lifetime.
+inline static void tfs_trace_end(TfsTraceSpan span, const char* name) {
+	if (span.start_ns == 0) { return; }
+
+	tfs_trace_record(name, span.start_ns, NULL, 0);
+}
+
+/// @brief Ends a span, recording it as @p name with an argument
+/// @param span The span to end
+/// @param name Name of the span. Must be a string with static lifetime.
+/// @param arg_name Name of the argument. Must be a string with static lifetime.
+/// @param arg Value of the argument.
+inline static void tfs_trace_end_arg(TfsTraceSpan span, const char* name, const char* arg_name, size_t arg) {
+	if (span.start_ns == 0) { return; }
+
+	tfs_trace_record(name, span.start_ns, arg_name, arg);
+}
+
+#endif
@@ -10,8 +10,16 @@
 // Includes
 #include <assert.h>	 // assert
 #include <stdbool.h> // bool
+#include <stdint.h>	 // uint32_t, uint64_t, UINT32_MAX
 #include <stdlib.h>	 // size_t
-#include <string.h>	 // strncmp
+#include <string.h>	 // strncmp, memset
+#include <time.h>	 // clock_gettime, clockid_t
+
+/// @brief Initial hash of #tfs_hash_bytes
+#define TFS_HASH_SEED 0xcbf29ce484222325u
+
+/// @brief Empty bucket of an open-addressed table of indices, see #tfs_buckets_clear
+#define TFS_BUCKET_EMPTY UINT32_MAX
 
 /// @brief Returns the minimum value between `lhs` and `rhs`
 inline static size_t tfs_min_size_t(size_t lhs, size_t rhs) {
@@ -42,4 +50,41 @@ inline static int tfs_str_cmp(const char* lhs, size_t lhs_len, const char* rhs,
 	return strncmp(lhs, rhs, lhs_len);
 }
 
+/// @brief Returns the current time of @p clock, in nanoseconds
+inline static uint64_t tfs_now_ns(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/// @brief Hashes @p len bytes of @p data, starting from @p seed
+/// @details
+/// Uses the FNV-1a hash. The seed should be #TFS_HASH_SEED, possibly mixed with some other value to hash along.
+inline static uint64_t tfs_hash_bytes(uint64_t seed, const void* data, size_t len) {
+	const unsigned char* bytes = data;
+	uint64_t hash = seed;
+	for (size_t n = 0; n < len; n++) {
+		hash ^= bytes[n];
+		hash *= 0x100000001b3u;
+	}
+
+	return hash;
+}
+
+/// @brief Empties all buckets of an open-addressed table of indices
+inline static void tfs_buckets_clear(uint32_t* buckets, size_t buckets_len) {
+	// Note: Every byte of `TFS_BUCKET_EMPTY` is `0xff`.
+	memset(buckets, 0xff, buckets_len * sizeof(uint32_t));
+}
+
+/// @brief Returns the first empty bucket from the one of @p hash onwards, probing linearly
+/// @details
+/// At least one bucket must be empty.
+inline static size_t tfs_buckets_find_empty(const uint32_t* buckets, size_t buckets_len, uint64_t hash) {
+	size_t bucket = (size_t)(hash % buckets_len);
+	while (buckets[bucket] != TFS_BUCKET_EMPTY) { bucket = (bucket + 1) % buckets_len; }
+
+	return bucket;
+}
+
 #endif